@@ -7,10 +7,20 @@
 #include <viewer/opengl/shaderprogram.h>
 #include <viewer/opengl/texture.h>
 #include <viewer/opengl/framebuffer.h>
+#include <viewer/opengl/buffer.h>
+#include <viewer/opengl/query.h>
+#include <viewer/core/parallel.h>
+#include <viewer/core/time.h>
 
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtx/euler_angles.hpp>
+#include <glm/gtc/matrix_access.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <random>
 
 
 struct material
@@ -37,14 +47,142 @@ struct opengl::layout<vertex>
 };
 
 /* Deferred Rendering Control */
+enum class spot_light_path : int { volumes = 0, volumes_instanced = 1, clustered_gpu = 2, clustered_cpu = 3 };
+enum class gbuffer_layout : int { full = 0, compact = 1, compact_rg8 = 2 };
+enum class geometry_path : int { gbuffer = 0, visibility = 1 };
+
 struct deferred_rendering
 {
     bool dir_light_pass = true;
     bool spot_light_pass = true;
     bool light_volume_debug = false;
     float distance_scale = 0.03f;
+
+    /* one light volume draw per spot light, all volumes in one instanced draw, or one full screen pass over per
+       cluster light lists */
+    spot_light_path light_path = spot_light_path::clustered_gpu;
+    bool cluster_heatmap = false;
+    int num_lights = 16;
+
+    /* gpu times of the spot light pass (per path, the query remembers the path it timed) and the light culling, cpu
+       time of the cpu culling and of submitting the pass */
+    std::array<double, 4> light_ms{};
+    spot_light_path light_query_path = spot_light_path::clustered_gpu;
+    double cull_ms = 0.0;
+    double cpu_cull_ms = 0.0;
+    double submit_ms = 0.0;
+
+    /* gpu times of the geometry pass and of the directional + spot light passes per gbuffer layout */
+    gbuffer_layout layout = gbuffer_layout::full;
+    double dir_ms = 0.0;
+    std::array<double, 3> gpass_ms{};
+    std::array<double, 3> lighting_ms{};
+
+    /* material evaluation while rasterizing, or ids only and a deferred material resolve */
+    geometry_path geometry = geometry_path::gbuffer;
+    double ids_ms = 0.0;
+    double resolve_ms = 0.0;
+
+    /* spot light shadows from the atlas: tile texels per pixel of the projected light diameter, tiles rendered per
+       frame at most, normal offset in tile texels */
+    bool spot_shadows = true;
+    float shadow_quality = 1.0f;
+    int shadow_updates = 8;
+    float shadow_bias = 1.5f;
+    double shadow_ms = 0.0;
+};
+
+/* Geometry Buffer: full layout stores world position (rgb16F) and normal (rgb16F), the compact layout reconstructs
+   the position from depth and stores octahedral normals in two snorm channels (rg16 or rg8); both share the
+   material (diffuse rgb, shininess a) and depth */
+struct gbuffer
+{
+    gbuffer_layout layout;
+    opengl::handle<opengl::framebuffer> fb;
+    opengl::handle<opengl::texture> pos;
+    opengl::handle<opengl::texture> normal;
+    opengl::handle<opengl::texture> material;
+    opengl::handle<opengl::texture> depth;
 };
 
+/* nominal bytes per pixel of all targets, material rgba8 and depth24 in each layout (drivers may pad rgb16F) */
+std::size_t gbuffer_texel_bytes(gbuffer_layout layout)
+{
+    switch(layout)
+    {
+        case gbuffer_layout::full:        return 6 + 6 + 4 + 4;
+        case gbuffer_layout::compact:     return 4 + 4 + 4;
+        case gbuffer_layout::compact_rg8: return 2 + 4 + 4;
+    }
+    return 0;
+}
+
+gbuffer construct_gbuffer(opengl::context& context, gbuffer_layout layout, unsigned int width, unsigned int height)
+{
+    gbuffer buffer;
+    buffer.layout = layout;
+    buffer.fb = context.make_framebuffer();
+
+    auto make_target = [&](opengl::texture_internal_type internal, opengl::texture_format format, opengl::texture_type type)
+    {
+        auto tex = context.make_texture(internal, format, type, width, height);
+        tex->parameter(opengl::min_filter::nearest);
+        tex->parameter(opengl::mag_filter::nearest);
+        return tex;
+    };
+
+    if(layout == gbuffer_layout::full)
+    {
+        buffer.pos = make_target(opengl::texture_internal_type::rgb16F, opengl::texture_format::rgb, opengl::texture_type::float_);
+        buffer.normal = make_target(opengl::texture_internal_type::rgb16F, opengl::texture_format::rgb, opengl::texture_type::float_);
+    }
+    else if(layout == gbuffer_layout::compact)
+    {
+        buffer.normal = make_target(opengl::texture_internal_type::rg16_snorm, opengl::texture_format::rg, opengl::texture_type::short_);
+    }
+    else
+    {
+        buffer.normal = make_target(opengl::texture_internal_type::rg8_snorm, opengl::texture_format::rg, opengl::texture_type::byte_);
+    }
+    buffer.material = make_target(opengl::texture_internal_type::rgba8, opengl::texture_format::rgba, opengl::texture_type::unsigned_byte_);
+    buffer.depth = make_target(opengl::texture_internal_type::depth24, opengl::texture_format::depth, opengl::texture_type::unsigned_int_);
+
+    if(layout == gbuffer_layout::full)
+    {
+        buffer.fb->attach_color(0, buffer.pos);
+        buffer.fb->attach_color(1, buffer.normal);
+        buffer.fb->attach_color(2, buffer.material);
+        buffer.fb->draw_attachment(0, 1, 2);
+    }
+    else
+    {
+        buffer.fb->attach_color(0, buffer.normal);
+        buffer.fb->attach_color(1, buffer.material);
+        buffer.fb->draw_attachment(0, 1);
+    }
+    buffer.fb->attach_depth(buffer.depth);
+    assert(buffer.fb->completed());
+    buffer.fb->unbind();
+
+    return buffer;
+}
+
+/* binds the targets read by the light passes and sets their uniforms */
+void bind_gbuffer(const gbuffer& buffer, opengl::shader_program& shader, const util::camera& camera)
+{
+    shader.uniform("gBuffer.pos", 0);
+    shader.uniform("gBuffer.normal", 1);
+    shader.uniform("gBuffer.material", 2);
+    shader.uniform("gBuffer.depth", 3);
+    shader.uniform("uCompact", buffer.layout != gbuffer_layout::full);
+    shader.uniform("uInvViewProj", glm::inverse(camera.projection() * camera.view()));
+
+    if(buffer.pos) { buffer.pos->bind(0); }
+    buffer.normal->bind(1);
+    buffer.material->bind(2);
+    buffer.depth->bind(3);
+}
+
 /* Directional Light Source */
 struct light_dir
 {
@@ -73,16 +211,22 @@ struct light_spot
     alignas(4) float quadratic = 0.032;
 };
 
-glm::mat4 spot_transform(const light_spot& spot, float distance_scale)
+/* distance at which the light falls below 5/256 of its maximum */
+float spot_range(const light_spot& spot, float distance_scale)
 {
     float ill_max = std::max<float>({ spot.color.r, spot.color.g, spot.color.b });
-    float distance_max = distance_scale * (-spot.linear + std::sqrt(spot.linear * spot.linear - 4.0f * spot.quadratic * (spot.constant - (256.0f / 5.0f) * ill_max))) / (2.0f * spot.quadratic);
+    return distance_scale * (-spot.linear + std::sqrt(spot.linear * spot.linear - 4.0f * spot.quadratic * (spot.constant - (256.0f / 5.0f) * ill_max))) / (2.0f * spot.quadratic);
+}
+
+glm::mat4 spot_transform(const light_spot& spot, float distance_scale)
+{
+    float distance_max = spot_range(spot, distance_scale);
 
     glm::vec3 default_dir = {0.0, -1.0, 0.0};
     auto rotate = glm::mat4(1.0);
     if( !(default_dir == spot.direction) )
     {
-        auto normal = glm::cross(spot.direction, default_dir);
+        auto normal = glm::cross(default_dir, spot.direction);
         float angle = glm::acos(glm::dot(spot.direction, default_dir));
         rotate = glm::rotate(rotate, angle, normal);
     }
@@ -94,6 +238,665 @@ glm::mat4 spot_transform(const light_spot& spot, float distance_scale)
     return translate * rotate * scale;
 }
 
+/* bounding sphere (xyz center, w radius) of the lit spot cone */
+glm::vec4 spot_sphere(const light_spot& spot, float distance_scale)
+{
+    float range = spot_range(spot, distance_scale);
+    float angle = spot.outer;
+
+    if(angle >= glm::half_pi<float>())    { return glm::vec4(spot.position, range); }
+    if(angle > glm::quarter_pi<float>())  { return glm::vec4(spot.position + glm::cos(angle) * range * spot.direction, glm::sin(angle) * range); }
+
+    float radius = range / (2.0f * glm::cos(angle));
+    return glm::vec4(spot.position + radius * spot.direction, radius);
+}
+
+/* the fixed spots of the scene followed by randomly placed small spots over the city */
+std::vector<light_spot> generate_spots(const std::vector<light_spot>& scene_spots, unsigned int count)
+{
+    std::vector<light_spot> spots(scene_spots.begin(), scene_spots.begin() + std::min<std::size_t>(count, scene_spots.size()));
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> area(-2.8f, 2.8f);
+    std::uniform_real_distribution<float> height(0.2f, 0.9f);
+    std::uniform_real_distribution<float> tilt(-0.4f, 0.4f);
+    std::uniform_real_distribution<float> hue(0.2f, 0.8f);
+    while(spots.size() < count)
+    {
+        light_spot spot;
+        spot.position = {area(rng), height(rng), area(rng)};
+        spot.direction = glm::normalize(glm::vec3(tilt(rng), -1.0f, tilt(rng)));
+        spot.color = {hue(rng), hue(rng), hue(rng)};
+        spot.linear = 0.7f;
+        spot.quadratic = 1.8f;
+        spots.push_back(spot);
+    }
+
+    return spots;
+}
+
+/* Visibility Buffer: the geometry pass only rasterizes draw and triangle ids into an r32ui target (plus depth);
+   materials are resolved afterwards into the gbuffer by one full screen pass per material, which refetches the
+   triangle from storage buffers and interpolates with analytic barycentrics. A classify pass writes the material
+   of every pixel as depth, the material passes select their pixels with an equal depth test */
+struct visibility_buffer
+{
+    static constexpr unsigned int triangle_bits = 20;
+    static constexpr unsigned int max_draws = 1u << (32 - triangle_bits);
+    static constexpr unsigned int max_materials = 4095;
+
+    struct draw
+    {
+        opengl::handle<opengl::vertexarray> vao;
+        unsigned int offset;
+        unsigned int count;
+    };
+
+    opengl::handle<opengl::shader_program> shader_ids;
+    opengl::handle<opengl::shader_program> shader_classify;
+    opengl::handle<opengl::shader_program> shader_resolve;
+
+    /* vertices and indices of all meshes, first index / base vertex / material per draw */
+    opengl::handle<opengl::buffer<vertex>> buffer_vertices;
+    opengl::handle<opengl::buffer<unsigned int>> buffer_indices;
+    opengl::handle<opengl::buffer<glm::uvec4>> buffer_draws;
+
+    std::vector<draw> draws;
+    std::vector<const material*> materials;
+
+    /* targets, rebuilt with the gbuffer */
+    opengl::handle<opengl::texture> ids;
+    opengl::handle<opengl::texture> material_depth;
+    opengl::handle<opengl::framebuffer> fb_ids;
+    opengl::handle<opengl::framebuffer> fb_resolve;
+
+    bool valid = false;
+};
+
+visibility_buffer construct_visibility(opengl::context& context, const asset::model<vertex, material>& model)
+{
+    static_assert(sizeof(vertex) == 8 * sizeof(float), "visibility_resolve.frag reads vertices with a stride of 8 floats");
+
+    visibility_buffer vis;
+
+    vis.shader_ids = context.make_shader();
+    vis.shader_ids->load("deferred_rendering/shader/visibility.vert", opengl::shader_type::vertex);
+    vis.shader_ids->load("deferred_rendering/shader/visibility.frag", opengl::shader_type::fragment);
+    vis.shader_ids->link();
+
+    vis.shader_classify = context.make_shader();
+    vis.shader_classify->load("deferred_rendering/shader/visibility_resolve.vert", opengl::shader_type::vertex);
+    vis.shader_classify->load("deferred_rendering/shader/visibility_classify.frag", opengl::shader_type::fragment);
+    vis.shader_classify->link();
+
+    vis.shader_resolve = context.make_shader();
+    vis.shader_resolve->load("deferred_rendering/shader/visibility_resolve.vert", opengl::shader_type::vertex);
+    vis.shader_resolve->load("deferred_rendering/shader/visibility_resolve.frag", opengl::shader_type::fragment);
+    vis.shader_resolve->link();
+
+    /* meshes are packed back to back, indices stay relative to their mesh (base vertex per draw) */
+    std::map<const asset::mesh<vertex>*, glm::uvec2> bases;
+    std::size_t num_vertices = 0, num_indices = 0;
+    for(const auto& [_, mesh] : model.meshes())
+    {
+        if(!mesh.indexbuffer())
+        {
+            platform_log(core::log::level::error, "[visibility_buffer] Only indexed meshes are supported");
+            return vis;
+        }
+
+        bases[&mesh] = glm::uvec2(num_vertices, num_indices);
+        num_vertices += mesh.vertexbuffer()->size();
+        num_indices += mesh.indexbuffer()->size();
+    }
+
+    vis.buffer_vertices = context.make_buffer<vertex>(opengl::buffer_target::shader_storage, num_vertices, opengl::buffer_usage::static_draw);
+    vis.buffer_indices = context.make_buffer<unsigned int>(opengl::buffer_target::shader_storage, num_indices, opengl::buffer_usage::static_draw);
+    for(const auto& [_, mesh] : model.meshes())
+    {
+        const auto& base = bases[&mesh];
+        vis.buffer_vertices->copy(base.x, *mesh.vertexbuffer(), 0, mesh.vertexbuffer()->size());
+        vis.buffer_indices->copy(base.y, *mesh.indexbuffer(), 0, mesh.indexbuffer()->size());
+    }
+
+    std::vector<glm::uvec4> draws;
+    for(const auto& [_, mat_group] : model.material_groups())
+    {
+        for(const auto& record : mat_group.records())
+        {
+            const auto& base = bases[&record.m_mesh];
+            draws.emplace_back(base.y + record.m_offset, base.x, vis.materials.size(), 0);
+            vis.draws.push_back({record.m_mesh.vao(), record.m_offset, record.m_count});
+
+            if(record.m_count / 3 >= (1u << visibility_buffer::triangle_bits))
+            {
+                platform_log(core::log::level::error, "[visibility_buffer] Draw exceeds {} triangles", 1u << visibility_buffer::triangle_bits);
+                return vis;
+            }
+        }
+        vis.materials.push_back(&mat_group.material());
+    }
+
+    if(draws.size() > visibility_buffer::max_draws || vis.materials.size() > visibility_buffer::max_materials)
+    {
+        platform_log(core::log::level::error, "[visibility_buffer] Model exceeds {} draws or {} materials", visibility_buffer::max_draws, visibility_buffer::max_materials);
+        return vis;
+    }
+
+    vis.buffer_draws = context.make_buffer<glm::uvec4>(opengl::buffer_target::shader_storage, draws, opengl::buffer_usage::static_draw);
+    vis.buffer_draws->unbind();
+
+    platform_log(core::log::level::info, "[visibility_buffer] {} draws, {} materials, {} vertices, {} indices", draws.size(), vis.materials.size(), num_vertices, num_indices);
+
+    vis.valid = true;
+    return vis;
+}
+
+/* id target and the material depth, the resolve pass renders into the color targets of the gbuffer */
+void attach_visibility(visibility_buffer& vis, const gbuffer& buffer, opengl::context& context, unsigned int width, unsigned int height)
+{
+    vis.ids = context.make_texture(opengl::texture_internal_type::r32ui, opengl::texture_format::red_int, opengl::texture_type::unsigned_int_, width, height);
+    vis.ids->parameter(opengl::min_filter::nearest);
+    vis.ids->parameter(opengl::mag_filter::nearest);
+
+    vis.material_depth = context.make_texture(opengl::texture_internal_type::depth24, opengl::texture_format::depth, opengl::texture_type::unsigned_int_, width, height);
+    vis.material_depth->parameter(opengl::min_filter::nearest);
+    vis.material_depth->parameter(opengl::mag_filter::nearest);
+
+    vis.fb_ids = context.make_framebuffer();
+    vis.fb_ids->attach_color(0, vis.ids);
+    vis.fb_ids->attach_depth(buffer.depth);
+    vis.fb_ids->draw_attachment(0);
+    assert(vis.fb_ids->completed());
+
+    vis.fb_resolve = context.make_framebuffer();
+    if(buffer.layout == gbuffer_layout::full)
+    {
+        vis.fb_resolve->attach_color(0, buffer.pos);
+        vis.fb_resolve->attach_color(1, buffer.normal);
+        vis.fb_resolve->attach_color(2, buffer.material);
+        vis.fb_resolve->draw_attachment(0, 1, 2);
+    }
+    else
+    {
+        vis.fb_resolve->attach_color(0, buffer.normal);
+        vis.fb_resolve->attach_color(1, buffer.material);
+        vis.fb_resolve->draw_attachment(0, 1);
+    }
+    vis.fb_resolve->attach_depth(vis.material_depth);
+    assert(vis.fb_resolve->completed());
+    vis.fb_resolve->unbind();
+}
+
+/* Clustered Light Culling: view space froxels (screen tiles x exponential depth slices) with a list of the spot
+   lights touching them; binned by a compute shader (fixed capacity per cluster) or on the cpu (compact lists) */
+struct light_clusters
+{
+    static constexpr unsigned int tiles_x = 16;
+    static constexpr unsigned int tiles_y = 9;
+    static constexpr unsigned int slices = 24;
+    static constexpr unsigned int count = tiles_x * tiles_y * slices;
+    static constexpr unsigned int max_lights = 256;
+
+    opengl::handle<opengl::shader_program> shader_cull;
+    opengl::handle<opengl::shader_program> shader_lights;
+
+    /* offset / count per cluster into the light indices */
+    opengl::handle<opengl::buffer<glm::uvec2>> buffer_grid;
+    opengl::handle<opengl::buffer<unsigned int>> buffer_indices;
+
+    std::vector<glm::uvec2> grid;
+    std::vector<unsigned int> indices;
+    std::vector<std::vector<unsigned int>> lists;
+};
+
+light_clusters construct_clusters(opengl::context& context)
+{
+    light_clusters clusters;
+
+    clusters.shader_cull = context.make_shader();
+    clusters.shader_cull->load("deferred_rendering/shader/light_cull.comp", opengl::shader_type::compute);
+    clusters.shader_cull->link();
+
+    clusters.shader_lights = context.make_shader();
+    clusters.shader_lights->load("deferred_rendering/shader/light_clustered.vert", opengl::shader_type::vertex);
+    clusters.shader_lights->load("deferred_rendering/shader/light_clustered.frag", opengl::shader_type::fragment);
+    clusters.shader_lights->link();
+
+    clusters.buffer_grid = context.make_buffer<glm::uvec2>(opengl::buffer_target::shader_storage, light_clusters::count, opengl::buffer_usage::dynamic_draw);
+    clusters.buffer_indices = context.make_buffer<unsigned int>(opengl::buffer_target::shader_storage, light_clusters::count * light_clusters::max_lights, opengl::buffer_usage::dynamic_draw);
+    clusters.buffer_indices->unbind();
+
+    clusters.grid.resize(light_clusters::count);
+    clusters.lists.resize(light_clusters::count);
+    return clusters;
+}
+
+/* cpu reference of light_cull.comp, slices binned in parallel, uploaded as compact lists */
+void cull_lights_cpu(light_clusters& clusters, const std::vector<light_spot>& spots, const util::camera& camera, float distance_scale)
+{
+    const glm::mat4 view = camera.view();
+    const glm::mat4 inv_proj = glm::inverse(camera.projection());
+    const float z_near = camera.near_plane();
+    const float z_far = camera.far_plane();
+
+    std::vector<glm::vec4> spheres(spots.size());
+    core::parallel_for(0, spots.size(), 1024, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; i++)
+        {
+            auto sphere = spot_sphere(spots[i], distance_scale);
+            spheres[i] = glm::vec4(glm::vec3(view * glm::vec4(glm::vec3(sphere), 1.0f)), sphere.w);
+        }
+    });
+
+    auto view_ray = [&](float x, float y)
+    {
+        glm::vec4 p = inv_proj * glm::vec4(x, y, -1.0f, 1.0f);
+        glm::vec3 v = glm::vec3(p) / p.w;
+        return v / -v.z;
+    };
+
+    core::parallel_for(0, light_clusters::slices, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t z = begin; z < end; z++)
+        {
+            float slice_near = z_near * std::pow(z_far / z_near, static_cast<float>(z) / light_clusters::slices);
+            float slice_far = z_near * std::pow(z_far / z_near, static_cast<float>(z + 1) / light_clusters::slices);
+
+            for(unsigned int y = 0; y < light_clusters::tiles_y; y++)
+            {
+                for(unsigned int x = 0; x < light_clusters::tiles_x; x++)
+                {
+                    glm::vec3 box_min(std::numeric_limits<float>::max()), box_max(std::numeric_limits<float>::lowest());
+                    for(unsigned int c = 0; c < 4; c++)
+                    {
+                        auto ray = view_ray(-1.0f + 2.0f * (x + (c & 1)) / light_clusters::tiles_x, -1.0f + 2.0f * (y + (c >> 1)) / light_clusters::tiles_y);
+                        box_min = glm::min(box_min, glm::min(ray * slice_near, ray * slice_far));
+                        box_max = glm::max(box_max, glm::max(ray * slice_near, ray * slice_far));
+                    }
+
+                    auto& list = clusters.lists[(z * light_clusters::tiles_y + y) * light_clusters::tiles_x + x];
+                    list.clear();
+                    for(unsigned int i = 0; i < spheres.size(); i++)
+                    {
+                        glm::vec3 center(spheres[i]);
+                        glm::vec3 d = glm::clamp(center, box_min, box_max) - center;
+                        if(glm::dot(d, d) <= spheres[i].w * spheres[i].w) { list.push_back(i); }
+                    }
+                }
+            }
+        }
+    });
+
+    clusters.indices.clear();
+    for(unsigned int i = 0; i < light_clusters::count; i++)
+    {
+        clusters.grid[i] = glm::uvec2(clusters.indices.size(), clusters.lists[i].size());
+        clusters.indices.insert(clusters.indices.end(), clusters.lists[i].begin(), clusters.lists[i].end());
+    }
+
+    clusters.buffer_grid->data(0, clusters.grid.data(), clusters.grid.size());
+    if(clusters.indices.size() > clusters.buffer_indices->size())
+    {
+        clusters.buffer_indices->data(clusters.indices);
+    }
+    else if(!clusters.indices.empty())
+    {
+        clusters.buffer_indices->data(0, clusters.indices.data(), clusters.indices.size());
+    }
+    clusters.buffer_indices->unbind();
+}
+
+/* Shadow Atlas: one depth texture split into fixed tiers of power of two tiles (8 x 1024, 16 x 512, 32 x 256 and
+   128 x 128 texels); lights ask for a tile size by their projected diameter on screen, a tier without free tiles
+   hands over the least recently used tile of a light not requesting one this frame. A tile keeps its depth until the
+   light or the scene revision changes, the lighting passes look up the tile of a light by its index */
+struct spot_shadow
+{
+    glm::mat4 light_space{1.0f};
+    glm::vec4 rect{0.0f};
+};
+
+struct shadow_tile
+{
+    glm::uvec2 offset;
+    unsigned int size;
+    int owner = -1;
+    std::uint64_t last_used = 0;
+
+    /* light and scene revision the depth was rendered for */
+    bool rendered = false;
+    light_spot light{};
+    float range = 0.0f;
+    unsigned int revision = 0;
+};
+
+struct shadow_caster
+{
+    const asset::mesh<vertex>* mesh;
+    unsigned int offset;
+    unsigned int count;
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+struct shadow_atlas
+{
+    static constexpr unsigned int size = 4096;
+    static constexpr unsigned int max_tile = 1024;
+    static constexpr unsigned int tiers = 4;
+    static constexpr std::array<unsigned int, tiers> rows = {2, 2, 2, 4};
+
+    opengl::handle<opengl::texture> depth;
+    opengl::handle<opengl::framebuffer> fb;
+    opengl::handle<opengl::shader_program> shader;
+    opengl::handle<opengl::buffer<spot_shadow>> buffer_shadows;
+    opengl::handle<opengl::timer_query> query;
+
+    /* tiles of all tiers, largest first; first tile of each tier and the end */
+    std::vector<shadow_tile> tiles;
+    std::array<std::size_t, tiers + 1> tier_begin{};
+
+    /* per light: tile index (or -1) and the entry of the shader */
+    std::vector<int> light_tiles;
+    std::vector<spot_shadow> shadows;
+
+    std::vector<shadow_caster> casters;
+
+    std::uint64_t frame = 0;
+    unsigned int revision = 1;
+
+    /* stats of the last update */
+    unsigned int shadowed = 0;
+    unsigned int rendered = 0;
+    unsigned int pending = 0;
+    unsigned int draws = 0;
+};
+
+shadow_atlas construct_shadow_atlas(opengl::context& context, const asset::model<vertex, material>& model, const glm::mat4& model_matrix)
+{
+    shadow_atlas atlas;
+
+    atlas.depth = context.make_texture(opengl::texture_internal_type::depth24, opengl::texture_format::depth,
+                                       opengl::texture_type::unsigned_int_, shadow_atlas::size, shadow_atlas::size);
+    atlas.depth->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+    atlas.depth->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+    atlas.depth->parameter(opengl::compare_mode::ref_to_texture);
+    atlas.depth->parameter(opengl::depth_func::less_equal);
+
+    atlas.fb = context.make_framebuffer();
+    atlas.fb->attach_depth(atlas.depth);
+    atlas.fb->draw_buffer(opengl::color_buffer::none);
+    atlas.fb->read_buffer(opengl::color_buffer::none);
+    assert(atlas.fb->completed());
+
+    atlas.shader = context.make_shader();
+    atlas.shader->load("deferred_rendering/shader/shadow_atlas.vert", opengl::shader_type::vertex);
+    atlas.shader->load("deferred_rendering/shader/shadow_atlas.frag", opengl::shader_type::fragment);
+    atlas.shader->link();
+
+    atlas.buffer_shadows = context.make_buffer<spot_shadow>(opengl::buffer_target::shader_storage, 1, opengl::buffer_usage::dynamic_draw);
+    atlas.buffer_shadows->unbind();
+    atlas.query = context.make_timer_query();
+
+    /* tiers are bands of rows across the atlas */
+    unsigned int y = 0;
+    for(unsigned int t = 0; t < shadow_atlas::tiers; t++)
+    {
+        const unsigned int tile = shadow_atlas::max_tile >> t;
+        atlas.tier_begin[t] = atlas.tiles.size();
+        for(unsigned int row = 0; row < shadow_atlas::rows[t]; row++, y += tile)
+        {
+            for(unsigned int x = 0; x + tile <= shadow_atlas::size; x += tile)
+            {
+                atlas.tiles.push_back({{x, y}, tile});
+            }
+        }
+    }
+    atlas.tier_begin[shadow_atlas::tiers] = atlas.tiles.size();
+    assert(y == shadow_atlas::size);
+
+    /* world space bounds of every record, culled against the light range */
+    for(const auto& [_, mat_group] : model.material_groups())
+    {
+        for(const auto& record : mat_group.records())
+        {
+            shadow_caster caster{&record.m_mesh, record.m_offset, record.m_count,
+                                 glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest())};
+            for(int i = 0; i < 8; i++)
+            {
+                glm::vec3 corner = {i & 1 ? record.m_max.x : record.m_min.x, i & 2 ? record.m_max.y : record.m_min.y, i & 4 ? record.m_max.z : record.m_min.z};
+                glm::vec3 p = model_matrix * glm::vec4(corner, 1.0f);
+                caster.min = glm::min(caster.min, p);
+                caster.max = glm::max(caster.max, p);
+            }
+            atlas.casters.push_back(caster);
+        }
+    }
+
+    return atlas;
+}
+
+/* perspective of the spot cone (clamped below 170 degrees) out to its range */
+glm::mat4 spot_light_space(const light_spot& spot, float range)
+{
+    const glm::vec3 up = std::abs(spot.direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const float fov = 2.0f * std::min(spot.outer, glm::radians(85.0f));
+    return glm::perspective(fov, 1.0f, std::max(0.01f, 0.01f * range), range) * glm::lookAt(spot.position, spot.position + spot.direction, up);
+}
+
+/* assigns tiles to the most important lights and renders the tiles whose light or scene changed (at most
+   max_updates, the most important first) */
+void update_shadow_atlas(shadow_atlas& atlas, opengl::context& context, const std::vector<light_spot>& spots, const util::camera& camera,
+                         float viewport_height, float distance_scale, float quality, int max_updates, const glm::mat4& model_matrix)
+{
+    atlas.frame++;
+
+    /* entries of lights beyond the count are dropped with their tiles */
+    bool upload_all = false;
+    if(atlas.light_tiles.size() != spots.size())
+    {
+        atlas.light_tiles.assign(spots.size(), -1);
+        atlas.shadows.assign(spots.size(), spot_shadow{});
+        for(auto& tile : atlas.tiles)
+        {
+            tile.owner = -1;
+        }
+        upload_all = true;
+    }
+
+    /* projected diameter of the bounding sphere in pixels, lights outside the view frustum get nothing */
+    const glm::mat4 view = camera.view();
+    const glm::mat4 view_proj = camera.projection() * view;
+    std::array<glm::vec4, 6> planes;
+    for(int i = 0; i < 3; i++)
+    {
+        planes[2 * i]     = glm::row(view_proj, 3) + glm::row(view_proj, i);
+        planes[2 * i + 1] = glm::row(view_proj, 3) - glm::row(view_proj, i);
+    }
+
+    const float pixel_scale = camera.projection()[1][1] * viewport_height;
+    std::vector<std::pair<float, unsigned int>> importance;
+    for(unsigned int i = 0; i < spots.size(); i++)
+    {
+        auto sphere = spot_sphere(spots[i], distance_scale);
+        bool inside = true;
+        for(const auto& plane : planes)
+        {
+            inside &= glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w >= -sphere.w * glm::length(glm::vec3(plane));
+        }
+        if(!inside) { continue; }
+
+        float depth = -(view * glm::vec4(glm::vec3(sphere), 1.0f)).z;
+        float diameter = depth > sphere.w ? pixel_scale * sphere.w / depth : viewport_height;
+        importance.emplace_back(diameter, i);
+    }
+
+    const std::size_t requests = std::min(importance.size(), atlas.tiles.size());
+    std::partial_sort(importance.begin(), importance.begin() + requests, importance.end(), std::greater<>());
+    importance.resize(requests);
+
+    auto tier_of = [&](unsigned int tile_size){ return static_cast<unsigned int>(std::countr_zero(shadow_atlas::max_tile / tile_size)); };
+
+    /* the current tile is kept within a factor of two of the wanted size, otherwise a free or the least recently used
+       tile of the wanted tier (or the smaller ones) is taken */
+    for(const auto& [diameter, light] : importance)
+    {
+        const unsigned int wanted = std::clamp(std::bit_ceil(static_cast<unsigned int>(std::max(diameter * quality, 1.0f))),
+                                               shadow_atlas::max_tile >> (shadow_atlas::tiers - 1), shadow_atlas::max_tile);
+
+        int current = atlas.light_tiles[light];
+        if(current >= 0 && atlas.tiles[current].size * 2 >= wanted && atlas.tiles[current].size <= wanted * 2)
+        {
+            atlas.tiles[current].last_used = atlas.frame;
+            continue;
+        }
+
+        int found = -1;
+        for(unsigned int t = tier_of(wanted); t < shadow_atlas::tiers && found < 0; t++)
+        {
+            for(std::size_t i = atlas.tier_begin[t]; i < atlas.tier_begin[t + 1]; i++)
+            {
+                const auto& tile = atlas.tiles[i];
+                if(tile.last_used == atlas.frame) { continue; }
+                if(found < 0 || tile.owner < 0 || (atlas.tiles[found].owner >= 0 && tile.last_used < atlas.tiles[found].last_used))
+                {
+                    found = static_cast<int>(i);
+                    if(tile.owner < 0) { break; }
+                }
+            }
+        }
+
+        if(found < 0 || found == current)
+        {
+            if(current >= 0) { atlas.tiles[current].last_used = atlas.frame; }
+            continue;
+        }
+
+        auto& tile = atlas.tiles[found];
+        if(tile.owner >= 0)
+        {
+            atlas.light_tiles[tile.owner] = -1;
+        }
+        if(current >= 0)
+        {
+            atlas.tiles[current].owner = -1;
+            atlas.tiles[current].rendered = false;
+        }
+
+        tile.owner = static_cast<int>(light);
+        tile.last_used = atlas.frame;
+        tile.rendered = false;
+        atlas.light_tiles[light] = found;
+    }
+
+    auto up_to_date = [&](const shadow_tile& tile)
+    {
+        const auto& spot = spots[tile.owner];
+        return tile.rendered && tile.revision == atlas.revision && tile.range == spot_range(spot, distance_scale) &&
+               tile.light.position == spot.position && tile.light.direction == spot.direction && tile.light.outer == spot.outer;
+    };
+
+    /* stale tiles of the requesting lights in order of importance */
+    std::vector<int> stale;
+    for(const auto& [_, light] : importance)
+    {
+        int t = atlas.light_tiles[light];
+        if(t >= 0 && !up_to_date(atlas.tiles[t])) { stale.push_back(t); }
+    }
+    if(stale.size() > static_cast<std::size_t>(max_updates)) { stale.resize(max_updates); }
+
+    atlas.rendered = static_cast<unsigned int>(stale.size());
+    atlas.draws = 0;
+    if(!stale.empty())
+    {
+        auto viewport = context.viewport();
+        auto scissor = context.set(opengl::options::scissor_test, true);
+        auto cull = context.set(opengl::options::cull_face, false);
+
+        atlas.fb->bind();
+        atlas.shader->bind();
+        atlas.shader->uniform("uModel", model_matrix);
+
+        for(int t : stale)
+        {
+            auto& tile = atlas.tiles[t];
+            const auto& spot = spots[tile.owner];
+            const float range = spot_range(spot, distance_scale);
+            const auto sphere = spot_sphere(spot, distance_scale);
+
+            context.viewport(tile.offset.x, tile.offset.y, tile.size, tile.size);
+            context.scissor(tile.offset.x, tile.offset.y, tile.size, tile.size);
+            context.clear(opengl::clear_options::depth);
+
+            atlas.shader->uniform("uLightSpace", spot_light_space(spot, range));
+            for(const auto& caster : atlas.casters)
+            {
+                glm::vec3 d = glm::clamp(glm::vec3(sphere), caster.min, caster.max) - glm::vec3(sphere);
+                if(glm::dot(d, d) > sphere.w * sphere.w) { continue; }
+
+                caster.mesh->vao()->bind();
+                caster.mesh->vao()->draw(caster.offset, caster.count, opengl::primitives::triangles);
+                atlas.draws++;
+            }
+
+            tile.rendered = true;
+            tile.light = spot;
+            tile.range = range;
+            tile.revision = atlas.revision;
+        }
+
+        atlas.fb->unbind();
+        context.set(opengl::options::cull_face, cull);
+        context.set(opengl::options::scissor_test, scissor);
+        context.viewport(viewport);
+    }
+
+    /* entries of the shader, a tile is only used once its depth is current */
+    atlas.shadowed = 0;
+    atlas.pending = 0;
+    for(unsigned int i = 0; i < spots.size(); i++)
+    {
+        spot_shadow entry{};
+        int t = atlas.light_tiles[i];
+        if(t >= 0 && up_to_date(atlas.tiles[t]))
+        {
+            const auto& tile = atlas.tiles[t];
+            entry.light_space = spot_light_space(spots[i], tile.range);
+            entry.rect = glm::vec4(glm::vec2(tile.offset), glm::vec2(static_cast<float>(tile.size))) / static_cast<float>(shadow_atlas::size);
+            atlas.shadowed++;
+        }
+        else if(t >= 0)
+        {
+            atlas.pending++;
+        }
+
+        if(!upload_all && (entry.rect != atlas.shadows[i].rect || entry.light_space != atlas.shadows[i].light_space))
+        {
+            atlas.buffer_shadows->data(i, &entry, 1);
+        }
+        atlas.shadows[i] = entry;
+    }
+
+    if(upload_all)
+    {
+        atlas.buffer_shadows->data(atlas.shadows);
+    }
+    atlas.buffer_shadows->unbind();
+}
+
+/* binds the atlas and the entries of the lights read by the spot light passes */
+void bind_shadow_atlas(const shadow_atlas& atlas, opengl::shader_program& shader, bool enabled, float bias)
+{
+    shader.uniform("uShadows", enabled);
+    shader.uniform("uShadowBias", bias);
+    shader.uniform("uShadowAtlas", 4);
+
+    atlas.depth->bind(4);
+    atlas.buffer_shadows->bind_base(3);
+}
+
 int main(int argc, char** argv)
 {
     /* initial window settings */
@@ -140,6 +943,12 @@ int main(int argc, char** argv)
     auto screen_quad = asset::shape<vertex>::create_screenquad(context);
     auto mesh_spots = asset::shape<vertex>::create_pyramid(context);
     auto buffer_spots = context.make_buffer<light_spot>(opengl::buffer_target::shader_storage, light_spots, opengl::buffer_usage::dynamic_draw);
+    const auto scene_spots = light_spots;
+
+    /* light cluster grid and gpu timers of the spot light pass */
+    auto clusters = construct_clusters(context);
+    auto query_light = context.make_timer_query();
+    auto query_cull = context.make_timer_query();
 
     /* load and compile shaders */
     auto shader_gpass = context.make_shader();
@@ -157,43 +966,34 @@ int main(int argc, char** argv)
     shader_lightspots->load("deferred_rendering/shader/light_spots.frag", opengl::shader_type::fragment);
     shader_lightspots->link();
 
+    auto shader_lightvolumes = context.make_shader();
+    shader_lightvolumes->load("deferred_rendering/shader/light_volumes.vert", opengl::shader_type::vertex);
+    shader_lightvolumes->load("deferred_rendering/shader/light_spots.frag", opengl::shader_type::fragment);
+    shader_lightvolumes->link();
+
     auto shader_debug = context.make_shader();
-    shader_debug->load("deferred_rendering/shader/debug_light.vert", opengl::shader_type::vertex);
+    shader_debug->load("deferred_rendering/shader/light_volumes.vert", opengl::shader_type::vertex);
     shader_debug->load("deferred_rendering/shader/debug_light.frag", opengl::shader_type::fragment);
     shader_debug->link();
 
 
-    /* setup gbuffer textures */
-    auto tex_pos = context.make_texture(opengl::texture_internal_type::rgb16F, opengl::texture_format::rgb,
-                                        opengl::texture_type::float_, view.window().size().x, view.window().size().y);
-    auto tex_normal = context.make_texture(opengl::texture_internal_type::rgb16F, opengl::texture_format::rgb,
-                                           opengl::texture_type::float_, view.window().size().x, view.window().size().y);
-    auto tex_material = context.make_texture(opengl::texture_internal_type::rgba8, opengl::texture_format::rgba,
-                                             opengl::texture_type::unsigned_byte_, view.window().size().x, view.window().size().y);
-    auto tex_depth = context.make_texture(opengl::texture_internal_type::depth, opengl::texture_format::depth,
-                                          opengl::texture_type::unsigned_int_, view.window().size().x, view.window().size().y);
+    /* setup gbuffer textures and framebuffer */
+    auto gbuf = construct_gbuffer(context, render_control.layout, view.window().size().x, view.window().size().y);
 
-    tex_pos->parameter(opengl::min_filter::nearest);
-    tex_pos->parameter(opengl::mag_filter::nearest);
+    auto shader_gpass_compact = context.make_shader();
+    shader_gpass_compact->load("deferred_rendering/shader/gpass.vert", opengl::shader_type::vertex);
+    shader_gpass_compact->load("deferred_rendering/shader/gpass_compact.frag", opengl::shader_type::fragment);
+    shader_gpass_compact->link();
 
-    tex_normal->parameter(opengl::min_filter::nearest);
-    tex_normal->parameter(opengl::mag_filter::nearest);
+    auto query_gpass = context.make_timer_query();
+    auto query_dir = context.make_timer_query();
 
-    tex_material->parameter(opengl::min_filter::nearest);
-    tex_material->parameter(opengl::mag_filter::nearest);
+    auto vis = construct_visibility(context, *model);
+    if(vis.valid) { attach_visibility(vis, gbuf, context, view.window().size().x, view.window().size().y); }
+    auto query_ids = context.make_timer_query();
+    auto query_resolve = context.make_timer_query();
 
-    tex_depth->parameter(opengl::min_filter::nearest);
-    tex_depth->parameter(opengl::mag_filter::nearest);
-
-
-    /* attach to gbuffer framebuffer */
-    auto fb_gbuffer = context.make_framebuffer();
-    fb_gbuffer->attach_color(0, tex_pos);
-    fb_gbuffer->attach_color(1, tex_normal);
-    fb_gbuffer->attach_color(2, tex_material);
-    fb_gbuffer->attach_depth(tex_depth);
-    fb_gbuffer->draw_attachment(0, 1, 2);
-    assert(fb_gbuffer->completed());
+    auto atlas = construct_shadow_atlas(context, *model, model_matrix);
 
 
     /* set context state */
@@ -205,47 +1005,152 @@ int main(int argc, char** argv)
     /***************** install callbacks *****************/
     view.on_render([&](auto& window, float dt)
     {
+        /* rebuilt on layout changes, times are kept per layout */
+        const auto layout = static_cast<std::size_t>(render_control.layout);
+        if(gbuf.layout != render_control.layout)
+        {
+            gbuf = construct_gbuffer(context, render_control.layout, window.size().x, window.size().y);
+            if(vis.valid) { attach_visibility(vis, gbuf, context, window.size().x, window.size().y); }
+        }
+        if(query_gpass->available())   { render_control.gpass_ms[layout] = query_gpass->elapsed_ms(); }
+        if(query_ids->available())     { render_control.ids_ms = query_ids->elapsed_ms(); }
+        if(query_resolve->available()) { render_control.resolve_ms = query_resolve->elapsed_ms(); }
+        if(query_dir->available())   { render_control.dir_ms = query_dir->elapsed_ms(); }
+        render_control.lighting_ms[layout] = (render_control.dir_light_pass ? render_control.dir_ms : 0.0) +
+                                             (render_control.spot_light_pass ? render_control.light_ms[static_cast<std::size_t>(render_control.light_path)] : 0.0);
+
         /************************** 1. Geometry pass *****************************/
-        fb_gbuffer->bind();
+        if(render_control.geometry == geometry_path::visibility && vis.valid)
         {
-            context.viewport(0, 0, window.size().x, window.size().y);
-            context.clear_color(0, 0, 0,  1);
-            context.clear(opengl::clear_options::color_depth);
-
-            shader_gpass->bind();
-            shader_gpass->uniform("uModel", model_matrix);
-            shader_gpass->uniform("uView", camera.view());
-            shader_gpass->uniform("uProj", camera.projection());
-            shader_gpass->uniform("uMaterial.map_diffuse", 0);
-
-            /* iterate over materials */
-            for(auto& [_, mat_group] : model->material_groups())
+            const bool time_ids = !query_ids->pending();
+            if(time_ids) { query_ids->begin(); }
+
+            /* 1a. draw and triangle ids */
+            vis.fb_ids->bind();
             {
-                /* set material uniforms */
-                auto& mat = mat_group.material();
-                shader_gpass->uniform("uMaterial.shininess", mat.shininess);
-                mat.map_diffuse->bind(0);
+                context.viewport(0, 0, window.size().x, window.size().y);
+                context.clear(opengl::clear_options::depth);
+
+                vis.shader_ids->bind();
+                vis.shader_ids->uniform("uModel", model_matrix);
+                vis.shader_ids->uniform("uView", camera.view());
+                vis.shader_ids->uniform("uProj", camera.projection());
+
+                for(unsigned int i = 0; i < vis.draws.size(); i++)
+                {
+                    const auto& draw = vis.draws[i];
+                    vis.shader_ids->uniform("uDrawID", static_cast<GLuint>(i));
+                    draw.vao->draw(draw.offset, draw.count, opengl::primitives::triangles);
+                }
+            }
+            vis.fb_ids->unbind();
+
+            if(time_ids) { query_ids->end(); }
+
+            const bool time_resolve = !query_resolve->pending();
+            if(time_resolve) { query_resolve->begin(); }
+
+            vis.fb_resolve->bind();
+            {
+                context.clear_color(0, 0, 0,  1);
+                context.clear(opengl::clear_options::color_depth);
+                context.set(opengl::options::cull_face, false);
+
+                vis.buffer_vertices->bind_base(0);
+                vis.buffer_indices->bind_base(1);
+                vis.buffer_draws->bind_base(2);
+                vis.ids->bind(0);
+                gbuf.depth->bind(1);
+
+                /* 1b. material of each pixel into the material depth */
+                auto func = context.set(opengl::depth_func::always);
+                vis.shader_classify->bind();
+                vis.shader_classify->uniform("uIDs", 0);
+                vis.shader_classify->uniform("uSceneDepth", 1);
+                vis.shader_classify->uniform("uDepth", 0.0f);
+                screen_quad->vao()->draw(opengl::primitives::triangles);
+
+                /* 1c. one full screen pass per material, early depth test keeps the other materials out */
+                context.set(opengl::depth_func::equal);
+                auto mask = context.depth_mask(false);
+
+                vis.shader_resolve->bind();
+                vis.shader_resolve->uniform("uIDs", 0);
+                vis.shader_resolve->uniform("uModel", model_matrix);
+                vis.shader_resolve->uniform("uNormalMatrix", glm::mat3(glm::transpose(glm::inverse(model_matrix))));
+                vis.shader_resolve->uniform("uViewProj", camera.projection() * camera.view());
+                vis.shader_resolve->uniform("uViewSize", glm::vec2(window.size()));
+                vis.shader_resolve->uniform("uCompact", gbuf.layout != gbuffer_layout::full);
+                vis.shader_resolve->uniform("uMaterial.map_diffuse", 2);
+
+                for(unsigned int i = 0; i < vis.materials.size(); i++)
+                {
+                    vis.shader_resolve->uniform("uDepth", static_cast<float>(i + 1) / 2048.0f - 1.0f);
+                    vis.shader_resolve->uniform("uMaterialIndex", static_cast<GLuint>(i));
+                    vis.shader_resolve->uniform("uMaterial.shininess", vis.materials[i]->shininess);
+                    vis.materials[i]->map_diffuse->bind(2);
 
-                /* iterate over mesh and render faces with this material */
-                for(const auto& record : mat_group.records())
+                    screen_quad->vao()->draw(opengl::primitives::triangles);
+                }
+
+                context.depth_mask(mask);
+                context.set(func);
+                context.set(opengl::options::cull_face, true);
+            }
+            vis.fb_resolve->unbind();
+
+            if(time_resolve) { query_resolve->end(); }
+        }
+        else
+        {
+            const bool time_gpass = !query_gpass->pending();
+            if(time_gpass) { query_gpass->begin(); }
+
+            auto& shader_gpass_active = gbuf.layout == gbuffer_layout::full ? shader_gpass : shader_gpass_compact;
+            gbuf.fb->bind();
+            {
+                context.viewport(0, 0, window.size().x, window.size().y);
+                context.clear_color(0, 0, 0,  1);
+                context.clear(opengl::clear_options::color_depth);
+
+                shader_gpass_active->bind();
+                shader_gpass_active->uniform("uModel", model_matrix);
+                shader_gpass_active->uniform("uView", camera.view());
+                shader_gpass_active->uniform("uProj", camera.projection());
+                shader_gpass_active->uniform("uMaterial.map_diffuse", 0);
+
+                /* iterate over materials */
+                for(auto& [_, mat_group] : model->material_groups())
                 {
-                    record.m_mesh.vao()->bind();
-                    record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles);
+                    /* set material uniforms */
+                    auto& mat = mat_group.material();
+                    shader_gpass_active->uniform("uMaterial.shininess", mat.shininess);
+                    mat.map_diffuse->bind(0);
+
+                    /* iterate over mesh and render faces with this material */
+                    for(const auto& record : mat_group.records())
+                    {
+                        record.m_mesh.vao()->bind();
+                        record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles);
+                    }
                 }
             }
+            gbuf.fb->unbind();
+
+            if(time_gpass) { query_gpass->end(); }
         }
-        fb_gbuffer->unbind();
 
 
         /************************** 2. Directional light pass *****************************/
         if(render_control.dir_light_pass)
         {
+            const bool time_dir = !query_dir->pending();
+            if(time_dir) { query_dir->begin(); }
+
             context.set(opengl::options::cull_face, false);
 
             shader_lightdir->bind();
-            shader_lightdir->uniform("gBuffer.pos", 0);
-            shader_lightdir->uniform("gBuffer.normal", 1);
-            shader_lightdir->uniform("gBuffer.material", 2);
+            bind_gbuffer(gbuf, *shader_lightdir, camera);
 
             shader_lightdir->uniform("uViewPos", camera.position());
             shader_lightdir->uniform("uViewSize", glm::vec2(window.size()));
@@ -254,72 +1159,173 @@ int main(int argc, char** argv)
             shader_lightdir->uniform("uLight.ambient", lightdir.ambient);
             shader_lightdir->uniform("uLight.color", lightdir.color);
 
-            tex_pos->bind(0);
-            tex_normal->bind(1);
-            tex_material->bind(2);
-
             screen_quad->vao()->draw(opengl::primitives::triangles);
 
             context.set(opengl::options::cull_face, true);
+
+            if(time_dir) { query_dir->end(); }
+        }
+
+        gbuf.fb->blit_default(0, 0, window.size().x, window.size().y, opengl::blit_mask::depth);
+
+
+        /************************** 3. Spot light shadows *****************************/
+        if(atlas.query->available()) { render_control.shadow_ms = atlas.query->elapsed_ms(); }
+
+        const bool spot_shadows = render_control.spot_light_pass && render_control.spot_shadows;
+        if(spot_shadows)
+        {
+            const bool time_shadows = !atlas.query->pending();
+            if(time_shadows) { atlas.query->begin(); }
+
+            update_shadow_atlas(atlas, context, light_spots, camera, static_cast<float>(window.size().y), render_control.distance_scale,
+                                render_control.shadow_quality, render_control.shadow_updates, model_matrix);
+
+            if(time_shadows) { atlas.query->end(); }
         }
 
-        fb_gbuffer->blit_default(0, 0, window.size().x, window.size().y, opengl::blit_mask::depth);
 
+        /************************** 4. Spot light pass *****************************/
+        if(query_light->available()) { render_control.light_ms[static_cast<std::size_t>(render_control.light_query_path)] = query_light->elapsed_ms(); }
+        if(query_cull->available())  { render_control.cull_ms = query_cull->elapsed_ms(); }
+
+        auto submit_start = core::clock::now();
 
-        /************************** 3. Spot light pass *****************************/
-        if(render_control.spot_light_pass)
+        const bool clustered = render_control.light_path == spot_light_path::clustered_gpu || render_control.light_path == spot_light_path::clustered_cpu;
+        if(render_control.spot_light_pass && clustered)
         {
+            const bool time_light = !query_light->pending();
+            if(time_light)
+            {
+                query_light->begin();
+                render_control.light_query_path = render_control.light_path;
+            }
+
+            if(render_control.light_path == spot_light_path::clustered_gpu)
+            {
+                const bool time_cull = !query_cull->pending();
+                if(time_cull) { query_cull->begin(); }
+
+                clusters.shader_cull->bind();
+                clusters.shader_cull->uniform("uView", camera.view());
+                clusters.shader_cull->uniform("uInvProj", glm::inverse(camera.projection()));
+                clusters.shader_cull->uniform("uClusters", glm::uvec3(light_clusters::tiles_x, light_clusters::tiles_y, light_clusters::slices));
+                clusters.shader_cull->uniform("uDepthRange", glm::vec2(camera.near_plane(), camera.far_plane()));
+                clusters.shader_cull->uniform("uNumLights", static_cast<int>(light_spots.size()));
+                clusters.shader_cull->uniform("uMaxLights", light_clusters::max_lights);
+                clusters.shader_cull->uniform("uDistanceScale", render_control.distance_scale);
+
+                buffer_spots->bind_base(0);
+                clusters.buffer_grid->bind_base(1);
+                clusters.buffer_indices->bind_base(2);
+
+                context.dispatch_compute((light_clusters::count + 63) / 64);
+                context.barrier(opengl::memory_barrier::shader_storage);
+
+                if(time_cull) { query_cull->end(); }
+            }
+            else
+            {
+                auto start = core::clock::now();
+                cull_lights_cpu(clusters, light_spots, camera, render_control.distance_scale);
+                render_control.cpu_cull_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+            }
+
+            auto blend = context.set(opengl::options::blend, !render_control.cluster_heatmap);
+            context.set(opengl::blend_func_factor_alpha::src_alpha, opengl::blend_func_factor_alpha::one);
+            auto depth = context.set(opengl::options::depth_test, false);
+            context.set(opengl::options::cull_face, false);
+
+            clusters.shader_lights->bind();
+            clusters.shader_lights->uniform("uViewPos", camera.position());
+            clusters.shader_lights->uniform("uViewSize", glm::vec2(window.size()));
+            clusters.shader_lights->uniform("uView", camera.view());
+            clusters.shader_lights->uniform("uClusters", glm::uvec3(light_clusters::tiles_x, light_clusters::tiles_y, light_clusters::slices));
+            clusters.shader_lights->uniform("uDepthRange", glm::vec2(camera.near_plane(), camera.far_plane()));
+            clusters.shader_lights->uniform("uMaxLights", light_clusters::max_lights);
+            clusters.shader_lights->uniform("uDistanceScale", render_control.distance_scale);
+            clusters.shader_lights->uniform("uHeatmap", render_control.cluster_heatmap);
+
+            bind_gbuffer(gbuf, *clusters.shader_lights, camera);
+            bind_shadow_atlas(atlas, *clusters.shader_lights, spot_shadows, render_control.shadow_bias);
+
+            buffer_spots->bind_base(0);
+            clusters.buffer_grid->bind_base(1);
+            clusters.buffer_indices->bind_base(2);
+
+            screen_quad->vao()->draw(opengl::primitives::triangles);
+
+            context.set(opengl::options::cull_face, true);
+            context.set(opengl::options::depth_test, depth);
+            context.set(opengl::options::blend, blend);
+
+            if(time_light) { query_light->end(); }
+        }
+        else if(render_control.spot_light_pass)
+        {
+            const bool time_light = !query_light->pending();
+            if(time_light)
+            {
+                query_light->begin();
+                render_control.light_query_path = render_control.light_path;
+            }
+
             auto blend = context.set(opengl::options::blend, true);
             context.set(opengl::blend_func_factor_alpha::src_alpha, opengl::blend_func_factor_alpha::one);
             context.set(opengl::options::depth_test, true);
             auto mask = context.depth_mask(false);
 
-            shader_lightspots->bind();
-            shader_lightspots->uniform("uModel", model_matrix);
-            shader_lightspots->uniform("uView", camera.view());
-            shader_lightspots->uniform("uProj", camera.projection());
-            shader_lightspots->uniform("uViewPos", camera.position());
-            shader_lightspots->uniform("uViewSize", glm::vec2(window.size()));
+            /* instanced volumes build their transforms in the vertex shader from the light buffer */
+            const bool instanced = render_control.light_path == spot_light_path::volumes_instanced;
+            auto& shader = instanced ? shader_lightvolumes : shader_lightspots;
 
-            shader_lightspots->uniform("gBuffer.pos", 0);
-            shader_lightspots->uniform("gBuffer.normal", 1);
-            shader_lightspots->uniform("gBuffer.material", 2);
+            shader->bind();
+            shader->uniform("uView", camera.view());
+            shader->uniform("uProj", camera.projection());
+            shader->uniform("uViewPos", camera.position());
+            shader->uniform("uViewSize", glm::vec2(window.size()));
 
-
-            tex_pos->bind(0);
-            tex_normal->bind(1);
-            tex_material->bind(2);
+            bind_gbuffer(gbuf, *shader, camera);
+            bind_shadow_atlas(atlas, *shader, spot_shadows, render_control.shadow_bias);
 
             buffer_spots->bind_base(0);
 
-            for(unsigned int i = 0; i < light_spots.size(); i++)
+            if(instanced)
+            {
+                shader->uniform("uDistanceScale", render_control.distance_scale);
+                mesh_spots->vao()->draw_instanced(light_spots.size(), opengl::primitives::triangles);
+            }
+            else
             {
-                auto& light = light_spots[i];
-                shader_lightspots->uniform("uLightIndex", static_cast<int>(i));
-                shader_lightspots->uniform("uModel", spot_transform(light, render_control.distance_scale));
+                for(unsigned int i = 0; i < light_spots.size(); i++)
+                {
+                    auto& light = light_spots[i];
+                    shader->uniform("uLightIndex", static_cast<int>(i));
+                    shader->uniform("uModel", spot_transform(light, render_control.distance_scale));
 
-                mesh_spots->vao()->draw(opengl::primitives::triangles);
+                    mesh_spots->vao()->draw(opengl::primitives::triangles);
+                }
             }
 
             context.set(opengl::options::blend, blend);
             context.depth_mask(mask);
+
+            if(time_light) { query_light->end(); }
         }
 
+        render_control.submit_ms = core::time_cast<core::milli_sec>(core::clock::now() - submit_start);
+
         if(render_control.light_volume_debug)
         {
             auto mode = context.set(opengl::polygon_mode::line);
 
             shader_debug->bind();
-            shader_debug->uniform("uModel", model_matrix);
             shader_debug->uniform("uView", camera.view());
             shader_debug->uniform("uProj", camera.projection());
+            shader_debug->uniform("uDistanceScale", render_control.distance_scale);
 
-            for(unsigned int i = 0; i < light_spots.size(); i++)
-            {
-                auto& light = light_spots[i];
-                shader_debug->uniform("uModel", spot_transform(light, render_control.distance_scale));
-                mesh_spots->vao()->draw(opengl::primitives::triangles);
-            }
+            buffer_spots->bind_base(0);
+            mesh_spots->vao()->draw_instanced(light_spots.size(), opengl::primitives::triangles);
 
             context.set(mode);
         }
@@ -328,10 +1334,8 @@ int main(int argc, char** argv)
 
     view.on_resize([&](auto& window, unsigned int width, unsigned int height)
     {
-        tex_pos->resize(width, height);
-        tex_material->resize(width, height);
-        tex_normal->resize(width, height);
-        tex_depth->resize(width, height);
+        gbuf = construct_gbuffer(context, gbuf.layout, width, height);
+        if(vis.valid) { attach_visibility(vis, gbuf, context, width, height); }
     });
 
     view.on_key([](auto& window, auto key, bool pressed)
@@ -405,6 +1409,15 @@ int main(int argc, char** argv)
 
                 ImGui::DragFloat("light volume scale", &render_control.distance_scale, 0.01f, 0.0f, 1.0f);
 
+                if(ImGui::SliderInt("lights", &render_control.num_lights, 16, 10000, "%d", ImGuiSliderFlags_Logarithmic))
+                {
+                    auto inner = light_spots[0].inner;
+                    auto outer = light_spots[0].outer;
+                    light_spots = generate_spots(scene_spots, static_cast<unsigned int>(render_control.num_lights));
+                    std::for_each(light_spots.begin(), light_spots.end(), [&](auto& light){ light.inner = inner; light.outer = outer; });
+                    changed = true;
+                }
+
                 if(changed)
                 {
                     buffer_spots->data(light_spots);
@@ -415,6 +1428,103 @@ int main(int argc, char** argv)
             ImGui::Checkbox("spotlight pass", &render_control.spot_light_pass);
             ImGui::Checkbox("lightvolume debug", &render_control.light_volume_debug);
 
+            ImGui::Dummy({0.0, 16.0});
+
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Spot Light Path: ");
+            ImGui::PushID("lightpath");
+            int path = static_cast<int>(render_control.light_path);
+            ImGui::RadioButton("light volumes", &path, static_cast<int>(spot_light_path::volumes));
+            ImGui::RadioButton("light volumes (instanced)", &path, static_cast<int>(spot_light_path::volumes_instanced));
+            ImGui::RadioButton("clustered (gpu culling)", &path, static_cast<int>(spot_light_path::clustered_gpu));
+            ImGui::RadioButton("clustered (cpu culling)", &path, static_cast<int>(spot_light_path::clustered_cpu));
+            render_control.light_path = static_cast<spot_light_path>(path);
+            ImGui::Checkbox("cluster heatmap", &render_control.cluster_heatmap);
+            ImGui::PopID();
+
+            ImGui::Text("clusters:       %ux%ux%u (max %u lights)", light_clusters::tiles_x, light_clusters::tiles_y, light_clusters::slices, light_clusters::max_lights);
+            const char* path_names[] = {"volumes", "volumes (instanced)", "clustered (gpu)", "clustered (cpu)"};
+            for(std::size_t i = 0; i < render_control.light_ms.size(); i++)
+            {
+                ImGui::Text("%-20s %4.2f ms (gpu)%s", path_names[i], render_control.light_ms[i], i == static_cast<std::size_t>(render_control.light_path) ? " *" : "");
+            }
+            ImGui::Text("submit:         %4.2f ms (cpu)", render_control.submit_ms);
+            if(render_control.light_path == spot_light_path::clustered_gpu)
+            {
+                ImGui::Text("light culling:  %4.2f ms (gpu)", render_control.cull_ms);
+            }
+            else if(render_control.light_path == spot_light_path::clustered_cpu)
+            {
+                ImGui::Text("light culling:  %4.2f ms (cpu)", render_control.cpu_cull_ms);
+            }
+
+            ImGui::Dummy({0.0, 16.0});
+
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Spot Shadows: ");
+            ImGui::PushID("shadows");
+            ImGui::Checkbox("shadow atlas", &render_control.spot_shadows);
+            ImGui::SliderFloat("quality", &render_control.shadow_quality, 0.25f, 4.0f);
+            ImGui::SliderInt("updates per frame", &render_control.shadow_updates, 1, 64);
+            ImGui::SliderFloat("normal bias", &render_control.shadow_bias, 0.0f, 4.0f);
+            if(ImGui::Button("invalidate tiles"))
+            {
+                atlas.revision++;
+            }
+            ImGui::PopID();
+
+            std::array<unsigned int, shadow_atlas::tiers> tiles_used{};
+            for(unsigned int t = 0; t < shadow_atlas::tiers; t++)
+            {
+                for(std::size_t i = atlas.tier_begin[t]; i < atlas.tier_begin[t + 1]; i++)
+                {
+                    tiles_used[t] += atlas.tiles[i].owner >= 0;
+                }
+            }
+            ImGui::Text("atlas:          %u^2, tiles %u/%zu %u/%zu %u/%zu %u/%zu", shadow_atlas::size,
+                        tiles_used[0], atlas.tier_begin[1] - atlas.tier_begin[0], tiles_used[1], atlas.tier_begin[2] - atlas.tier_begin[1],
+                        tiles_used[2], atlas.tier_begin[3] - atlas.tier_begin[2], tiles_used[3], atlas.tier_begin[4] - atlas.tier_begin[3]);
+            ImGui::Text("shadowed:       %u lights (%u pending)", atlas.shadowed, atlas.pending);
+            ImGui::Text("rendered:       %u tiles, %u draws", atlas.rendered, atlas.draws);
+            ImGui::Text("shadows:        %4.2f ms (gpu)", render_control.shadow_ms);
+
+            ImGui::Dummy({0.0, 16.0});
+
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "GBuffer Layout: ");
+            ImGui::PushID("gbuffer");
+            int layout = static_cast<int>(render_control.layout);
+            ImGui::RadioButton("full (pos rgb16F, normal rgb16F)", &layout, static_cast<int>(gbuffer_layout::full));
+            ImGui::RadioButton("compact (depth, octahedral rg16)", &layout, static_cast<int>(gbuffer_layout::compact));
+            ImGui::RadioButton("compact (depth, octahedral rg8)", &layout, static_cast<int>(gbuffer_layout::compact_rg8));
+            render_control.layout = static_cast<gbuffer_layout>(layout);
+            ImGui::PopID();
+
+            const char* layout_names[] = {"full", "rg16", "rg8"};
+            const double pixels = static_cast<double>(window.size().x) * window.size().y;
+            for(std::size_t i = 0; i < render_control.gpass_ms.size(); i++)
+            {
+                ImGui::Text("%-5s %5.2f MB  gpass %4.2f ms  lighting %4.2f ms", layout_names[i],
+                            gbuffer_texel_bytes(static_cast<gbuffer_layout>(i)) * pixels / (1024.0 * 1024.0),
+                            render_control.gpass_ms[i], render_control.lighting_ms[i]);
+            }
+
+            ImGui::Dummy({0.0, 16.0});
+
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Geometry Path: ");
+            ImGui::PushID("geometry");
+            int geometry = static_cast<int>(render_control.geometry);
+            ImGui::RadioButton("gbuffer pass", &geometry, static_cast<int>(geometry_path::gbuffer));
+            if(vis.valid)
+            {
+                ImGui::RadioButton("visibility buffer", &geometry, static_cast<int>(geometry_path::visibility));
+            }
+            render_control.geometry = static_cast<geometry_path>(geometry);
+            ImGui::PopID();
+
+            if(render_control.geometry == geometry_path::visibility)
+            {
+                ImGui::Text("ids:            %4.2f ms (gpu)", render_control.ids_ms);
+                ImGui::Text("resolve:        %4.2f ms (gpu, %zu materials)", render_control.resolve_ms, vis.materials.size());
+            }
+
         }
         ImGui::End();
 
@@ -422,13 +1532,13 @@ int main(int argc, char** argv)
         ImGui::SetNextWindowPos({16.0f, window.size().y - 256.0f - 32.0f});
         ImGui::Begin("##GBuffer", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoTitleBar);
         {
-            ImGui::Image(tex_pos.get(), {128, 128}, {0, 1}, {1, 0});
+            ImGui::Image(gbuf.pos ? gbuf.pos.get() : gbuf.depth.get(), {128, 128}, {0, 1}, {1, 0});
             ImGui::SameLine();
-            ImGui::Image(tex_normal.get(), {128, 128}, {0, 1}, {1, 0});
+            ImGui::Image(gbuf.normal.get(), {128, 128}, {0, 1}, {1, 0});
 
-            ImGui::Image(tex_material.get(), {128, 128}, {0, 1}, {1, 0});
+            ImGui::Image(gbuf.material.get(), {128, 128}, {0, 1}, {1, 0});
             ImGui::SameLine();
-            ImGui::Image(tex_depth.get(), {128, 128}, {0, 1}, {1, 0});
+            ImGui::Image(gbuf.depth.get(), {128, 128}, {0, 1}, {1, 0});
         }
         ImGui::End();
     });
@@ -0,0 +1,38 @@
+#version 330
+
+struct Material
+{
+    float shininess;
+    sampler2D map_diffuse;
+};
+
+uniform Material uMaterial;
+
+/* compact layout: position comes from the depth buffer, normals are octahedral encoded into two snorm channels */
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gMaterial;
+
+in VS_OUT
+{
+    vec3 normal;
+    vec3 fragPos;
+    vec2 texCoord;
+} fs_in;
+
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encode_normal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+}
+
+void main(void)
+{
+    gNormal = encode_normal(normalize(fs_in.normal));
+    gMaterial = vec4(texture(uMaterial.map_diffuse, fs_in.texCoord).rgb, uMaterial.shininess / 255.0);
+}
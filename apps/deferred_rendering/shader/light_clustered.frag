@@ -0,0 +1,204 @@
+#version 430
+
+struct Light
+{
+    vec3 position;
+    vec3 direction;
+
+    vec3 color;
+
+    float innerCutoff;
+    float outerCutoff;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+layout(std430, binding = 0) readonly buffer bLights
+{
+    Light lights[];
+};
+
+layout(std430, binding = 1) readonly buffer bClusterGrid
+{
+    uvec2 grid[];
+};
+
+layout(std430, binding = 2) readonly buffer bClusterIndices
+{
+    uint indices[];
+};
+
+/* shadow atlas entry of each light: light space matrix and uv rect of its tile (empty rect: not shadowed) */
+struct Shadow
+{
+    mat4 lightSpace;
+    vec4 rect;
+};
+
+layout(std430, binding = 3) readonly buffer bShadows
+{
+    Shadow shadows[];
+};
+
+struct Buffer
+{
+    sampler2D pos;
+    sampler2D normal;
+    sampler2D material;
+    sampler2D depth;
+};
+
+uniform vec3 uViewPos;
+uniform vec2 uViewSize;
+uniform mat4 uView;
+uniform uvec3 uClusters;
+uniform vec2 uDepthRange;
+uniform uint uMaxLights;
+uniform float uDistanceScale;
+uniform bool uHeatmap;
+uniform Buffer gBuffer;
+uniform bool uCompact;
+uniform mat4 uInvViewProj;
+uniform bool uShadows;
+uniform float uShadowBias;
+uniform sampler2DShadow uShadowAtlas;
+
+
+out vec4 fragColor;
+
+
+vec3 brdf_blinn_phong(vec3 lightDir, vec3 viewDir, vec3 normal, vec3 diffuse, vec3 specular, float shininess)
+{
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    vec3 reflectDir = reflect(-lightDir, normal);
+
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+
+    return (diff * diffuse) + (spec * specular);
+}
+
+/* lit fraction from the atlas tile of the light: the position is offset along the normal by the world size of a
+   tile texel, four bilinear comparisons are kept one texel inside the tile */
+float spot_shadow(int index, Light light, vec3 fragPos, vec3 normal, float distance)
+{
+    if(!uShadows) { return 1.0; }
+
+    Shadow shadow = shadows[index];
+    if(shadow.rect.z == 0.0) { return 1.0; }
+
+    vec2 atlasSize = vec2(textureSize(uShadowAtlas, 0));
+    float texelWorld = 2.0 * distance * tan(min(light.outerCutoff, radians(85.0))) / (shadow.rect.z * atlasSize.x);
+
+    vec4 pos = shadow.lightSpace * vec4(fragPos + normal * texelWorld * uShadowBias, 1.0);
+    vec3 ndc = pos.xyz / pos.w;
+    if(pos.w <= 0.0 || any(greaterThan(abs(ndc), vec3(1.0)))) { return 1.0; }
+
+    vec2 texel = 1.0 / atlasSize;
+    vec2 uv = shadow.rect.xy + (ndc.xy * 0.5 + 0.5) * shadow.rect.zw;
+    float depth = ndc.z * 0.5 + 0.5;
+
+    float lit = 0.0;
+    for(int i = 0; i < 4; i++)
+    {
+        vec2 offset = (vec2(i & 1, i >> 1) - 0.5) * texel;
+        lit += texture(uShadowAtlas, vec3(clamp(uv + offset, shadow.rect.xy + texel, shadow.rect.xy + shadow.rect.zw - texel), depth));
+    }
+
+    return lit * 0.25;
+}
+
+/* distance at which the light falls below 5/256 of its maximum (extent of its light volume) */
+float light_range(Light light)
+{
+    float illMax = max(max(light.color.r, light.color.g), light.color.b);
+    float l = light.linear;
+    float q = light.quadratic;
+    return uDistanceScale * (-l + sqrt(l * l - 4.0 * q * (light.constant - (256.0 / 5.0) * illMax))) / (2.0 * q);
+}
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+/* octahedral normal of the compact layout */
+vec3 decode_normal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0) { n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy); }
+    return normalize(n);
+}
+
+/* world position and normal, either stored (full layout) or reconstructed from depth (compact layout) */
+void read_gbuffer(vec2 texCoord, out vec3 fragPos, out vec3 normal)
+{
+    if(uCompact)
+    {
+        float depth = texture(gBuffer.depth, texCoord).r;
+        vec4 pos = uInvViewProj * vec4(vec3(texCoord, depth) * 2.0 - 1.0, 1.0);
+        fragPos = pos.xyz / pos.w;
+        normal = decode_normal(texture(gBuffer.normal, texCoord).rg);
+    }
+    else
+    {
+        fragPos = texture(gBuffer.pos, texCoord).rgb;
+        normal = normalize(texture(gBuffer.normal, texCoord).rgb);
+    }
+}
+
+void main(void)
+{
+    vec2 texCoord = gl_FragCoord.xy / uViewSize.xy;
+
+    /* nothing was rendered here */
+    if(uCompact ? texture(gBuffer.depth, texCoord).r == 1.0 : texture(gBuffer.normal, texCoord).rgb == vec3(0.0)) { discard; }
+
+    vec3 fragPos, normal;
+    read_gbuffer(texCoord, fragPos, normal);
+
+    vec4 material = texture(gBuffer.material, texCoord).rgba;
+    vec3 diffuse = material.rgb;
+    float shininess = material.a * 256.0;
+    vec3 specular = diffuse;
+    vec3 viewDir = normalize(uViewPos - fragPos);
+
+    /* cluster of the fragment (exponential depth slices) */
+    float depth = -(uView * vec4(fragPos, 1.0)).z;
+    uint slice = uint(clamp(log(depth / uDepthRange.x) / log(uDepthRange.y / uDepthRange.x) * float(uClusters.z), 0.0, float(uClusters.z - 1u)));
+    uvec2 tile = min(uvec2(texCoord * vec2(uClusters.xy)), uClusters.xy - 1u);
+    uvec2 cluster = grid[(slice * uClusters.y + tile.y) * uClusters.x + tile.x];
+
+    if(uHeatmap)
+    {
+        float load = float(cluster.y) / float(uMaxLights);
+        fragColor = vec4(load > 1.0 ? vec3(1.0, 0.0, 1.0) : mix(vec3(0.0, 0.0, 0.2), vec3(1.0, 0.8, 0.0), load), 1.0);
+        return;
+    }
+
+    vec3 illuminance = vec3(0.0);
+    uint count = min(cluster.y, uMaxLights);
+    for(uint i = 0u; i < count; i++)
+    {
+        int index = int(indices[cluster.x + i]);
+        Light light = lights[index];
+
+        float distance = length(light.position - fragPos);
+        if(distance > light_range(light)) { continue; }
+
+        vec3 lightDir = normalize(light.position - fragPos);
+        vec3 spotDir = normalize(-light.direction);
+
+        float theta = acos(dot(lightDir, spotDir));
+        float epsilon = (light.outerCutoff - light.innerCutoff);
+        float intensity = clamp((light.outerCutoff - theta) / epsilon, 0.0, 1.0);
+        float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+        if(intensity <= 0.0) { continue; }
+
+        illuminance += spot_shadow(index, light, fragPos, normal, distance) * intensity * attenuation * light.color * brdf_blinn_phong(lightDir, viewDir, normal, diffuse, specular, shininess);
+    }
+
+    fragColor = vec4(illuminance, 1.0);
+}
@@ -13,12 +13,15 @@ struct Buffer
     sampler2D pos;
     sampler2D normal;
     sampler2D material;
+    sampler2D depth;
 };
 
 uniform vec3 uViewPos;
 uniform vec2 uViewSize;
 uniform Light uLight;
 uniform Buffer gBuffer;
+uniform bool uCompact;
+uniform mat4 uInvViewProj;
 
 
 out vec4 fragColor;
@@ -35,11 +38,41 @@ vec3 brdf_blinn_phong(vec3 lightDir, vec3 viewDir, vec3 normal, vec3 diffuse, ve
     return (diff * diffuse) + (spec * specular);
 }
 
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+/* octahedral normal of the compact layout */
+vec3 decode_normal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0) { n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy); }
+    return normalize(n);
+}
+
+/* world position and normal, either stored (full layout) or reconstructed from depth (compact layout) */
+void read_gbuffer(vec2 texCoord, out vec3 fragPos, out vec3 normal)
+{
+    if(uCompact)
+    {
+        float depth = texture(gBuffer.depth, texCoord).r;
+        vec4 pos = uInvViewProj * vec4(vec3(texCoord, depth) * 2.0 - 1.0, 1.0);
+        fragPos = pos.xyz / pos.w;
+        normal = decode_normal(texture(gBuffer.normal, texCoord).rg);
+    }
+    else
+    {
+        fragPos = texture(gBuffer.pos, texCoord).rgb;
+        normal = normalize(texture(gBuffer.normal, texCoord).rgb);
+    }
+}
+
 void main(void)
 {
     vec2 texCoord = gl_FragCoord.xy / uViewSize.xy;
-    vec3 fragPos = texture(gBuffer.pos, texCoord).rgb;
-    vec3 normal = normalize(texture(gBuffer.normal, texCoord).rgb);
+    vec3 fragPos, normal;
+    read_gbuffer(texCoord, fragPos, normal);
     vec4 material = texture(gBuffer.material, texCoord).rgba;
 
     vec3 diffuse = material.rgb;
@@ -20,18 +20,37 @@ layout(std430, binding = 0) buffer bLights
     Light lights[];
 };
 
+/* shadow atlas entry of each light: light space matrix and uv rect of its tile (empty rect: not shadowed) */
+struct Shadow
+{
+    mat4 lightSpace;
+    vec4 rect;
+};
+
+layout(std430, binding = 3) readonly buffer bShadows
+{
+    Shadow shadows[];
+};
+
 struct Buffer
 {
     sampler2D pos;
     sampler2D normal;
     sampler2D material;
+    sampler2D depth;
 };
 
 uniform vec3 uViewPos;
 uniform vec2 uViewSize;
-uniform int uLightIndex;
 uniform Buffer gBuffer;
+uniform bool uCompact;
+uniform mat4 uInvViewProj;
+uniform bool uShadows;
+uniform float uShadowBias;
+uniform sampler2DShadow uShadowAtlas;
+
 
+flat in int vLightIndex;
 
 out vec4 fragColor;
 
@@ -47,12 +66,72 @@ vec3 brdf_blinn_phong(vec3 lightDir, vec3 viewDir, vec3 normal, vec3 diffuse, ve
     return (diff * diffuse) + (spec * specular);
 }
 
+/* lit fraction from the atlas tile of the light: the position is offset along the normal by the world size of a
+   tile texel, four bilinear comparisons are kept one texel inside the tile */
+float spot_shadow(int index, Light light, vec3 fragPos, vec3 normal, float distance)
+{
+    if(!uShadows) { return 1.0; }
+
+    Shadow shadow = shadows[index];
+    if(shadow.rect.z == 0.0) { return 1.0; }
+
+    vec2 atlasSize = vec2(textureSize(uShadowAtlas, 0));
+    float texelWorld = 2.0 * distance * tan(min(light.outerCutoff, radians(85.0))) / (shadow.rect.z * atlasSize.x);
+
+    vec4 pos = shadow.lightSpace * vec4(fragPos + normal * texelWorld * uShadowBias, 1.0);
+    vec3 ndc = pos.xyz / pos.w;
+    if(pos.w <= 0.0 || any(greaterThan(abs(ndc), vec3(1.0)))) { return 1.0; }
+
+    vec2 texel = 1.0 / atlasSize;
+    vec2 uv = shadow.rect.xy + (ndc.xy * 0.5 + 0.5) * shadow.rect.zw;
+    float depth = ndc.z * 0.5 + 0.5;
+
+    float lit = 0.0;
+    for(int i = 0; i < 4; i++)
+    {
+        vec2 offset = (vec2(i & 1, i >> 1) - 0.5) * texel;
+        lit += texture(uShadowAtlas, vec3(clamp(uv + offset, shadow.rect.xy + texel, shadow.rect.xy + shadow.rect.zw - texel), depth));
+    }
+
+    return lit * 0.25;
+}
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+/* octahedral normal of the compact layout */
+vec3 decode_normal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0) { n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy); }
+    return normalize(n);
+}
+
+/* world position and normal, either stored (full layout) or reconstructed from depth (compact layout) */
+void read_gbuffer(vec2 texCoord, out vec3 fragPos, out vec3 normal)
+{
+    if(uCompact)
+    {
+        float depth = texture(gBuffer.depth, texCoord).r;
+        vec4 pos = uInvViewProj * vec4(vec3(texCoord, depth) * 2.0 - 1.0, 1.0);
+        fragPos = pos.xyz / pos.w;
+        normal = decode_normal(texture(gBuffer.normal, texCoord).rg);
+    }
+    else
+    {
+        fragPos = texture(gBuffer.pos, texCoord).rgb;
+        normal = normalize(texture(gBuffer.normal, texCoord).rgb);
+    }
+}
+
 void main(void)
 {
-    Light uLight = lights[uLightIndex];
+    Light uLight = lights[vLightIndex];
     vec2 texCoord = gl_FragCoord.xy / uViewSize.xy;
-    vec3 fragPos = texture(gBuffer.pos, texCoord).rgb;
-    vec3 normal = normalize(texture(gBuffer.normal, texCoord).rgb);
+    vec3 fragPos, normal;
+    read_gbuffer(texCoord, fragPos, normal);
 
     vec4 material = texture(gBuffer.material, texCoord).rgba;
     vec3 diffuse = material.rgb;
@@ -70,7 +149,9 @@ void main(void)
     float distance    = length(uLight.position - fragPos);
     float attenuation = 1.0 / (uLight.constant + uLight.linear * distance + uLight.quadratic * (distance * distance));
 
-    vec3 illuminance = intensity * attenuation * uLight.color * brdf_blinn_phong(lightDir, viewDir, normal, diffuse, specular, shininess);
+    float shadow = intensity > 0.0 ? spot_shadow(vLightIndex, uLight, fragPos, normal, distance) : 1.0;
+
+    vec3 illuminance = shadow * intensity * attenuation * uLight.color * brdf_blinn_phong(lightDir, viewDir, normal, diffuse, specular, shininess);
 
     fragColor = vec4(illuminance, 1.0);
 }
@@ -5,8 +5,12 @@ layout(location = 0) in vec3 aPosition;
 uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProj;
+uniform int uLightIndex;
+
+flat out int vLightIndex;
 
 void main(void)
 {
+    vLightIndex = uLightIndex;
     gl_Position =  uProj * uView * uModel * vec4(aPosition, 1.0);
 }
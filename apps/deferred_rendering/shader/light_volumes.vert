@@ -0,0 +1,59 @@
+#version 430
+
+/* light volumes of all spot lights in one instanced draw, the transform of each pyramid is built from its light */
+layout(location = 0) in vec3 aPosition;
+
+struct Light
+{
+    vec3 position;
+    vec3 direction;
+
+    vec3 color;
+
+    float innerCutoff;
+    float outerCutoff;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+layout(std430, binding = 0) buffer bLights
+{
+    Light lights[];
+};
+
+uniform mat4 uView;
+uniform mat4 uProj;
+uniform float uDistanceScale;
+
+flat out int vLightIndex;
+
+
+/* distance at which the light falls below 5/256 of its maximum (extent of its light volume) */
+float light_range(Light light)
+{
+    float illMax = max(max(light.color.r, light.color.g), light.color.b);
+    float l = light.linear;
+    float q = light.quadratic;
+    return uDistanceScale * (-l + sqrt(l * l - 4.0 * q * (light.constant - (256.0 / 5.0) * illMax))) / (2.0 * q);
+}
+
+/* pyramid apex at the light, -y along the light direction, base covering the outer cone */
+mat4 light_transform(Light light)
+{
+    float range = light_range(light);
+    float extent = tan(light.outerCutoff) * range;
+
+    vec3 y = -normalize(light.direction);
+    vec3 x = normalize(cross(abs(y.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 0.0, 1.0), y));
+    vec3 z = cross(x, y);
+
+    return mat4(vec4(x * extent, 0.0), vec4(y * range, 0.0), vec4(z * extent, 0.0), vec4(light.position, 1.0));
+}
+
+void main(void)
+{
+    vLightIndex = gl_InstanceID;
+    gl_Position = uProj * uView * light_transform(lights[gl_InstanceID]) * vec4(aPosition, 1.0);
+}
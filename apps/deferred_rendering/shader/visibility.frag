@@ -0,0 +1,11 @@
+#version 330
+
+/* draw (upper bits) and triangle of the draw (lower 20 bits) */
+uniform uint uDrawID;
+
+layout (location = 0) out uint gID;
+
+void main(void)
+{
+    gID = (uDrawID << 20u) | uint(gl_PrimitiveID);
+}
@@ -8,5 +8,5 @@ uniform mat4 uProj;
 
 void main(void)
 {
-    gl_Position =  uProj * uView * uModel * vec4(aPosition, 1.0);
+    gl_Position = uProj * uView * uModel * vec4(aPosition, 1.0);
 }
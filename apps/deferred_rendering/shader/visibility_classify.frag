@@ -0,0 +1,21 @@
+#version 430
+
+/* first index, base vertex, material */
+layout(std430, binding = 2) readonly buffer bDraws
+{
+    uvec4 draws[];
+};
+
+uniform usampler2D uIDs;
+uniform sampler2D uSceneDepth;
+
+/* material of the visible triangle as depth (m + 1) / 4096, exact in float and in the depth buffer, the material
+   passes select their pixels with an equal depth test */
+void main(void)
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    if(texelFetch(uSceneDepth, pixel, 0).r == 1.0) { discard; }
+
+    uint id = texelFetch(uIDs, pixel, 0).r;
+    gl_FragDepth = float(draws[id >> 20u].z + 1u) / 4096.0;
+}
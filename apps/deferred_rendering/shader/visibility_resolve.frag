@@ -0,0 +1,141 @@
+#version 430
+
+struct Material
+{
+    float shininess;
+    sampler2D map_diffuse;
+};
+
+/* interleaved vertices (position, normal, texcoord) */
+layout(std430, binding = 0) readonly buffer bVertices
+{
+    float vertices[];
+};
+
+layout(std430, binding = 1) readonly buffer bIndices
+{
+    uint indices[];
+};
+
+/* first index, base vertex, material */
+layout(std430, binding = 2) readonly buffer bDraws
+{
+    uvec4 draws[];
+};
+
+uniform usampler2D uIDs;
+uniform mat4 uModel;
+uniform mat3 uNormalMatrix;
+uniform mat4 uViewProj;
+uniform vec2 uViewSize;
+uniform uint uMaterialIndex;
+uniform bool uCompact;
+uniform Material uMaterial;
+
+/* full layout: position, normal, material; compact layout: octahedral normal, material */
+layout (location = 0) out vec4 gTarget0;
+layout (location = 1) out vec4 gTarget1;
+layout (location = 2) out vec4 gTarget2;
+
+const uint vertexStride = 8u;
+
+
+struct Barycentrics
+{
+    vec3 lambda;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+/* perspective correct barycentrics of the pixel and their screen space derivatives, from the clip space corners */
+Barycentrics barycentrics(vec4 p0, vec4 p1, vec4 p2, vec2 ndc)
+{
+    vec3 invW = 1.0 / vec3(p0.w, p1.w, p2.w);
+    vec2 ndc0 = p0.xy * invW.x;
+    vec2 ndc1 = p1.xy * invW.y;
+    vec2 ndc2 = p2.xy * invW.z;
+
+    float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+    vec3 ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    vec3 ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+    float ddxSum = dot(ddx, vec3(1.0));
+    float ddySum = dot(ddy, vec3(1.0));
+
+    vec2 delta = ndc - ndc0;
+    float interpInvW = invW.x + delta.x * ddxSum + delta.y * ddySum;
+    float interpW = 1.0 / interpInvW;
+
+    Barycentrics result;
+    result.lambda = interpW * (vec3(invW.x, 0.0, 0.0) + delta.x * ddx + delta.y * ddy);
+
+    /* one pixel steps in ndc */
+    vec2 pixel = 2.0 / uViewSize;
+    ddx *= pixel.x;
+    ddy *= pixel.y;
+    ddxSum *= pixel.x;
+    ddySum *= pixel.y;
+
+    result.ddx = (1.0 / (interpInvW + ddxSum)) * (interpInvW * result.lambda + ddx) - result.lambda;
+    result.ddy = (1.0 / (interpInvW + ddySum)) * (interpInvW * result.lambda + ddy) - result.lambda;
+    return result;
+}
+
+vec3 vertex_vec3(uint index, uint offset)
+{
+    uint base = index * vertexStride + offset;
+    return vec3(vertices[base], vertices[base + 1u], vertices[base + 2u]);
+}
+
+vec2 vertex_vec2(uint index, uint offset)
+{
+    uint base = index * vertexStride + offset;
+    return vec2(vertices[base], vertices[base + 1u]);
+}
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encode_normal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+}
+
+void main(void)
+{
+    uint id = texelFetch(uIDs, ivec2(gl_FragCoord.xy), 0).r;
+    uvec4 draw = draws[id >> 20u];
+    if(draw.z != uMaterialIndex) { discard; }
+
+    uint first = draw.x + 3u * (id & 0xFFFFFu);
+    uvec3 tri = uvec3(indices[first], indices[first + 1u], indices[first + 2u]) + draw.y;
+
+    vec3 pos0 = vec3(uModel * vec4(vertex_vec3(tri.x, 0u), 1.0));
+    vec3 pos1 = vec3(uModel * vec4(vertex_vec3(tri.y, 0u), 1.0));
+    vec3 pos2 = vec3(uModel * vec4(vertex_vec3(tri.z, 0u), 1.0));
+
+    vec2 ndc = gl_FragCoord.xy / uViewSize * 2.0 - 1.0;
+    Barycentrics b = barycentrics(uViewProj * vec4(pos0, 1.0), uViewProj * vec4(pos1, 1.0), uViewProj * vec4(pos2, 1.0), ndc);
+
+    vec3 fragPos = mat3(pos0, pos1, pos2) * b.lambda;
+    vec3 normal = normalize(uNormalMatrix * (mat3(vertex_vec3(tri.x, 3u), vertex_vec3(tri.y, 3u), vertex_vec3(tri.z, 3u)) * b.lambda));
+
+    /* texture coordinates and their derivatives select the mip level like the rasterizer would */
+    mat3x2 uvs = mat3x2(vertex_vec2(tri.x, 6u), vertex_vec2(tri.y, 6u), vertex_vec2(tri.z, 6u));
+    vec3 diffuse = textureGrad(uMaterial.map_diffuse, uvs * b.lambda, uvs * b.ddx, uvs * b.ddy).rgb;
+    vec4 material = vec4(diffuse, uMaterial.shininess / 255.0);
+
+    if(uCompact)
+    {
+        gTarget0 = vec4(encode_normal(normal), 0.0, 0.0);
+        gTarget1 = material;
+    }
+    else
+    {
+        gTarget0 = vec4(fragPos, 1.0);
+        gTarget1 = vec4(normal, 0.0);
+        gTarget2 = material;
+    }
+}
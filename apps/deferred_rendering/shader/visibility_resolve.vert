@@ -0,0 +1,11 @@
+#version 330
+
+layout(location = 0) in vec3 aPosition;
+
+/* full screen quad at the depth of a material */
+uniform float uDepth;
+
+void main(void)
+{
+    gl_Position = vec4(aPosition.xy, uDepth, 1.0);
+}
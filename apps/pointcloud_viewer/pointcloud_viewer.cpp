@@ -9,6 +9,7 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtx/euler_angles.hpp>
 
+#include <filesystem>
 #include <iostream>
 
 struct vertex
@@ -65,8 +66,23 @@ int main(int argc, char** argv)
 
     auto& context = view.context();
 
-    /* load pointcloud from ply file */
-    auto cloud = asset::pointcloud_loader<vertex>::load_ply(context, "assets/pc_porsche/porsche.ply");
+    /* load pointcloud from ply file (or the file given as argument, ply / las / obj) */
+    std::filesystem::path cloud_path = argc > 1 ? argv[1] : "assets/pc_porsche/porsche.ply";
+
+    asset::pointcloud_loader<vertex>::result_type cloud;
+    if(cloud_path.extension() == ".las" || cloud_path.extension() == ".LAS")
+    {
+        cloud = asset::pointcloud_loader<vertex>::load_las(context, cloud_path);
+    }
+    else if(cloud_path.extension() == ".obj")
+    {
+        cloud = asset::pointcloud_loader<vertex>::load_obj(context, cloud_path);
+    }
+    else
+    {
+        cloud = asset::pointcloud_loader<vertex>::load_ply(context, cloud_path);
+    }
+
     if(!cloud)
     {
         std::cerr << "Failure while reading pointcloud file!" << std::endl;
@@ -6,14 +6,24 @@
 #include <viewer/asset/obj_model.h>
 #include <viewer/asset/shapes.h>
 #include <viewer/asset/texture.h>
+#include <viewer/asset/spherical_harmonics.h>
+#include <viewer/asset/probe_cache.h>
+#include <viewer/core/time.h>
 
 #include <viewer/opengl/shaderprogram.h>
 #include <viewer/opengl/texture.h>
 #include <viewer/opengl/texturecube.h>
 #include <viewer/opengl/framebuffer.h>
+#include <viewer/opengl/fence.h>
+#include <viewer/opengl/query.h>
+#include <viewer/opengl/buffer.h>
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 /************** materials and vertex definition **************/
 struct material_scene
 {
@@ -51,6 +61,12 @@ struct reflection_settings
     bool normal_map = true;
     bool render_volume = false;
     int selected = 0;
+
+    /* ggx prefiltered maps (one fetch at the roughness level) and sh irradiance */
+    bool prefiltered = true;
+    float roughness = 0.2f;
+    bool irradiance = true;
+    bool cpu_sh = false;
 };
 
 struct reflection_prope
@@ -61,6 +77,41 @@ struct reflection_prope
 
     glm::vec3 position;
     glm::vec3 extends;
+
+    /* specular mip chain (roughness = level / (levels - 1)) and irradiance of the captured scene */
+    opengl::handle<opengl::texture_cube> tex_prefiltered;
+    asset::sh_coefficients sh;
+
+    /* single face target of time-sliced updates */
+    opengl::handle<opengl::framebuffer> framebuffer_face;
+
+    /* gpu sh coefficients on their way back (time-sliced updates don't wait on them) */
+    opengl::handle<opengl::buffer<glm::vec4>> sh_staging;
+    opengl::handle<opengl::fence> sh_fence;
+
+    /* placement last written to the probe cache */
+    std::uint64_t baked{0};
+};
+
+/* passes turning a captured probe into its prefiltered map and sh coefficients */
+struct prope_filter
+{
+    static constexpr unsigned int size = 256;
+    static constexpr unsigned int levels = 6;
+    static constexpr int samples = 64;
+
+    /* source level projected onto the sh basis (32^2 texels per face for 1024^2 probes) */
+    static constexpr unsigned int sh_level = 5;
+
+    opengl::handle<opengl::shader_program> shader_prefilter;
+    opengl::handle<opengl::shader_program> shader_sh;
+    opengl::handle<opengl::framebuffer> framebuffer;
+    opengl::handle<opengl::framebuffer> framebuffer_sh;
+    opengl::handle<opengl::texture> tex_sh;
+    std::shared_ptr<asset::mesh<vertex>> screen_quad;
+
+    double prefilter_ms = 0.0;
+    double sh_ms = 0.0;
 };
 
 /* construct framebuffer with cubemap attachments */
@@ -69,54 +120,564 @@ reflection_prope construct_prope(opengl::context& gl_context, const glm::uvec2&
     auto tex_cube_color = gl_context.make_texture_cube(opengl::texture_internal_type::rgba8, opengl::texture_format::rgba, opengl::texture_type::unsigned_byte_, 1024, 1024);
     auto tex_cube_depth = gl_context.make_texture_cube(opengl::texture_internal_type::depth, opengl::texture_format::depth, opengl::texture_type::float_, 1024, 1024);
 
-    tex_cube_color->parameter(opengl::min_filter::linear);
+    tex_cube_color->parameter(opengl::min_filter::linear_mipmap_linear);
     tex_cube_color->parameter(opengl::mag_filter::linear);
 
+    /* r11g11b10f: a third of the memory of rgba16f, no alpha needed */
+    auto tex_cube_prefiltered = gl_context.make_texture_cube(opengl::texture_internal_type::r11g11b10f, opengl::texture_format::rgb, opengl::texture_type::float_,
+                                                             prope_filter::size, prope_filter::size);
+    tex_cube_prefiltered->mip_levels(prope_filter::levels);
+    tex_cube_prefiltered->parameter(opengl::min_filter::linear_mipmap_linear);
+    tex_cube_prefiltered->parameter(opengl::mag_filter::linear);
+
     auto fb_cube = gl_context.make_framebuffer();
     fb_cube->attach_color(0, tex_cube_color);
     fb_cube->attach_depth(tex_cube_depth);
     fb_cube->draw_attachment(0);
 
-    return reflection_prope{ fb_cube, tex_cube_color, tex_cube_depth, pos, extends };
+    auto sh_staging = gl_context.make_buffer<glm::vec4>(opengl::buffer_target::pixel_pack, 9, opengl::buffer_usage::stream_read);
+    sh_staging->unbind();
+
+    return reflection_prope{ fb_cube, tex_cube_color, tex_cube_depth, pos, extends, tex_cube_prefiltered, {},
+                             gl_context.make_framebuffer(), sh_staging, gl_context.make_fence() };
+}
+
+/* fragment passes and render targets of the probe filtering */
+prope_filter construct_filter(opengl::context& gl_context)
+{
+    prope_filter filter;
+
+    filter.shader_prefilter = gl_context.make_shader();
+    filter.shader_prefilter->load("reflection_probes/shader/prefilter.vert", opengl::shader_type::vertex);
+    filter.shader_prefilter->load("reflection_probes/shader/prefilter.geom", opengl::shader_type::geometry);
+    filter.shader_prefilter->load("reflection_probes/shader/prefilter.frag", opengl::shader_type::fragment);
+    filter.shader_prefilter->link();
+
+    filter.shader_sh = gl_context.make_shader();
+    filter.shader_sh->load("reflection_probes/shader/prefilter.vert", opengl::shader_type::vertex);
+    filter.shader_sh->load("reflection_probes/shader/sh_project.frag", opengl::shader_type::fragment);
+    filter.shader_sh->link();
+
+    filter.framebuffer = gl_context.make_framebuffer();
+
+    /* one texel per coefficient */
+    filter.tex_sh = gl_context.make_texture(opengl::texture_internal_type::rgba32f, opengl::texture_format::rgba, opengl::texture_type::float_, 9, 1);
+    filter.tex_sh->parameter(opengl::min_filter::nearest);
+    filter.tex_sh->parameter(opengl::mag_filter::nearest);
+    filter.framebuffer_sh = gl_context.make_framebuffer();
+    filter.framebuffer_sh->attach_color(0, filter.tex_sh);
+    filter.framebuffer_sh->draw_attachment(0);
+
+    filter.screen_quad = asset::shape<vertex>::create_screenquad(gl_context);
+    return filter;
 }
 
-/* render scene from prope viewpoint to cubemap */
-void render_prope(reflection_prope& refl_prope, opengl::context& gl_context, opengl::handle<opengl::shader_program>& shader_prope, const std::function<void(opengl::handle<opengl::shader_program>&, bool)>& render_func)
+/* ggx prefiltering of the captured cube map into the mip levels of the r11g11b10f map (all faces of a level in
+   one layered pass) and sh projection of the radiance, on the gpu or read back and projected on the cpu; without
+   wait the gpu coefficients are read back asynchronously (resolve_prope_sh) and no timings are taken */
+void filter_prope(reflection_prope& refl_prope, opengl::context& gl_context, prope_filter& filter, bool cpu_sh, bool wait = true)
 {
-    refl_prope.framebuffer->bind();
+    auto start = core::clock::now();
+    auto blend = gl_context.set(opengl::options::blend, false);
+    auto depth_test = gl_context.set(opengl::options::depth_test, false);
+    auto viewport = gl_context.viewport();
+
+    /* source mip chain for filtered importance sampling */
+    refl_prope.tex_color->generate_mip_maps();
+    refl_prope.tex_color->bind(0);
+
+    filter.shader_prefilter->bind();
+    filter.shader_prefilter->uniform("uEnvironment", 0);
+    filter.shader_prefilter->uniform("uSourceSize", static_cast<float>(refl_prope.tex_color->size(opengl::cube_face::positive_x).x));
+    filter.shader_prefilter->uniform("uSamples", prope_filter::samples);
+
+    for(unsigned int level = 0; level < prope_filter::levels; level++)
     {
-        auto size = refl_prope.tex_color->size(opengl::cube_face::positive_x);
-        auto viewport = gl_context.viewport(0, 0, size.x, size.y);
-        gl_context.clear(opengl::clear_options::color_depth);
+        unsigned int size = std::max(prope_filter::size >> level, 1u);
 
-        auto prope_pos = refl_prope.position;
+        filter.framebuffer->attach_color(0, refl_prope.tex_prefiltered, level);
+        filter.framebuffer->draw_attachment(0);
+        filter.framebuffer->bind();
+        gl_context.viewport(0, 0, size, size);
 
-        /* setup view matrices for each cube face */
-        std::array<glm::mat4, 6> views =
+        filter.shader_prefilter->uniform("uFaceSize", static_cast<float>(size));
+        filter.shader_prefilter->uniform("uRoughness", static_cast<float>(level) / (prope_filter::levels - 1));
+        filter.screen_quad->vao()->draw(opengl::primitives::triangles);
+    }
+    filter.framebuffer->unbind();
+
+    if(wait)
+    {
+        auto fence = gl_context.make_fence();
+        fence->insert();
+        fence->wait(std::numeric_limits<std::uint64_t>::max());
+    }
+
+    auto sh_start = core::clock::now();
+    if(wait) { filter.prefilter_ms = core::time_cast<core::milli_sec>(sh_start - start); }
+
+    if(cpu_sh)
+    {
+        /* an asynchronous gpu read back still in flight would overwrite the projection */
+        refl_prope.sh_fence->reset();
+        refl_prope.sh = asset::sh_projection::project(*refl_prope.tex_color, prope_filter::sh_level);
+    }
+    else
+    {
+        filter.framebuffer_sh->bind();
+        gl_context.viewport(0, 0, 9, 1);
+
+        filter.shader_sh->bind();
+        filter.shader_sh->uniform("uEnvironment", 0);
+        filter.shader_sh->uniform("uLod", static_cast<float>(prope_filter::sh_level));
+        filter.shader_sh->uniform("uFaceSize", static_cast<int>(std::max(refl_prope.tex_color->size(opengl::cube_face::positive_x).x >> prope_filter::sh_level, 1u)));
+        filter.screen_quad->vao()->draw(opengl::primitives::triangles);
+
+        if(wait)
+        {
+            std::array<glm::vec4, 9> coefficients;
+            gl_context.read_pixels(0, 0, 9, 1, &coefficients[0].x);
+
+            for(int i = 0; i < 9; i++)
             {
-                glm::lookAt(prope_pos, prope_pos + glm::vec3( 1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),  // +X
-                glm::lookAt(prope_pos, prope_pos + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),  // -X
-                glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f,  1.0f, 0.0f), glm::vec3(0.0f,  0.0f, 1.0f)),  // +Y
-                glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f)), // -Y
-                glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f, 0.0f,  1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),  // +Z
-                glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f))   // -Z
-            };
+                refl_prope.sh.radiance[i] = glm::vec3(coefficients[i]);
+            }
+        }
+        else
+        {
+            /* into the pack buffer, pixels is an offset */
+            refl_prope.sh_staging->bind();
+            gl_context.read_pixels(0, 0, 9, 1, static_cast<float*>(nullptr));
+            refl_prope.sh_staging->unbind();
+            refl_prope.sh_fence->insert();
+        }
+        filter.framebuffer_sh->unbind();
+    }
+
+    if(wait)
+    {
+        filter.sh_ms = core::time_cast<core::milli_sec>(core::clock::now() - sh_start);
+        refl_prope.sh.project_ms = filter.sh_ms;
+    }
 
-        /* currently assume all faces have the same size (aabb with equal axis sizes) */
-        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    refl_prope.tex_color->unbind();
+    gl_context.viewport(viewport);
+    gl_context.set(opengl::options::depth_test, depth_test);
+    gl_context.set(opengl::options::blend, blend);
+}
+
+/* view matrices of the cube faces */
+std::array<glm::mat4, 6> prope_views(const glm::vec3& prope_pos)
+{
+    return
+        {
+            glm::lookAt(prope_pos, prope_pos + glm::vec3( 1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),  // +X
+            glm::lookAt(prope_pos, prope_pos + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),  // -X
+            glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f,  1.0f, 0.0f), glm::vec3(0.0f,  0.0f, 1.0f)),  // +Y
+            glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f)), // -Y
+            glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f, 0.0f,  1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),  // +Z
+            glm::lookAt(prope_pos, prope_pos + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f))   // -Z
+        };
+}
+
+/* currently assume all faces have the same size (aabb with equal axis sizes) */
+glm::mat4 prope_projection()
+{
+    return glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+}
+
+/* box (in the space view_proj transforms from) intersects the frustum, conservative */
+bool box_visible(const glm::mat4& view_proj, const glm::vec3& box_min, const glm::vec3& box_max)
+{
+    glm::ivec3 outside_lo(0), outside_hi(0);
+    for(unsigned int c = 0; c < 8; c++)
+    {
+        glm::vec3 corner(c & 1 ? box_max.x : box_min.x, c & 2 ? box_max.y : box_min.y, c & 4 ? box_max.z : box_min.z);
+        glm::vec4 clip = view_proj * glm::vec4(corner, 1.0f);
+        for(int a = 0; a < 3; a++)
+        {
+            outside_lo[a] += clip[a] < -clip.w;
+            outside_hi[a] += clip[a] > clip.w;
+        }
+    }
+
+    /* all corners outside of one frustum plane */
+    return !glm::any(glm::equal(outside_lo, glm::ivec3(8))) && !glm::any(glm::equal(outside_hi, glm::ivec3(8)));
+}
+
+/* render scene from prope viewpoint to cubemap (all faces in one layered pass, or a single face) */
+void render_prope(reflection_prope& refl_prope, opengl::context& gl_context, opengl::handle<opengl::shader_program>& shader_prope, const std::function<void(opengl::handle<opengl::shader_program>&, bool)>& render_func, int face = -1)
+{
+    auto& framebuffer = face < 0 ? refl_prope.framebuffer : refl_prope.framebuffer_face;
+    if(face >= 0)
+    {
+        auto cube_face = static_cast<opengl::cube_face>(static_cast<int>(opengl::cube_face::positive_x) + face);
+        framebuffer->attach_color(0, refl_prope.tex_color, cube_face);
+        framebuffer->attach_depth(refl_prope.tex_depth, cube_face);
+        framebuffer->draw_attachment(0);
+    }
+
+    framebuffer->bind();
+    {
+        auto size = refl_prope.tex_color->size(opengl::cube_face::positive_x);
+        auto viewport = gl_context.viewport(0, 0, size.x, size.y);
+        gl_context.clear(opengl::clear_options::color_depth);
 
         /* render scene to cubemap */
         shader_prope->bind();
         shader_prope->uniform("uModel", glm::translate(glm::mat4(1.0), {0.0f, -1.0f, 0.0f}));
-        shader_prope->uniform("projection", projection);
-        shader_prope->uniform("captureViews[0]", views);
+        shader_prope->uniform("projection", prope_projection());
+        shader_prope->uniform("captureViews[0]", prope_views(refl_prope.position));
+        shader_prope->uniform("uFirstFace", std::max(face, 0));
+        shader_prope->uniform("uNumFaces", face < 0 ? 6 : 1);
 
         render_func(shader_prope, false);
         render_func(shader_prope, true);
 
         gl_context.viewport(viewport);
     }
-    refl_prope.framebuffer->unbind();
+    framebuffer->unbind();
+}
+
+/************** prope capture **************/
+/* how the faces of a prope are rendered: a geometry shader replicating every triangle to all six layers, instanced
+   draws routing each instance to its face with gl_Layer from the vertex shader (ARB_shader_viewport_layer_array), or
+   one pass per face where the extension is missing; the latter two skip records outside a face frustum on the cpu */
+enum class prope_capture : int { geometry_shader = 0, instanced = 1, face_passes = 2 };
+
+using scene_record = asset::material_group<vertex, material_scene>::record;
+using scene_func = std::function<void(opengl::handle<opengl::shader_program>&, bool, const std::function<void(const scene_record&)>&)>;
+
+struct prope_renderer
+{
+    prope_capture mode = prope_capture::instanced;
+    bool layered = false;
+
+    opengl::handle<opengl::shader_program> shader_geometry;
+    opengl::handle<opengl::shader_program> shader_layered;
+    opengl::handle<opengl::shader_program> shader_face;
+
+    /* last capture */
+    unsigned int draws = 0;
+    unsigned int faces_drawn = 0;
+    unsigned int faces_culled = 0;
+};
+
+prope_renderer construct_renderer(opengl::context& gl_context)
+{
+    prope_renderer renderer;
+
+    renderer.shader_geometry = gl_context.make_shader();
+    renderer.shader_geometry->load("reflection_probes/shader/refl_prope.vert", opengl::shader_type::vertex);
+    renderer.shader_geometry->load("reflection_probes/shader/refl_prope.geom", opengl::shader_type::geometry);
+    renderer.shader_geometry->load("reflection_probes/shader/scene.frag", opengl::shader_type::fragment);
+    renderer.shader_geometry->link();
+
+    renderer.layered = gl_context.extension("GL_ARB_shader_viewport_layer_array");
+    if(renderer.layered)
+    {
+        renderer.shader_layered = gl_context.make_shader();
+        renderer.shader_layered->load("reflection_probes/shader/refl_prope_layered.vert", opengl::shader_type::vertex);
+        renderer.shader_layered->load("reflection_probes/shader/scene.frag", opengl::shader_type::fragment);
+        renderer.shader_layered->link();
+    }
+    else
+    {
+        platform_log(core::log::level::warning, "[reflection_probes] GL_ARB_shader_viewport_layer_array not supported, propes are captured in one pass per face");
+        renderer.mode = prope_capture::face_passes;
+    }
+
+    renderer.shader_face = gl_context.make_shader();
+    renderer.shader_face->load("reflection_probes/shader/refl_prope_face.vert", opengl::shader_type::vertex);
+    renderer.shader_face->load("reflection_probes/shader/scene.frag", opengl::shader_type::fragment);
+    renderer.shader_face->link();
+
+    return renderer;
+}
+
+/* render scene from prope viewpoint to cubemap with the selected capture path (all faces, or a single face) */
+void capture_prope(reflection_prope& refl_prope, opengl::context& gl_context, prope_renderer& renderer, const scene_func& render_func, int face = -1)
+{
+    if(renderer.mode == prope_capture::geometry_shader)
+    {
+        render_prope(refl_prope, gl_context, renderer.shader_geometry, [&](auto& shader, bool transparent_only)
+        {
+            render_func(shader, transparent_only, [](const scene_record& record){ record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles); });
+        }, face);
+        return;
+    }
+
+    const glm::mat4 model = glm::translate(glm::mat4(1.0), {0.0f, -1.0f, 0.0f});
+    const auto views = prope_views(refl_prope.position);
+    const auto projection = prope_projection();
+
+    std::array<glm::mat4, 6> model_view_proj;
+    for(int i = 0; i < 6; i++)
+    {
+        model_view_proj[i] = projection * views[i] * model;
+    }
+
+    const int first = std::max(face, 0);
+    const int last = face < 0 ? 6 : face + 1;
+    renderer.draws = renderer.faces_drawn = renderer.faces_culled = 0;
+
+    auto size = refl_prope.tex_color->size(opengl::cube_face::positive_x);
+    auto viewport = gl_context.viewport(0, 0, size.x, size.y);
+
+    auto attach_face = [&](int i)
+    {
+        auto cube_face = static_cast<opengl::cube_face>(static_cast<int>(opengl::cube_face::positive_x) + i);
+        refl_prope.framebuffer_face->attach_color(0, refl_prope.tex_color, cube_face);
+        refl_prope.framebuffer_face->attach_depth(refl_prope.tex_depth, cube_face);
+        refl_prope.framebuffer_face->draw_attachment(0);
+    };
+
+    if(renderer.mode == prope_capture::instanced && renderer.layered)
+    {
+        /* all faces into the layered target, a single face into the face target (gl_Layer is ignored there) */
+        auto& framebuffer = face < 0 ? refl_prope.framebuffer : refl_prope.framebuffer_face;
+        if(face >= 0) { attach_face(face); }
+
+        framebuffer->bind();
+        gl_context.clear(opengl::clear_options::color_depth);
+
+        auto& shader = renderer.shader_layered;
+        shader->bind();
+        shader->uniform("uModel", model);
+        shader->uniform("projection", projection);
+        shader->uniform("captureViews[0]", views);
+
+        auto draw = [&](const scene_record& record)
+        {
+            std::array<int, 6> faces{};
+            int count = 0;
+            for(int i = first; i < last; i++)
+            {
+                if(box_visible(model_view_proj[i], record.m_min, record.m_max)) { faces[count++] = i; }
+            }
+            renderer.faces_culled += (last - first) - count;
+            if(count == 0) { return; }
+
+            shader->uniform("uFaces[0]", faces);
+            record.m_mesh.vao()->draw_instanced(record.m_offset, record.m_count, count, opengl::primitives::triangles);
+            renderer.draws++;
+            renderer.faces_drawn += count;
+        };
+        render_func(shader, false, draw);
+        render_func(shader, true, draw);
+
+        framebuffer->unbind();
+    }
+    else
+    {
+        auto& shader = renderer.shader_face;
+        shader->bind();
+        shader->uniform("uModel", model);
+        shader->uniform("projection", projection);
+        shader->uniform("captureViews[0]", views);
+
+        for(int i = first; i < last; i++)
+        {
+            attach_face(i);
+            refl_prope.framebuffer_face->bind();
+            gl_context.clear(opengl::clear_options::color_depth);
+            shader->uniform("uFace", i);
+
+            auto draw = [&](const scene_record& record)
+            {
+                if(!box_visible(model_view_proj[i], record.m_min, record.m_max))
+                {
+                    renderer.faces_culled++;
+                    return;
+                }
+
+                record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles);
+                renderer.draws++;
+                renderer.faces_drawn++;
+            };
+            render_func(shader, false, draw);
+            render_func(shader, true, draw);
+        }
+        refl_prope.framebuffer_face->unbind();
+    }
+
+    gl_context.viewport(viewport);
+}
+
+/* copies gpu sh coefficients of an asynchronous filter pass once they arrived */
+void resolve_prope_sh(reflection_prope& refl_prope)
+{
+    if(!refl_prope.sh_fence->pending() || !refl_prope.sh_fence->signaled()) { return; }
+
+    refl_prope.sh_staging->bind();
+    if(const auto* coefficients = refl_prope.sh_staging->map(opengl::buffer_access::read))
+    {
+        for(int i = 0; i < 9; i++)
+        {
+            refl_prope.sh.radiance[i] = glm::vec3(coefficients[i]);
+        }
+        refl_prope.sh_staging->unmap();
+    }
+    refl_prope.sh_staging->unbind();
+    refl_prope.sh_fence->reset();
+}
+
+
+/************** time-sliced prope updates **************/
+/* dirty propes are updated one face per slice followed by one filter slice, as many slices per frame as fit into the
+   gpu budget; slice costs are running averages of timer queries read back frames later. Visible propes go first,
+   then the longest waiting. A prope dirtied while it updates finishes and starts over, so dragging still converges */
+struct prope_scheduler
+{
+    enum slice : unsigned int { face = 0, filter = 1 };
+
+    struct state
+    {
+        int next = -1;                  /* next face, 6 = filter, -1 = up to date */
+        bool dirty = false;             /* invalidated during the current update */
+        std::uint64_t since = 0;        /* frame it was invalidated */
+    };
+
+    struct timing
+    {
+        opengl::handle<opengl::timer_query> query;
+        slice kind;
+    };
+
+    bool time_sliced = true;
+    float budget_ms = 1.0f;
+
+    std::vector<state> propes;
+    std::vector<timing> queries;
+    std::array<double, 2> cost_ms = {0.5, 1.0};
+    std::uint64_t frame = 0;
+    int active = -1;
+
+    /* last frame */
+    unsigned int faces = 0;
+    unsigned int filters = 0;
+    double planned_ms = 0.0;
+    std::size_t completed = 0;
+};
+
+void invalidate_prope(prope_scheduler& scheduler, unsigned int index)
+{
+    auto& state = scheduler.propes[index];
+    if(state.next < 0)
+    {
+        state.next = 0;
+        state.since = scheduler.frame;
+    }
+    else
+    {
+        state.dirty = true;
+    }
+}
+
+/* scene change inside a world space box, every prope whose volume overlaps it is dirty */
+void invalidate_propes(prope_scheduler& scheduler, const std::vector<reflection_prope>& refl_propes, const glm::vec3& box_min, const glm::vec3& box_max)
+{
+    for(unsigned int i = 0; i < refl_propes.size(); i++)
+    {
+        const auto& prope = refl_propes[i];
+        if(glm::all(glm::lessThanEqual(prope.position - prope.extends, box_max)) && glm::all(glm::greaterThanEqual(prope.position + prope.extends, box_min)))
+        {
+            invalidate_prope(scheduler, i);
+        }
+    }
+}
+
+bool prope_visible(const reflection_prope& refl_prope, const glm::mat4& view_proj)
+{
+    return box_visible(view_proj, refl_prope.position - refl_prope.extends, refl_prope.position + refl_prope.extends);
+}
+
+/* runs the slices of this frame; render_face(prope, face) captures one face, finish(prope, consistent) filters the
+   capture, which is not consistent if the prope was invalidated while its faces were captured (mixes old and new) */
+void schedule_propes(prope_scheduler& scheduler, std::vector<reflection_prope>& refl_propes, opengl::context& gl_context, const glm::mat4& view_proj,
+                     const std::function<void(reflection_prope&, int)>& render_face, const std::function<void(reflection_prope&, bool)>& finish)
+{
+    scheduler.frame++;
+    scheduler.propes.resize(refl_propes.size());
+    scheduler.faces = scheduler.filters = 0;
+    scheduler.planned_ms = 0.0;
+
+    /* measured slice costs of earlier frames */
+    for(auto& t : scheduler.queries)
+    {
+        if(t.query->available())
+        {
+            scheduler.cost_ms[t.kind] = 0.8 * scheduler.cost_ms[t.kind] + 0.2 * t.query->elapsed_ms();
+        }
+    }
+
+    auto next_prope = [&]()
+    {
+        int best = -1;
+        bool best_visible = false;
+        for(unsigned int i = 0; i < refl_propes.size(); i++)
+        {
+            const auto& state = scheduler.propes[i];
+            if(state.next < 0) { continue; }
+
+            bool visible = prope_visible(refl_propes[i], view_proj);
+            if(best < 0 || (visible && !best_visible) || (visible == best_visible && state.since < scheduler.propes[best].since))
+            {
+                best = static_cast<int>(i);
+                best_visible = visible;
+            }
+        }
+        return best;
+    };
+
+    auto query = [&](prope_scheduler::slice kind) -> opengl::timer_query&
+    {
+        auto it = std::find_if(scheduler.queries.begin(), scheduler.queries.end(), [](const auto& t){ return !t.query->pending(); });
+        if(it == scheduler.queries.end())
+        {
+            scheduler.queries.push_back({gl_context.make_timer_query(), kind});
+            it = scheduler.queries.end() - 1;
+        }
+        it->kind = kind;
+        return *it->query;
+    };
+
+    while(true)
+    {
+        if(scheduler.active < 0 || scheduler.propes[scheduler.active].next < 0)
+        {
+            scheduler.active = next_prope();
+            if(scheduler.active < 0) { break; }
+        }
+
+        auto& state = scheduler.propes[scheduler.active];
+        auto& prope = refl_propes[scheduler.active];
+        auto kind = state.next < 6 ? prope_scheduler::face : prope_scheduler::filter;
+
+        /* at least one slice per frame, nothing over budget after that */
+        bool first = scheduler.faces + scheduler.filters == 0;
+        if(scheduler.time_sliced && !first && scheduler.planned_ms + scheduler.cost_ms[kind] > scheduler.budget_ms) { break; }
+
+        auto& timer = query(kind);
+        timer.begin();
+        if(kind == prope_scheduler::face)
+        {
+            render_face(prope, state.next++);
+            scheduler.faces++;
+        }
+        else
+        {
+            finish(prope, !state.dirty);
+            scheduler.filters++;
+            scheduler.completed++;
+
+            state.next = state.dirty ? 0 : -1;
+            state.since = scheduler.frame;
+            state.dirty = false;
+        }
+        timer.end();
+        scheduler.planned_ms += scheduler.cost_ms[kind];
+    }
 }
 
 
@@ -170,11 +731,7 @@ int main(int argc, char** argv)
     shader_debug->load("reflection_probes/shader/debug_prope.frag", opengl::shader_type::fragment);
     shader_debug->link();
 
-    auto shader_probe = context.make_shader();
-    shader_probe->load("reflection_probes/shader/refl_prope.vert", opengl::shader_type::vertex);
-    shader_probe->load("reflection_probes/shader/refl_prope.geom", opengl::shader_type::geometry);
-    shader_probe->load("reflection_probes/shader/scene.frag", opengl::shader_type::fragment);
-    shader_probe->link();
+    auto renderer = construct_renderer(context);
 
 
     /* enable/disable OpenGL options */
@@ -185,8 +742,8 @@ int main(int argc, char** argv)
     context.clear_color(0.0, 0.0, 0.0, 1.0);
 
 
-    /* render scene func */
-    auto render_scene = [model](auto& shader, bool transparent_only = false)
+    /* render scene func, draw submits a record (prope captures cull them per face) */
+    auto render_scene_records = [model](opengl::handle<opengl::shader_program>& shader, bool transparent_only, const std::function<void(const scene_record&)>& draw)
     {
         /* iterate over materials */
         for(auto& [_, mat_group] : model->material_groups())
@@ -202,21 +759,138 @@ int main(int argc, char** argv)
 
             for(const auto& record : mat_group.records())
             {
-                record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles);
+                draw(record);
             }
         }
     };
 
-    /* precompute prope cube maps */
+    auto render_scene = [&](auto& shader, bool transparent_only = false)
+    {
+        render_scene_records(shader, transparent_only, [](const scene_record& record)
+        {
+            record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles);
+        });
+    };
+
+    /* precompute prope cube maps, prefiltered levels and irradiance */
+    auto filter = construct_filter(context);
+
+    /* static propes are baked to disk, keyed by the scene sources and the prope placement */
+    asset::probe_cache prope_cache(context, "assets/wanderer/probes", asset::probe_cache::hash_files({
+        "assets/wanderer/wanderer.obj", "assets/wanderer/wanderer.mtl",
+        "reflection_probes/shader/refl_prope.vert", "reflection_probes/shader/refl_prope.geom", "reflection_probes/shader/refl_prope_layered.vert",
+        "reflection_probes/shader/refl_prope_face.vert", "reflection_probes/shader/scene.frag"}));
+
+    auto prope_hash = [&](const reflection_prope& prope)
+    {
+        auto hash = asset::probe_cache::hash(&prope.position, sizeof(prope.position));
+        hash = asset::probe_cache::hash(&prope.extends, sizeof(prope.extends), hash);
+        auto size = prope.tex_color->size(opengl::cube_face::positive_x);
+        return asset::probe_cache::hash(&size, sizeof(size), hash);
+    };
+
+    auto startup = core::clock::now();
     for(auto& prope : refl_propes)
     {
-        render_prope(prope, context, shader_probe, render_scene);
+        prope.baked = prope_hash(prope);
+        if(!prope_cache.load(prope.baked, *prope.tex_color))
+        {
+            capture_prope(prope, context, renderer, render_scene_records);
+            prope_cache.store(prope.baked, *prope.tex_color);
+        }
+        filter_prope(prope, context, filter, refl_settings.cpu_sh);
     }
 
+    /* files of the startup placements are kept for the next run, anything else baked earlier is stale */
+    std::vector<std::uint64_t> startup_hashes;
+    for(const auto& prope : refl_propes) { startup_hashes.push_back(prope.baked); }
+    prope_cache.prune(startup_hashes);
+    const double startup_ms = core::time_cast<core::milli_sec>(core::clock::now() - startup);
+
+    /* later updates are spread over frames, a finished capture at a new placement is baked */
+    prope_scheduler scheduler;
+    scheduler.propes.resize(refl_propes.size());
+    bool continuous_updates = false;
+
+    auto render_face = [&](reflection_prope& prope, int face)
+    {
+        capture_prope(prope, context, renderer, render_scene_records, face);
+    };
+
+    auto finish_prope = [&](reflection_prope& prope, bool consistent)
+    {
+        filter_prope(prope, context, filter, refl_settings.cpu_sh, false);
+
+        /* a capture spanning an invalidation is only shown, the clean recapture that follows is baked */
+        if(auto hash = prope_hash(prope); consistent && hash != prope.baked)
+        {
+            prope_cache.store(hash, *prope.tex_color);
+            prope.baked = hash;
+
+            /* the file of the previous placement is dropped unless it is needed at startup */
+            auto keep = startup_hashes;
+            for(const auto& p : refl_propes) { keep.push_back(p.baked); }
+            prope_cache.prune(keep);
+        }
+    };
+
+    /* frame times of the last seconds, spikes of prope updates show up in the deviation */
+    std::array<float, 240> frame_ms{};
+    std::size_t frame_index = 0;
+
+    /* gpu time per prope of each capture path, all propes captured a few rounds (waits for every result) */
+    std::array<double, 3> capture_ms{};
+    auto benchmark_capture = [&]()
+    {
+        constexpr int rounds = 8;
+        constexpr const char* names[] = {"geometry shader", "instanced", "face passes"};
+
+        auto mode = renderer.mode;
+        auto query = context.make_timer_query();
+        auto fence = context.make_fence();
+        for(int m = 0; m < 3; m++)
+        {
+            renderer.mode = static_cast<prope_capture>(m);
+            capture_ms[m] = 0.0;
+            if(renderer.mode == prope_capture::instanced && !renderer.layered) { continue; }
+
+            for(int r = 0; r < rounds; r++)
+            {
+                query->begin();
+                for(auto& prope : refl_propes)
+                {
+                    capture_prope(prope, context, renderer, render_scene_records);
+                }
+                query->end();
+
+                fence->insert();
+                fence->wait(std::numeric_limits<std::uint64_t>::max());
+                while(!query->available()) {}
+                capture_ms[m] += query->elapsed_ms() / (rounds * refl_propes.size());
+            }
+
+            platform_log(core::log::level::info, "[reflection_probes] capture ({}): {:.3f} ms per prope", names[m], capture_ms[m]);
+        }
+        renderer.mode = mode;
+    };
+
 
     /***************** install callbacks *****************/
     view.on_render([&](auto& window, float dt)
     {
+        /* hand finished prope read backs to the cache writer */
+        prope_cache.update();
+
+        /********** time-sliced prope updates **********/
+        frame_ms[frame_index++ % frame_ms.size()] = dt * 1000.0f;
+        if(continuous_updates)
+        {
+            for(unsigned int i = 0; i < refl_propes.size(); i++) { invalidate_prope(scheduler, i); }
+        }
+
+        for(auto& prope : refl_propes) { resolve_prope_sh(prope); }
+        schedule_propes(scheduler, refl_propes, context, camera.projection() * camera.view(), render_face, finish_prope);
+
         /********** render water **********/
         {
             shader_water->bind();
@@ -227,6 +901,8 @@ int main(int argc, char** argv)
             shader_water->uniform("uReflections", refl_settings.reflections);
             shader_water->uniform("uNormalMap", refl_settings.normal_map);
             shader_water->uniform("uParallax", refl_settings.parallax);
+            shader_water->uniform("uIrradiance", refl_settings.irradiance);
+            shader_water->uniform("uSpecularLod", refl_settings.prefiltered ? refl_settings.roughness * (prope_filter::levels - 1) : 0.0f);
 
             /* set prope parameter */
             for(unsigned int i = 0; i < refl_propes.size(); i++)
@@ -236,7 +912,8 @@ int main(int argc, char** argv)
                 shader_water->uniform(str_access + "pos", prope.position);
                 shader_water->uniform(str_access + "extends", prope.extends);
                 shader_water->uniform(str_access + "map", static_cast<int>(3 + i));
-                prope.tex_color->bind(3 + i);
+                shader_water->uniform(str_access + "sh[0]", prope.sh.radiance);
+                (refl_settings.prefiltered ? prope.tex_prefiltered : prope.tex_color)->bind(3 + i);
             }
             shader_water->uniform("uNumPropes", static_cast<int>(refl_propes.size()));
 
@@ -320,14 +997,37 @@ int main(int argc, char** argv)
 
             if(ImGui::DragFloat3("position",  &refl_propes[refl_settings.selected].position[0], 0.1f))
             {
-                render_prope(refl_propes[refl_settings.selected], context, shader_probe, render_scene);
+                invalidate_prope(scheduler, refl_settings.selected);
             }
 
             if(ImGui::DragFloat("extends",  &refl_propes[refl_settings.selected].extends[0], 0.1f))
             {
                 refl_propes[refl_settings.selected].extends = {refl_propes[refl_settings.selected].extends.x, refl_propes[refl_settings.selected].extends.x, refl_propes[refl_settings.selected].extends.x};
-                render_prope(refl_propes[refl_settings.selected], context, shader_probe, render_scene);
+                invalidate_prope(scheduler, refl_settings.selected);
+            }
+            if(ImGui::Button("update all"))
+            {
+                invalidate_propes(scheduler, refl_propes, glm::vec3(-std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::max()));
             }
+            ImGui::SameLine();
+            ImGui::Checkbox("continuous", &continuous_updates);
+            ImGui::Checkbox("time sliced", &scheduler.time_sliced);
+            ImGui::SliderFloat("budget (ms)", &scheduler.budget_ms, 0.1f, 8.0f);
+
+            unsigned int dirty = static_cast<unsigned int>(std::count_if(scheduler.propes.begin(), scheduler.propes.end(), [](const auto& p){ return p.next >= 0; }));
+            ImGui::Text("slices:    %u faces, %u filters (%4.2f ms planned), %u dirty, %zu updated", scheduler.faces, scheduler.filters, scheduler.planned_ms, dirty, scheduler.completed);
+            ImGui::Text("gpu cost:  face %4.2f ms, filter %4.2f ms", scheduler.cost_ms[prope_scheduler::face], scheduler.cost_ms[prope_scheduler::filter]);
+
+            float mean = 0.0f, deviation = 0.0f, peak = 0.0f;
+            std::size_t samples = std::min(frame_index, frame_ms.size());
+            for(std::size_t i = 0; i < samples; i++) { mean += frame_ms[i] / samples; peak = std::max(peak, frame_ms[i]); }
+            for(std::size_t i = 0; i < samples; i++) { deviation += (frame_ms[i] - mean) * (frame_ms[i] - mean) / samples; }
+            ImGui::Text("frame:     %5.2f ms avg, %5.2f ms std dev, %5.2f ms max", mean, std::sqrt(deviation), peak);
+
+            auto cache = prope_cache.stats();
+            ImGui::Text("startup:   %5.2f ms (%zu loaded, %zu baked)", startup_ms, cache.loaded, cache.baked);
+            ImGui::Text("cache:     %5.2f MB -> %5.2f MB, %zu pending", cache.raw_bytes / (1024.0 * 1024.0), cache.file_bytes / (1024.0 * 1024.0), cache.pending);
+            ImGui::Text("           load %5.2f ms, read back %5.2f ms, compress %5.2f ms", cache.load_ms, cache.readback_ms, cache.compress_ms);
             ImGui::PopID();
 
             /* global render settings */
@@ -335,6 +1035,44 @@ int main(int argc, char** argv)
             ImGui::Checkbox("parallax correction", &refl_settings.parallax);
             ImGui::Checkbox("water normal map", &refl_settings.normal_map);
             ImGui::Checkbox("render probe volume", &refl_settings.render_volume);
+
+            /* probe filtering */
+            ImGui::Dummy({0.0, 16.0});
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Probe Filtering: ");
+            ImGui::Checkbox("prefiltered (ggx)", &refl_settings.prefiltered);
+            ImGui::SliderFloat("roughness", &refl_settings.roughness, 0.0f, 1.0f);
+            ImGui::Checkbox("sh irradiance", &refl_settings.irradiance);
+            bool refilter = ImGui::Checkbox("sh on cpu", &refl_settings.cpu_sh);
+            ImGui::SameLine();
+            refilter |= ImGui::Button("refilter");
+            if(refilter)
+            {
+                for(auto& prope : refl_propes)
+                {
+                    filter_prope(prope, context, filter, refl_settings.cpu_sh);
+                }
+            }
+            ImGui::Text("prefilter: %5.2f ms (%u levels, %u^2, %d samples)", filter.prefilter_ms, prope_filter::levels, prope_filter::size, prope_filter::samples);
+            ImGui::Text("sh:        %5.2f ms (%s)", filter.sh_ms, refl_settings.cpu_sh ? "cpu" : "gpu");
+
+            /* probe capture */
+            ImGui::Dummy({0.0, 16.0});
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Probe Capture: ");
+            int capture_mode = static_cast<int>(renderer.mode);
+            ImGui::RadioButton("geometry shader", &capture_mode, 0); ImGui::SameLine();
+            if(renderer.layered) { ImGui::RadioButton("instanced", &capture_mode, 1); ImGui::SameLine(); }
+            ImGui::RadioButton("face passes", &capture_mode, 2);
+            renderer.mode = static_cast<prope_capture>(capture_mode);
+
+            if(renderer.mode != prope_capture::geometry_shader)
+            {
+                ImGui::Text("last:      %u draws, %u faces drawn, %u culled", renderer.draws, renderer.faces_drawn, renderer.faces_culled);
+            }
+            if(ImGui::Button("benchmark"))
+            {
+                benchmark_capture();
+            }
+            ImGui::Text("per prope: gs %5.2f ms, instanced %5.2f ms, passes %5.2f ms", capture_ms[0], capture_ms[1], capture_ms[2]);
         }
         ImGui::End();
 
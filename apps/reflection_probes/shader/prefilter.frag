@@ -0,0 +1,97 @@
+#version 330
+
+flat in int tFace;
+
+out vec4 fragColor;
+
+uniform samplerCube uEnvironment;
+uniform float uSourceSize;
+uniform float uFaceSize;
+uniform float uRoughness;
+uniform int uSamples;
+
+const float PI = 3.14159265359;
+
+/* direction through a texel of a cube map face (uv in [0, 1]^2, gl cube map convention) */
+vec3 cube_direction(int face, vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    switch(face)
+    {
+    case 0: return vec3( 1.0, -p.y, -p.x);
+    case 1: return vec3(-1.0, -p.y,  p.x);
+    case 2: return vec3( p.x,  1.0,  p.y);
+    case 3: return vec3( p.x, -1.0, -p.y);
+    case 4: return vec3( p.x, -p.y,  1.0);
+    }
+    return vec3(-p.x, -p.y, -1.0);
+}
+
+float radical_inverse(uint bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10;
+}
+
+/* ggx distributed half vector around n (alpha = roughness^2) */
+vec3 importance_sample_ggx(vec2 xi, vec3 n, float alpha)
+{
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+    vec3 up = abs(n.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, n));
+    vec3 bitangent = cross(n, tangent);
+
+    return normalize(tangent * cos(phi) * sinTheta + bitangent * sin(phi) * sinTheta + n * cosTheta);
+}
+
+float distribution_ggx(float nh, float alpha)
+{
+    float a2 = alpha * alpha;
+    float d = nh * nh * (a2 - 1.0) + 1.0;
+    return a2 / (PI * d * d);
+}
+
+/* split sum prefiltering (n = v = r): samples are read from the source mip level whose texel solid angle matches
+   the solid angle covered by the sample, so few samples give a noise free result */
+void main(void)
+{
+    vec3 n = normalize(cube_direction(tFace, gl_FragCoord.xy / uFaceSize));
+    if(uRoughness <= 0.0)
+    {
+        fragColor = vec4(textureLod(uEnvironment, n, 0.0).rgb, 1.0);
+        return;
+    }
+
+    float alpha = uRoughness * uRoughness;
+    float texelSolidAngle = 4.0 * PI / (6.0 * uSourceSize * uSourceSize);
+
+    vec3 color = vec3(0.0);
+    float weight = 0.0;
+    for(int i = 0; i < uSamples; i++)
+    {
+        vec2 xi = vec2(float(i) / float(uSamples), radical_inverse(uint(i)));
+        vec3 h = importance_sample_ggx(xi, n, alpha);
+        vec3 l = 2.0 * dot(n, h) * h - n;
+
+        float nl = dot(n, l);
+        if(nl > 0.0)
+        {
+            float nh = max(dot(n, h), 0.0);
+            float pdf = distribution_ggx(nh, alpha) * 0.25;
+            float sampleSolidAngle = 1.0 / (float(uSamples) * pdf + 1e-4);
+            float lod = max(0.5 * log2(sampleSolidAngle / texelSolidAngle) + 1.0, 0.0);
+
+            color += textureLod(uEnvironment, l, lod).rgb * nl;
+            weight += nl;
+        }
+    }
+
+    fragColor = vec4(color / max(weight, 1e-4), 1.0);
+}
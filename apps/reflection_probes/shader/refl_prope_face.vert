@@ -0,0 +1,25 @@
+#version 330
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aUV;
+
+uniform mat4 uModel;
+uniform mat4 captureViews[6];
+uniform mat4 projection;
+
+/* one face per pass into a non layered target (no layer selection in the vertex stage) */
+uniform int uFace;
+
+out vec3 tFragPos;
+out vec3 tNormal;
+out vec2 tUV;
+
+void main(void)
+{
+    vec4 worldPos = uModel * vec4(aPosition, 1.0);
+    tFragPos = worldPos.xyz;
+    gl_Position = projection * captureViews[uFace] * worldPos;
+    tNormal = aNormal;
+    tUV = aUV;
+}
@@ -0,0 +1,29 @@
+#version 410
+#extension GL_ARB_shader_viewport_layer_array : require
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aUV;
+
+uniform mat4 uModel;
+uniform mat4 captureViews[6];
+uniform mat4 projection;
+
+/* cube face of each instance, faces culled on the cpu are left out */
+uniform int uFaces[6];
+
+out vec3 tFragPos;
+out vec3 tNormal;
+out vec2 tUV;
+
+void main(void)
+{
+    int face = uFaces[gl_InstanceID];
+    gl_Layer = face;
+
+    vec4 worldPos = uModel * vec4(aPosition, 1.0);
+    tFragPos = worldPos.xyz;
+    gl_Position = projection * captureViews[face] * worldPos;
+    tNormal = aNormal;
+    tUV = aUV;
+}
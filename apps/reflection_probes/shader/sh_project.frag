@@ -0,0 +1,68 @@
+#version 330
+
+out vec4 fragColor;
+
+uniform samplerCube uEnvironment;
+uniform float uLod;
+uniform int uFaceSize;
+
+const float PI = 3.14159265359;
+
+vec3 cube_direction(int face, vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    switch(face)
+    {
+    case 0: return vec3( 1.0, -p.y, -p.x);
+    case 1: return vec3(-1.0, -p.y,  p.x);
+    case 2: return vec3( p.x,  1.0,  p.y);
+    case 3: return vec3( p.x, -1.0, -p.y);
+    case 4: return vec3( p.x, -p.y,  1.0);
+    }
+    return vec3(-p.x, -p.y, -1.0);
+}
+
+/* real sh basis function i of band 0 - 2 */
+float sh_basis(int i, vec3 d)
+{
+    switch(i)
+    {
+    case 0: return 0.282095;
+    case 1: return 0.488603 * d.y;
+    case 2: return 0.488603 * d.z;
+    case 3: return 0.488603 * d.x;
+    case 4: return 1.092548 * d.x * d.y;
+    case 5: return 1.092548 * d.y * d.z;
+    case 6: return 0.315392 * (3.0 * d.z * d.z - 1.0);
+    case 7: return 1.092548 * d.x * d.z;
+    }
+    return 0.546274 * (d.x * d.x - d.y * d.y);
+}
+
+/* one coefficient per fragment (x = coefficient index): sum over all texels of the given level weighted by
+   their solid angle, normalized to the full sphere */
+void main(void)
+{
+    int index = int(gl_FragCoord.x);
+
+    vec3 sum = vec3(0.0);
+    float weight = 0.0;
+    for(int face = 0; face < 6; face++)
+    {
+        for(int y = 0; y < uFaceSize; y++)
+        {
+            for(int x = 0; x < uFaceSize; x++)
+            {
+                vec3 direction = cube_direction(face, (vec2(x, y) + 0.5) / float(uFaceSize));
+                float length2 = dot(direction, direction);
+                float w = 1.0 / (length2 * sqrt(length2));
+
+                direction *= inversesqrt(length2);
+                sum += textureLod(uEnvironment, direction, uLod).rgb * sh_basis(index, direction) * w;
+                weight += w;
+            }
+        }
+    }
+
+    fragColor = vec4(sum * 4.0 * PI / weight, 1.0);
+}
@@ -14,6 +14,10 @@ uniform vec3 uViewPos;
 uniform bool uParallax;
 uniform bool uNormalMap;
 uniform bool uReflections;
+uniform bool uIrradiance;
+
+/* mip level of the prefiltered maps (roughness * (levels - 1)), 0 for unfiltered maps */
+uniform float uSpecularLod;
 
 struct ReflPrope
 {
@@ -21,12 +25,28 @@ struct ReflPrope
     vec3 extends;
 
     samplerCube map;
+
+    /* order 2 sh coefficients of the radiance */
+    vec3 sh[9];
 };
 
 const int MAX_PROPES = 5;
 uniform ReflPrope uReflPropes[MAX_PROPES];
 uniform int uNumPropes;
 
+const float PI = 3.14159265359;
+
+/* irradiance around n from the sh radiance (bands scaled by the clamped cosine) */
+vec3 prope_irradiance(const in ReflPrope probe, vec3 n)
+{
+    vec3 result = PI * 0.282095 * probe.sh[0]
+                + (2.0 * PI / 3.0) * 0.488603 * (probe.sh[1] * n.y + probe.sh[2] * n.z + probe.sh[3] * n.x)
+                + (PI / 4.0) * (1.092548 * (probe.sh[4] * n.x * n.y + probe.sh[5] * n.y * n.z + probe.sh[7] * n.x * n.z)
+                              + 0.315392 * probe.sh[6] * (3.0 * n.z * n.z - 1.0)
+                              + 0.546274 * probe.sh[8] * (n.x * n.x - n.y * n.y));
+    return max(result, vec3(0.0));
+}
+
 /* simple linear falloff */
 float prope_influence(vec3 fragPos, vec3 probePos, vec3 probeExtent)
 {
@@ -65,9 +85,10 @@ void main(void)
 
     vec3 diff = texture(uMapDiffuse, uv).rgb;
     vec3 refl_intensity = vec3(0.0);
+    vec3 irradiance = vec3(0.0);
 
-    /* reflections from cube maps */
-    if(uReflections)
+    /* reflections (single fetch from the prefiltered level) and irradiance from cube maps */
+    if(uReflections || uIrradiance)
     {
         float sum_weight = 0.0;
         for(int i = 0; i < MAX_PROPES; i++)
@@ -83,14 +104,19 @@ void main(void)
                 if(uParallax) { reflPrope = parallax_correct(uReflPropes[i], reflPrope); }
 
                 sum_weight += w;
-                refl_intensity += w * texture(uReflPropes[i].map, reflPrope).rgb;
+                refl_intensity += w * textureLod(uReflPropes[i].map, reflPrope, uSpecularLod).rgb;
+                irradiance += w * prope_irradiance(uReflPropes[i], normal);
             }
         }
 
         /* normalize based on total weights */
         refl_intensity /= sum_weight;
+        irradiance /= sum_weight;
     }
 
+    if(!uReflections) { refl_intensity = vec3(0.0); }
+    if(uIrradiance) { diff *= irradiance / PI; }
+
     /* custom blending to water color */
     fragColor = vec4(diff * 0.5 + 0.5 * refl_intensity, 0.9);
 }
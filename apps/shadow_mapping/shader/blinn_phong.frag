@@ -8,13 +8,30 @@ struct Light
     vec3 color;
 };
 
+/* mode: 0 reference loop of depth comparisons, 1 hardware pcf, 2 variance, 3 exponential shadow maps */
 struct Shadow
 {
+    int mode;
     float bias;
     float spacing;
     int samples;
 
-    sampler2D map_shadow;
+    float exponent;
+    float bleeding;
+    float minVariance;
+
+    sampler2DArray map_shadow;
+    sampler2DArrayShadow map_compare;
+    sampler2DArray map_moments;
+};
+
+/* cascades cover the view depth up to their split, texel scale is the world size of a texel relative to the first */
+struct Cascades
+{
+    int count;
+    vec4 splits;
+    vec4 texelScale;
+    bool debug;
 };
 
 struct Material
@@ -29,6 +46,8 @@ struct Material
 uniform vec3 uViewPos;
 uniform Light uLight;
 uniform Shadow uShadow;
+uniform Cascades uCascades;
+uniform mat4 uLightSpace[4];
 uniform Material uMaterial;
 
 out vec4 fragColor;
@@ -38,7 +57,7 @@ in VS_OUT
     vec3 fragPos;
     vec3 normal;
     vec2 texCoord;
-    vec4 fragPosLightSpace;
+    float viewDepth;
 } fs_in;
 
 
@@ -50,7 +69,7 @@ float random(vec3 seed, int i)
     return fract(sin(dot_product) * 43758.5453);
 }
 
-float compute_light_coverage(vec4 fragPosLightSpace, vec3 lightDirection, float bias, float spacing, int samples)
+float compute_light_coverage(vec4 fragPosLightSpace, int cascade, vec3 lightDirection, float bias, float spacing, int samples)
 {
     // https://github.com/opengl-tutorials/ogl/blob/master/tutorial16_shadowmaps/ShadowMapping.fragmentshader
     vec2 poission_disc[16] =
@@ -79,19 +98,46 @@ float compute_light_coverage(vec4 fragPosLightSpace, vec3 lightDirection, float
     float adjBias = max(bias * (1.0 - dot(fs_in.normal, lightDirection)), bias / 10.0);
     //float adjBias = clamp( bias * tan(acos( dot(fs_in.normal, lightDirection) ) ), 0, 2 * bias);
 
+    if(projCoords.z > 1.0)
+    {
+        return 0.0;
+    }
+
+    /* bilinear 2x2 comparison of the sampler */
+    if(uShadow.mode == 1)
+    {
+        return 1.0 - texture(uShadow.map_compare, vec4(projCoords.xy, cascade, currentDepth - adjBias));
+    }
+
+    /* chebyshev upper bound of the lit fraction, the tail is cut to reduce light bleeding */
+    if(uShadow.mode == 2)
+    {
+        vec2 moments = texture(uShadow.map_moments, vec3(projCoords.xy, cascade)).rg;
+        if(currentDepth - adjBias <= moments.x) { return 0.0; }
+
+        float variance = max(moments.y - moments.x * moments.x, uShadow.minVariance);
+        float d = currentDepth - adjBias - moments.x;
+        float lit = clamp((variance / (variance + d * d) - uShadow.bleeding) / (1.0 - uShadow.bleeding), 0.0, 1.0);
+        return 1.0 - lit;
+    }
+
+    if(uShadow.mode == 3)
+    {
+        float occluder = texture(uShadow.map_moments, vec3(projCoords.xy, cascade)).r;
+        return 1.0 - clamp(exp(-uShadow.exponent * (currentDepth - adjBias)) * occluder, 0.0, 1.0);
+    }
+
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(uShadow.map_shadow, 0);
+    vec2 texelSize = 1.0 / textureSize(uShadow.map_shadow, 0).xy;
 
     for(int i = 0; i < samples; i++)
     {
         int index = int( 16.0 * random(gl_FragCoord.xyy, i) ) % 16;
-        float closestDepth = texture( uShadow.map_shadow, projCoords.xy + poission_disc[index] * texelSize * spacing ).r;
+        float closestDepth = texture( uShadow.map_shadow, vec3(projCoords.xy + poission_disc[index] * texelSize * spacing, cascade) ).r;
         shadow += currentDepth - adjBias > closestDepth ? 1.0 : 0.0;
     }
 
-    shadow = projCoords.z > 1.0 ? 0.0 : shadow / samples;
-
-    return shadow;
+    return shadow / samples;
 }
 
 vec3 brdf_blinn_phong(vec3 lightDir, vec3 viewDir, vec3 normal, vec3 diffuse, vec3 specular, float shininess)
@@ -112,11 +158,27 @@ void main(void)
 
     vec3 illuminance = uLight.ambient * vec3(texture(uMaterial.map_diffuse, fs_in.texCoord));
 
-    float shadow = compute_light_coverage(fs_in.fragPosLightSpace, lightDir, uShadow.bias, uShadow.spacing, uShadow.samples);
+    /* first cascade reaching the fragment, beyond the last one is unshadowed */
+    int cascade = 0;
+    while(cascade < uCascades.count && fs_in.viewDepth > uCascades.splits[cascade]) { cascade++; }
+
+    float shadow = 0.0;
+    if(cascade < uCascades.count)
+    {
+        vec4 fragPosLightSpace = uLightSpace[cascade] * vec4(fs_in.fragPos, 1.0);
+        shadow = compute_light_coverage(fragPosLightSpace, cascade, lightDir, uShadow.bias * uCascades.texelScale[cascade], uShadow.spacing, uShadow.samples);
+    }
+
     illuminance += (1.0 - shadow) * uLight.color * brdf_blinn_phong(lightDir, viewDir, normal,
                                                    texture(uMaterial.map_diffuse, fs_in.texCoord).rgb,
                                                    texture(uMaterial.map_specular, fs_in.texCoord).rgb,
                                                    uMaterial.shininess);
 
+    if(uCascades.debug && cascade < uCascades.count)
+    {
+        const vec3 tint[4] = vec3[](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+        illuminance *= tint[cascade];
+    }
+
     fragColor = vec4(illuminance, 1.0);
 }
@@ -7,14 +7,13 @@ layout(location = 2) in vec2 aTexCoord;
 uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProj;
-uniform mat4 uLightSpace;
 
 out VS_OUT
 {
     vec3 fragPos;
     vec3 normal;
     vec2 texCoord;
-    vec4 fragPosLightSpace;
+    float viewDepth;
 } vs_out;
 
 void main(void)
@@ -22,6 +21,6 @@ void main(void)
     vs_out.fragPos              = vec3(uModel * vec4(aPosition, 1.0));
     vs_out.normal               = mat3(transpose(inverse(uModel))) * aNormal;
     vs_out.texCoord             = aTexCoord;
-    vs_out.fragPosLightSpace    = uLightSpace * vec4(vs_out.fragPos, 1.0);
+    vs_out.viewDepth            = -(uView * vec4(vs_out.fragPos, 1.0)).z;
     gl_Position                 = uProj * uView * vec4(vs_out.fragPos, 1.0);
 }
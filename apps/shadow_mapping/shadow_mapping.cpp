@@ -5,7 +5,9 @@
 #include <viewer/asset/obj_model.h>
 #include <viewer/opengl/shaderprogram.h>
 #include <viewer/opengl/texture.h>
+#include <viewer/opengl/texture_array.h>
 #include <viewer/opengl/framebuffer.h>
+#include <viewer/opengl/query.h>
 
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/constants.hpp>
@@ -14,6 +16,13 @@
 #include <glm/gtx/string_cast.hpp>
 #include <iostream>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <vector>
+
 struct material
 {
     float shininess = 32.0;
@@ -51,22 +60,399 @@ struct light
     glm::vec3 color = {0.5, 0.5, 0.5};
 };
 
+/* reference takes samples depth comparisons in the shader, hardware pcf one comparison fetch, the filterable maps
+   one fetch of blurred moments */
+enum class shadow_filter : int
+{
+    reference = 0,
+    hardware_pcf = 1,
+    variance = 2,
+    exponential = 3
+};
+
 /* Helper Struct for method controls */
 struct shadow
 {
+    shadow_filter filter = shadow_filter::hardware_pcf;
     float bias = 0.0025;
-    glm::vec2 near_far_plane = {0.0, 30.0};
-    float scale = 5.0;
-    float distance = 25.0f;
 
-    int resolution = 4*1024;
+    int resolution = 2*1024;
 
     int samples = 16;
     float spacing = 0.65f;
 
+    /* filterable maps */
+    int blur_radius = 3;
+    float exponent = 40.0f;
+    float bleeding = 0.2f;
+    float min_variance = 0.00002f;
+
     bool face_culling = false;
+
+    /* cascades: split distances blend logarithmic and uniform splits by lambda, up to max distance */
+    int cascades = 4;
+    float lambda = 0.75f;
+    float max_distance = 20.0f;
+    bool stabilize = true;
+    bool debug = false;
+
+    /* cached cascades are only redrawn if the light, the cascade or a caster in it changed; the smallest meshes hover
+       as dynamic casters drawn on top of a copy of the static depth */
+    bool cache = true;
+    int dynamic_casters = 2;
+    bool animate = true;
+};
+
+
+/************** cascaded shadow maps **************/
+constexpr int max_cascades = 4;
+constexpr float hover_height = 0.5f;
+
+enum class cascade_update : int
+{
+    cached = 0,
+    dynamic = 1,
+    full = 2
+};
+
+/* light space region of one view depth slice, bounds are in the rotation of the light (x, y across, -z along it) */
+struct cascade
+{
+    float split = 0.0f;
+    glm::vec2 min{0.0f};
+    glm::vec2 max{0.0f};
+    float center_z = 0.0f;
+    float radius = 0.0f;
+    float texel = 0.0f;
+    glm::mat4 light_space{1.0f};
+
+    /* cache: static depth is valid for this light space and revision, dynamic casters last drawn on top of it */
+    glm::mat4 cached_light_space{0.0f};
+    unsigned int cached_revision = 0;
+    std::vector<std::pair<std::size_t, glm::mat4>> cached_dynamic;
+
+    /* moments are derived from the depth after it changed */
+    bool moments_dirty = true;
+
+    /* stats of the shadow pass */
+    cascade_update update = cascade_update::full;
+    unsigned int static_draws = 0;
+    unsigned int dynamic_draws = 0;
+    double pass_ms = 0.0;
+    opengl::handle<opengl::timer_query> query;
+};
+
+/* mesh with world space bounds (union of its records) */
+struct caster
+{
+    const asset::mesh<vertex>* mesh;
+    glm::vec3 object_min;
+    glm::vec3 object_max;
+
+    glm::mat4 model{1.0f};
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+    bool dynamic = false;
+};
+
+/* depth of the static casters lives in its own array, the sampled maps are copies of it with dynamic casters on top */
+struct cascaded_shadow
+{
+    opengl::handle<opengl::texture_array> maps;
+    opengl::handle<opengl::texture_array> static_maps;
+    opengl::handle<opengl::framebuffer> fb;
+    opengl::handle<opengl::framebuffer> fb_static;
+    std::array<cascade, max_cascades> cascades;
+
+    /* blurred moments of the filterable maps and the target of the horizontal pass, allocated on first use */
+    opengl::handle<opengl::texture_array> moments;
+    opengl::handle<opengl::texture_array> moments_blur;
+    double blur_ms = 0.0;
+    opengl::handle<opengl::timer_query> blur_query;
+
+    /* bumped whenever the static depth of every cascade is invalid (set of static casters, render state, storage) */
+    unsigned int revision = 1;
+
+    /* sorted by size, the first ones are the dynamic casters */
+    std::vector<caster> casters;
+    std::map<const asset::mesh<vertex>*, std::size_t> caster_index;
+    glm::vec3 scene_min{std::numeric_limits<float>::max()};
+    glm::vec3 scene_max{std::numeric_limits<float>::lowest()};
+
+    /* depth range of the scene along the light, shared by all cascades */
+    glm::mat4 light_rotation{1.0f};
+    float near_plane = 0.0f;
+    float far_plane = 1.0f;
 };
 
+/* bounds of a box after transformation (all eight corners) */
+void transform_bounds(const glm::mat4& matrix, const glm::vec3& min, const glm::vec3& max, glm::vec3& out_min, glm::vec3& out_max)
+{
+    out_min = glm::vec3(std::numeric_limits<float>::max());
+    out_max = glm::vec3(std::numeric_limits<float>::lowest());
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner = {i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z};
+        glm::vec3 p = matrix * glm::vec4(corner, 1.0f);
+        out_min = glm::min(out_min, p);
+        out_max = glm::max(out_max, p);
+    }
+}
+
+cascaded_shadow construct_cascaded_shadow(opengl::context& context, const asset::model<vertex, material>& model, const glm::mat4& model_matrix, int resolution)
+{
+    cascaded_shadow csm;
+
+    csm.maps = context.make_texture_array(opengl::texture_internal_type::depth32, opengl::texture_format::depth,
+                                          opengl::texture_type::float_, resolution, resolution, max_cascades);
+    csm.maps->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::border);
+    csm.maps->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::border);
+    csm.maps->parameter(opengl::texture_color::border_color, {1.0, 1.0, 1.0, 1.0});
+
+    csm.static_maps = context.make_texture_array(opengl::texture_internal_type::depth32, opengl::texture_format::depth,
+                                                 opengl::texture_type::float_, resolution, resolution, max_cascades);
+
+    csm.fb = context.make_framebuffer();
+    csm.fb->attach_depth(csm.maps, 0);
+    csm.fb->draw_buffer(opengl::color_buffer::none);
+    csm.fb->read_buffer(opengl::color_buffer::none);
+
+    csm.fb_static = context.make_framebuffer();
+    csm.fb_static->attach_depth(csm.static_maps, 0);
+    csm.fb_static->draw_buffer(opengl::color_buffer::none);
+    csm.fb_static->read_buffer(opengl::color_buffer::none);
+
+    for(auto& c : csm.cascades)
+    {
+        c.query = context.make_timer_query();
+    }
+    csm.blur_query = context.make_timer_query();
+
+    /* object space bounds of the records, merged per mesh */
+    std::map<const asset::mesh<vertex>*, std::pair<glm::vec3, glm::vec3>> bounds;
+    for(const auto& [_, mat_group] : model.material_groups())
+    {
+        for(const auto& record : mat_group.records())
+        {
+            auto [it, inserted] = bounds.try_emplace(&record.m_mesh, record.m_min, record.m_max);
+            it->second.first = glm::min(it->second.first, record.m_min);
+            it->second.second = glm::max(it->second.second, record.m_max);
+        }
+    }
+
+    for(const auto& [mesh, box] : bounds)
+    {
+        caster c{mesh, box.first, box.second, model_matrix};
+        transform_bounds(model_matrix, box.first, box.second, c.min, c.max);
+        csm.scene_min = glm::min(csm.scene_min, c.min);
+        csm.scene_max = glm::max(csm.scene_max, c.max);
+        csm.casters.push_back(c);
+    }
+
+    /* room for hovering casters, the depth range along the light never changes with them */
+    csm.scene_max.y += hover_height;
+
+    auto volume = [](const caster& c){ auto extent = c.max - c.min; return extent.x * extent.y * extent.z; };
+    std::sort(csm.casters.begin(), csm.casters.end(), [&](const auto& a, const auto& b){ return volume(a) < volume(b); });
+    for(std::size_t i = 0; i < csm.casters.size(); i++)
+    {
+        csm.caster_index[csm.casters[i].mesh] = i;
+    }
+
+    return csm;
+}
+
+/* sampler state of the depth for the filter, comparison fetches need the compare mode, every other fetch must not have it */
+void apply_filter(cascaded_shadow& csm, shadow_filter filter)
+{
+    csm.maps->parameter(filter == shadow_filter::hardware_pcf ? opengl::compare_mode::ref_to_texture : opengl::compare_mode::none);
+    csm.maps->parameter(opengl::depth_func::less_equal);
+
+    for(auto& c : csm.cascades)
+    {
+        c.moments_dirty = true;
+    }
+}
+
+/* moments of the dirty cascades, a horizontal pass from depth into the blur target and a vertical pass into the moments */
+void update_moments(opengl::context& context, cascaded_shadow& csm, const opengl::handle<opengl::shader_program>& shader, const shadow& settings)
+{
+    const auto& size = csm.maps->size();
+    if(!csm.moments || csm.moments->size() != size)
+    {
+        csm.moments = context.make_texture_array(opengl::texture_internal_type::rg32F, opengl::texture_format::rg,
+                                                 opengl::texture_type::float_, size.x, size.y, size.z);
+        csm.moments_blur = context.make_texture_array(opengl::texture_internal_type::rg32F, opengl::texture_format::rg,
+                                                      opengl::texture_type::float_, size.x, size.y, size.z);
+        for(auto& c : csm.cascades)
+        {
+            c.moments_dirty = true;
+        }
+    }
+
+    if(csm.blur_query->available()) { csm.blur_ms = csm.blur_query->elapsed_ms(); }
+
+    const bool dirty = std::any_of(csm.cascades.begin(), csm.cascades.begin() + settings.cascades, [](const auto& c){ return c.moments_dirty; });
+    if(!dirty)
+    {
+        csm.blur_ms = 0.0;
+        return;
+    }
+
+    const bool time_blur = !csm.blur_query->pending();
+    if(time_blur) { csm.blur_query->begin(); }
+
+    shader->bind();
+    shader->uniform("uDepth", 0);
+    shader->uniform("uSource", 1);
+    shader->uniform("uExponential", settings.filter == shadow_filter::exponential);
+    shader->uniform("uExponent", settings.exponent);
+    shader->uniform("uRadius", settings.blur_radius);
+    csm.maps->bind(0);
+    csm.moments_blur->bind(1);
+
+    for(int i = 0; i < settings.cascades; i++)
+    {
+        auto& c = csm.cascades[i];
+        if(!c.moments_dirty) { continue; }
+
+        shader->uniform("uLayer", i);
+
+        shader->uniform("uFromDepth", true);
+        shader->uniform("uDirection", glm::ivec2(1, 0));
+        csm.moments_blur->bind_image(0, opengl::image_access::write_only);
+        context.dispatch_compute((size.x + 15) / 16, (size.y + 15) / 16);
+        context.barrier(opengl::memory_barrier::texture_fetch);
+
+        shader->uniform("uFromDepth", false);
+        shader->uniform("uDirection", glm::ivec2(0, 1));
+        csm.moments->bind_image(0, opengl::image_access::write_only);
+        context.dispatch_compute((size.x + 15) / 16, (size.y + 15) / 16);
+
+        c.moments_dirty = false;
+    }
+    context.barrier(opengl::memory_barrier::texture_fetch);
+
+    if(time_blur) { csm.blur_query->end(); }
+}
+
+/* the first count casters are dynamic and hover above their place */
+void update_casters(cascaded_shadow& csm, const glm::mat4& model_matrix, int count, float time)
+{
+    for(std::size_t i = 0; i < csm.casters.size(); i++)
+    {
+        auto& c = csm.casters[i];
+        const bool dynamic = i < static_cast<std::size_t>(count);
+        if(dynamic != c.dynamic)
+        {
+            /* a caster left or joined the static depth */
+            c.dynamic = dynamic;
+            csm.revision++;
+        }
+
+        const float height = dynamic ? hover_height * (0.5f + 0.5f * std::sin(2.0f * time + static_cast<float>(i))) : 0.0f;
+        c.model = glm::translate(glm::vec3(0.0f, height, 0.0f)) * model_matrix;
+        transform_bounds(c.model, c.object_min, c.object_max, c.min, c.max);
+    }
+}
+
+/* fits the cascades to the view frustum slices: practical split scheme, bounding spheres snapped to the texel grid of
+   the light when stabilized (no shimmering under camera movement), otherwise the tighter bounds of the slice corners */
+void update_cascades(cascaded_shadow& csm, const util::camera& camera, const glm::vec3& light_direction, const shadow& settings)
+{
+    const glm::vec3 up = std::abs(light_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    csm.light_rotation = glm::lookAt(glm::vec3(0.0f), light_direction, up);
+
+    /* the scene depth along the light, every caster is inside the depth range of every cascade */
+    glm::vec3 scene_min, scene_max;
+    transform_bounds(csm.light_rotation, csm.scene_min, csm.scene_max, scene_min, scene_max);
+    csm.near_plane = -scene_max.z - 0.01f;
+    csm.far_plane = -scene_min.z + 0.01f;
+
+    /* corners of the near and far plane */
+    const glm::mat4 inv_view_proj = glm::inverse(camera.projection() * camera.view());
+    std::array<glm::vec3, 8> corners;
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec4 p = inv_view_proj * glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+        corners[i] = glm::vec3(p) / p.w;
+    }
+
+    const float near_plane = camera.near_plane();
+    const float far_plane = camera.far_plane();
+    const float max_distance = glm::clamp(settings.max_distance, near_plane + 0.01f, far_plane);
+    const float resolution = static_cast<float>(csm.maps->size().x);
+
+    float split_near = near_plane;
+    for(int i = 0; i < settings.cascades; i++)
+    {
+        auto& c = csm.cascades[i];
+
+        const float t = static_cast<float>(i + 1) / settings.cascades;
+        const float split_log = near_plane * std::pow(max_distance / near_plane, t);
+        const float split_uniform = near_plane + (max_distance - near_plane) * t;
+        c.split = settings.lambda * split_log + (1.0f - settings.lambda) * split_uniform;
+
+        /* slice corners in the rotation of the light, view depth is linear along the corner rays */
+        const float t_near = (split_near - near_plane) / (far_plane - near_plane);
+        const float t_far = (c.split - near_plane) / (far_plane - near_plane);
+        std::array<glm::vec3, 8> slice;
+        glm::vec3 center(0.0f);
+        for(int j = 0; j < 4; j++)
+        {
+            slice[j]     = csm.light_rotation * glm::vec4(glm::mix(corners[j], corners[j + 4], t_near), 1.0f);
+            slice[j + 4] = csm.light_rotation * glm::vec4(glm::mix(corners[j], corners[j + 4], t_far), 1.0f);
+            center += slice[j] + slice[j + 4];
+        }
+        center /= 8.0f;
+
+        c.radius = 0.0f;
+        for(const auto& p : slice)
+        {
+            c.radius = std::max(c.radius, glm::length(p - center));
+        }
+
+        if(settings.stabilize)
+        {
+            /* rounded radius keeps the texel size constant, the snapped center moves the map by whole texels */
+            c.radius = std::ceil(c.radius * 16.0f) / 16.0f;
+            c.texel = 2.0f * c.radius / resolution;
+            glm::vec2 snapped = glm::floor(glm::vec2(center) / c.texel) * c.texel;
+            c.min = snapped - c.radius;
+            c.max = snapped + c.radius;
+        }
+        else
+        {
+            c.min = glm::vec2(std::numeric_limits<float>::max());
+            c.max = glm::vec2(std::numeric_limits<float>::lowest());
+            for(const auto& p : slice)
+            {
+                c.min = glm::min(c.min, glm::vec2(p));
+                c.max = glm::max(c.max, glm::vec2(p));
+            }
+            c.texel = std::max(c.max.x - c.min.x, c.max.y - c.min.y) / resolution;
+        }
+        c.center_z = center.z;
+
+        c.light_space = glm::ortho(c.min.x, c.max.x, c.min.y, c.max.y, csm.near_plane, csm.far_plane) * csm.light_rotation;
+        split_near = c.split;
+    }
+}
+
+/* casters overlapping the cascade across the light and not entirely behind its receivers */
+bool cascade_visible(const cascaded_shadow& csm, const cascade& c, const caster& object)
+{
+    glm::vec3 min, max;
+    transform_bounds(csm.light_rotation, object.min, object.max, min, max);
+
+    if(max.x < c.min.x || min.x > c.max.x || max.y < c.min.y || min.y > c.max.y)
+    {
+        return false;
+    }
+
+    return max.z >= c.center_z - c.radius;
+}
+
 int main(int argc, char** argv)
 {
     /* initial window settings */
@@ -87,20 +473,13 @@ int main(int argc, char** argv)
 
     /* load obj model */
     auto model = asset::model_loader<vertex, material>::load_obj(context, "assets/small_city/small_city.obj");
+    auto model_matrix = glm::translate(glm::scale(glm::vec3(0.05f)), {0.0f, 2.0f, 0.0f});
 
 
-    /* framebuffer for shadow map */
-    auto texture_shadow = context.make_texture(opengl::texture_internal_type::depth32, opengl::texture_format::depth,
-                                               opengl::texture_type::float_, shadow_settings.resolution, shadow_settings.resolution);
-    texture_shadow->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::border);
-    texture_shadow->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::border);
-    texture_shadow->parameter(opengl::texture_color::border_color, {1.0, 1.0, 1.0, 1.0});
-
-    auto fb_shadow = context.make_framebuffer();
-    fb_shadow->attach_depth(texture_shadow);
-    fb_shadow->draw_buffer(opengl::color_buffer::none);
-    fb_shadow->read_buffer(opengl::color_buffer::none);
-    assert(fb_shadow->completed());
+    /* depth array with a layer per cascade and a framebuffer rendering into one layer at a time */
+    auto csm = construct_cascaded_shadow(context, *model, model_matrix, shadow_settings.resolution);
+    assert(csm.fb->completed());
+    apply_filter(csm, shadow_settings.filter);
 
 
     /* create shader and compile */
@@ -114,6 +493,10 @@ int main(int argc, char** argv)
     shader_light->load("shadow_mapping/shader/blinn_phong.frag", opengl::shader_type::fragment);
     shader_light->link();
 
+    auto shader_moments = context.make_shader();
+    shader_moments->load("shadow_mapping/shader/shadow_moments.comp", opengl::shader_type::compute);
+    shader_moments->link();
+
 
     /* enable/disable OpenGL options */
     context.clear_color(0.0, 0.5, 1.0, 1.0);
@@ -122,61 +505,149 @@ int main(int argc, char** argv)
     context.cull(opengl::polygon_face::back);
 
 
+    float time = 0.0f;
     view.on_render([&](auto& window, float dt)
     {
-        auto model_matrix = glm::translate(glm::scale(glm::vec3(0.05f)), {0.0f, 2.0f, 0.0f});
-        glm::mat4 light_proj = glm::ortho(-shadow_settings.scale, shadow_settings.scale, -shadow_settings.scale, shadow_settings.scale,
-                                           shadow_settings.near_far_plane.x, shadow_settings.near_far_plane.y);
-        glm::mat4 light_view = glm::lookAt(-shadow_settings.distance * dir_light.direction,
-                                          glm::vec3( 0.0f, 0.0f,  0.0f),
-                                          glm::vec3( 0.0f, 1.0f,  0.0f));
-        glm::mat4 light_matrix = light_proj * light_view;
+        if(shadow_settings.animate) { time += dt; }
+
+        update_casters(csm, model_matrix, shadow_settings.dynamic_casters, time);
+        update_cascades(csm, camera, dir_light.direction, shadow_settings);
 
         /********************** 1. shadow map pass **********************/
         {
             /* backup opengl state */
-            auto size = texture_shadow->size();
+            auto size = csm.maps->size();
             auto viewport = context.viewport(0, 0, size.x, size.y);
             auto cull = shadow_settings.face_culling ? context.cull(opengl::polygon_face::front) : opengl::polygon_face::back;
 
-            fb_shadow->bind();
-            context.clear(opengl::clear_options::depth);
-
             shader_shadowmap->bind();
-            shader_shadowmap->uniform("uModel", model_matrix);
-            shader_shadowmap->uniform("uLightSpace", light_matrix);
 
-            for(const auto& [_, mesh] : model->meshes())
+            for(int i = 0; i < shadow_settings.cascades; i++)
             {
-                mesh.vao()->draw(opengl::primitives::triangles);
-            }
+                auto& c = csm.cascades[i];
+                if(c.query->available()) { c.pass_ms = c.query->elapsed_ms(); }
+
+                /* static depth is redrawn for a new light space or revision, the copy if a dynamic caster in the cascade changed */
+                const bool static_valid = shadow_settings.cache && c.cached_revision == csm.revision && c.cached_light_space == c.light_space;
 
-            fb_shadow->unbind();
+                std::vector<std::pair<std::size_t, glm::mat4>> dynamic;
+                for(std::size_t j = 0; j < csm.casters.size() && csm.casters[j].dynamic; j++)
+                {
+                    if(cascade_visible(csm, c, csm.casters[j])) { dynamic.emplace_back(j, csm.casters[j].model); }
+                }
+
+                if(static_valid && dynamic == c.cached_dynamic)
+                {
+                    c.update = cascade_update::cached;
+                    c.pass_ms = 0.0;
+                    continue;
+                }
+
+                const bool time_pass = !c.query->pending();
+                if(time_pass) { c.query->begin(); }
+
+                shader_shadowmap->uniform("uLightSpace", c.light_space);
+
+                csm.fb_static->attach_depth(csm.static_maps, i);
+                if(!static_valid)
+                {
+                    csm.fb_static->bind();
+                    context.clear(opengl::clear_options::depth);
+
+                    c.static_draws = 0;
+                    for(const auto& object : csm.casters)
+                    {
+                        if(object.dynamic || !cascade_visible(csm, c, object)) { continue; }
+
+                        shader_shadowmap->uniform("uModel", object.model);
+                        object.mesh->vao()->draw(opengl::primitives::triangles);
+                        c.static_draws++;
+                    }
+
+                    csm.fb_static->unbind();
+                    c.cached_light_space = c.light_space;
+                    c.cached_revision = csm.revision;
+                }
+
+                /* copy of the static depth with the dynamic casters on top */
+                csm.fb->attach_depth(csm.maps, i);
+                csm.fb_static->blit(*csm.fb, 0, 0, size.x, size.y, opengl::blit_mask::depth);
+
+                csm.fb->bind();
+                for(const auto& [j, object_model] : dynamic)
+                {
+                    shader_shadowmap->uniform("uModel", object_model);
+                    csm.casters[j].mesh->vao()->draw(opengl::primitives::triangles);
+                }
+                csm.fb->unbind();
+
+                c.dynamic_draws = static_cast<unsigned int>(dynamic.size());
+                c.cached_dynamic = std::move(dynamic);
+                c.update = static_valid ? cascade_update::dynamic : cascade_update::full;
+                c.moments_dirty = true;
+
+                if(time_pass) { c.query->end(); }
+            }
 
             /* set opengl state */
             context.viewport(viewport);
             context.cull(cull);
         }
 
-        /********************** 2. Blinn-Phong **********************/
+        /********************** 2. filterable shadow maps **********************/
+        if(shadow_settings.filter == shadow_filter::variance || shadow_settings.filter == shadow_filter::exponential)
+        {
+            update_moments(context, csm, shader_moments, shadow_settings);
+        }
+
+        /********************** 3. Blinn-Phong **********************/
         {
             shader_light->bind();
-            shader_light->uniform("uModel", model_matrix);
             shader_light->uniform("uView", camera.view());
             shader_light->uniform("uProj", camera.projection());
             shader_light->uniform("uViewPos", camera.position());
-            shader_light->uniform("uLightSpace", light_matrix);
 
             /* light */
             shader_light->uniform("uLight.direction", dir_light.direction);
             shader_light->uniform("uLight.ambient", dir_light.ambient);
             shader_light->uniform("uLight.color", dir_light.color);
 
+            shader_light->uniform("uShadow.mode", static_cast<int>(shadow_settings.filter));
             shader_light->uniform("uShadow.bias", shadow_settings.bias);
             shader_light->uniform("uShadow.spacing", shadow_settings.spacing);
             shader_light->uniform("uShadow.samples", shadow_settings.samples);
+            shader_light->uniform("uShadow.exponent", shadow_settings.exponent);
+            shader_light->uniform("uShadow.bleeding", shadow_settings.bleeding);
+            shader_light->uniform("uShadow.minVariance", shadow_settings.min_variance);
             shader_light->uniform("uShadow.map_shadow", 2);
-            texture_shadow->bind(2);
+            shader_light->uniform("uShadow.map_compare", 3);
+            shader_light->uniform("uShadow.map_moments", 4);
+
+            /* only the unit of the sampler in use holds a texture, the depth has the compare mode of one of them */
+            csm.maps->unbind(2);
+            csm.maps->unbind(3);
+            csm.maps->unbind(4);
+            switch(shadow_settings.filter)
+            {
+            case shadow_filter::reference:    csm.maps->bind(2); break;
+            case shadow_filter::hardware_pcf: csm.maps->bind(3); break;
+            default:                          csm.moments->bind(4); break;
+            }
+
+            /* cascades, the bias grows with the texel size */
+            std::array<glm::mat4, max_cascades> light_space;
+            glm::vec4 splits(0.0f), texel_scale(1.0f);
+            for(int i = 0; i < shadow_settings.cascades; i++)
+            {
+                light_space[i] = csm.cascades[i].light_space;
+                splits[i] = csm.cascades[i].split;
+                texel_scale[i] = csm.cascades[i].texel / csm.cascades[0].texel;
+            }
+            shader_light->uniform("uLightSpace[0]", light_space);
+            shader_light->uniform("uCascades.count", shadow_settings.cascades);
+            shader_light->uniform("uCascades.splits", splits);
+            shader_light->uniform("uCascades.texelScale", texel_scale);
+            shader_light->uniform("uCascades.debug", shadow_settings.debug);
 
             shader_light->uniform("uMaterial.map_diffuse", 0);
             shader_light->uniform("uMaterial.map_specular", 1);
@@ -193,6 +664,7 @@ int main(int argc, char** argv)
                 /* iterate over mesh and render faces with this material */
                 for(const auto& record : mat_group.records())
                 {
+                    shader_light->uniform("uModel", csm.casters[csm.caster_index.at(&record.m_mesh)].model);
                     record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles);
                 }
             }
@@ -255,30 +727,93 @@ int main(int argc, char** argv)
 
             ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Shadow Map: ");
             ImGui::PushID("shadow");
-            ImGui::DragFloat("distance", &shadow_settings.distance);
-            ImGui::DragFloat2("Near/Far Plane", &shadow_settings.near_far_plane[0]);
-            ImGui::DragFloat("Ortho scale", &shadow_settings.scale);
-            ImGui::Checkbox("face culling", &shadow_settings.face_culling);
+            ImGui::SliderInt("cascades", &shadow_settings.cascades, 1, max_cascades);
+            ImGui::SliderFloat("split lambda", &shadow_settings.lambda, 0.0f, 1.0f);
+            ImGui::DragFloat("max distance", &shadow_settings.max_distance, 0.1f, 1.0f, camera.far_plane());
+            ImGui::Checkbox("stabilize", &shadow_settings.stabilize);
+            ImGui::Checkbox("show cascades", &shadow_settings.debug);
+            if(ImGui::Checkbox("face culling", &shadow_settings.face_culling))
+            {
+                csm.revision++;
+            }
+
+            ImGui::Separator();
+
+            ImGui::Checkbox("cache", &shadow_settings.cache);
+            ImGui::SliderInt("dynamic casters", &shadow_settings.dynamic_casters, 0, static_cast<int>(csm.casters.size()));
+            ImGui::Checkbox("animate", &shadow_settings.animate);
 
             ImGui::Separator();
 
             ImGui::DragFloat("bias", &shadow_settings.bias, 0.00001, 0.0, 0.1, "%.6f");
-            ImGui::DragFloat("filter spacing", &shadow_settings.spacing, 0.01, 0.0, 10.0);
-            ImGui::DragInt("filter samples", &shadow_settings.samples, 1.0, 1, 64);
+
+            int filter = static_cast<int>(shadow_settings.filter);
+            bool filter_changed = false;
+            filter_changed |= ImGui::RadioButton("reference", &filter, static_cast<int>(shadow_filter::reference)); ImGui::SameLine();
+            filter_changed |= ImGui::RadioButton("hardware pcf", &filter, static_cast<int>(shadow_filter::hardware_pcf)); ImGui::SameLine();
+            filter_changed |= ImGui::RadioButton("vsm", &filter, static_cast<int>(shadow_filter::variance)); ImGui::SameLine();
+            filter_changed |= ImGui::RadioButton("esm", &filter, static_cast<int>(shadow_filter::exponential));
+            if(filter_changed)
+            {
+                shadow_settings.filter = static_cast<shadow_filter>(filter);
+                apply_filter(csm, shadow_settings.filter);
+            }
+
+            switch(shadow_settings.filter)
+            {
+            case shadow_filter::reference:
+                ImGui::DragFloat("filter spacing", &shadow_settings.spacing, 0.01, 0.0, 10.0);
+                ImGui::DragInt("filter samples", &shadow_settings.samples, 1.0, 1, 64);
+                break;
+
+            case shadow_filter::hardware_pcf:
+                break;
+
+            case shadow_filter::variance:
+            case shadow_filter::exponential:
+            {
+                bool blur_changed = ImGui::SliderInt("blur radius", &shadow_settings.blur_radius, 0, 8);
+                if(shadow_settings.filter == shadow_filter::variance)
+                {
+                    ImGui::SliderFloat("light bleeding", &shadow_settings.bleeding, 0.0f, 0.9f);
+                    ImGui::DragFloat("min variance", &shadow_settings.min_variance, 0.000001f, 0.0f, 0.01f, "%.6f");
+                }
+                else
+                {
+                    blur_changed |= ImGui::SliderFloat("exponent", &shadow_settings.exponent, 1.0f, 80.0f);
+                }
+                if(blur_changed)
+                {
+                    apply_filter(csm, shadow_settings.filter);
+                }
+                ImGui::Text("moments blur: %5.3f ms", csm.blur_ms);
+                break;
+            }
+            }
 
             if(ImGui::DragInt("resolution", &shadow_settings.resolution, 1, 1, 8*1024))
             {
-                texture_shadow->resize(shadow_settings.resolution, shadow_settings.resolution);
+                csm.maps->resize(shadow_settings.resolution, shadow_settings.resolution, max_cascades);
+                csm.static_maps->resize(shadow_settings.resolution, shadow_settings.resolution, max_cascades);
+                csm.revision++;
             }
             ImGui::PopID();
-        }
-        ImGui::End();
 
-        /************** render shadow map **************/
-        ImGui::SetNextWindowPos({16.0f, window.size().y - 256.0f - 32.0f});
-        ImGui::Begin("##shadowmap", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoTitleBar);
-        {
-            ImGui::Image(texture_shadow.get(), {256, 256}, {0, 1}, {1, 0});
+
+            ImGui::Dummy({0.0, 16.0});
+
+
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Cascades: ");
+            constexpr const char* updates[] = {"cached", "dynamic", "full"};
+            double total_ms = 0.0;
+            for(int i = 0; i < shadow_settings.cascades; i++)
+            {
+                const auto& c = csm.cascades[i];
+                ImGui::Text("%d: %6.2f m  %-7s  %4u + %2u / %zu draws  %5.3f ms  (%.4f m/texel)", i, c.split, updates[static_cast<int>(c.update)],
+                            c.static_draws, c.dynamic_draws, csm.casters.size(), c.pass_ms, c.texel);
+                total_ms += c.pass_ms;
+            }
+            ImGui::Text("shadow pass: %5.3f ms", total_ms);
         }
         ImGui::End();
     });
@@ -0,0 +1,63 @@
+#version 330
+
+/* temporal upscaling: the frame is rendered at a fraction of the output resolution with a sub-pixel jitter (in
+   render pixels); each output pixel gathers the jittered samples of the 3x3 nearest render texels weighted by their
+   distance (gaussian fit of blackman-harris) and accumulates them into the reprojected history, which is clamped
+   to the color box of these samples */
+uniform sampler2D uColorPrev;
+uniform sampler2D uColorCurr;
+uniform sampler2D uVelocity;
+uniform float uAlpha;
+uniform vec2 uJitter;
+
+out vec4 fragColor;
+
+void main(void)
+{
+    vec2 outputSize = vec2(textureSize(uColorPrev, 0));
+    vec2 renderSize = vec2(textureSize(uColorCurr, 0));
+    vec2 texCoord = gl_FragCoord.xy / outputSize;
+
+    /* output pixel center in render pixels, texel t sampled the scene at t + 0.5 - jitter */
+    vec2 pos = texCoord * renderSize;
+    ivec2 nearest = ivec2(floor(pos + uJitter));
+
+    vec4 sum = vec4(0.0);
+    float weights = 0.0;
+    float confidence = 0.0;
+    vec4 boxMin = vec4(1.0);
+    vec4 boxMax = vec4(0.0);
+    for(int y = -1; y <= 1; y++)
+    {
+        for(int x = -1; x <= 1; x++)
+        {
+            ivec2 texel = clamp(nearest + ivec2(x, y), ivec2(0), ivec2(renderSize) - 1);
+            vec4 sample_color = texelFetch(uColorCurr, texel, 0);
+
+            vec2 d = vec2(texel) + 0.5 - uJitter - pos;
+            float weight = exp(-2.29 * dot(d, d));
+
+            sum += weight * sample_color;
+            weights += weight;
+            confidence = max(confidence, weight);
+
+            boxMin = min(boxMin, sample_color);
+            boxMax = max(boxMax, sample_color);
+        }
+    }
+    vec4 color = sum / weights;
+
+    /* disoccluded by the screen border, nothing to accumulate */
+    vec2 texCoordPrev = texCoord + texture(uVelocity, texCoord).xy;
+    if(any(lessThan(texCoordPrev, vec2(0.0))) || any(greaterThan(texCoordPrev, vec2(1.0))))
+    {
+        fragColor = color;
+        return;
+    }
+
+    /* samples far from the pixel center contribute less, the history converges over the jitter sequence; a blend
+       factor of one (taa disabled) ignores the history */
+    float blend = uAlpha >= 1.0 ? 1.0 : clamp(uAlpha * confidence, 0.0, 1.0);
+    vec4 colorPrev = clamp(texture(uColorPrev, texCoordPrev), boxMin, boxMax);
+    fragColor = mix(colorPrev, color, blend);
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 
 #include <viewer/viewer.h>
@@ -7,6 +9,7 @@
 #include <viewer/opengl/shaderprogram.h>
 #include <viewer/opengl/texture.h>
 #include <viewer/opengl/framebuffer.h>
+#include <viewer/opengl/query.h>
 
 #include <glm/gtx/transform.hpp>
 
@@ -70,6 +73,11 @@ struct TAA
     float alpha = 0.1;
     bool enabled = true;
 
+    /* temporal upscaling: the scene is rendered at a fraction of the output resolution and reconstructed from the
+       jittered samples of several frames (history stays at output resolution) */
+    bool upscaling = false;
+    float render_scale = 0.5f;
+
     /* history buffer */
     struct History
     {
@@ -78,6 +86,24 @@ struct TAA
         opengl::handle<opengl::texture> color;
     } history[2];
     int history_idx = 0;
+
+    /* one jitter sample per output pixel needs scale^-2 times the samples of native resolution */
+    int jitter_phases() const
+    {
+        float scale = upscaling ? render_scale : 1.0f;
+        return std::min(static_cast<int>(std::ceil(8.0f / (scale * scale))), 64);
+    }
+
+    glm::uvec2 render_size(const glm::uvec2& output) const
+    {
+        float scale = upscaling ? render_scale : 1.0f;
+        return glm::max(glm::uvec2(glm::round(glm::vec2(output) * scale)), glm::uvec2(1));
+    }
+
+    double render_ms = 0.0;
+    double resolve_ms = 0.0;
+    opengl::handle<opengl::timer_query> render_query;
+    opengl::handle<opengl::timer_query> resolve_query;
 };
 
 
@@ -125,15 +151,18 @@ int main(int argc, char** argv)
     TAA taa;
     taa.history[0] = create_history_buffer();
     taa.history[1] = create_history_buffer();
+    taa.render_query = context.make_timer_query();
+    taa.resolve_query = context.make_timer_query();
 
 
-    /* create pipeline framebuffer with color, velocity, and depth texture */
+    /* create pipeline framebuffer with color, velocity, and depth texture (at render resolution) */
+    auto render_size = taa.render_size(view.window().size());
     auto tex_color = context.make_texture(opengl::texture_internal_type::rgb8, opengl::texture_format::rgb,
-                                          opengl::texture_type::unsigned_byte_, view.window().size().x, view.window().size().y);
+                                          opengl::texture_type::unsigned_byte_, render_size.x, render_size.y);
     auto tex_vel = context.make_texture(opengl::texture_internal_type::rgb16F, opengl::texture_format::rgb,
-                                        opengl::texture_type::float_, view.window().size().x, view.window().size().y);
+                                        opengl::texture_type::float_, render_size.x, render_size.y);
     auto tex_depth = context.make_texture(opengl::texture_internal_type::depth, opengl::texture_format::depth,
-                                          opengl::texture_type::unsigned_int_, view.window().size().x, view.window().size().y);
+                                          opengl::texture_type::unsigned_int_, render_size.x, render_size.y);
 
     tex_color->parameter(opengl::min_filter::linear);
     tex_color->parameter(opengl::mag_filter::linear);
@@ -152,6 +181,19 @@ int main(int argc, char** argv)
     fb_pipeline->draw_attachment(0, 1);
     assert(fb_pipeline->completed());
 
+    /* render targets follow the render scale, independent of the history buffers */
+    auto resize_render_targets = [&](const glm::uvec2& output)
+    {
+        render_size = taa.render_size(output);
+
+        tex_color->resize(render_size.x, render_size.y);
+        tex_depth->resize(render_size.x, render_size.y);
+        tex_vel->resize(render_size.x, render_size.y);
+
+        taa.jitter_noise = halton_sequence(taa.jitter_phases());
+        taa.jitter_idx = 0;
+    };
+
 
     /* create shader and compile */
     auto shader = context.make_shader();
@@ -164,6 +206,11 @@ int main(int argc, char** argv)
     shader_post->load("temporal_anti_aliasing/shader/post.frag", opengl::shader_type::fragment);
     shader_post->link();
 
+    auto shader_upscale = context.make_shader();
+    shader_upscale->load("temporal_anti_aliasing/shader/post.vert", opengl::shader_type::vertex);
+    shader_upscale->load("temporal_anti_aliasing/shader/upscale.frag", opengl::shader_type::fragment);
+    shader_upscale->link();
+
 
     /* enable/disable OpenGL options */
     context.clear_color(1.0, 1.0, 1.0, 1.0);
@@ -182,19 +229,26 @@ int main(int argc, char** argv)
         /* store unjitter view-projection matrix */
         taa.history[taa.history_idx].proj = camera.projection() * camera.view();
 
+        /* generate different samples by adding viewport sub-pixel offset (halton sequence), in render pixels */
+        auto jitter = taa.enabled ? taa.jitter_noise[taa.jitter_idx] - glm::vec2{0.5, 0.5} : glm::vec2(0.0);
+
+        if(taa.render_query->available()) { taa.render_ms = taa.render_query->elapsed_ms(); }
+        if(taa.resolve_query->available()) { taa.resolve_ms = taa.resolve_query->elapsed_ms(); }
+
         /*********** 1. render scene and store motion vectors ***********/
         fb_pipeline->bind();
         {
+            const bool time_render = !taa.render_query->pending();
+            if(time_render) { taa.render_query->begin(); }
+
+            auto viewport = context.viewport(0, 0, render_size.x, render_size.y);
             context.clear(opengl::clear_options::color_depth);
 
             shader->bind();
             shader->uniform("uModel", glm::translate(glm::mat4(1.0), {0.0f, -1.0f, 0.0f}));
             shader->uniform("uProjViewCurr", taa.history[taa.history_idx].proj);
             shader->uniform("uProjViewPrev", taa.history[history_prev].proj);
-
-            /* generate different samples by adding viewport sub-pixel offset (halton sequence) */
-            auto jitter = (taa.jitter_noise[taa.jitter_idx] - glm::vec2{0.5, 0.5}) / glm::vec2(taa.history[history_prev].color->size());
-            shader->uniform("uJitter", taa.enabled ? jitter : glm::vec2(0.0));
+            shader->uniform("uJitter", jitter / glm::vec2(render_size));
 
             /* iterate over materials */
             for(auto& [_, mat_group] : model->material_groups())
@@ -211,25 +265,36 @@ int main(int argc, char** argv)
                     record.m_mesh.vao()->draw(record.m_offset, record.m_count, opengl::primitives::triangles);
                 }
             }
+
+            context.viewport(viewport);
+            if(time_render) { taa.render_query->end(); }
         }
         fb_pipeline->unbind();
 
         /*********** 2. combine with temporal samples ***********/
         taa.history[taa.history_idx].framebuffer->bind();
         {
+            const bool time_resolve = !taa.resolve_query->pending();
+            if(time_resolve) { taa.resolve_query->begin(); }
+
             context.clear(opengl::clear_options::color);
 
-            shader_post->bind();
-            shader_post->uniform("uColorPrev", 0);
-            shader_post->uniform("uColorCurr", 1);
-            shader_post->uniform("uVelocity", 2);
-            shader_post->uniform("uAlpha", taa.enabled ? taa.alpha : 1.0f);
+            /* upscaling reconstructs each output pixel from the jittered render samples around it */
+            auto& shader_resolve = taa.upscaling ? shader_upscale : shader_post;
+            shader_resolve->bind();
+            shader_resolve->uniform("uColorPrev", 0);
+            shader_resolve->uniform("uColorCurr", 1);
+            shader_resolve->uniform("uVelocity", 2);
+            shader_resolve->uniform("uAlpha", taa.enabled ? taa.alpha : 1.0f);
+            if(taa.upscaling) { shader_resolve->uniform("uJitter", jitter); }
 
             taa.history[history_prev].color->bind(0);
             tex_color->bind(1);
             tex_vel->bind(2);
 
             screen_quad->vao()->draw(opengl::primitives::triangles);
+
+            if(time_resolve) { taa.resolve_query->end(); }
         }
         taa.history[taa.history_idx].framebuffer->unbind();
 
@@ -243,9 +308,7 @@ int main(int argc, char** argv)
         taa.history[0].color->resize(width, height);
         taa.history[1].color->resize(width, height);
 
-        tex_color->resize(width, height);
-        tex_depth->resize(width, height);
-        tex_vel->resize(width, height);
+        resize_render_targets({width, height});
     });
 
     view.on_gui([&](auto& window, float dt)
@@ -260,6 +323,23 @@ int main(int argc, char** argv)
             ImGui::TextColored({0.7, 0.7, 0.7, 1.0}, "TAA:");
             ImGui::Checkbox("enabled", &taa.enabled);
             ImGui::SliderFloat("blend factor", &taa.alpha, 0.0, 1.0);
+            ImGui::Dummy({0.0, 8.0});
+
+            ImGui::TextColored({0.7, 0.7, 0.7, 1.0}, "Upscaling:");
+            bool resize = ImGui::Checkbox("upscaling", &taa.upscaling);
+            if(taa.upscaling)
+            {
+                resize |= ImGui::SliderFloat("render scale", &taa.render_scale, 0.25, 1.0);
+            }
+            if(resize)
+            {
+                resize_render_targets(window.size());
+            }
+
+            ImGui::Text("render:  %4u x %4u (%2zu jitter phases)", render_size.x, render_size.y, taa.jitter_noise.size());
+            ImGui::Text("output:  %4u x %4u", window.size().x, window.size().y);
+            ImGui::Text("scene:   %5.3f ms", taa.render_ms);
+            ImGui::Text("resolve: %5.3f ms", taa.resolve_ms);
 
             ImGui::Image(taa.history[taa.history_idx].color.get(), {256, 256}, {0.4, 0.5}, {0.5, 0.4});
         }
@@ -0,0 +1,15 @@
+#version 330
+
+uniform sampler2D uColorPrev;
+uniform sampler2D uColorCurr;
+
+/* 1 / number of accumulated samples (including the current one) */
+uniform float uWeight;
+
+out vec4 fragColor;
+
+void main(void)
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    fragColor = mix(texelFetch(uColorPrev, texel, 0), texelFetch(uColorCurr, texel, 0), uWeight);
+}
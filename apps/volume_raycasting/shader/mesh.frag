@@ -0,0 +1,22 @@
+#version 330
+
+in vec3 tNormal;
+
+out vec4 fragColor;
+
+struct Light
+{
+    vec3 color;
+    vec3 ambient;
+    vec3 direction;
+};
+
+uniform Light uLight;
+
+/* same shading as the iso surface raycaster (diffuse lighting of the gradient normal) */
+void main(void)
+{
+    vec3 normal = normalize(tNormal);
+    float diff = max(dot(normal, normalize(-uLight.direction)), 0.0);
+    fragColor = vec4(uLight.ambient + uLight.color * diff, 1.0);
+}
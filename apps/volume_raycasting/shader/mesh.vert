@@ -0,0 +1,16 @@
+#version 330
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aNormal;
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProj;
+
+out vec3 tNormal;
+
+void main(void)
+{
+    gl_Position = uProj * uView * uModel * vec4(aPosition, 1.0);
+    tNormal = mat3(uModel) * aNormal;
+}
@@ -7,13 +7,33 @@ struct Raycast
     sampler2D entry;
     sampler2D exit;
     sampler3D volume;
+    sampler3D bricks;
+    sampler3D gradients;
+
+    /* bc4 compressed slices (layers) used instead of volume */
+    sampler2DArray compressedVolume;
+    int compressed;
+
+    vec3 brickExtent;
+    int skipEmpty;
+    int precomputedGradients;
 
     float stepSize;
     int maxSteps;
 
+    /* ray offset in [0, 1) steps for progressive refinement, negative for a fixed start */
+    float jitter;
+
     int renderType;
     float isoValue;
     float gamma;
+
+    sampler2D transferFunction;
+    sampler2D preintegration;
+    float tableSize;
+    int preintegrated;
+    float opacityCorrection;
+    float earlyTermination;
 };
 
 struct Light
@@ -38,6 +58,23 @@ float random(vec3 seed, int i)
     return fract(sin(dot_product) * 43758.5453);
 }
 
+/* normalized density, compressed volumes interpolate between the two nearest layers */
+float sample_density(vec3 position)
+{
+    if(uRaycast.compressed == 0)
+    {
+        return textureLod(uRaycast.volume, position, 0).r;
+    }
+
+    float layers = float(textureSize(uRaycast.compressedVolume, 0).z);
+    float z = clamp(position.z * layers - 0.5, 0.0, layers - 1.0);
+    float z0 = floor(z);
+
+    float front = textureLod(uRaycast.compressedVolume, vec3(position.xy, z0), 0).r;
+    float back = textureLod(uRaycast.compressedVolume, vec3(position.xy, min(z0 + 1.0, layers - 1.0)), 0).r;
+    return mix(front, back, z - z0);
+}
+
 vec3 refine(in vec3 pos, in vec3 rayDir)
 {
     /* half step */
@@ -45,7 +82,7 @@ vec3 refine(in vec3 pos, in vec3 rayDir)
     pos -= (0.5 * step_vector);
 
     /* quarter step */
-    float density = textureLod(uRaycast.volume, pos, 0).r;
+    float density = sample_density(pos);
     pos -= step_vector * (density > uRaycast.isoValue ? 0.25 : -0.25 );
 
     return pos;
@@ -53,7 +90,21 @@ vec3 refine(in vec3 pos, in vec3 rayDir)
 
 vec3 gradient(vec3 position)
 {
+    /* precomputed direction (rgb * 0.5 + 0.5), a single filtered fetch */
+    if(uRaycast.precomputedGradients == 1)
+    {
+        return textureLod(uRaycast.gradients, position, 0).rgb * 2.0 - 1.0;
+    }
+
     /* central difference approximation of density gradient */
+    if(uRaycast.compressed == 1)
+    {
+        vec3 voxel = 1.0 / vec3(textureSize(uRaycast.compressedVolume, 0));
+        return vec3(sample_density(position + vec3(voxel.x, 0.0, 0.0)) - sample_density(position - vec3(voxel.x, 0.0, 0.0)),
+                    sample_density(position + vec3(0.0, voxel.y, 0.0)) - sample_density(position - vec3(0.0, voxel.y, 0.0)),
+                    sample_density(position + vec3(0.0, 0.0, voxel.z)) - sample_density(position - vec3(0.0, 0.0, voxel.z))) * 0.5;
+    }
+
     float dx = textureLodOffset(uRaycast.volume, position, 0, ivec3( 1, 0, 0)).r
               -textureLodOffset(uRaycast.volume, position, 0, ivec3(-1, 0, 0)).r;
     float dy = textureLodOffset(uRaycast.volume, position, 0, ivec3( 0, 1, 0)).r
@@ -64,14 +115,84 @@ vec3 gradient(vec3 position)
     return vec3(dx, dy, dz) * 0.5;
 }
 
+/* lookup texture coordinate of a normalized density (texel centers span [0, 1]) */
+float table_coord(float value)
+{
+    return (value * (uRaycast.tableSize - 1.0) + 0.5) / uRaycast.tableSize;
+}
+
+/* premultiplied color and opacity of the ray segment between two density samples */
+vec4 classify(float front, float back)
+{
+    if(uRaycast.preintegrated == 1)
+    {
+        return textureLod(uRaycast.preintegration, vec2(table_coord(back), table_coord(front)), 0);
+    }
+
+    /* post classification of the back sample, opacity corrected for the step length */
+    vec4 color = textureLod(uRaycast.transferFunction, vec2(table_coord(back), 0.5), 0);
+    color.a = 1.0 - pow(1.0 - min(color.a, 0.9999), uRaycast.opacityCorrection);
+    return vec4(color.rgb * color.a, color.a);
+}
+
+/* diffuse lighting from the density gradient (unlit in homogeneous regions) */
+vec3 shading(vec3 position)
+{
+    vec3 g = gradient(position);
+    if(dot(g, g) < 1e-4) { return vec3(1.0); }
+
+    vec3 normal = mat3(uModel) * -normalize(g);
+    float diff = max(dot(normal, normalize(-uLight.direction)), 0.0);
+    return uLight.ambient + uLight.color * diff;
+}
+
+/* the transfer function assigns no opacity to any density within the range (table entry of the whole range) */
+bool transparent(vec2 range)
+{
+    return textureLod(uRaycast.preintegration, vec2(table_coord(range.y), table_coord(range.x)), 0).a <= 0.0;
+}
+
+/* min / max density of the brick containing position (bricks overlap by one voxel) */
+vec2 brick_range(vec3 position)
+{
+    ivec3 brick = clamp(ivec3(position / uRaycast.brickExtent), ivec3(0), textureSize(uRaycast.bricks, 0) - 1);
+    return texelFetch(uRaycast.bricks, brick, 0).rg;
+}
+
+/* number of steps until the ray leaves the brick containing position */
+uint brick_skip(vec3 position, vec3 rayDir)
+{
+    vec3 brickMin = floor(position / uRaycast.brickExtent) * uRaycast.brickExtent;
+    vec3 brickMax = brickMin + uRaycast.brickExtent;
+
+    vec3 dir = mix(vec3(-1e-6), vec3(1e-6), greaterThanEqual(rayDir, vec3(0.0)));
+    dir = mix(dir, rayDir, greaterThan(abs(rayDir), vec3(1e-6)));
+
+    vec3 t = (mix(brickMin, brickMax, greaterThan(dir, vec3(0.0))) - position) / dir;
+    float tExit = min(t.x, min(t.y, t.z));
+
+    return uint(max(ceil(tExit / uRaycast.stepSize), 1.0));
+}
+
 vec4 render_mip(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
 {
     vec4 finalColor = vec4(0.0);
-    for(uint i = 0u; i < numSteps; i++)
+    uint i = 0u;
+    while(i < numSteps)
     {
-        float density = textureLod(uRaycast.volume, rayPos, 0).r;
+        /* brick can not raise the current maximum */
+        if(uRaycast.skipEmpty == 1 && brick_range(rayPos).y <= finalColor.r)
+        {
+            uint skip = brick_skip(rayPos, rayDir);
+            rayPos += float(skip) * uRaycast.stepSize * rayDir;
+            i += skip;
+            continue;
+        }
+
+        float density = sample_density(rayPos);
         finalColor = max(finalColor, vec4(density));
         rayPos += uRaycast.stepSize * rayDir;
+        i++;
     }
 
     return vec4(pow(finalColor.rgb, vec3(1.0 / uRaycast.gamma)), 1.0);
@@ -80,9 +201,19 @@ vec4 render_mip(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
 vec4 render_isosurface(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
 {
     vec4 finalColor = vec4(0.0);
-    for(uint i = 0u; i < numSteps; i++)
+    uint i = 0u;
+    while(i < numSteps)
     {
-        float density = textureLod(uRaycast.volume, rayPos, 0).r;
+        /* no sample inside the brick can cross the iso value */
+        if(uRaycast.skipEmpty == 1 && brick_range(rayPos).y <= uRaycast.isoValue)
+        {
+            uint skip = brick_skip(rayPos, rayDir);
+            rayPos += float(skip) * uRaycast.stepSize * rayDir;
+            i += skip;
+            continue;
+        }
+
+        float density = sample_density(rayPos);
         if(density > uRaycast.isoValue)
         {
             /* refine position and compute normal estimate from gradient */
@@ -98,12 +229,52 @@ vec4 render_isosurface(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
         }
 
         rayPos += uRaycast.stepSize * rayDir;
+        i++;
     }
 
     finalColor.a = 1.0;
     return finalColor;
 }
 
+vec4 render_dvr(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
+{
+    vec4 finalColor = vec4(0.0);
+    float front = sample_density(rayPos);
+    uint i = 0u;
+    while(i < numSteps)
+    {
+        /* no density within the brick is visible */
+        if(uRaycast.skipEmpty == 1 && transparent(brick_range(rayPos)))
+        {
+            uint skip = brick_skip(rayPos, rayDir);
+            rayPos += float(skip) * uRaycast.stepSize * rayDir;
+            front = sample_density(rayPos);
+            i += skip;
+            continue;
+        }
+
+        vec3 next = rayPos + uRaycast.stepSize * rayDir;
+        float back = sample_density(next);
+
+        vec4 color = classify(front, back);
+        if(color.a > 0.0)
+        {
+            color.rgb *= shading(next);
+            finalColor += (1.0 - finalColor.a) * color;
+
+            /* early ray termination */
+            if(finalColor.a >= uRaycast.earlyTermination) { break; }
+        }
+
+        front = back;
+        rayPos = next;
+        i++;
+    }
+
+    /* composited over the black background */
+    return vec4(pow(finalColor.rgb, vec3(1.0 / uRaycast.gamma)), 1.0);
+}
+
 void main(void)
 {
     vec2 fragPos = gl_FragCoord.xy / uScreenSize;
@@ -114,8 +285,10 @@ void main(void)
     if(rayStart == rayEnd) { discard; }
 
     uint numSteps = uint( min(uRaycast.maxSteps, length(rayStart - rayEnd) / uRaycast.stepSize) );
-    float random_offset = random(gl_FragCoord.xyy, int(gl_FragCoord.x));
-    vec3 rayPos = rayStart + rayDir * random_offset * uRaycast.stepSize;
+    if(uRaycast.jitter >= 0.0)
+    {
+        rayStart += rayDir * fract(random(gl_FragCoord.xyy, int(gl_FragCoord.x)) + uRaycast.jitter) * uRaycast.stepSize;
+    }
 
     switch (uRaycast.renderType)
     {
@@ -125,5 +298,8 @@ void main(void)
     case 1:
         fragColor = render_mip(rayStart, rayDir, numSteps);
         break;
+    case 2:
+        fragColor = render_dvr(rayStart, rayDir, numSteps);
+        break;
     }
 }
@@ -0,0 +1,282 @@
+#version 330
+
+out vec4 fragColor;
+
+/* multi resolution brick pyramid, sampled through a page table (see asset::brick_cache) */
+struct Raycast
+{
+    sampler2D entry;
+    sampler2D exit;
+
+    usampler3D pageTable;
+    sampler3D atlas;
+    vec3 atlasSize;
+    vec3 volumeSize;
+    float brickSize;
+
+    float stepSize;
+    int maxSteps;
+
+    /* ray offset in [0, 1) steps for progressive refinement, negative for a fixed start */
+    float jitter;
+
+    int renderType;
+    float isoValue;
+    float gamma;
+
+    sampler2D transferFunction;
+    sampler2D preintegration;
+    float tableSize;
+    int preintegrated;
+    float opacityCorrection;
+    float earlyTermination;
+};
+
+struct Light
+{
+    vec3 color;
+    vec3 ambient;
+    vec3 direction;
+};
+
+uniform mat4 uModel;
+uniform vec2 uScreenSize;
+
+uniform Light uLight;
+uniform Raycast uRaycast;
+
+const uint EMPTY = 254u;
+
+
+// https://github.com/opengl-tutorials/ogl/blob/master/tutorial16_shadowmaps/ShadowMapping.fragmentshader
+float random(vec3 seed, int i)
+{
+    vec4 seed4 = vec4(seed,i);
+    float dot_product = dot(seed4, vec4(12.9898,78.233,45.164,94.673));
+    return fract(sin(dot_product) * 43758.5453);
+}
+
+
+/* page table entry of the finest brick covering position (xyz = atlas slot, w = level) */
+uvec4 page_entry(vec3 position)
+{
+    ivec3 size = textureSize(uRaycast.pageTable, 0);
+    ivec3 cell = clamp(ivec3(position * uRaycast.volumeSize / uRaycast.brickSize), ivec3(0), size - 1);
+    return texelFetch(uRaycast.pageTable, cell, 0);
+}
+
+float sample_entry(vec3 position, uvec4 entry)
+{
+    /* empty or not (yet) resident */
+    if(entry.w >= EMPTY) { return 0.0; }
+
+    /* voxel coordinates within the brick of the resident level, shifted by the one voxel apron */
+    vec3 voxel = position * uRaycast.volumeSize / exp2(float(entry.w));
+    vec3 local = voxel - floor(voxel / uRaycast.brickSize) * uRaycast.brickSize;
+    vec3 texel = vec3(entry.xyz) * (uRaycast.brickSize + 2.0) + 1.0 + local;
+
+    return textureLod(uRaycast.atlas, texel / uRaycast.atlasSize, 0).r;
+}
+
+float density(vec3 position)
+{
+    return sample_entry(position, page_entry(position));
+}
+
+/* number of steps until the ray leaves the finest brick (page table cell) containing position */
+uint cell_skip(vec3 position, vec3 rayDir)
+{
+    vec3 extent = vec3(uRaycast.brickSize) / uRaycast.volumeSize;
+    vec3 cellMin = floor(position / extent) * extent;
+    vec3 cellMax = cellMin + extent;
+
+    vec3 dir = mix(vec3(-1e-6), vec3(1e-6), greaterThanEqual(rayDir, vec3(0.0)));
+    dir = mix(dir, rayDir, greaterThan(abs(rayDir), vec3(1e-6)));
+
+    vec3 t = (mix(cellMin, cellMax, greaterThan(dir, vec3(0.0))) - position) / dir;
+    float tExit = min(t.x, min(t.y, t.z));
+
+    return uint(max(ceil(tExit / uRaycast.stepSize), 1.0));
+}
+
+vec3 refine(in vec3 pos, in vec3 rayDir)
+{
+    /* half step */
+    vec3 step_vector = rayDir*uRaycast.stepSize;
+    pos -= (0.5 * step_vector);
+
+    /* quarter step */
+    pos -= step_vector * (density(pos) > uRaycast.isoValue ? 0.25 : -0.25 );
+
+    return pos;
+}
+
+vec3 gradient(vec3 position)
+{
+    /* central difference approximation of density gradient (one voxel of the finest level) */
+    vec3 h = 1.0 / uRaycast.volumeSize;
+    float dx = density(position + vec3(h.x, 0, 0)) - density(position - vec3(h.x, 0, 0));
+    float dy = density(position + vec3(0, h.y, 0)) - density(position - vec3(0, h.y, 0));
+    float dz = density(position + vec3(0, 0, h.z)) - density(position - vec3(0, 0, h.z));
+
+    return vec3(dx, dy, dz) * 0.5;
+}
+
+/* lookup texture coordinate of a normalized density (texel centers span [0, 1]) */
+float table_coord(float value)
+{
+    return (value * (uRaycast.tableSize - 1.0) + 0.5) / uRaycast.tableSize;
+}
+
+/* premultiplied color and opacity of the ray segment between two density samples */
+vec4 classify(float front, float back)
+{
+    if(uRaycast.preintegrated == 1)
+    {
+        return textureLod(uRaycast.preintegration, vec2(table_coord(back), table_coord(front)), 0);
+    }
+
+    /* post classification of the back sample, opacity corrected for the step length */
+    vec4 color = textureLod(uRaycast.transferFunction, vec2(table_coord(back), 0.5), 0);
+    color.a = 1.0 - pow(1.0 - min(color.a, 0.9999), uRaycast.opacityCorrection);
+    return vec4(color.rgb * color.a, color.a);
+}
+
+/* diffuse lighting from the density gradient (unlit in homogeneous regions) */
+vec3 shading(vec3 position)
+{
+    vec3 g = gradient(position);
+    if(dot(g, g) < 1e-4) { return vec3(1.0); }
+
+    vec3 normal = mat3(uModel) * -normalize(g);
+    float diff = max(dot(normal, normalize(-uLight.direction)), 0.0);
+    return uLight.ambient + uLight.color * diff;
+}
+
+vec4 render_mip(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
+{
+    vec4 finalColor = vec4(0.0);
+    uint i = 0u;
+    while(i < numSteps)
+    {
+        uvec4 entry = page_entry(rayPos);
+        if(entry.w == EMPTY)
+        {
+            uint skip = cell_skip(rayPos, rayDir);
+            rayPos += float(skip) * uRaycast.stepSize * rayDir;
+            i += skip;
+            continue;
+        }
+
+        finalColor = max(finalColor, vec4(sample_entry(rayPos, entry)));
+        rayPos += uRaycast.stepSize * rayDir;
+        i++;
+    }
+
+    return vec4(pow(finalColor.rgb, vec3(1.0 / uRaycast.gamma)), 1.0);
+}
+
+vec4 render_isosurface(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
+{
+    vec4 finalColor = vec4(0.0);
+    uint i = 0u;
+    while(i < numSteps)
+    {
+        uvec4 entry = page_entry(rayPos);
+        if(entry.w == EMPTY)
+        {
+            uint skip = cell_skip(rayPos, rayDir);
+            rayPos += float(skip) * uRaycast.stepSize * rayDir;
+            i += skip;
+            continue;
+        }
+
+        if(sample_entry(rayPos, entry) > uRaycast.isoValue)
+        {
+            /* refine position and compute normal estimate from gradient */
+            rayPos = refine(rayPos, rayDir);
+            vec3 normal = mat3(uModel) * -normalize(gradient(rayPos));
+
+            /* shading */
+            vec3 lightDir = normalize(-uLight.direction);
+            float diff = max(dot(normal, lightDir), 0.0);
+            finalColor.rgb = uLight.ambient + uLight.color * diff;
+
+            break;
+        }
+
+        rayPos += uRaycast.stepSize * rayDir;
+        i++;
+    }
+
+    finalColor.a = 1.0;
+    return finalColor;
+}
+
+vec4 render_dvr(in vec3 rayPos, in vec3 rayDir, in uint numSteps)
+{
+    vec4 finalColor = vec4(0.0);
+    float front = density(rayPos);
+    uint i = 0u;
+    while(i < numSteps)
+    {
+        /* region below the first visible density (see brick_cache::empty_threshold) */
+        uvec4 entry = page_entry(rayPos);
+        if(entry.w == EMPTY)
+        {
+            uint skip = cell_skip(rayPos, rayDir);
+            rayPos += float(skip) * uRaycast.stepSize * rayDir;
+            front = density(rayPos);
+            i += skip;
+            continue;
+        }
+
+        vec3 next = rayPos + uRaycast.stepSize * rayDir;
+        float back = density(next);
+
+        vec4 color = classify(front, back);
+        if(color.a > 0.0)
+        {
+            color.rgb *= shading(next);
+            finalColor += (1.0 - finalColor.a) * color;
+
+            /* early ray termination */
+            if(finalColor.a >= uRaycast.earlyTermination) { break; }
+        }
+
+        front = back;
+        rayPos = next;
+        i++;
+    }
+
+    return vec4(pow(finalColor.rgb, vec3(1.0 / uRaycast.gamma)), 1.0);
+}
+
+void main(void)
+{
+    vec2 fragPos = gl_FragCoord.xy / uScreenSize;
+    vec3 rayStart = texture(uRaycast.entry, fragPos).xyz;
+    vec3 rayEnd = texture(uRaycast.exit, fragPos).xyz;
+    vec3 rayDir = normalize(rayEnd - rayStart);
+
+    if(rayStart == rayEnd) { discard; }
+
+    uint numSteps = uint( min(uRaycast.maxSteps, length(rayStart - rayEnd) / uRaycast.stepSize) );
+    if(uRaycast.jitter >= 0.0)
+    {
+        rayStart += rayDir * fract(random(gl_FragCoord.xyy, int(gl_FragCoord.x)) + uRaycast.jitter) * uRaycast.stepSize;
+    }
+
+    switch (uRaycast.renderType)
+    {
+    case 0:
+        fragColor = render_isosurface(rayStart, rayDir, numSteps);
+        break;
+    case 1:
+        fragColor = render_mip(rayStart, rayDir, numSteps);
+        break;
+    case 2:
+        fragColor = render_dvr(rayStart, rayDir, numSteps);
+        break;
+    }
+}
@@ -2,14 +2,26 @@
 
 #include <viewer/viewer.h>
 #include <viewer/asset/volume.h>
+#include <viewer/asset/compressed_volume.h>
+#include <viewer/asset/bricked_volume.h>
+#include <viewer/asset/transfer_function.h>
+#include <viewer/asset/volume_series.h>
+#include <viewer/asset/isosurface.h>
+#include <viewer/asset/mpr.h>
 #include <viewer/asset/shapes.h>
 #include <viewer/asset/texture.h>
+#include <viewer/asset/image.h>
 #include <viewer/opengl/shaderprogram.h>
 #include <viewer/opengl/framebuffer.h>
 
 #include <glm/gtc/constants.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
 struct vertex
 {
     glm::vec3 position;
@@ -24,6 +36,21 @@ struct opengl::layout<vertex>
     };
 };
 
+struct mesh_vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+template <>
+struct opengl::layout<mesh_vertex>
+{
+    static constexpr attr_info value[] = {
+        {opengl::type::float_, 3, opengl::buffer_mapping::cast, offsetof(mesh_vertex, position)},
+        {opengl::type::float_, 3, opengl::buffer_mapping::cast, offsetof(mesh_vertex, normal)}
+    };
+};
+
 
 /* Directional Light Source */
 struct light
@@ -35,6 +62,8 @@ struct light
 
     glm::vec3 ambient = {0.2, 0.2, 0.2};
     glm::vec3 color = {1.0, 1.0, 1.0};
+
+    bool operator==(const light&) const = default;
 };
 
 /* helper */
@@ -46,8 +75,159 @@ struct raycasting
     int render_type = 1;
     float iso_value = 0.15f;
     float gamma = 1.5f;
+
+    /* empty space skipping */
+    bool skip_empty = true;
+
+    /* one gradient texel per shaded sample instead of six density fetches */
+    bool precomputed_gradients = true;
+
+    /* bc4 compressed slices instead of the r8 / r16 volume texture */
+    bool compressed = false;
+
+    /* direct volume rendering */
+    bool preintegrated = true;
+    float early_termination = 0.98f;
+
+    /* paged multi resolution volume */
+    bool bricked = false;
+    float pixel_error = 1.0f;
+    int upload_budget = 32;
+
+    bool operator==(const raycasting&) const = default;
 };
 
+/* progressive refinement: reduced resolution and coarse steps while the camera moves, jittered full resolution
+   samples accumulated into a history buffer while the view is still */
+struct progressive
+{
+    bool enabled = true;
+    float interaction_scale = 0.5f;
+    float interaction_step = 2.0f;
+    int max_samples = 32;
+
+    /* state the accumulated samples belong to */
+    int samples = 0;
+    glm::mat4 view{1.0};
+    glm::mat4 proj{1.0};
+    raycasting settings;
+    light lighting;
+
+    struct Buffer
+    {
+        opengl::handle<opengl::framebuffer> framebuffer;
+        opengl::handle<opengl::texture> color;
+    } frame, history[2];
+    int history_idx = 0;
+};
+
+/* marching cubes mesh of the iso surface, drawn instead of raycasting while the iso value stays fixed */
+struct surface_mesh
+{
+    bool enabled = false;
+    float iso_value = -1.0f;
+
+    std::size_t vertices = 0;
+    std::size_t triangles = 0;
+    double extract_ms = 0.0;
+    double merge_ms = 0.0;
+
+    /* average frame time last seen with raycasting (0) and with the mesh (1) */
+    double frame_ms[2] = {0.0, 0.0};
+
+    std::shared_ptr<asset::mesh<mesh_vertex>> mesh;
+};
+
+/* multiplanar reconstruction next to the 3D view: axial, coronal, sagittal and one oblique slice, all positions in
+   texture coordinates of the volume */
+struct slice_views
+{
+    bool enabled = false;
+    glm::vec3 position{0.5f, 0.5f, 0.5f};
+    glm::vec2 oblique_angles{0.5f, 0.5f};
+    float oblique_offset = 0.0f;
+    asset::mpr_volume::window window;
+
+    std::unique_ptr<asset::mpr_volume> volume;
+    std::vector<asset::mpr_slice> slices;
+};
+
+/* transfer function editor: color and opacity curve over density; left click adds or drags a point,
+   right click removes it, the color of the selected point is edited below */
+bool edit_transfer_function(asset::transfer_function& tf, int& selected)
+{
+    bool changed = false;
+
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const ImVec2 size = {ImGui::CalcItemWidth(), 96.0f};
+    auto to_screen = [&](float value, float opacity) -> ImVec2
+    {
+        return {origin.x + value * size.x, origin.y + (1.0f - opacity) * size.y};
+    };
+
+    ImGui::InvisibleButton("##transfer_function", size);
+    const ImVec2 mouse = ImGui::GetIO().MousePos;
+    const float mouse_value = std::clamp((mouse.x - origin.x) / size.x, 0.0f, 1.0f);
+    const float mouse_opacity = std::clamp(1.0f - (mouse.y - origin.y) / size.y, 0.0f, 1.0f);
+
+    int hovered = -1;
+    const auto& points = tf.points();
+    for(std::size_t i = 0; i < points.size(); i++)
+    {
+        ImVec2 p = to_screen(points[i].position, points[i].color.a);
+        if(std::abs(p.x - mouse.x) < 6.0f && std::abs(p.y - mouse.y) < 6.0f) { hovered = static_cast<int>(i); }
+    }
+
+    if(ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+    {
+        selected = hovered >= 0 ? hovered : static_cast<int>(tf.add(mouse_value, glm::vec4(glm::vec3(tf.evaluate(mouse_value)), mouse_opacity)));
+        changed |= hovered < 0;
+    }
+    else if(ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left) && selected >= 0)
+    {
+        selected = static_cast<int>(tf.move(selected, mouse_value, mouse_opacity));
+        changed = true;
+    }
+    else if(ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Right) && hovered >= 0 && points.size() > 1)
+    {
+        tf.remove(hovered);
+        selected = -1;
+        changed = true;
+    }
+
+    /* filled opacity curve tinted with the transfer function color, control points on top */
+    auto* draw = ImGui::GetWindowDrawList();
+    draw->AddRectFilled(origin, {origin.x + size.x, origin.y + size.y}, IM_COL32(32, 32, 32, 255));
+
+    constexpr int segments = 128;
+    for(int i = 0; i < segments; i++)
+    {
+        float v0 = static_cast<float>(i) / segments, v1 = static_cast<float>(i + 1) / segments;
+        glm::vec4 c0 = tf.evaluate(v0), c1 = tf.evaluate(v1);
+        ImU32 color = ImGui::ColorConvertFloat4ToU32({0.5f * (c0.r + c1.r), 0.5f * (c0.g + c1.g), 0.5f * (c0.b + c1.b), 1.0f});
+        draw->AddQuadFilled(to_screen(v0, 0.0f), to_screen(v0, c0.a), to_screen(v1, c1.a), to_screen(v1, 0.0f), color);
+        draw->AddLine(to_screen(v0, c0.a), to_screen(v1, c1.a), IM_COL32(255, 255, 255, 255));
+    }
+
+    for(std::size_t i = 0; i < points.size(); i++)
+    {
+        ImU32 outline = static_cast<int>(i) == selected ? IM_COL32(255, 255, 0, 255) : IM_COL32(255, 255, 255, 255);
+        draw->AddCircleFilled(to_screen(points[i].position, points[i].color.a), 5.0f, outline);
+    }
+
+    if(selected >= 0 && selected < static_cast<int>(points.size()))
+    {
+        glm::vec3 color = points[selected].color;
+        if(ImGui::ColorEdit3("point color", &color[0]))
+        {
+            tf.color(selected, color);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
 int main(int argc, char** argv)
 {
     /* initial window settings */
@@ -69,7 +249,118 @@ int main(int argc, char** argv)
 
     auto& context = view.context();
 
-    auto tex_volume = asset::volume_loader::load_raw(context, "assets/skull/skull_256x256x256_uint8.raw", {256, 256, 256});
+    /* optional time series: volume_raycasting <directory> <x> <y> <z>, the first time step stands in for the static
+       volume (brick grid, gradients and histogram are derived from it and therefore disabled during playback) */
+    std::filesystem::path volume_path = "assets/skull/skull_256x256x256_uint8.raw";
+    glm::uvec3 volume_size = {256, 256, 256};
+
+    std::shared_ptr<asset::volume_series> series;
+    if(argc > 4)
+    {
+        volume_size = {std::atoi(argv[2]), std::atoi(argv[3]), std::atoi(argv[4])};
+        series = asset::volume_series_loader::load(context, argv[1], volume_size);
+        if(!series)
+        {
+            return EXIT_FAILURE;
+        }
+
+        volume_path = series->path(0);
+        raycast_settings.skip_empty = false;
+        raycast_settings.precomputed_gradients = false;
+    }
+
+    /* map volume, compute brick min / max grid and upload both */
+    auto volume = asset::volume_loader::map_raw(volume_path, volume_size);
+    if(!volume)
+    {
+        return EXIT_FAILURE;
+    }
+
+    auto tex_volume = asset::volume_loader::load(context, *volume);
+    auto bricks = asset::volume_loader::compute_bricks(*volume, 8);
+    auto tex_bricks = asset::volume_loader::load(context, bricks);
+    glm::vec3 brick_extent = glm::vec3(bricks.brick_size) / glm::vec3(volume->size());
+
+    /* gradients and histogram (initial iso value) */
+    auto tex_gradients = asset::volume_loader::load(context, asset::volume_loader::compute_gradients(*volume));
+    auto histogram = asset::volume_loader::compute_histogram(*volume, 256);
+
+    /* bc4 copy of the (first) volume, encoded when it is enabled for the first time; either the bc4 array or the
+       r8 / r16 volume with its gradients is resident, never both (gradients are computed from the bc4 layers) */
+    asset::compressed_volume compressed;
+    opengl::handle<opengl::texture_array> tex_compressed;
+    auto make_resident = [&](bool use_compressed)
+    {
+        if(use_compressed)
+        {
+            if(compressed.data.empty())
+            {
+                compressed = asset::compressed_volume_loader::encode(*volume);
+                platform_log(core::log::level::info, "[volume_raycasting] {}: bc4 encoded, max error {:.4f}, rmse {:.5f}, psnr {:.1f} dB",
+                             volume_path.filename().string(), compressed.max_error, compressed.rmse, compressed.psnr);
+            }
+            if(!tex_compressed) { tex_compressed = asset::compressed_volume_loader::load(context, compressed); }
+
+            tex_volume.reset();
+            tex_gradients.reset();
+        }
+        else
+        {
+            if(!tex_volume) { tex_volume = asset::volume_loader::load(context, *volume); }
+            if(!tex_gradients) { tex_gradients = asset::volume_loader::load(context, asset::volume_loader::compute_gradients(*volume)); }
+
+            tex_compressed.reset();
+        }
+    };
+
+    /* bytes of the monolithic volume textures currently allocated */
+    auto resident_bytes = [&]()
+    {
+        const std::size_t voxels = static_cast<std::size_t>(volume->size().x) * volume->size().y * volume->size().z;
+        return std::array<std::size_t, 3>{tex_volume ? volume->bytes() : 0, tex_gradients ? voxels * 4 : 0, tex_compressed ? compressed.bytes() : 0};
+    };
+    raycast_settings.iso_value = histogram.suggest_iso();
+
+    /* transfer function around the suggested iso value, pre-integrated for the current step size
+       (opacities refer to a step of one voxel) */
+    asset::transfer_function transfer_function;
+    transfer_function.add(raycast_settings.iso_value, {0.8f, 0.5f, 0.4f, 0.0f});
+    transfer_function.add(std::min(raycast_settings.iso_value + 0.1f, 1.0f), {0.9f, 0.8f, 0.7f, 0.05f});
+    int selected_point = -1;
+
+    asset::preintegration_table preintegration(context, 256);
+    const float reference_step = 1.0f / static_cast<float>(std::max({volume->size().x, volume->size().y, volume->size().z}));
+
+    std::vector<float> histogram_plot(histogram.bins.size());
+    std::transform(histogram.bins.begin(), histogram.bins.end(), histogram_plot.begin(), [](auto count)
+    {
+        return std::log10(1.0f + static_cast<float>(count));
+    });
+
+    /* brick pyramid (cooked once next to the raw file) streamed into a small atlas to exercise paging */
+    std::unique_ptr<asset::brick_cache> brick_cache;
+    if(!series)
+    {
+        auto pyramid_path = volume_path;
+        pyramid_path.replace_extension(".bvol");
+        std::shared_ptr<asset::brick_pyramid> pyramid;
+        if(std::filesystem::exists(pyramid_path))
+        {
+            pyramid = asset::brick_pyramid_loader::load(pyramid_path);
+        }
+
+        /* missing or cooked by an older version */
+        if(!pyramid && asset::brick_pyramid_loader::cook(*volume, pyramid_path, 32))
+        {
+            pyramid = asset::brick_pyramid_loader::load(pyramid_path);
+        }
+
+        if(pyramid)
+        {
+            brick_cache = std::make_unique<asset::brick_cache>(context, pyramid, 8 << 20);
+        }
+    }
+
     auto mesh_cube = asset::shape<vertex>::create_unitcube(context);
 
     /* create entry exit texture framebuffer */
@@ -86,6 +377,31 @@ int main(int argc, char** argv)
     assert(fb_entry_exit->completed());
 
 
+    /* color buffers for progressive refinement (rgba16f so that the running average does not quantize) */
+    auto create_color_buffer = [&]()
+    {
+        auto tex_color = context.make_texture(opengl::texture_internal_type::rgba16f, opengl::texture_format::rgba,
+                                              opengl::texture_type::float_, settings.width, settings.heigth);
+
+        tex_color->parameter(opengl::min_filter::linear);
+        tex_color->parameter(opengl::mag_filter::linear);
+
+        auto fb_color = context.make_framebuffer();
+        fb_color->attach_color(0, tex_color);
+        fb_color->draw_attachment(0);
+        assert(fb_color->completed());
+
+        return progressive::Buffer{ fb_color, tex_color };
+    };
+
+    progressive refinement;
+    refinement.frame = create_color_buffer();
+    refinement.history[0] = create_color_buffer();
+    refinement.history[1] = create_color_buffer();
+
+    auto screen_quad = asset::shape<vertex>::create_screenquad(context);
+
+
     /* create shader and compile */
     auto shader_entry_exit = context.make_shader();
     shader_entry_exit->load("volume_raycasting/shader/entry_exit.vert", opengl::shader_type::vertex);
@@ -97,17 +413,272 @@ int main(int argc, char** argv)
     shader_raycast->load("volume_raycasting/shader/raycast.frag", opengl::shader_type::fragment);
     shader_raycast->link();
 
+    auto shader_raycast_bricked = context.make_shader();
+    shader_raycast_bricked->load("volume_raycasting/shader/simple.vert", opengl::shader_type::vertex);
+    shader_raycast_bricked->load("volume_raycasting/shader/raycast_bricked.frag", opengl::shader_type::fragment);
+    shader_raycast_bricked->link();
+
+    auto shader_mesh = context.make_shader();
+    shader_mesh->load("volume_raycasting/shader/mesh.vert", opengl::shader_type::vertex);
+    shader_mesh->load("volume_raycasting/shader/mesh.frag", opengl::shader_type::fragment);
+    shader_mesh->link();
+
+    auto shader_accumulate = context.make_shader();
+    shader_accumulate->load("volume_raycasting/shader/accumulate.vert", opengl::shader_type::vertex);
+    shader_accumulate->load("volume_raycasting/shader/accumulate.frag", opengl::shader_type::fragment);
+    shader_accumulate->link();
+
     /* opengl context settings */
     context.clear_color(0, 0, 0, 1);
     context.set(opengl::options::blend, true);
     context.set(opengl::blend_func_factor_alpha::src_alpha, opengl::blend_func_factor_alpha::one_minus_src_alpha);
 
 
+    /* raycasting pass into the bound framebuffer, resolution is the size of the current viewport */
+    auto raycast = [&](const glm::mat4& model, const glm::uvec2& resolution, float step_size, float jitter, bool preintegrated)
+    {
+        /* paged volume */
+        if(raycast_settings.bricked && brick_cache)
+        {
+            const float threshold[] = {raycast_settings.iso_value, 0.0f, transfer_function.first_visible()};
+            brick_cache->empty_threshold(threshold[raycast_settings.render_type]);
+            brick_cache->update(model, camera.view(), camera.projection(), resolution.y,
+                                raycast_settings.pixel_error, raycast_settings.upload_budget);
+
+            const auto& pyramid = brick_cache->pyramid();
+
+            shader_raycast_bricked->bind();
+            shader_raycast_bricked->uniform("uModel", model);
+            shader_raycast_bricked->uniform("uView", camera.view());
+            shader_raycast_bricked->uniform("uProj", camera.projection());
+            shader_raycast_bricked->uniform("uScreenSize", glm::vec2(resolution));
+
+            shader_raycast_bricked->uniform("uRaycast.entry", 0);
+            shader_raycast_bricked->uniform("uRaycast.exit", 1);
+            shader_raycast_bricked->uniform("uRaycast.pageTable", 2);
+            shader_raycast_bricked->uniform("uRaycast.atlas", 3);
+            shader_raycast_bricked->uniform("uRaycast.atlasSize", glm::vec3(brick_cache->atlas()->size()));
+            shader_raycast_bricked->uniform("uRaycast.volumeSize", glm::vec3(pyramid->size()));
+            shader_raycast_bricked->uniform("uRaycast.brickSize", static_cast<float>(pyramid->brick_size()));
+            shader_raycast_bricked->uniform("uRaycast.stepSize", step_size);
+            shader_raycast_bricked->uniform("uRaycast.maxSteps", raycast_settings.max_steps);
+            shader_raycast_bricked->uniform("uRaycast.jitter", jitter);
+
+            shader_raycast_bricked->uniform("uRaycast.renderType", raycast_settings.render_type);
+            shader_raycast_bricked->uniform("uRaycast.isoValue", raycast_settings.iso_value);
+            shader_raycast_bricked->uniform("uRaycast.gamma", raycast_settings.gamma);
+
+            shader_raycast_bricked->uniform("uRaycast.transferFunction", 5);
+            shader_raycast_bricked->uniform("uRaycast.preintegration", 6);
+            shader_raycast_bricked->uniform("uRaycast.tableSize", static_cast<float>(preintegration.resolution()));
+            shader_raycast_bricked->uniform("uRaycast.preintegrated", preintegrated ? 1 : 0);
+            shader_raycast_bricked->uniform("uRaycast.opacityCorrection", step_size / reference_step);
+            shader_raycast_bricked->uniform("uRaycast.earlyTermination", raycast_settings.early_termination);
+
+            shader_raycast_bricked->uniform("uLight.direction", light_dir.direction);
+            shader_raycast_bricked->uniform("uLight.ambient", light_dir.ambient);
+            shader_raycast_bricked->uniform("uLight.color", light_dir.color);
+
+            tex_entry->bind(0);
+            tex_exit->bind(1);
+            brick_cache->page_table()->bind(2);
+            brick_cache->atlas()->bind(3);
+            preintegration.lookup()->bind(5);
+            preintegration.table()->bind(6);
+
+            mesh_cube->vao()->draw(opengl::primitives::triangles);
+
+            tex_entry->unbind();
+            tex_exit->unbind();
+            brick_cache->page_table()->unbind();
+            brick_cache->atlas()->unbind();
+            preintegration.lookup()->unbind(5);
+            preintegration.table()->unbind(6);
+        }
+        /* monolithic volume */
+        else
+        {
+            const bool use_compressed = raycast_settings.compressed && tex_compressed && !series;
+            const bool use_gradients = raycast_settings.precomputed_gradients && tex_gradients;
+
+            shader_raycast->bind();
+            shader_raycast->uniform("uModel", model);
+            shader_raycast->uniform("uView", camera.view());
+            shader_raycast->uniform("uProj", camera.projection());
+            shader_raycast->uniform("uScreenSize", glm::vec2(resolution));
+
+            shader_raycast->uniform("uRaycast.entry", 0);
+            shader_raycast->uniform("uRaycast.exit", 1);
+            shader_raycast->uniform("uRaycast.volume", 2);
+            shader_raycast->uniform("uRaycast.compressedVolume", 7);
+            shader_raycast->uniform("uRaycast.compressed", use_compressed ? 1 : 0);
+            shader_raycast->uniform("uRaycast.bricks", 3);
+            shader_raycast->uniform("uRaycast.brickExtent", brick_extent);
+            shader_raycast->uniform("uRaycast.skipEmpty", raycast_settings.skip_empty ? 1 : 0);
+            shader_raycast->uniform("uRaycast.gradients", 4);
+            shader_raycast->uniform("uRaycast.precomputedGradients", use_gradients ? 1 : 0);
+            shader_raycast->uniform("uRaycast.stepSize", step_size);
+            shader_raycast->uniform("uRaycast.maxSteps", raycast_settings.max_steps);
+            shader_raycast->uniform("uRaycast.jitter", jitter);
+
+            shader_raycast->uniform("uRaycast.renderType", raycast_settings.render_type);
+            shader_raycast->uniform("uRaycast.isoValue", raycast_settings.iso_value);
+            shader_raycast->uniform("uRaycast.gamma", raycast_settings.gamma);
+
+            shader_raycast->uniform("uRaycast.transferFunction", 5);
+            shader_raycast->uniform("uRaycast.preintegration", 6);
+            shader_raycast->uniform("uRaycast.tableSize", static_cast<float>(preintegration.resolution()));
+            shader_raycast->uniform("uRaycast.preintegrated", preintegrated ? 1 : 0);
+            shader_raycast->uniform("uRaycast.opacityCorrection", step_size / reference_step);
+            shader_raycast->uniform("uRaycast.earlyTermination", raycast_settings.early_termination);
+
+            shader_raycast->uniform("uLight.direction", light_dir.direction);
+            shader_raycast->uniform("uLight.ambient", light_dir.ambient);
+            shader_raycast->uniform("uLight.color", light_dir.color);
+
+            tex_entry->bind(0);
+            tex_exit->bind(1);
+            const auto& volume_texture = series ? series->texture() : tex_volume;
+            if(volume_texture) { volume_texture->bind(2); }
+            tex_bricks->bind(3);
+            if(tex_gradients) { tex_gradients->bind(4); }
+            preintegration.lookup()->bind(5);
+            preintegration.table()->bind(6);
+            if(use_compressed) { tex_compressed->bind(7); }
+
+            mesh_cube->vao()->draw(opengl::primitives::triangles);
+
+            tex_entry->unbind();
+            tex_exit->unbind();
+            if(volume_texture) { volume_texture->unbind(); }
+            tex_bricks->unbind();
+            if(tex_gradients) { tex_gradients->unbind(); }
+            preintegration.lookup()->unbind(5);
+            preintegration.table()->unbind(6);
+            if(use_compressed) { tex_compressed->unbind(7); }
+        }
+    };
+
+
+    /* iso surface mesh of the (first) volume, extracted on demand */
+    surface_mesh surface;
+    auto extract_surface = [&]()
+    {
+        auto iso = asset::isosurface_loader::extract(*volume, raycast_settings.iso_value);
+        surface.mesh = asset::isosurface_loader::load<mesh_vertex>(context, iso);
+        surface.iso_value = raycast_settings.iso_value;
+        surface.vertices = iso.positions.size();
+        surface.triangles = iso.indices.size() / 3;
+        surface.extract_ms = iso.extract_ms;
+        surface.merge_ms = iso.merge_ms;
+    };
+
+
+    /* slice planes of the current settings, only slices whose plane (or window) changed are resampled */
+    slice_views mpr;
+    auto update_slices = [&]()
+    {
+        if(!mpr.volume)
+        {
+            mpr.volume = std::make_unique<asset::mpr_volume>(*volume);
+            for(int i = 0; i < 4; i++)
+            {
+                mpr.slices.emplace_back(context, glm::uvec2(512, 512));
+            }
+        }
+
+        const auto& p = mpr.position;
+        asset::mpr_volume::plane planes[4];
+        planes[0] = {{0.5f, 0.5f, p.z}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+        planes[1] = {{0.5f, p.y, 0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+        planes[2] = {{p.x, 0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+
+        /* oblique plane through the center (shifted along its normal) */
+        const auto& a = mpr.oblique_angles;
+        glm::vec3 normal = {glm::cos(a.y) * glm::sin(a.x), glm::sin(a.y), glm::cos(a.y) * glm::cos(a.x)};
+        glm::vec3 u = glm::normalize(glm::cross(std::abs(normal.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0), normal));
+        planes[3] = {glm::vec3(0.5f) + mpr.oblique_offset * normal, u, glm::cross(normal, u)};
+
+        for(int i = 0; i < 4; i++)
+        {
+            mpr.slices[i].plane(planes[i]);
+            mpr.slices[i].window(mpr.window);
+            mpr.slices[i].update(*mpr.volume);
+        }
+    };
+
+    /* unrefined frame with the shader paths that volume_reference mirrors (monolithic volume, central difference
+       gradients), written to disk together with the command line rendering the same image on the cpu */
+    bool screenshot = false;
+    auto save_screenshot = [&](const glm::mat4& model, const glm::uvec2& resolution)
+    {
+        auto settings_backup = raycast_settings;
+        raycast_settings.precomputed_gradients = false;
+        raycast_settings.bricked = false;
+        raycast_settings.compressed = false;
+
+        /* the bc4 path released the volume texture, a temporary one is enough (no gradients needed) */
+        const bool temporary_volume = !series && !tex_volume;
+        if(temporary_volume) { tex_volume = asset::volume_loader::load(context, *volume); }
+        raycast(model, resolution, raycast_settings.step_size, -1.0f, raycast_settings.preintegrated);
+        if(temporary_volume) { tex_volume.reset(); }
+        raycast_settings = settings_backup;
+
+        asset::image image(resolution.x, resolution.y);
+        context.read_pixels(0, 0, resolution.x, resolution.y, image.ptr());
+        for(unsigned int y = 0; y < resolution.y / 2; y++)
+        {
+            auto* top = image.ptr() + y * resolution.x * 4;
+            auto* bottom = image.ptr() + (resolution.y - 1 - y) * resolution.x * 4;
+            std::swap_ranges(top, top + resolution.x * 4, bottom);
+        }
+
+        if(!asset::image_loader::save(image, "volume_raycasting.png")) { return; }
+
+        if(raycast_settings.render_type == 2)
+        {
+            platform_log(core::log::level::warning, "[volume_raycasting] saved volume_raycasting.png, the cpu reference only covers ISO and MIP");
+            return;
+        }
+
+        const auto& eye = camera.position();
+        platform_log(core::log::level::info, "[volume_raycasting] saved volume_raycasting.png, reference: volume_reference {} {} {} {} --mode {} --iso {} "
+                     "--step {} --max-steps {} --gamma {} --light {} {} {} --size {} {} --camera {} {} {}{} --compare volume_raycasting.png",
+                     volume_path.string(), volume_size.x, volume_size.y, volume_size.z, raycast_settings.render_type == 0 ? "iso" : "mip",
+                     raycast_settings.iso_value, raycast_settings.step_size, raycast_settings.max_steps, raycast_settings.gamma,
+                     light_dir.direction.x, light_dir.direction.y, light_dir.direction.z, resolution.x, resolution.y,
+                     eye.x, eye.y, eye.z, raycast_settings.skip_empty ? "" : " --no-skip");
+    };
+
+
     /***************** install callbacks *****************/
     view.on_render([&](auto& window, float dt)
     {
         auto model = glm::rotate(glm::mat4(1.0), -glm::half_pi<float>(), glm::vec3{1.0, 0.0, 0.0});
 
+        surface.frame_ms[surface.enabled ? 1 : 0] = core::time_cast<core::milli_sec>(view.frameclock().avg());
+        if(surface.enabled && surface.mesh)
+        {
+            auto depth_test = context.set(opengl::options::depth_test, true);
+
+            shader_mesh->bind();
+            shader_mesh->uniform("uModel", model);
+            shader_mesh->uniform("uView", camera.view());
+            shader_mesh->uniform("uProj", camera.projection());
+            shader_mesh->uniform("uLight.direction", light_dir.direction);
+            shader_mesh->uniform("uLight.ambient", light_dir.ambient);
+            shader_mesh->uniform("uLight.color", light_dir.color);
+
+            surface.mesh->vao()->draw(opengl::primitives::triangles);
+
+            shader_mesh->unbind();
+            context.set(opengl::options::depth_test, depth_test);
+
+            /* the raycasting history is stale once it is displayed again */
+            refinement.samples = 0;
+            return;
+        }
+
         /* 1. render pass, computing entry exit points */
         fb_entry_exit->bind();
         {
@@ -134,37 +705,99 @@ int main(int argc, char** argv)
         }
         fb_entry_exit->unbind();
 
-        /* 2. render pass, perform raycasting */
+        /* 2. render pass, perform raycasting (directly or progressively refined) */
+        bool tf_changed = false;
+        if(raycast_settings.render_type == 2)
         {
-            shader_raycast->bind();
-            shader_raycast->uniform("uModel", model);
-            shader_raycast->uniform("uView", camera.view());
-            shader_raycast->uniform("uProj", camera.projection());
-            shader_raycast->uniform("uScreenSize", glm::vec2(window.size().x, window.size().y));
+            tf_changed = preintegration.update(transfer_function, raycast_settings.step_size / reference_step);
+        }
 
-            shader_raycast->uniform("uRaycast.entry", 0);
-            shader_raycast->uniform("uRaycast.exit", 1);
-            shader_raycast->uniform("uRaycast.volume", 2);
-            shader_raycast->uniform("uRaycast.stepSize", raycast_settings.step_size);
-            shader_raycast->uniform("uRaycast.maxSteps", raycast_settings.max_steps);
+        if(screenshot)
+        {
+            save_screenshot(model, window.size());
+            screenshot = false;
+            return;
+        }
 
-            shader_raycast->uniform("uRaycast.renderType", raycast_settings.render_type);
-            shader_raycast->uniform("uRaycast.isoValue", raycast_settings.iso_value);
-            shader_raycast->uniform("uRaycast.gamma", raycast_settings.gamma);
+        if(!refinement.enabled)
+        {
+            raycast(model, window.size(), raycast_settings.step_size, -1.0f, raycast_settings.preintegrated);
+            return;
+        }
 
-            shader_raycast->uniform("uLight.direction", light_dir.direction);
-            shader_raycast->uniform("uLight.ambient", light_dir.ambient);
-            shader_raycast->uniform("uLight.color", light_dir.color);
+        /* restart accumulation whenever the image would change */
+        bool camera_moved = camera.view() != refinement.view || camera.projection() != refinement.proj;
+        bool interacting = view.controls().active() || camera_moved;
+        bool bricks_changed = raycast_settings.bricked && brick_cache && brick_cache->stats().uploaded > 0;
+        if(interacting || tf_changed || bricks_changed || raycast_settings != refinement.settings || light_dir != refinement.lighting)
+        {
+            refinement.samples = 0;
+        }
+        refinement.view = camera.view();
+        refinement.proj = camera.projection();
+        refinement.settings = raycast_settings;
+        refinement.lighting = light_dir;
 
-            tex_entry->bind(0);
-            tex_exit->bind(1);
-            tex_volume->bind(2);
+        if(interacting)
+        {
+            /* reduced resolution and coarse steps (post classification, the table is built for the fine step) */
+            glm::uvec2 resolution = glm::max(glm::uvec2(glm::vec2(window.size()) * refinement.interaction_scale), glm::uvec2(1));
+            refinement.frame.framebuffer->bind();
+            {
+                context.clear(opengl::clear_options::color);
+                auto viewport = context.viewport(0, 0, resolution.x, resolution.y);
+                raycast(model, resolution, raycast_settings.step_size * refinement.interaction_step, -1.0f, false);
+                context.viewport(viewport);
+            }
+            refinement.frame.framebuffer->unbind();
 
-            mesh_cube->vao()->draw(opengl::primitives::triangles);
+            refinement.frame.framebuffer->blit_default(0, 0, resolution.x, resolution.y, 0, 0, window.size().x, window.size().y,
+                                                       opengl::blit_mask::color, opengl::blit_filter::linear);
+            return;
+        }
 
-            tex_entry->unbind();
-            tex_exit->unbind();
-            tex_volume->unbind();
+        if(refinement.samples < refinement.max_samples)
+        {
+            /* full resolution sample with a new ray offset (golden ratio sequence) */
+            float jitter = std::fmod(refinement.samples * 0.618034f, 1.0f);
+            refinement.frame.framebuffer->bind();
+            {
+                context.clear(opengl::clear_options::color);
+                raycast(model, window.size(), raycast_settings.step_size, jitter, raycast_settings.preintegrated);
+            }
+            refinement.frame.framebuffer->unbind();
+
+            /* running average with the previous history */
+            int history_prev = refinement.history_idx;
+            refinement.history_idx = (refinement.history_idx + 1) % 2;
+            refinement.history[refinement.history_idx].framebuffer->bind();
+            {
+                context.clear(opengl::clear_options::color);
+
+                shader_accumulate->bind();
+                shader_accumulate->uniform("uColorPrev", 0);
+                shader_accumulate->uniform("uColorCurr", 1);
+                shader_accumulate->uniform("uWeight", 1.0f / (refinement.samples + 1));
+
+                refinement.history[history_prev].color->bind(0);
+                refinement.frame.color->bind(1);
+
+                screen_quad->vao()->draw(opengl::primitives::triangles);
+            }
+            refinement.history[refinement.history_idx].framebuffer->unbind();
+            refinement.samples++;
+        }
+
+        /* converged images are only displayed */
+        refinement.history[refinement.history_idx].framebuffer->blit_default(0, 0, window.size().x, window.size().y, opengl::blit_mask::color);
+    });
+
+    view.on_update([&](auto& window, double dt)
+    {
+        /* a new time step invalidates the accumulated samples */
+        if(series && series->update(dt))
+        {
+            refinement.samples = 0;
         }
     });
 
@@ -172,6 +805,11 @@ int main(int argc, char** argv)
     {
         tex_entry->resize(width, height);
         tex_exit->resize(width, height);
+
+        refinement.frame.color->resize(width, height);
+        refinement.history[0].color->resize(width, height);
+        refinement.history[1].color->resize(width, height);
+        refinement.samples = 0;
     });
 
     view.on_key([](auto& window, auto key, bool pressed)
@@ -209,9 +847,135 @@ int main(int argc, char** argv)
         ImGui::Separator();
 
         ImGui::RadioButton("ISO", &raycast_settings.render_type, 0); ImGui::SameLine();
-        ImGui::RadioButton("MIP", &raycast_settings.render_type, 1);
+        ImGui::RadioButton("MIP", &raycast_settings.render_type, 1); ImGui::SameLine();
+        ImGui::RadioButton("DVR", &raycast_settings.render_type, 2);
 
         ImGui::DragFloat("iso_value", &raycast_settings.iso_value, 0.0001, 0.0, 1.0);
+        ImGui::SameLine();
+        if(ImGui::Button("auto"))
+        {
+            raycast_settings.iso_value = histogram.suggest_iso();
+        }
+
+        ImGui::PlotHistogram("##histogram", histogram_plot.data(), static_cast<int>(histogram_plot.size()), 0, "histogram (log)", 0.0f, FLT_MAX, {0, 64});
+        ImGui::Text("range: [%.3f, %.3f]", histogram.min, histogram.max);
+        /* gradients, brick grid and bc4 copy are computed from the first step only, a series samples every step itself */
+        if(!series)
+        {
+            ImGui::Checkbox("precomputed gradients", &raycast_settings.precomputed_gradients);
+
+            if(ImGui::Checkbox("compressed (BC4)", &raycast_settings.compressed))
+            {
+                make_resident(raycast_settings.compressed);
+            }
+
+            auto resident = resident_bytes();
+            ImGui::Text("resident:  volume %.1f MB, gradients %.1f MB, bc4 %.1f MB", resident[0] / (1024.0 * 1024.0),
+                        resident[1] / (1024.0 * 1024.0), resident[2] / (1024.0 * 1024.0));
+            if(!compressed.data.empty())
+            {
+                ImGui::Text("error:     max %.4f, rmse %.5f (%.1f dB)", compressed.max_error, compressed.rmse, compressed.psnr);
+                ImGui::Text("encode:    %5.2f ms", compressed.encode_ms);
+            }
+        }
+
+        if(raycast_settings.render_type == 2)
+        {
+            ImGui::Separator();
+
+            edit_transfer_function(transfer_function, selected_point);
+            ImGui::Checkbox("pre-integrated", &raycast_settings.preintegrated);
+            ImGui::DragFloat("early termination", &raycast_settings.early_termination, 0.001, 0.5, 1.0);
+            ImGui::Text("table: %zu entries in %5.2f ms", preintegration.rebuilt(), preintegration.update_ms());
+        }
+
+        ImGui::Separator();
+
+        ImGui::Checkbox("progressive", &refinement.enabled);
+        ImGui::DragFloat("interaction scale", &refinement.interaction_scale, 0.01, 0.1, 1.0);
+        ImGui::DragFloat("interaction step", &refinement.interaction_step, 0.01, 1.0, 8.0);
+        ImGui::DragInt("max samples", &refinement.max_samples, 1, 1, 256);
+        ImGui::Text("samples:      %d / %d", refinement.samples, refinement.max_samples);
+
+        ImGui::Separator();
+
+        if(!series)
+        {
+            ImGui::Checkbox("empty space skipping", &raycast_settings.skip_empty);
+
+            /* bricks classified empty for the iso surface */
+            auto empty = std::count_if(bricks.range.begin(), bricks.range.end(), [&](const auto& range)
+            {
+                return range.y / 65535.0f <= raycast_settings.iso_value;
+            });
+            ImGui::Text("empty bricks: %5.1f %%", 100.0f * empty / bricks.range.size());
+        }
+        ImGui::Text("frame time:   %5.2f ms", core::time_cast<core::milli_sec>(view.frameclock().avg()));
+
+        ImGui::Separator();
+
+        if(ImGui::RadioButton("raycast", !surface.enabled))
+        {
+            surface.enabled = false;
+        }
+        ImGui::SameLine();
+        if(ImGui::RadioButton("mesh", surface.enabled))
+        {
+            surface.enabled = true;
+            if(!surface.mesh) { extract_surface(); }
+        }
+        ImGui::SameLine();
+        if(ImGui::Button("extract"))
+        {
+            extract_surface();
+        }
+        if(surface.mesh)
+        {
+            ImGui::Text("mesh:      %zu vertices, %zu triangles (iso %.3f)", surface.vertices, surface.triangles, surface.iso_value);
+            ImGui::Text("extract:   %5.2f ms (merge %5.2f ms)", surface.extract_ms, surface.merge_ms);
+        }
+        ImGui::Text("raycast:   %5.2f ms / frame", surface.frame_ms[0]);
+        ImGui::Text("mesh:      %5.2f ms / frame", surface.frame_ms[1]);
+
+        if(ImGui::Button("screenshot"))
+        {
+            screenshot = true;
+        }
+
+        if(series)
+        {
+            ImGui::Separator();
+
+            bool playing = series->playing(), loop = series->loop();
+            float speed = series->speed();
+            int step = static_cast<int>(series->stats().wanted);
+
+            if(ImGui::Checkbox("play", &playing)) { series->play(playing); }
+            ImGui::SameLine();
+            if(ImGui::Checkbox("loop", &loop)) { series->loop(loop); }
+            if(ImGui::DragFloat("steps / s", &speed, 0.1, 0.0, 120.0)) { series->speed(speed); }
+            if(ImGui::SliderInt("time step", &step, 0, static_cast<int>(series->steps()) - 1)) { series->seek(step); }
+
+            const auto& stats = series->stats();
+            ImGui::Text("shown:     %zu, dropped %zu, stalled %zu frames", stats.shown, stats.dropped, stats.stalled);
+            ImGui::Text("prefetch:  %zu cached, %.1f MB/s", stats.cached, stats.read_mb_s);
+            ImGui::Text("upload:    %5.2f ms", stats.upload_ms);
+        }
+
+        if(brick_cache)
+        {
+            ImGui::Separator();
+
+            ImGui::Checkbox("bricked (paged)", &raycast_settings.bricked);
+            ImGui::DragFloat("pixel_error", &raycast_settings.pixel_error, 0.01, 0.1, 16.0);
+            ImGui::DragInt("upload_budget", &raycast_settings.upload_budget, 1, 1, 512);
+
+            const auto& stats = brick_cache->stats();
+            ImGui::Text("resident:  %zu / %zu slots (%.1f MB)", stats.resident, stats.slots, stats.atlas_bytes / (1024.0 * 1024.0));
+            ImGui::Text("requested: %zu (pending %zu)", stats.requested, stats.pending);
+            ImGui::Text("uploaded:  %zu, evicted %zu", stats.uploaded, stats.evicted);
+            ImGui::Text("update:    %5.2f ms", stats.update_ms);
+        }
 
         ImGui::Dummy({0.0, 16.0});
 
@@ -246,6 +1010,40 @@ int main(int argc, char** argv)
         }
 
         ImGui::End();
+
+        /************** slices **************/
+        /* reconstructed from the single volume only, a series would not follow playback */
+        if(series) { return; }
+
+        ImGui::SetNextWindowPos({window.size().x - 16.0f, 16}, 0, {1.0f, 0.0f});
+        ImGui::Begin("##Slices", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoTitleBar);
+        {
+            ImGui::TextColored({1.0, 1.0, 0, 1.0}, "Slices: ");
+            ImGui::Checkbox("show slices", &mpr.enabled);
+            if(mpr.enabled)
+            {
+                ImGui::SliderFloat("axial", &mpr.position.z, 0.0f, 1.0f);
+                ImGui::SliderFloat("coronal", &mpr.position.y, 0.0f, 1.0f);
+                ImGui::SliderFloat("sagittal", &mpr.position.x, 0.0f, 1.0f);
+                ImGui::SliderFloat2("oblique angles", &mpr.oblique_angles[0], -glm::pi<float>(), glm::pi<float>());
+                ImGui::SliderFloat("oblique offset", &mpr.oblique_offset, -0.87f, 0.87f);
+                ImGui::SliderFloat("level", &mpr.window.level, 0.0f, 1.0f);
+                ImGui::SliderFloat("width", &mpr.window.width, 0.001f, 1.0f);
+
+                update_slices();
+
+                const char* names[] = {"axial", "coronal", "sagittal", "oblique"};
+                for(int i = 0; i < 4; i++)
+                {
+                    ImGui::BeginGroup();
+                    ImGui::Text("%-9s %5.2f ms", names[i], mpr.slices[i].update_ms());
+                    ImGui::Image(mpr.slices[i].texture().get(), {192, 192});
+                    ImGui::EndGroup();
+                    if(i % 2 == 0) { ImGui::SameLine(); }
+                }
+            }
+        }
+        ImGui::End();
     });
 
     /* start main loop */
@@ -0,0 +1,200 @@
+#include <cstdlib>
+
+#include <viewer/core/log.h>
+#include <viewer/asset/cpu_raycaster.h>
+#include <viewer/asset/image.h>
+#include <viewer/asset/volume.h>
+#include <viewer/utility/camera.h>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+/* headless cpu rendering of a volume with the defaults of the volume_raycasting app (camera, model rotation, light);
+   optionally compares the result with a screenshot of the gpu raycaster taken with the same parameters */
+struct options
+{
+    std::filesystem::path volume;
+    glm::uvec3 size{0, 0, 0};
+
+    glm::uvec2 resolution{1280, 720};
+    glm::vec3 camera{-2.0f, 0.0f, 0.0f};
+    int repeat = 1;
+
+    std::filesystem::path output = "volume_reference.png";
+    std::filesystem::path compare;
+    int tolerance = 8;
+    float max_mismatch = 1.0f;
+
+    asset::cpu_raycaster::settings settings;
+};
+
+void usage()
+{
+    std::cout << "usage: volume_reference <volume.dat | volume.raw x y z> [options]\n"
+                 "  --mode iso|mip         render type (mip)\n"
+                 "  --iso <value>          iso value (0.15)\n"
+                 "  --step <size>          step size in texture space (0.005)\n"
+                 "  --max-steps <n>        maximum steps per ray (1024)\n"
+                 "  --gamma <value>        gamma of the maximum intensity projection (1.5)\n"
+                 "  --light <x> <y> <z>    light direction\n"
+                 "  --no-skip              disable empty space skipping\n"
+                 "  --size <w> <h>         image size (1280 720)\n"
+                 "  --camera <x> <y> <z>   camera position looking at the origin (-2 0 0)\n"
+                 "  --repeat <n>           render n times and report the best rate (1)\n"
+                 "  --out <image>          output image (volume_reference.png)\n"
+                 "  --compare <image>      gpu screenshot to compare with\n"
+                 "  --tolerance <n>        per channel difference counted as mismatch (8)\n"
+                 "  --max-mismatch <pct>   mismatching pixels tolerated before failing (1.0)\n";
+}
+
+bool parse(int argc, char** argv, options& opt)
+{
+    if(argc < 2) { return false; }
+
+    int i = 1;
+    opt.volume = argv[i++];
+    if(opt.volume.extension() != ".dat")
+    {
+        if(argc < 5) { return false; }
+        opt.size = {std::atoi(argv[2]), std::atoi(argv[3]), std::atoi(argv[4])};
+        i = 5;
+    }
+
+    auto has = [&](int count) { return i + count < argc; };
+    for(; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        if(!std::strcmp(arg, "--mode") && has(1))
+        {
+            opt.settings.render_type = !std::strcmp(argv[++i], "iso") ? asset::cpu_raycaster::mode::isosurface : asset::cpu_raycaster::mode::mip;
+        }
+        else if(!std::strcmp(arg, "--iso") && has(1))        { opt.settings.iso_value = std::stof(argv[++i]); }
+        else if(!std::strcmp(arg, "--step") && has(1))       { opt.settings.step_size = std::stof(argv[++i]); }
+        else if(!std::strcmp(arg, "--max-steps") && has(1))  { opt.settings.max_steps = std::atoi(argv[++i]); }
+        else if(!std::strcmp(arg, "--gamma") && has(1))      { opt.settings.gamma = std::stof(argv[++i]); }
+        else if(!std::strcmp(arg, "--no-skip"))              { opt.settings.skip_empty = false; }
+        else if(!std::strcmp(arg, "--repeat") && has(1))     { opt.repeat = std::max(std::atoi(argv[++i]), 1); }
+        else if(!std::strcmp(arg, "--out") && has(1))        { opt.output = argv[++i]; }
+        else if(!std::strcmp(arg, "--compare") && has(1))    { opt.compare = argv[++i]; }
+        else if(!std::strcmp(arg, "--tolerance") && has(1))  { opt.tolerance = std::atoi(argv[++i]); }
+        else if(!std::strcmp(arg, "--max-mismatch") && has(1)) { opt.max_mismatch = std::stof(argv[++i]); }
+        else if(!std::strcmp(arg, "--size") && has(2))
+        {
+            opt.resolution = {std::max(std::atoi(argv[i + 1]), 1), std::max(std::atoi(argv[i + 2]), 1)};
+            i += 2;
+        }
+        else if(!std::strcmp(arg, "--camera") && has(3))
+        {
+            opt.camera = {std::stof(argv[i + 1]), std::stof(argv[i + 2]), std::stof(argv[i + 3])};
+            i += 3;
+        }
+        else if(!std::strcmp(arg, "--light") && has(3))
+        {
+            opt.settings.light_direction = glm::normalize(glm::vec3(std::stof(argv[i + 1]), std::stof(argv[i + 2]), std::stof(argv[i + 3])));
+            i += 3;
+        }
+        else
+        {
+            std::cerr << "unknown or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if constexpr (core::g_logging)
+    {
+        auto& log = core::log::instance();
+        log.add_sink(core::log::level::info, [](const auto& msg){ std::cout << msg.text << std::endl; });
+        log.add_sink(core::log::level::warning, [](const auto& msg){ std::cout << msg.text << std::endl; });
+        log.add_sink(core::log::level::error, [](const auto& msg){ std::cerr << msg.text << std::endl; });
+    }
+
+    options opt;
+    if(!parse(argc, argv, opt))
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    auto volume = opt.volume.extension() == ".dat" ? asset::volume_loader::map_dat(opt.volume)
+                                                   : asset::volume_loader::map_raw(opt.volume, opt.size);
+    if(!volume)
+    {
+        return EXIT_FAILURE;
+    }
+
+    asset::cpu_raycaster raycaster(*volume);
+
+    /* same camera and model transformation as the volume_raycasting app */
+    util::camera camera(static_cast<float>(opt.resolution.x), static_cast<float>(opt.resolution.y), 0.25f * glm::pi<float>(), 0.1f, 10.0f);
+    camera.position(opt.camera);
+    camera.look_at({0.0f, 0.0f, 0.0f});
+    auto model = glm::rotate(glm::mat4(1.0), -glm::half_pi<float>(), glm::vec3{1.0, 0.0, 0.0});
+
+    std::shared_ptr<asset::image> result;
+    asset::cpu_raycaster::statistics best;
+    for(int i = 0; i < opt.repeat; i++)
+    {
+        result = raycaster.render(model, camera.view(), camera.projection(), opt.resolution, opt.settings);
+        if(i == 0 || raycaster.stats().render_ms < best.render_ms) { best = raycaster.stats(); }
+    }
+
+    std::printf("rendered %ux%u (%s) in %.1f ms: %zu rays, %zu samples, %.2f Mrays/s, %.1f Msamples/s\n",
+                opt.resolution.x, opt.resolution.y, opt.settings.render_type == asset::cpu_raycaster::mode::mip ? "mip" : "iso",
+                best.render_ms, best.rays, best.samples, best.rays_per_second * 1e-6, best.samples / (best.render_ms * 1e-3) * 1e-6);
+
+    if(!asset::image_loader::save(*result, opt.output))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if(opt.compare.empty())
+    {
+        return EXIT_SUCCESS;
+    }
+
+    /* pixel wise comparison with the gpu image (texture filtering and interpolation precision differ slightly) */
+    auto reference = asset::image_loader::load(opt.compare);
+    if(reference->size() != result->size())
+    {
+        std::cerr << "image size mismatch: " << opt.compare.string() << " is " << reference->size().x << "x" << reference->size().y << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::size_t mismatches = 0;
+    int max_difference = 0;
+    double sum = 0.0;
+    for(std::size_t i = 0; i < result->pixels().size(); i++)
+    {
+        const auto& a = result->pixels()[i];
+        const auto& b = reference->pixels()[i];
+
+        int difference = 0;
+        for(int c = 0; c < 3; c++)
+        {
+            difference = std::max(difference, std::abs(static_cast<int>(a[c]) - static_cast<int>(b[c])));
+        }
+
+        max_difference = std::max(max_difference, difference);
+        sum += difference;
+        mismatches += difference > opt.tolerance;
+    }
+
+    const double pixels = static_cast<double>(result->pixels().size());
+    const double mismatch = 100.0 * mismatches / pixels;
+    std::printf("compared with %s: max difference %d, mean %.3f, %zu pixels (%.3f %%) above %d\n",
+                opt.compare.string().c_str(), max_difference, sum / pixels, mismatches, mismatch, opt.tolerance);
+
+    return mismatch <= opt.max_mismatch ? EXIT_SUCCESS : EXIT_FAILURE;
+}
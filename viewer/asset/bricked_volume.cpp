@@ -0,0 +1,645 @@
+#include "bricked_volume.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/mapped_file.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+#include "viewer/opengl/context.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace asset
+{
+
+namespace detail
+{
+
+constexpr char brick_magic[4] = {'B', 'V', 'O', 'L'};
+constexpr std::uint32_t brick_version = 2;
+constexpr std::size_t brick_header_size = 32;
+constexpr std::size_t brick_payload_alignment = 4096;
+
+inline std::size_t payload_offset(std::size_t num_bricks)
+{
+    std::size_t end = brick_header_size + num_bricks * sizeof(glm::u16vec2);
+    return (end + brick_payload_alignment - 1) / brick_payload_alignment * brick_payload_alignment;
+}
+
+/* 2x2x2 box filter, odd sizes repeat the border voxel */
+inline std::unique_ptr<volume> downsample(const volume& src)
+{
+    const auto& size = src.size();
+    glm::uvec3 half = glm::max((size + 1u) / 2u, glm::uvec3(1));
+    auto dst = std::make_unique<volume>(half, src.type());
+    std::uint8_t* out = dst->data();
+
+    core::parallel_for(0, half.z, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t z = begin; z < end; z++)
+        {
+            unsigned int z0 = std::min<unsigned int>(2 * z, size.z - 1), z1 = std::min<unsigned int>(2 * z + 1, size.z - 1);
+            for(unsigned int y = 0; y < half.y; y++)
+            {
+                unsigned int y0 = std::min(2 * y, size.y - 1), y1 = std::min(2 * y + 1, size.y - 1);
+                for(unsigned int x = 0; x < half.x; x++)
+                {
+                    unsigned int x0 = std::min(2 * x, size.x - 1), x1 = std::min(2 * x + 1, size.x - 1);
+                    unsigned int sum = src.raw(x0, y0, z0) + src.raw(x1, y0, z0) + src.raw(x0, y1, z0) + src.raw(x1, y1, z0)
+                                     + src.raw(x0, y0, z1) + src.raw(x1, y0, z1) + src.raw(x0, y1, z1) + src.raw(x1, y1, z1);
+
+                    std::size_t index = (z * half.y + y) * half.x + x;
+                    if(src.type() == voxel_type::uint8)
+                    {
+                        out[index] = static_cast<std::uint8_t>((sum + 4) / 8);
+                    }
+                    else
+                    {
+                        auto value = static_cast<std::uint16_t>((sum + 4) / 8);
+                        std::memcpy(out + 2 * index, &value, sizeof(value));
+                    }
+                }
+            }
+        }
+    });
+
+    return dst;
+}
+
+/* copies one brick including its apron (border voxels are clamped) and returns its normalized min / max */
+inline glm::u16vec2 extract_brick(const volume& src, const glm::uvec3& origin, unsigned int brick_size, std::uint8_t* dst)
+{
+    const auto& size = src.size();
+    const std::size_t vb = src.voxel_bytes();
+    const int padded = static_cast<int>(brick_size + 2 * brick_pyramid::apron);
+    const std::size_t row_bytes = size.x * vb;
+
+    const int x_first = static_cast<int>(origin.x) - static_cast<int>(brick_pyramid::apron);
+    const int x_begin = std::max(x_first, 0);
+    const int x_end = std::min(x_first + padded, static_cast<int>(size.x));
+
+    for(int pz = 0; pz < padded; pz++)
+    {
+        int z = std::clamp(static_cast<int>(origin.z) + pz - static_cast<int>(brick_pyramid::apron), 0, static_cast<int>(size.z) - 1);
+        for(int py = 0; py < padded; py++)
+        {
+            int y = std::clamp(static_cast<int>(origin.y) + py - static_cast<int>(brick_pyramid::apron), 0, static_cast<int>(size.y) - 1);
+
+            const std::uint8_t* row = src.slice(z) + y * row_bytes;
+            std::uint8_t* out = dst + (static_cast<std::size_t>(pz) * padded + py) * padded * vb;
+
+            /* inner segment is contiguous, the remainder repeats the first / last voxel of the row */
+            int px = 0;
+            for(; px < x_begin - x_first; px++) { std::memcpy(out + px * vb, row + x_begin * vb, vb); }
+            if(x_end > x_begin)
+            {
+                std::memcpy(out + px * vb, row + x_begin * vb, (x_end - x_begin) * vb);
+                px += x_end - x_begin;
+            }
+            for(; px < padded; px++) { std::memcpy(out + px * vb, row + (size.x - 1) * vb, vb); }
+        }
+    }
+
+    const std::size_t count = static_cast<std::size_t>(padded) * padded * padded;
+    if(src.type() == voxel_type::uint8)
+    {
+        auto [lo, hi] = std::minmax_element(dst, dst + count);
+        return {*lo * 257u, *hi * 257u};
+    }
+
+    auto* voxels = reinterpret_cast<const std::uint16_t*>(dst);
+    auto [lo, hi] = std::minmax_element(voxels, voxels + count);
+    return {*lo, *hi};
+}
+
+}
+
+
+/*========================== brick_pyramid ==========================*/
+brick_pyramid::brick_pyramid(const std::shared_ptr<core::mapped_file>& file, const glm::uvec3& size, voxel_type type, unsigned int brick_size)
+    : m_file(file), m_size(size), m_type(type), m_brick_size(brick_size), m_levels(layout(size, brick_size))
+{
+    m_ranges = m_file->data() + detail::brick_header_size;
+    m_payload = m_file->data() + detail::payload_offset(num_bricks());
+}
+
+const glm::uvec3& brick_pyramid::size() const
+{
+    return m_size;
+}
+
+voxel_type brick_pyramid::type() const
+{
+    return m_type;
+}
+
+unsigned int brick_pyramid::brick_size() const
+{
+    return m_brick_size;
+}
+
+unsigned int brick_pyramid::padded_size() const
+{
+    return m_brick_size + 2 * apron;
+}
+
+std::size_t brick_pyramid::brick_bytes() const
+{
+    std::size_t padded = padded_size();
+    return padded * padded * padded * (m_type == voxel_type::uint8 ? 1 : 2);
+}
+
+const std::vector<brick_pyramid::level>& brick_pyramid::levels() const
+{
+    return m_levels;
+}
+
+std::size_t brick_pyramid::num_bricks() const
+{
+    const auto& last = m_levels.back();
+    return last.first + static_cast<std::size_t>(last.bricks.x) * last.bricks.y * last.bricks.z;
+}
+
+std::size_t brick_pyramid::brick_index(unsigned int level, const glm::uvec3& brick) const
+{
+    const auto& l = m_levels[level];
+    return l.first + (static_cast<std::size_t>(brick.z) * l.bricks.y + brick.y) * l.bricks.x + brick.x;
+}
+
+glm::u16vec2 brick_pyramid::range(std::size_t index) const
+{
+    glm::u16vec2 value;
+    std::memcpy(&value, m_ranges + index * sizeof(glm::u16vec2), sizeof(value));
+    return value;
+}
+
+const std::uint8_t* brick_pyramid::brick(std::size_t index) const
+{
+    return m_payload + index * brick_bytes();
+}
+
+std::vector<brick_pyramid::level> brick_pyramid::layout(const glm::uvec3& size, unsigned int brick_size)
+{
+    std::vector<level> levels;
+
+    glm::uvec3 level_size = size;
+    std::size_t first = 0;
+    while(true)
+    {
+        glm::uvec3 bricks = (level_size + brick_size - 1u) / brick_size;
+        levels.push_back({level_size, bricks, first});
+        first += static_cast<std::size_t>(bricks.x) * bricks.y * bricks.z;
+
+        if(bricks == glm::uvec3(1) || levels.size() >= 16) { break; }
+        level_size = glm::max((level_size + 1u) / 2u, glm::uvec3(1));
+    }
+
+    return levels;
+}
+
+
+/*========================== brick_pyramid_loader ==========================*/
+bool brick_pyramid_loader::cook(const volume& vol, const std::filesystem::path& path, unsigned int brick_size)
+{
+    auto start = core::clock::now();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+        platform_log(core::log::level::error, "[asset::brick_pyramid] Couldn't create file {0}", path.string());
+        return false;
+    }
+
+    auto levels = brick_pyramid::layout(vol.size(), brick_size);
+    const auto& last = levels.back();
+    const std::size_t num_bricks = last.first + static_cast<std::size_t>(last.bricks.x) * last.bricks.y * last.bricks.z;
+
+    const std::size_t padded = brick_size + 2 * brick_pyramid::apron;
+    const std::size_t brick_bytes = padded * padded * padded * vol.voxel_bytes();
+
+    /*----------------- header (ranges are written once all bricks are known) --------------------*/
+    std::uint32_t header[7] =
+        {
+            detail::brick_version,
+            vol.size().x, vol.size().y, vol.size().z,
+            vol.type() == voxel_type::uint8 ? 0u : 1u,
+            brick_size,
+            static_cast<std::uint32_t>(levels.size())
+        };
+    file.write(detail::brick_magic, sizeof(detail::brick_magic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<glm::u16vec2> ranges(num_bricks);
+    std::vector<char> padding(detail::payload_offset(num_bricks) - detail::brick_header_size, 0);
+    file.write(padding.data(), padding.size());
+
+    /*----------------- bricks, one layer of bricks at a time --------------------*/
+    std::unique_ptr<volume> downsampled;
+    const volume* source = &vol;
+    std::vector<std::uint8_t> layer;
+
+    for(std::size_t l = 0; l < levels.size(); l++)
+    {
+        if(l > 0)
+        {
+            downsampled = detail::downsample(*source);
+            source = downsampled.get();
+        }
+
+        const auto& level = levels[l];
+        const std::size_t layer_bricks = static_cast<std::size_t>(level.bricks.x) * level.bricks.y;
+        layer.resize(layer_bricks * brick_bytes);
+
+        for(unsigned int bz = 0; bz < level.bricks.z; bz++)
+        {
+            core::parallel_for(0, layer_bricks, 1, [&](std::size_t begin, std::size_t end)
+            {
+                for(std::size_t b = begin; b < end; b++)
+                {
+                    glm::uvec3 brick = {b % level.bricks.x, b / level.bricks.x, bz};
+                    auto range = detail::extract_brick(*source, brick * brick_size, brick_size, layer.data() + b * brick_bytes);
+
+                    /* box filtered voxels average thin features away, culling relies on the ranges of the finer
+                       bricks covered by this one */
+                    if(l > 0)
+                    {
+                        const auto& finer = levels[l - 1];
+                        const glm::uvec3 first = brick * 2u;
+                        const glm::uvec3 last = glm::min(first + 1u, finer.bricks - 1u);
+                        for(unsigned int z = first.z; z <= last.z; z++)
+                        {
+                            for(unsigned int y = first.y; y <= last.y; y++)
+                            {
+                                for(unsigned int x = first.x; x <= last.x; x++)
+                                {
+                                    const auto& child = ranges[finer.first + (static_cast<std::size_t>(z) * finer.bricks.y + y) * finer.bricks.x + x];
+                                    range = {std::min(range.x, child.x), std::max(range.y, child.y)};
+                                }
+                            }
+                        }
+                    }
+
+                    ranges[level.first + bz * layer_bricks + b] = range;
+                }
+            });
+
+            file.write(reinterpret_cast<const char*>(layer.data()), layer.size());
+        }
+    }
+
+    file.seekp(detail::brick_header_size);
+    file.write(reinterpret_cast<const char*>(ranges.data()), ranges.size() * sizeof(glm::u16vec2));
+
+    if(!file)
+    {
+        platform_log(core::log::level::error, "[asset::brick_pyramid] Failed writing {0}", path.string());
+        return false;
+    }
+
+    auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    platform_log(core::log::level::info, "[asset::brick_pyramid] cooked {} levels, {} bricks ({:.1f} MB) in {:.1f} ms ( {} )",
+                 levels.size(), num_bricks, num_bricks * brick_bytes / (1024.0 * 1024.0), elapsed, path.string());
+
+    return true;
+}
+
+brick_pyramid_loader::result_type brick_pyramid_loader::load(const std::filesystem::path& path)
+{
+    if (!std::filesystem::is_regular_file(path))
+    {
+        platform_log(core::log::level::error, "[asset::brick_pyramid] path does is not a file {0} ", path.string());
+        return nullptr;
+    }
+
+    auto file = std::make_shared<core::mapped_file>(path);
+    if(!file->is_open())
+    {
+        return nullptr;
+    }
+
+    std::uint32_t header[7];
+    if(file->size() < detail::brick_header_size || std::memcmp(file->data(), detail::brick_magic, sizeof(detail::brick_magic)) != 0)
+    {
+        platform_log(core::log::level::error, "[asset::brick_pyramid] Not a brick pyramid {0}", path.string());
+        return nullptr;
+    }
+    std::memcpy(header, file->data() + sizeof(detail::brick_magic), sizeof(header));
+
+    if(header[0] != detail::brick_version || header[4] > 1 || header[5] == 0)
+    {
+        platform_log(core::log::level::error, "[asset::brick_pyramid] Unsupported version or format {0}", path.string());
+        return nullptr;
+    }
+
+    glm::uvec3 size = {header[1], header[2], header[3]};
+    auto pyramid = std::make_shared<brick_pyramid>(file, size, header[4] == 0 ? voxel_type::uint8 : voxel_type::uint16, header[5]);
+
+    if(pyramid->levels().size() != header[6] ||
+       file->size() < detail::payload_offset(pyramid->num_bricks()) + pyramid->num_bricks() * pyramid->brick_bytes())
+    {
+        platform_log(core::log::level::error, "[asset::brick_pyramid] Truncated or inconsistent file {0}", path.string());
+        return nullptr;
+    }
+
+    return pyramid;
+}
+
+
+/*========================== brick_cache ==========================*/
+brick_cache::brick_cache(opengl::context& context, const std::shared_ptr<brick_pyramid>& pyramid, std::size_t budget_bytes)
+    : m_context(context), m_pyramid(pyramid)
+{
+    const unsigned int padded = m_pyramid->padded_size();
+
+    /* cube-ish atlas of slots, limited by the maximum 3D texture size */
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_size);
+    const unsigned int max_slots = std::max(1u, static_cast<unsigned int>(max_size) / padded);
+
+    std::size_t count = std::max<std::size_t>(1, budget_bytes / m_pyramid->brick_bytes());
+    unsigned int n = std::clamp(static_cast<unsigned int>(std::cbrt(static_cast<double>(count))), 1u, max_slots);
+    m_slots = {n, n, std::clamp(static_cast<unsigned int>(count / (n * n)), 1u, max_slots)};
+    m_slot_info.resize(static_cast<std::size_t>(m_slots.x) * m_slots.y * m_slots.z);
+
+    bool is_8bit = m_pyramid->type() == voxel_type::uint8;
+    m_atlas = context.make_texture_3D(is_8bit ? opengl::texture_internal_type::r8 : opengl::texture_internal_type::r16,
+                                      opengl::texture_format::red,
+                                      is_8bit ? opengl::texture_type::unsigned_byte_ : opengl::texture_type::unsigned_short_,
+                                      m_slots.x * padded, m_slots.y * padded, m_slots.z * padded);
+    m_atlas->smooth(true);
+    m_atlas->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+    m_atlas->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+    m_atlas->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::edge);
+
+    const auto& finest = m_pyramid->levels().front().bricks;
+    m_table.resize(static_cast<std::size_t>(finest.x) * finest.y * finest.z);
+    m_page_table = context.make_texture_3D(opengl::texture_internal_type::rgba8u, opengl::texture_format::rgba_int, opengl::texture_type::unsigned_byte_,
+                                           finest.x, finest.y, finest.z);
+    m_page_table->smooth(false);
+    m_page_table->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+    m_page_table->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+    m_page_table->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::edge);
+
+    m_stats.slots = m_slot_info.size();
+    m_stats.atlas_bytes = m_slot_info.size() * m_pyramid->brick_bytes();
+
+    /* coarsest level stays resident as fallback */
+    const auto& top = m_pyramid->levels().back();
+    for(std::size_t i = 0; i < static_cast<std::size_t>(top.bricks.x) * top.bricks.y * top.bricks.z; i++)
+    {
+        if(!upload(top.first + i, true)) { break; }
+    }
+    rebuild_page_table();
+
+    platform_log(core::log::level::info, "[asset::brick_cache] atlas {}x{}x{} slots ({:.1f} MB), page table {}x{}x{}",
+                 m_slots.x, m_slots.y, m_slots.z, m_stats.atlas_bytes / (1024.0 * 1024.0), finest.x, finest.y, finest.z);
+}
+
+void brick_cache::empty_threshold(float value)
+{
+    if(value != m_empty_threshold)
+    {
+        m_empty_threshold = value;
+        rebuild_page_table();
+    }
+}
+
+void brick_cache::update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, float viewport_height,
+                         float pixel_error, unsigned int upload_budget)
+{
+    auto start = core::clock::now();
+
+    m_frame++;
+    m_stats.uploaded = 0;
+    m_stats.evicted = 0;
+
+    const auto& levels = m_pyramid->levels();
+    const glm::vec3 size = glm::vec3(m_pyramid->size());
+    const float brick_size = static_cast<float>(m_pyramid->brick_size());
+
+    const glm::mat4 mvp = proj * view * model;
+    const glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    const float voxel_world = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))))
+                              / glm::min(size.x, glm::min(size.y, size.z));
+    const float pixel_scale = proj[1][1] * 0.5f * viewport_height;
+
+    /*----------------- traverse from the coarsest level, refine while the projected voxel is too large --------------------*/
+    struct node { unsigned int level; glm::uvec3 brick; };
+    std::vector<node> stack;
+    std::vector<std::pair<std::size_t, unsigned int>> wanted;
+
+    const auto& top = levels.back();
+    for(unsigned int z = 0; z < top.bricks.z; z++)
+        for(unsigned int y = 0; y < top.bricks.y; y++)
+            for(unsigned int x = 0; x < top.bricks.x; x++)
+                stack.push_back({static_cast<unsigned int>(levels.size() - 1), {x, y, z}});
+
+    while(!stack.empty())
+    {
+        node n = stack.back();
+        stack.pop_back();
+
+        std::size_t index = m_pyramid->brick_index(n.level, n.brick);
+        if(m_pyramid->range(index).y / 65535.0f <= m_empty_threshold) { continue; }
+
+        /* brick bounds in normalized volume coordinates */
+        float scale = brick_size * static_cast<float>(1u << n.level);
+        glm::vec3 lo = glm::vec3(n.brick) * scale / size;
+        glm::vec3 hi = glm::min((glm::vec3(n.brick) + 1.0f) * scale / size, glm::vec3(1.0f));
+
+        glm::ivec3 outside_lo(0), outside_hi(0);
+        glm::vec3 world_lo(std::numeric_limits<float>::max()), world_hi(-std::numeric_limits<float>::max());
+        for(unsigned int c = 0; c < 8; c++)
+        {
+            glm::vec3 corner = {c & 1 ? hi.x : lo.x, c & 2 ? hi.y : lo.y, c & 4 ? hi.z : lo.z};
+            glm::vec4 clip = mvp * glm::vec4(corner - 0.5f, 1.0f);
+            for(int a = 0; a < 3; a++)
+            {
+                outside_lo[a] += clip[a] < -clip.w;
+                outside_hi[a] += clip[a] > clip.w;
+            }
+
+            glm::vec3 world = glm::vec3(model * glm::vec4(corner - 0.5f, 1.0f));
+            world_lo = glm::min(world_lo, world);
+            world_hi = glm::max(world_hi, world);
+        }
+
+        /* all corners outside of one frustum plane */
+        if(glm::any(glm::equal(outside_lo, glm::ivec3(8))) || glm::any(glm::equal(outside_hi, glm::ivec3(8)))) { continue; }
+
+        float distance = glm::length(glm::max(glm::vec3(0.0f), glm::max(world_lo - eye, eye - world_hi)));
+        float projected = voxel_world * static_cast<float>(1u << n.level) * pixel_scale / glm::max(distance, 1e-3f);
+
+        if(n.level > 0 && projected > pixel_error)
+        {
+            /* keep the coarser brick around while its children stream in */
+            if(auto it = m_resident.find(index); it != m_resident.end())
+            {
+                m_slot_info[it->second].last_used = m_frame;
+            }
+
+            const auto& children = levels[n.level - 1].bricks;
+            for(unsigned int c = 0; c < 8; c++)
+            {
+                glm::uvec3 child = n.brick * 2u + glm::uvec3(c & 1, (c >> 1) & 1, (c >> 2) & 1);
+                if(glm::all(glm::lessThan(child, children)))
+                {
+                    stack.push_back({n.level - 1, child});
+                }
+            }
+            continue;
+        }
+
+        wanted.emplace_back(index, n.level);
+    }
+
+    /*----------------- touch resident bricks, upload missing ones (coarse first) --------------------*/
+    std::vector<std::pair<std::size_t, unsigned int>> pending;
+    for(const auto& [index, level] : wanted)
+    {
+        if(auto it = m_resident.find(index); it != m_resident.end())
+        {
+            m_slot_info[it->second].last_used = m_frame;
+        }
+        else
+        {
+            pending.emplace_back(index, level);
+        }
+    }
+
+    std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    for(std::size_t i = 0; i < pending.size() && m_stats.uploaded < upload_budget; i++)
+    {
+        if(!upload(pending[i].first, false)) { break; }
+    }
+
+    if(m_stats.uploaded > 0)
+    {
+        rebuild_page_table();
+    }
+
+    m_stats.requested = wanted.size();
+    m_stats.pending = pending.size() - m_stats.uploaded;
+    m_stats.resident = m_resident.size();
+    m_stats.update_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+}
+
+const opengl::handle<opengl::texture_3D>& brick_cache::atlas() const
+{
+    return m_atlas;
+}
+
+const opengl::handle<opengl::texture_3D>& brick_cache::page_table() const
+{
+    return m_page_table;
+}
+
+const std::shared_ptr<brick_pyramid>& brick_cache::pyramid() const
+{
+    return m_pyramid;
+}
+
+const brick_cache::statistics& brick_cache::stats() const
+{
+    return m_stats;
+}
+
+bool brick_cache::upload(std::size_t brick, bool pinned)
+{
+    /* free slot first, otherwise the least recently used one that was not requested this frame */
+    unsigned int target = std::numeric_limits<unsigned int>::max();
+    std::uint64_t oldest = m_frame;
+    for(unsigned int i = 0; i < m_slot_info.size(); i++)
+    {
+        const auto& s = m_slot_info[i];
+        if(s.brick == std::numeric_limits<std::size_t>::max())
+        {
+            target = i;
+            break;
+        }
+
+        if(!s.pinned && s.last_used < oldest)
+        {
+            oldest = s.last_used;
+            target = i;
+        }
+    }
+
+    if(target == std::numeric_limits<unsigned int>::max())
+    {
+        return false;
+    }
+
+    auto& s = m_slot_info[target];
+    if(s.brick != std::numeric_limits<std::size_t>::max())
+    {
+        m_resident.erase(s.brick);
+        m_stats.evicted++;
+    }
+
+    const unsigned int padded = m_pyramid->padded_size();
+    glm::uvec3 origin = glm::uvec3(target % m_slots.x, (target / m_slots.x) % m_slots.y, target / (m_slots.x * m_slots.y)) * padded;
+
+    auto alignment = m_context.unpack_alignment(1);
+    m_atlas->sub_data(m_pyramid->brick(brick), origin.x, origin.y, origin.z, padded, padded, padded);
+    m_context.unpack_alignment(alignment);
+
+    s.brick = brick;
+    s.last_used = m_frame;
+    s.pinned = pinned;
+    m_resident[brick] = target;
+    m_stats.uploaded++;
+
+    return true;
+}
+
+void brick_cache::rebuild_page_table()
+{
+    const auto& levels = m_pyramid->levels();
+    const glm::uvec3 finest = levels.front().bricks;
+
+    std::fill(m_table.begin(), m_table.end(), glm::u8vec4(0, 0, 0, missing_entry));
+
+    /* coarse to fine, finer resident (or empty) bricks overwrite the region of their ancestors */
+    for(int l = static_cast<int>(levels.size()) - 1; l >= 0; l--)
+    {
+        const auto& level = levels[l];
+        const unsigned int scale = 1u << l;
+
+        for(unsigned int bz = 0; bz < level.bricks.z; bz++)
+        for(unsigned int by = 0; by < level.bricks.y; by++)
+        for(unsigned int bx = 0; bx < level.bricks.x; bx++)
+        {
+            std::size_t index = m_pyramid->brick_index(l, {bx, by, bz});
+
+            glm::u8vec4 entry;
+            if(m_pyramid->range(index).y / 65535.0f <= m_empty_threshold)
+            {
+                entry = {0, 0, 0, empty_entry};
+            }
+            else if(auto it = m_resident.find(index); it != m_resident.end())
+            {
+                unsigned int slot = it->second;
+                entry = {slot % m_slots.x, (slot / m_slots.x) % m_slots.y, slot / (m_slots.x * m_slots.y), l};
+            }
+            else
+            {
+                continue;
+            }
+
+            glm::uvec3 lo = glm::uvec3(bx, by, bz) * scale;
+            glm::uvec3 hi = glm::min(lo + scale, finest);
+            for(unsigned int z = lo.z; z < hi.z; z++)
+                for(unsigned int y = lo.y; y < hi.y; y++)
+                    std::fill_n(m_table.begin() + (static_cast<std::size_t>(z) * finest.y + y) * finest.x + lo.x, hi.x - lo.x, entry);
+        }
+    }
+
+    m_page_table->sub_data(reinterpret_cast<const unsigned char*>(m_table.data()), 0, 0, 0, finest.x, finest.y, finest.z);
+}
+
+}
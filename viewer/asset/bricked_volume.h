@@ -0,0 +1,148 @@
+#pragma once
+
+#include "viewer/asset/volume.h"
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace opengl { class context; }
+namespace core { class mapped_file; }
+
+
+namespace asset
+{
+
+/*========================== brick_pyramid ==========================*/
+/* offline cooked multi resolution volume: level l is downsampled by 2^l, every level is split into bricks of
+   brick_size^3 voxels which are stored with a one voxel apron (copied from the neighbours) so that bricks can
+   be filtered independently; the file is memory mapped and bricks are read on demand
+
+   file layout: header (32 bytes), per brick min / max (u16 x 2), brick payload (starts 4096 byte aligned) */
+class brick_pyramid
+{
+public:
+    static constexpr unsigned int apron = 1;
+
+    struct level
+    {
+        glm::uvec3 size;
+        glm::uvec3 bricks;
+        std::size_t first;
+    };
+
+private:
+    std::shared_ptr<core::mapped_file> m_file;
+
+    glm::uvec3 m_size{0, 0, 0};
+    voxel_type m_type{voxel_type::uint8};
+    unsigned int m_brick_size{32};
+    std::vector<level> m_levels;
+
+    const std::uint8_t* m_ranges{nullptr};
+    const std::uint8_t* m_payload{nullptr};
+
+public:
+    brick_pyramid(const std::shared_ptr<core::mapped_file>& file, const glm::uvec3& size, voxel_type type, unsigned int brick_size);
+
+    const glm::uvec3& size() const;
+    voxel_type type() const;
+    unsigned int brick_size() const;
+    unsigned int padded_size() const;
+    std::size_t brick_bytes() const;
+
+    const std::vector<level>& levels() const;
+    std::size_t num_bricks() const;
+    std::size_t brick_index(unsigned int level, const glm::uvec3& brick) const;
+
+    /* normalized (16 bit) min / max of a brick including its apron, conservative: coarse bricks include the
+       ranges of the finer bricks they cover */
+    glm::u16vec2 range(std::size_t index) const;
+    const std::uint8_t* brick(std::size_t index) const;
+
+    /* level layout shared by the cooker and the reader */
+    static std::vector<level> layout(const glm::uvec3& size, unsigned int brick_size);
+};
+
+class brick_pyramid_loader
+{
+public:
+    using result_type = std::shared_ptr<brick_pyramid>;
+
+    static bool cook(const volume& vol, const std::filesystem::path& path, unsigned int brick_size = 32);
+    static result_type load(const std::filesystem::path& path);
+};
+
+
+/*========================== brick_cache ==========================*/
+/* gpu residency for a brick pyramid: bricks live in slots of a texture_3D atlas, a page table (one rgba8ui
+   texel per finest brick) points to the finest resident brick (xyz = atlas slot, w = level) or marks the region
+   empty (w = 254); bricks are requested by view frustum and screen space error and evicted least recently used */
+class brick_cache
+{
+public:
+    static constexpr std::uint8_t empty_entry = 254;
+    static constexpr std::uint8_t missing_entry = 255;
+
+    struct statistics
+    {
+        std::size_t slots{0};
+        std::size_t resident{0};
+        std::size_t requested{0};
+        std::size_t uploaded{0};
+        std::size_t evicted{0};
+        std::size_t pending{0};
+        std::size_t atlas_bytes{0};
+        double update_ms{0.0};
+    };
+
+private:
+    struct slot
+    {
+        std::size_t brick = std::numeric_limits<std::size_t>::max();
+        std::uint64_t last_used{0};
+        bool pinned{false};
+    };
+
+    opengl::context& m_context;
+    std::shared_ptr<brick_pyramid> m_pyramid;
+
+    opengl::handle<opengl::texture_3D> m_atlas;
+    opengl::handle<opengl::texture_3D> m_page_table;
+
+    glm::uvec3 m_slots{0, 0, 0};
+    std::vector<slot> m_slot_info;
+    std::unordered_map<std::size_t, unsigned int> m_resident;
+    std::vector<glm::u8vec4> m_table;
+
+    std::uint64_t m_frame{0};
+    float m_empty_threshold{0.0f};
+    statistics m_stats;
+
+public:
+    brick_cache(opengl::context& context, const std::shared_ptr<brick_pyramid>& pyramid, std::size_t budget_bytes);
+
+    /* bricks below this normalized value are treated as empty (never uploaded) */
+    void empty_threshold(float value);
+
+    /* request bricks for the current view and upload at most 'upload_budget' of them (coarse levels first);
+       model maps the unit cube [-0.5, 0.5]^3 to world space, pixel_error is the accepted projected voxel size */
+    void update(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, float viewport_height,
+                float pixel_error = 1.0f, unsigned int upload_budget = 64);
+
+    const opengl::handle<opengl::texture_3D>& atlas() const;
+    const opengl::handle<opengl::texture_3D>& page_table() const;
+    const std::shared_ptr<brick_pyramid>& pyramid() const;
+    const statistics& stats() const;
+
+private:
+    bool upload(std::size_t brick, bool pinned);
+    void rebuild_page_table();
+};
+
+}
@@ -0,0 +1,264 @@
+#include "compressed_volume.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+#include "viewer/opengl/context.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace asset
+{
+
+namespace detail
+{
+
+/* palette index codes: 0 / 1 select the endpoints, the interpolated values follow in order from r0 to r1 */
+inline std::uint8_t bc4_code(unsigned int step, unsigned int steps)
+{
+    return step == 0 ? 0 : (step == steps ? 1 : static_cast<std::uint8_t>(step + 1));
+}
+
+/* decoded value (in 0..255) of an index code */
+inline float bc4_decode(std::uint8_t r0, std::uint8_t r1, unsigned int code)
+{
+    if(code == 0) { return r0; }
+    if(code == 1) { return r1; }
+
+    if(r0 > r1)
+    {
+        return ((8 - code) * r0 + (code - 1) * r1) / 7.0f;
+    }
+
+    if(code == 6) { return 0.0f; }
+    if(code == 7) { return 255.0f; }
+    return ((6 - code) * r0 + (code - 1) * r1) / 5.0f;
+}
+
+struct bc4_block
+{
+    std::uint8_t r0{0};
+    std::uint8_t r1{0};
+    std::uint8_t codes[16]{};
+    float error{0.0f};
+};
+
+/* indices of the nearest palette entries for endpoints r0 / r1 (squared error summed over the block) */
+inline bc4_block bc4_fit(const float* values, std::uint8_t r0, std::uint8_t r1)
+{
+    bc4_block block;
+    block.r0 = r0;
+    block.r1 = r1;
+
+    const bool extremes = r0 <= r1;
+    const unsigned int steps = extremes ? 5 : 7;
+    const float scale = r0 != r1 ? steps / (static_cast<float>(r1) - r0) : 0.0f;
+
+    for(int i = 0; i < 16; i++)
+    {
+        const float v = values[i];
+        auto step = static_cast<unsigned int>(std::clamp(std::round((v - r0) * scale), 0.0f, static_cast<float>(steps)));
+        std::uint8_t code = bc4_code(step, steps);
+        float d = v - bc4_decode(r0, r1, code);
+
+        if(extremes)
+        {
+            /* exact 0 and 255 of the second mode */
+            if(v < std::abs(d))         { code = 6; d = v; }
+            if(255.0f - v < std::abs(d)) { code = 7; d = 255.0f - v; }
+        }
+
+        block.codes[i] = code;
+        block.error += d * d;
+    }
+
+    return block;
+}
+
+inline bc4_block bc4_encode(const float* values)
+{
+    float lo = values[0], hi = values[0];
+    for(int i = 1; i < 16; i++)
+    {
+        lo = std::min(lo, values[i]);
+        hi = std::max(hi, values[i]);
+    }
+
+    auto r0 = static_cast<std::uint8_t>(std::round(hi));
+    auto r1 = static_cast<std::uint8_t>(std::round(lo));
+
+    /* eight values between max and min (r0 > r1), a constant block is exact in the second mode */
+    bc4_block best = r0 > r1 ? bc4_fit(values, r0, r1) : bc4_fit(values, r1, r0);
+    if(r0 != 255 && r1 != 0) { return best; }
+
+    /* block touches the range ends: six values between the inner min / max, ends stored exactly */
+    float inner_lo = 255.0f, inner_hi = 0.0f;
+    for(int i = 0; i < 16; i++)
+    {
+        if(values[i] < 0.5f || values[i] >= 254.5f) { continue; }
+        inner_lo = std::min(inner_lo, values[i]);
+        inner_hi = std::max(inner_hi, values[i]);
+    }
+    if(inner_lo > inner_hi) { inner_lo = inner_hi = 0.0f; }
+
+    auto candidate = bc4_fit(values, static_cast<std::uint8_t>(std::round(inner_lo)), static_cast<std::uint8_t>(std::round(inner_hi)));
+    return candidate.error < best.error ? candidate : best;
+}
+
+/* two endpoints followed by the 3 bit codes of the texels (row major), little endian */
+inline void bc4_pack(const bc4_block& block, std::uint8_t* dst)
+{
+    std::uint64_t bits = 0;
+    for(int i = 0; i < 16; i++)
+    {
+        bits |= static_cast<std::uint64_t>(block.codes[i]) << (3 * i);
+    }
+
+    dst[0] = block.r0;
+    dst[1] = block.r1;
+    for(int i = 0; i < 6; i++)
+    {
+        dst[2 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+}
+
+struct slice_error
+{
+    double squared{0.0};
+    float max{0.0f};
+};
+
+/* encodes one slice, voxels outside the volume repeat the border (clamped block footprint) */
+template<typename T>
+slice_error encode_slice(const volume& vol, compressed_volume& out, unsigned int z)
+{
+    constexpr float to_byte = 255.0f / std::numeric_limits<T>::max();
+    const auto& size = vol.size();
+    const auto* voxels = reinterpret_cast<const T*>(vol.slice(z));
+    std::uint8_t* dst = out.data.data() + z * out.slice_bytes();
+
+    slice_error error;
+    float values[16];
+    float originals[16];
+    for(unsigned int by = 0; by < out.blocks.y; by++)
+    {
+        for(unsigned int bx = 0; bx < out.blocks.x; bx++, dst += compressed_volume_loader::block_bytes)
+        {
+            for(unsigned int i = 0; i < 16; i++)
+            {
+                unsigned int x = std::min(bx * 4 + (i & 3), size.x - 1);
+                unsigned int y = std::min(by * 4 + (i >> 2), size.y - 1);
+                originals[i] = voxels[static_cast<std::size_t>(y) * size.x + x];
+                values[i] = originals[i] * to_byte;
+            }
+
+            auto block = bc4_encode(values);
+            bc4_pack(block, dst);
+
+            /* error of the voxels inside the volume against the original values */
+            for(unsigned int i = 0; i < 16; i++)
+            {
+                if(bx * 4 + (i & 3) >= size.x || by * 4 + (i >> 2) >= size.y) { continue; }
+
+                float d = std::abs(bc4_decode(block.r0, block.r1, block.codes[i]) / 255.0f - originals[i] / std::numeric_limits<T>::max());
+                error.squared += d * d;
+                error.max = std::max(error.max, d);
+            }
+        }
+    }
+
+    return error;
+}
+
+}
+
+std::size_t compressed_volume::bytes() const
+{
+    return data.size();
+}
+
+std::size_t compressed_volume::slice_bytes() const
+{
+    return static_cast<std::size_t>(blocks.x) * blocks.y * compressed_volume_loader::block_bytes;
+}
+
+float compressed_volume::value(unsigned int x, unsigned int y, unsigned int z) const
+{
+    const std::uint8_t* block = data.data() + z * slice_bytes() + (static_cast<std::size_t>(y / 4) * blocks.x + x / 4) * compressed_volume_loader::block_bytes;
+
+    std::uint64_t bits = 0;
+    for(int i = 0; i < 6; i++)
+    {
+        bits |= static_cast<std::uint64_t>(block[2 + i]) << (8 * i);
+    }
+
+    auto code = static_cast<unsigned int>((bits >> (3 * ((y & 3) * 4 + (x & 3)))) & 7);
+    return detail::bc4_decode(block[0], block[1], code) / 255.0f;
+}
+
+compressed_volume compressed_volume_loader::encode(const volume& vol)
+{
+    auto start = core::clock::now();
+
+    compressed_volume out;
+    out.size = vol.size();
+    out.blocks = (glm::uvec2(out.size) + 3u) / 4u;
+    out.data.resize(out.slice_bytes() * out.size.z);
+    out.source_bytes = vol.bytes();
+
+    std::vector<detail::slice_error> errors(out.size.z);
+    core::parallel_for(0, out.size.z, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t z = begin; z < end; z++)
+        {
+            errors[z] = vol.type() == voxel_type::uint8 ? detail::encode_slice<std::uint8_t>(vol, out, static_cast<unsigned int>(z))
+                                                        : detail::encode_slice<std::uint16_t>(vol, out, static_cast<unsigned int>(z));
+        }
+    });
+
+    double squared = 0.0;
+    for(const auto& error : errors)
+    {
+        squared += error.squared;
+        out.max_error = std::max(out.max_error, error.max);
+    }
+
+    const double voxels = static_cast<double>(out.size.x) * out.size.y * out.size.z;
+    out.rmse = static_cast<float>(std::sqrt(squared / std::max(voxels, 1.0)));
+    out.psnr = out.rmse > 0.0f ? static_cast<float>(-20.0 * std::log10(out.rmse)) : std::numeric_limits<float>::infinity();
+    out.encode_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+
+    platform_log(core::log::level::info, "[asset::compressed_volume] encoded {}x{}x{} to bc4 in {:.1f} ms: {:.1f} MB -> {:.1f} MB ({:.1f}:1), max error {:.4f}, rmse {:.5f}, psnr {:.1f} dB",
+                 out.size.x, out.size.y, out.size.z, out.encode_ms, out.source_bytes / (1024.0 * 1024.0), out.bytes() / (1024.0 * 1024.0),
+                 static_cast<double>(out.source_bytes) / std::max<std::size_t>(out.bytes(), 1), out.max_error, out.rmse, out.psnr);
+
+    return out;
+}
+
+compressed_volume_loader::result_type compressed_volume_loader::load(opengl::context& context, const compressed_volume& compressed)
+{
+    auto start = core::clock::now();
+    const auto& size = compressed.size;
+
+    auto tex = context.make_texture_array(opengl::texture_internal_type::compressed_red_rgtc1, opengl::texture_format::red,
+                                          opengl::texture_type::unsigned_byte_, size.x, size.y, size.z);
+
+    /* slabs of ~32 MB of whole layers */
+    constexpr std::size_t slab_target = 32 << 20;
+    const std::size_t slice_bytes = compressed.slice_bytes();
+    const unsigned int slab_depth = static_cast<unsigned int>(std::clamp<std::size_t>(slab_target / std::max<std::size_t>(slice_bytes, 1), 1, size.z));
+    for(unsigned int z = 0; z < size.z; z += slab_depth)
+    {
+        unsigned int depth = std::min(slab_depth, size.z - z);
+        tex->compressed_sub_data(compressed.data.data() + z * slice_bytes, z, depth, depth * slice_bytes);
+    }
+
+    platform_log(core::log::level::info, "[asset::compressed_volume] uploaded {}x{}x{} ({:.1f} MB, bc4) in {:.1f} ms",
+                 size.x, size.y, size.z, compressed.bytes() / (1024.0 * 1024.0), core::time_cast<core::milli_sec>(core::clock::now() - start));
+
+    return tex;
+}
+
+}
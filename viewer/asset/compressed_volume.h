@@ -0,0 +1,58 @@
+#pragma once
+
+#include "volume.h"
+#include "viewer/opengl/texture_array.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace asset
+{
+
+/*========================== compressed_volume ==========================*/
+/* volume as BC4 (RGTC1) compressed slices: every slice is split into 4x4 blocks of 8 bytes (two 8 bit endpoints
+   and 3 bit palette indices), 4 bits per voxel on the gpu. RGTC is not defined for 3D textures, so the slices are
+   uploaded as layers of a 2D array texture and the raycaster interpolates between layers itself */
+struct compressed_volume
+{
+    glm::uvec3 size{0, 0, 0};
+    glm::uvec2 blocks{0, 0};
+    std::vector<std::uint8_t> data;
+
+    /* error of the decoded against the original normalized values */
+    float max_error{0.0f};
+    float rmse{0.0f};
+    float psnr{0.0f};
+
+    std::size_t source_bytes{0};
+    double encode_ms{0.0};
+
+    std::size_t bytes() const;
+    std::size_t slice_bytes() const;
+
+    /* normalized value of a voxel as decoded by the gpu */
+    float value(unsigned int x, unsigned int y, unsigned int z) const;
+};
+
+class compressed_volume_loader
+{
+public:
+    using result_type = std::shared_ptr<opengl::texture_array>;
+
+    static constexpr std::size_t block_bytes = 8;
+
+    /* encodes all slices in parallel; per block the better of the two BC4 modes is kept (eight interpolated values
+       between min and max, or six between the inner values plus exact 0 and 1 for blocks touching the range ends) */
+    static compressed_volume encode(const volume& vol);
+
+    /* compressed_red_rgtc1 array texture with one layer per slice (linear filtering, clamped to the edges) */
+    static result_type load(opengl::context& context, const compressed_volume& compressed);
+};
+
+}
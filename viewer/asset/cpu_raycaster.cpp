@@ -0,0 +1,334 @@
+#include "cpu_raycaster.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/simd.h"
+#include "viewer/core/time.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace asset
+{
+
+namespace detail
+{
+
+constexpr unsigned int raycast_tile = 16;
+
+/* bricked copy of the normalized voxels, voxels beyond the volume repeat the border (clamp to edge) */
+template<typename T>
+void copy_bricks(const volume& vol, const glm::uvec3& bricks, unsigned int bz, std::vector<float>& voxels)
+{
+    constexpr unsigned int b = cpu_raycaster::brick_size;
+    constexpr unsigned int s = b + 1;
+    const float scale = 1.0f / static_cast<float>(std::numeric_limits<T>::max());
+
+    const auto& size = vol.size();
+    const T* data = reinterpret_cast<const T*>(vol.ptr());
+
+    for(unsigned int by = 0; by < bricks.y; by++)
+    {
+        for(unsigned int bx = 0; bx < bricks.x; bx++)
+        {
+            float* dst = voxels.data() + ((static_cast<std::size_t>(bz) * bricks.y + by) * bricks.x + bx) * s * s * s;
+            for(unsigned int z = 0; z < s; z++)
+            {
+                const std::size_t vz = std::min(bz * b + z, size.z - 1);
+                for(unsigned int y = 0; y < s; y++)
+                {
+                    const std::size_t vy = std::min(by * b + y, size.y - 1);
+                    const T* row = data + (vz * size.y + vy) * size.x;
+                    for(unsigned int x = 0; x < s; x++)
+                    {
+                        *dst++ = row[std::min(bx * b + x, size.x - 1)] * scale;
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
+
+
+/*========================== cpu_raycaster ==========================*/
+cpu_raycaster::cpu_raycaster(const volume& vol)
+    : m_size(glm::max(vol.size(), glm::uvec3(2))), m_bricks((vol.size() + brick_size - 1u) / brick_size)
+{
+    auto start = core::clock::now();
+
+    constexpr unsigned int s = brick_size + 1;
+    const std::size_t count = static_cast<std::size_t>(m_bricks.x) * m_bricks.y * m_bricks.z;
+    m_voxels.resize(count * s * s * s);
+    m_range.resize(count);
+
+    if(glm::any(glm::lessThan(vol.size(), glm::uvec3(2))))
+    {
+        platform_log(core::log::level::error, "[asset::cpu_raycaster] Volume needs at least two voxels per axis");
+        std::fill(m_voxels.begin(), m_voxels.end(), 0.0f);
+        return;
+    }
+
+    core::parallel_for(0, m_bricks.z, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t bz = begin; bz < end; bz++)
+        {
+            if(vol.type() == voxel_type::uint8)
+            {
+                detail::copy_bricks<std::uint8_t>(vol, m_bricks, static_cast<unsigned int>(bz), m_voxels);
+            }
+            else
+            {
+                detail::copy_bricks<std::uint16_t>(vol, m_bricks, static_cast<unsigned int>(bz), m_voxels);
+            }
+        }
+    });
+
+    /* the range includes the voxel before every brick, which is read by samples near its lower border */
+    core::parallel_for(0, m_bricks.z, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t bz = begin; bz < end; bz++)
+        {
+            for(unsigned int by = 0; by < m_bricks.y; by++)
+            {
+                for(unsigned int bx = 0; bx < m_bricks.x; bx++)
+                {
+                    glm::uvec3 brick(bx, by, static_cast<unsigned int>(bz));
+                    glm::uvec3 first = glm::max(brick * brick_size, glm::uvec3(1)) - 1u;
+                    glm::uvec3 last = glm::min(brick * brick_size + brick_size, m_size - 1u);
+
+                    glm::vec2 range(1.0f, 0.0f);
+                    for(unsigned int z = first.z; z <= last.z; z++)
+                    {
+                        for(unsigned int y = first.y; y <= last.y; y++)
+                        {
+                            for(unsigned int x = first.x; x <= last.x; x++)
+                            {
+                                float v = vol.value(x, y, z);
+                                range = {std::min(range.x, v), std::max(range.y, v)};
+                            }
+                        }
+                    }
+
+                    m_range[(bz * m_bricks.y + by) * m_bricks.x + bx] = range;
+                }
+            }
+        }
+    });
+
+    platform_log(core::log::level::info, "[asset::cpu_raycaster] bricked {}x{}x{} voxels into {}x{}x{} bricks ({:.1f} MB) in {:.1f} ms",
+                 m_size.x, m_size.y, m_size.z, m_bricks.x, m_bricks.y, m_bricks.z,
+                 m_voxels.size() * sizeof(float) / (1024.0 * 1024.0), core::time_cast<core::milli_sec>(core::clock::now() - start));
+}
+
+std::shared_ptr<image> cpu_raycaster::render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj,
+                                             const glm::uvec2& resolution, const settings& s)
+{
+    auto result = std::make_shared<image>(resolution.x, resolution.y, color{0, 0, 0, 255});
+    auto start = core::clock::now();
+
+    const glm::mat4 inverse = glm::inverse(proj * view * model);
+    const glm::mat3 normal_matrix = glm::mat3(model);
+    const glm::uvec2 tiles = (resolution + detail::raycast_tile - 1u) / detail::raycast_tile;
+
+    std::atomic<std::size_t> rays{0}, samples{0};
+    core::parallel_for(0, static_cast<std::size_t>(tiles.x) * tiles.y, 1, [&](std::size_t begin, std::size_t end)
+    {
+        std::size_t tile_rays = 0, tile_samples = 0;
+        for(std::size_t tile = begin; tile < end; tile++)
+        {
+            const glm::uvec2 first = glm::uvec2(tile % tiles.x, tile / tiles.x) * detail::raycast_tile;
+            const glm::uvec2 last = glm::min(first + detail::raycast_tile, resolution);
+
+            for(unsigned int y = first.y; y < last.y; y++)
+            {
+                for(unsigned int x = first.x; x < last.x; x++)
+                {
+                    /* pixel center on the near and far plane in object space (y of the image points down) */
+                    glm::vec2 ndc = (glm::vec2(x, resolution.y - 1 - y) + 0.5f) / glm::vec2(resolution) * 2.0f - 1.0f;
+                    glm::vec4 near_point = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+                    glm::vec4 far_point = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+                    glm::vec3 origin = glm::vec3(near_point) / near_point.w;
+                    glm::vec3 direction = glm::vec3(far_point) / far_point.w - origin;
+
+                    /* entry and exit of the unit cube within the clip range (the rasterized cube faces on the gpu) */
+                    glm::vec3 inv = 1.0f / direction;
+                    glm::vec3 t0 = (glm::vec3(-0.5f) - origin) * inv;
+                    glm::vec3 t1 = (glm::vec3(0.5f) - origin) * inv;
+                    glm::vec3 tmin = glm::min(t0, t1), tmax = glm::max(t0, t1);
+                    float enter = std::max({tmin.x, tmin.y, tmin.z, 0.0f});
+                    float leave = std::min({tmax.x, tmax.y, tmax.z, 1.0f});
+                    if(!(enter < leave)) { continue; }
+
+                    glm::vec3 entry = origin + enter * direction + 0.5f;
+                    glm::vec3 exit = origin + leave * direction + 0.5f;
+
+                    glm::vec3 c = glm::clamp(trace(entry, exit, normal_matrix, s, tile_samples), 0.0f, 1.0f);
+                    (*result)(x, y) = color(glm::round(c * 255.0f), 255);
+                    tile_rays++;
+                }
+            }
+        }
+
+        rays += tile_rays;
+        samples += tile_samples;
+    });
+
+    m_stats.rays = rays;
+    m_stats.samples = samples;
+    m_stats.render_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    m_stats.rays_per_second = m_stats.render_ms > 0.0 ? m_stats.rays / (m_stats.render_ms * 1e-3) : 0.0;
+
+    return result;
+}
+
+float cpu_raycaster::sample(const glm::vec3& position) const
+{
+    /* voxel centers at (i + 0.5) / size, clamp to edge */
+    const glm::vec3 v = glm::clamp(position * glm::vec3(m_size) - 0.5f, glm::vec3(0.0f), glm::vec3(m_size - 1u));
+    const glm::uvec3 i = glm::min(glm::uvec3(v), m_size - 2u);
+    const glm::vec3 t = v - glm::vec3(i);
+
+    constexpr unsigned int s = brick_size + 1;
+    const glm::uvec3 brick = i / brick_size;
+    const glm::uvec3 local = i - brick * brick_size;
+    const float* c = m_voxels.data() + ((static_cast<std::size_t>(brick.z) * m_bricks.y + brick.y) * m_bricks.x + brick.x) * s * s * s
+                                     + (local.z * s + local.y) * s + local.x;
+
+#if defined(CORE_SIMD_SSE2)
+    /* (x0 y0, x1 y0, x0 y1, x1 y1) of both z planes, lerped in z, then y, then x */
+    __m128 lo = _mm_setr_ps(c[0], c[1], c[s], c[s + 1]);
+    __m128 hi = _mm_setr_ps(c[s * s], c[s * s + 1], c[s * s + s], c[s * s + s + 1]);
+    __m128 z = _mm_add_ps(lo, _mm_mul_ps(_mm_sub_ps(hi, lo), _mm_set1_ps(t.z)));
+    __m128 z_y1 = _mm_shuffle_ps(z, z, _MM_SHUFFLE(3, 2, 3, 2));
+    __m128 y = _mm_add_ps(z, _mm_mul_ps(_mm_sub_ps(z_y1, z), _mm_set1_ps(t.y)));
+
+    float xy[4];
+    _mm_storeu_ps(xy, y);
+    return xy[0] + (xy[1] - xy[0]) * t.x;
+#else
+    auto lerp = [](float a, float b, float w) { return a + (b - a) * w; };
+    float y0 = lerp(lerp(c[0], c[1], t.x), lerp(c[s], c[s + 1], t.x), t.y);
+    float y1 = lerp(lerp(c[s * s], c[s * s + 1], t.x), lerp(c[s * s + s], c[s * s + s + 1], t.x), t.y);
+    return lerp(y0, y1, t.z);
+#endif
+}
+
+const glm::uvec3& cpu_raycaster::size() const
+{
+    return m_size;
+}
+
+const cpu_raycaster::statistics& cpu_raycaster::stats() const
+{
+    return m_stats;
+}
+
+glm::vec3 cpu_raycaster::trace(const glm::vec3& entry, const glm::vec3& exit, const glm::mat3& normal_matrix, const settings& s, std::size_t& samples) const
+{
+    const glm::vec3 direction = glm::normalize(exit - entry);
+    const glm::vec3 step = direction * s.step_size;
+    const unsigned int steps = static_cast<unsigned int>(std::min(static_cast<float>(s.max_steps), glm::length(exit - entry) / s.step_size));
+
+    glm::vec3 position = entry;
+    unsigned int i = 0;
+
+    if(s.render_type == mode::mip)
+    {
+        float maximum = 0.0f;
+        while(i < steps)
+        {
+            /* brick can not raise the current maximum */
+            if(s.skip_empty && brick_range(position).y <= maximum)
+            {
+                unsigned int skip = brick_skip(position, direction, s.step_size);
+                position += static_cast<float>(skip) * step;
+                i += skip;
+                continue;
+            }
+
+            maximum = std::max(maximum, sample(position));
+            samples++;
+            position += step;
+            i++;
+        }
+
+        return glm::vec3(std::pow(maximum, 1.0f / s.gamma));
+    }
+
+    while(i < steps)
+    {
+        /* no sample inside the brick can cross the iso value */
+        if(s.skip_empty && brick_range(position).y <= s.iso_value)
+        {
+            unsigned int skip = brick_skip(position, direction, s.step_size);
+            position += static_cast<float>(skip) * step;
+            i += skip;
+            continue;
+        }
+
+        samples++;
+        if(sample(position) > s.iso_value)
+        {
+            /* refine position by a half and a quarter step */
+            position -= 0.5f * step;
+            position -= step * (sample(position) > s.iso_value ? 0.25f : -0.25f);
+
+            glm::vec3 g = gradient(position);
+            float length = glm::length(g);
+            float diffuse = 0.0f;
+            if(length > 0.0f)
+            {
+                glm::vec3 normal = normal_matrix * (-g / length);
+                diffuse = std::max(glm::dot(normal, glm::normalize(-s.light_direction)), 0.0f);
+            }
+
+            return s.light_ambient + s.light_color * diffuse;
+        }
+
+        position += step;
+        i++;
+    }
+
+    return glm::vec3(0.0f);
+}
+
+glm::vec3 cpu_raycaster::gradient(const glm::vec3& position) const
+{
+    /* central differences one voxel apart (textureLodOffset) */
+    const glm::vec3 h = 1.0f / glm::vec3(m_size);
+    return glm::vec3(sample(position + glm::vec3(h.x, 0, 0)) - sample(position - glm::vec3(h.x, 0, 0)),
+                     sample(position + glm::vec3(0, h.y, 0)) - sample(position - glm::vec3(0, h.y, 0)),
+                     sample(position + glm::vec3(0, 0, h.z)) - sample(position - glm::vec3(0, 0, h.z))) * 0.5f;
+}
+
+const glm::vec2& cpu_raycaster::brick_range(const glm::vec3& position) const
+{
+    const glm::vec3 extent = glm::vec3(static_cast<float>(brick_size)) / glm::vec3(m_size);
+    const glm::ivec3 brick = glm::clamp(glm::ivec3(glm::floor(position / extent)), glm::ivec3(0), glm::ivec3(m_bricks) - 1);
+    return m_range[(static_cast<std::size_t>(brick.z) * m_bricks.y + brick.y) * m_bricks.x + brick.x];
+}
+
+unsigned int cpu_raycaster::brick_skip(const glm::vec3& position, const glm::vec3& direction, float step_size) const
+{
+    const glm::vec3 extent = glm::vec3(static_cast<float>(brick_size)) / glm::vec3(m_size);
+    const glm::vec3 brick_min = glm::floor(position / extent) * extent;
+    const glm::vec3 brick_max = brick_min + extent;
+
+    float t_exit = std::numeric_limits<float>::max();
+    for(int axis = 0; axis < 3; axis++)
+    {
+        float dir = std::abs(direction[axis]) > 1e-6f ? direction[axis] : (direction[axis] >= 0.0f ? 1e-6f : -1e-6f);
+        float bound = dir > 0.0f ? brick_max[axis] : brick_min[axis];
+        t_exit = std::min(t_exit, (bound - position[axis]) / dir);
+    }
+
+    return static_cast<unsigned int>(std::max(std::ceil(t_exit / step_size), 1.0f));
+}
+
+}
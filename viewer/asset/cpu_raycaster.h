@@ -0,0 +1,92 @@
+#pragma once
+
+#include "viewer/asset/image.h"
+#include "viewer/asset/volume.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+namespace asset
+{
+
+/*========================== cpu_raycaster ==========================*/
+/* software counterpart of raycast.frag (iso surface with refinement and central difference shading, maximum
+   intensity projection) for headless rendering and for checking the shader output: the volume is re-laid out
+   into bricks of normalized float voxels with a one voxel apron so that every trilinear sample reads from a
+   single brick, images are rendered in screen tiles handed out to all hardware threads */
+class cpu_raycaster
+{
+public:
+    static constexpr unsigned int brick_size = 8;
+
+    enum class mode
+    {
+        isosurface = 0,
+        mip = 1
+    };
+
+    /* same meaning and defaults as the uniforms of the raycasting shader */
+    struct settings
+    {
+        mode render_type{mode::mip};
+        float step_size{0.005f};
+        int max_steps{4 * 256};
+        float iso_value{0.15f};
+        float gamma{1.5f};
+        bool skip_empty{true};
+
+        glm::vec3 light_direction{-0.5f, -0.70710678f, -0.5f};
+        glm::vec3 light_ambient{0.2f, 0.2f, 0.2f};
+        glm::vec3 light_color{1.0f, 1.0f, 1.0f};
+    };
+
+    struct statistics
+    {
+        std::size_t rays{0};
+        std::size_t samples{0};
+        double render_ms{0.0};
+        double rays_per_second{0.0};
+    };
+
+private:
+    glm::uvec3 m_size;
+    glm::uvec3 m_bricks;
+
+    /* (brick_size + 1)^3 voxels per brick, bricks in x, y, z order */
+    std::vector<float> m_voxels;
+
+    /* min / max of every brick extended by one voxel into its neighbours (as volume_loader::compute_bricks) */
+    std::vector<glm::vec2> m_range;
+
+    statistics m_stats;
+
+public:
+    explicit cpu_raycaster(const volume& vol);
+
+    /* renders the unit cube around the origin (texture coordinates = position + 0.5) into an rgba8 image with
+       the first row at the top; pixels that miss the volume are black */
+    std::shared_ptr<image> render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj,
+                                  const glm::uvec2& resolution, const settings& s);
+
+    /* trilinear sample at texture coordinates in [0, 1] (clamped to the border voxels) */
+    float sample(const glm::vec3& position) const;
+
+    const glm::uvec3& size() const;
+    const statistics& stats() const;
+
+private:
+    /* color of the ray between two texture space positions and the number of samples taken */
+    glm::vec3 trace(const glm::vec3& entry, const glm::vec3& exit, const glm::mat3& normal_matrix, const settings& s, std::size_t& samples) const;
+
+    glm::vec3 gradient(const glm::vec3& position) const;
+    const glm::vec2& brick_range(const glm::vec3& position) const;
+    unsigned int brick_skip(const glm::vec3& position, const glm::vec3& direction, float step_size) const;
+};
+
+}
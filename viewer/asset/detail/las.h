@@ -0,0 +1,237 @@
+#pragma once
+
+#include "viewer/asset/detail/obj_model.h"
+#include "viewer/core/simd.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace asset::detail::las
+{
+
+/* public header block fields of an uncompressed LAS 1.0 - 1.4 file (only what is needed for decoding) */
+struct header
+{
+    std::uint8_t version_major{0};
+    std::uint8_t version_minor{0};
+    std::uint16_t header_size{0};
+    std::uint32_t point_offset{0};
+    std::uint8_t point_format{0};
+    std::uint16_t record_length{0};
+    std::uint64_t num_points{0};
+
+    glm::dvec3 scale{1.0};
+    glm::dvec3 offset{0.0};
+    glm::dvec3 min{0.0};
+    glm::dvec3 max{0.0};
+};
+
+template<typename T>
+inline T read(const std::uint8_t* ptr)
+{
+    T value;
+    std::memcpy(&value, ptr, sizeof(T));
+    return value;
+}
+
+/* minimal record size of the supported point data formats (0 = unsupported) */
+inline std::size_t record_size(std::uint8_t format)
+{
+    switch(format)
+    {
+        case 0: return 20;
+        case 1: return 28;
+        case 2: return 26;
+        case 3: return 34;
+        case 6: return 30;
+        case 7: return 36;
+        case 8: return 38;
+        default: return 0;
+    }
+}
+
+/* byte offset of the 16 bit rgb triplet inside a record (0 = format without color) */
+inline std::size_t rgb_offset(std::uint8_t format)
+{
+    switch(format)
+    {
+        case 2: return 20;
+        case 3: return 28;
+        case 7: return 30;
+        case 8: return 30;
+        default: return 0;
+    }
+}
+
+inline bool parse_header(const std::uint8_t* data, std::size_t size, header& h, std::string& error)
+{
+    if(size < 227 || std::memcmp(data, "LASF", 4) != 0)
+    {
+        error = "not a LAS file";
+        return false;
+    }
+
+    h.version_major = data[24];
+    h.version_minor = data[25];
+    h.header_size   = read<std::uint16_t>(data + 94);
+    h.point_offset  = read<std::uint32_t>(data + 96);
+    h.point_format  = data[104];
+    h.record_length = read<std::uint16_t>(data + 105);
+    h.num_points    = read<std::uint32_t>(data + 107);
+
+    h.scale  = {read<double>(data + 131), read<double>(data + 139), read<double>(data + 147)};
+    h.offset = {read<double>(data + 155), read<double>(data + 163), read<double>(data + 171)};
+    h.max    = {read<double>(data + 179), read<double>(data + 195), read<double>(data + 211)};
+    h.min    = {read<double>(data + 187), read<double>(data + 203), read<double>(data + 219)};
+
+    /* LAS 1.4 stores the (64 bit) point count separately, the legacy field may be zero */
+    if(h.version_major == 1 && h.version_minor >= 4 && h.header_size >= 375 && size >= 255)
+    {
+        auto count = read<std::uint64_t>(data + 247);
+        if(count > 0) { h.num_points = count; }
+    }
+
+    /* bit 7 / bit 6 of the format byte mark LASzip compressed point records */
+    if(h.point_format & 0xC0)
+    {
+        error = "compressed (LAZ) point records are not supported";
+        return false;
+    }
+
+    auto min_record = record_size(h.point_format);
+    if(min_record == 0)
+    {
+        error = "unsupported point data format " + std::to_string(h.point_format);
+        return false;
+    }
+
+    if(h.record_length < min_record)
+    {
+        error = "point record length is smaller than required by its format";
+        return false;
+    }
+
+    if(h.point_offset > size)
+    {
+        error = "offset to point data exceeds file size";
+        return false;
+    }
+
+    return true;
+}
+
+/* decodes 'count' records starting at 'records' into vertices (color is skipped if color_offset is zero);
+   positions are X * scale + offset, the double precision offset already contains the recentering shift */
+template<typename Data>
+void decode(const std::uint8_t* records, std::size_t stride, std::size_t count,
+            const glm::dvec3& scale, const glm::dvec3& offset,
+            std::size_t color_offset, float color_scale, Data* vertices)
+{
+    constexpr bool with_color = has_member<Data>::color::value;
+    const bool decode_color = with_color && color_offset > 0;
+
+    std::size_t i = 0;
+
+#if defined(CORE_SIMD_SSE2)
+    const __m128d scale_x = _mm_set1_pd(scale.x), scale_y = _mm_set1_pd(scale.y), scale_z = _mm_set1_pd(scale.z);
+    const __m128d offset_x = _mm_set1_pd(offset.x), offset_y = _mm_set1_pd(offset.y), offset_z = _mm_set1_pd(offset.z);
+    const __m128 color_factor = _mm_set1_ps(color_scale);
+
+    auto gather = [&](std::size_t field) -> __m128i
+    {
+        return _mm_set_epi32(read<std::int32_t>(records + (i + 3) * stride + field),
+                             read<std::int32_t>(records + (i + 2) * stride + field),
+                             read<std::int32_t>(records + (i + 1) * stride + field),
+                             read<std::int32_t>(records + (i + 0) * stride + field));
+    };
+
+    auto gather_u16 = [&](std::size_t field) -> __m128
+    {
+        __m128i v = _mm_set_epi32(read<std::uint16_t>(records + (i + 3) * stride + field),
+                                  read<std::uint16_t>(records + (i + 2) * stride + field),
+                                  read<std::uint16_t>(records + (i + 1) * stride + field),
+                                  read<std::uint16_t>(records + (i + 0) * stride + field));
+        return _mm_mul_ps(_mm_cvtepi32_ps(v), color_factor);
+    };
+
+    /* scaled integers are converted in double precision (two lanes) before narrowing to float */
+    auto transform = [](__m128i v, __m128d s, __m128d o) -> __m128
+    {
+        __m128d lo = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(v), s), o);
+        __m128d hi = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))), s), o);
+        return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+    };
+
+    for(; i + 4 <= count; i += 4)
+    {
+        alignas(16) float x[4], y[4], z[4];
+        _mm_store_ps(x, transform(gather(0), scale_x, offset_x));
+        _mm_store_ps(y, transform(gather(4), scale_y, offset_y));
+        _mm_store_ps(z, transform(gather(8), scale_z, offset_z));
+
+        for(std::size_t k = 0; k < 4; k++)
+        {
+            vertices[i + k].position = {x[k], y[k], z[k]};
+        }
+
+        if constexpr (with_color)
+        {
+            if(decode_color)
+            {
+                alignas(16) float r[4], g[4], b[4];
+                _mm_store_ps(r, gather_u16(color_offset + 0));
+                _mm_store_ps(g, gather_u16(color_offset + 2));
+                _mm_store_ps(b, gather_u16(color_offset + 4));
+
+                for(std::size_t k = 0; k < 4; k++)
+                {
+                    vertices[i + k].color = {r[k], g[k], b[k]};
+                }
+            }
+        }
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        const std::uint8_t* record = records + i * stride;
+        vertices[i].position =
+            {
+                static_cast<float>(read<std::int32_t>(record + 0) * scale.x + offset.x),
+                static_cast<float>(read<std::int32_t>(record + 4) * scale.y + offset.y),
+                static_cast<float>(read<std::int32_t>(record + 8) * scale.z + offset.z)
+            };
+
+        if constexpr (with_color)
+        {
+            if(decode_color)
+            {
+                vertices[i].color =
+                    {
+                        read<std::uint16_t>(record + color_offset + 0) * color_scale,
+                        read<std::uint16_t>(record + color_offset + 2) * color_scale,
+                        read<std::uint16_t>(record + color_offset + 4) * color_scale
+                    };
+            }
+        }
+    }
+}
+
+/* some writers store 8 bit colors in the 16 bit fields; inspect a sample to pick the normalization */
+inline float color_scale(const std::uint8_t* records, std::size_t stride, std::size_t count, std::size_t color_offset)
+{
+    std::uint16_t max_value = 0;
+    for(std::size_t i = 0; i < count; i++)
+    {
+        const std::uint8_t* record = records + i * stride + color_offset;
+        max_value = std::max({max_value, read<std::uint16_t>(record + 0), read<std::uint16_t>(record + 2), read<std::uint16_t>(record + 4)});
+    }
+
+    return max_value > 255 ? 1.0f / 65535.0f : 1.0f / 255.0f;
+}
+
+}
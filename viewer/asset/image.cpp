@@ -80,4 +80,33 @@ image_loader::result_type image_loader::load(const std::filesystem::path &path)
     return result_type(img);
 }
 
+bool image_loader::save(const image& img, const std::filesystem::path& path)
+{
+    const auto& size = img.size();
+    const auto extension = path.extension();
+    const auto filename = path.string();
+
+    int result = 0;
+    if(extension == ".png")
+    {
+        result = stbi_write_png(filename.c_str(), size.x, size.y, 4, img.ptr(), size.x * 4);
+    }
+    else if(extension == ".bmp")
+    {
+        result = stbi_write_bmp(filename.c_str(), size.x, size.y, 4, img.ptr());
+    }
+    else if(extension == ".tga")
+    {
+        result = stbi_write_tga(filename.c_str(), size.x, size.y, 4, img.ptr());
+    }
+
+    if(result == 0)
+    {
+        platform_log(core::log::level::error, "[asset::image] Couldn't save image {0}", filename);
+        return false;
+    }
+
+    return true;
+}
+
 }
@@ -38,6 +38,9 @@ class image_loader
 public:
     using result_type = std::shared_ptr<image>;
     static result_type load(const std::filesystem::path& path);
+
+    /* png, bmp or tga depending on the extension */
+    static bool save(const image& img, const std::filesystem::path& path);
 };
 
 }
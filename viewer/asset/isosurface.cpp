@@ -0,0 +1,353 @@
+#include "isosurface.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace asset
+{
+
+namespace detail
+{
+
+/* marching cubes tables: corner i of a cell lies at (i & 1, (i >> 1) & 1, (i >> 2) & 1), edge e runs from corner
+   edges[e][0] along axis axes[e]; triangles lists three edges per triangle for every inside / outside
+   configuration (bit i set = corner i inside) */
+struct mc_tables
+{
+    std::array<std::array<std::uint8_t, 2>, 12> edges;
+    std::array<std::uint8_t, 12> axes;
+    std::array<std::vector<std::uint8_t>, 256> triangles;
+
+    mc_tables()
+    {
+        /* edges grouped by axis */
+        std::array<std::array<int, 8>, 8> edge_of;
+        std::uint8_t count = 0;
+        for(std::uint8_t axis = 0; axis < 3; axis++)
+        {
+            for(std::uint8_t c = 0; c < 8; c++)
+            {
+                if(c & (1 << axis)) { continue; }
+
+                edges[count] = {c, static_cast<std::uint8_t>(c | (1 << axis))};
+                axes[count] = axis;
+                edge_of[c][c | (1 << axis)] = edge_of[c | (1 << axis)][c] = count;
+                count++;
+            }
+        }
+
+        /* faces with their corners counter clockwise seen from outside the cell: (u, v, axis) is right handed,
+           so the order (0,0) (1,0) (1,1) (0,1) in (u, v) is counter clockwise around +axis */
+        std::array<std::array<std::uint8_t, 4>, 6> faces;
+        for(int axis = 0; axis < 3; axis++)
+        {
+            const int u = 1 << ((axis + 1) % 3), v = 1 << ((axis + 2) % 3);
+            for(int side = 0; side < 2; side++)
+            {
+                const int w = side ? 1 << axis : 0;
+                std::array<std::uint8_t, 4> face = {static_cast<std::uint8_t>(w), static_cast<std::uint8_t>(w | u),
+                                                    static_cast<std::uint8_t>(w | u | v), static_cast<std::uint8_t>(w | v)};
+                if(!side) { std::reverse(face.begin(), face.end()); }
+                faces[2 * axis + side] = face;
+            }
+        }
+
+        /* edges of every face as bit mask */
+        std::array<unsigned int, 6> face_edges{};
+        for(int f = 0; f < 6; f++)
+        {
+            for(int i = 0; i < 4; i++)
+            {
+                face_edges[f] |= 1u << edge_of[faces[f][i]][faces[f][(i + 1) % 4]];
+            }
+        }
+
+        for(int config = 0; config < 256; config++)
+        {
+            auto inside = [&](int corner) { return (config >> corner) & 1; };
+
+            /* every face contributes one segment per run of inside corners, from the edge where the run starts
+               to the edge where it ends; ambiguous faces therefore always separate the inside corners, which
+               keeps neighbouring cells consistent. Each intersected edge is shared by two faces, so the
+               segments close into loops around the inside region */
+            std::array<int, 12> next;
+            next.fill(-1);
+            for(const auto& face : faces)
+            {
+                for(int i = 0; i < 4; i++)
+                {
+                    int a = face[i], b = face[(i + 1) % 4];
+                    if(!inside(a) || inside(b)) { continue; }
+
+                    int j = i;
+                    while(inside(face[(j + 3) % 4])) { j = (j + 3) % 4; }
+
+                    int enter = edge_of[face[(j + 3) % 4]][face[j]];
+                    next[enter] = edge_of[a][b];
+                }
+            }
+
+            /* fan triangulation of every loop, rooted such that as few diagonals as possible run across a cell
+               face (the neighbouring cell might use the same diagonal, which would duplicate a mesh edge) */
+            auto across_face = [&](int e0, int e1)
+            {
+                return std::any_of(face_edges.begin(), face_edges.end(), [&](const auto& f)
+                {
+                    return (f >> e0 & 1) && (f >> e1 & 1);
+                });
+            };
+
+            std::array<bool, 12> visited{};
+            for(int start = 0; start < 12; start++)
+            {
+                if(next[start] < 0 || visited[start]) { continue; }
+
+                std::vector<std::uint8_t> loop;
+                for(int e = start; !visited[e]; e = next[e])
+                {
+                    visited[e] = true;
+                    loop.push_back(static_cast<std::uint8_t>(e));
+                }
+
+                const std::size_t n = loop.size();
+                std::size_t root = 0, best = n;
+                for(std::size_t r = 0; r < n; r++)
+                {
+                    std::size_t crossing = 0;
+                    for(std::size_t k = 2; k + 1 < n; k++)
+                    {
+                        crossing += across_face(loop[r], loop[(r + k) % n]);
+                    }
+                    if(crossing < best) { best = crossing; root = r; }
+                }
+
+                for(std::size_t k = 1; k + 1 < n; k++)
+                {
+                    triangles[config].insert(triangles[config].end(), {loop[root], loop[(root + k) % n], loop[(root + k + 1) % n]});
+                }
+            }
+        }
+    }
+};
+
+inline const mc_tables& marching_cubes()
+{
+    static const mc_tables tables;
+    return tables;
+}
+
+/* output of one z slab; bottom / top hold the vertices on the first / last grid plane of the slab that lie on
+   x or y edges (the only ones shared with the neighbouring slab) as (planar edge key, local index) */
+struct isosurface_slab
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned int> indices;
+
+    std::vector<std::pair<std::size_t, unsigned int>> bottom;
+    std::vector<std::pair<std::size_t, unsigned int>> top;
+};
+
+/* cells in the layers [z0, z1); edge vertices of the lower and upper grid plane of the current layer are cached in
+   two planes of (x, y, axis) slots */
+template<typename T>
+void extract_slab(const volume& vol, float threshold, unsigned int z0, unsigned int z1, isosurface_slab& slab)
+{
+    constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+
+    const auto& tables = marching_cubes();
+    const glm::uvec3 size = vol.size();
+    const glm::vec3 scale = 1.0f / glm::vec3(size);
+    const std::size_t plane = static_cast<std::size_t>(size.x) * size.y;
+    const T* data = reinterpret_cast<const T*>(vol.ptr());
+
+    auto value = [&](unsigned int x, unsigned int y, unsigned int z) -> float
+    {
+        return static_cast<float>(data[z * plane + static_cast<std::size_t>(y) * size.x + x]);
+    };
+
+    /* central differences (one sided at the border) scaled into object space */
+    auto gradient = [&](unsigned int x, unsigned int y, unsigned int z) -> glm::vec3
+    {
+        glm::uvec3 lo(x > 0 ? x - 1 : x, y > 0 ? y - 1 : y, z > 0 ? z - 1 : z);
+        glm::uvec3 hi(std::min(x + 1, size.x - 1), std::min(y + 1, size.y - 1), std::min(z + 1, size.z - 1));
+
+        glm::vec3 difference(value(hi.x, y, z) - value(lo.x, y, z),
+                             value(x, hi.y, z) - value(x, lo.y, z),
+                             value(x, y, hi.z) - value(x, y, lo.z));
+        return difference / glm::vec3(glm::max(hi - lo, glm::uvec3(1))) * glm::vec3(size);
+    };
+
+    std::vector<unsigned int> lower(plane * 3, none), upper(plane * 3, none);
+
+    auto vertex = [&](unsigned int x, unsigned int y, unsigned int z, unsigned int axis, unsigned int layer) -> unsigned int
+    {
+        auto& cache = z == layer ? lower : upper;
+        const std::size_t key = (static_cast<std::size_t>(y) * size.x + x) * 3 + axis;
+        if(cache[key] != none) { return cache[key]; }
+
+        glm::uvec3 p0(x, y, z), p1 = p0;
+        p1[axis]++;
+
+        float v0 = value(p0.x, p0.y, p0.z), v1 = value(p1.x, p1.y, p1.z);
+        float t = std::clamp((threshold - v0) / (v1 - v0), 0.0f, 1.0f);
+
+        glm::vec3 position = glm::vec3(p0);
+        position[axis] += t;
+
+        glm::vec3 g = glm::mix(gradient(p0.x, p0.y, p0.z), gradient(p1.x, p1.y, p1.z), t);
+        float length = glm::length(g);
+
+        unsigned int index = static_cast<unsigned int>(slab.positions.size());
+        slab.positions.push_back((position + 0.5f) * scale - 0.5f);
+        slab.normals.push_back(length > 0.0f ? -g / length : glm::vec3(0.0f, 0.0f, 1.0f));
+        cache[key] = index;
+
+        /* x / y edges on the planes shared with the neighbouring slabs */
+        if(axis < 2 && z == z0) { slab.bottom.emplace_back(key, index); }
+        if(axis < 2 && z == z1) { slab.top.emplace_back(key, index); }
+
+        return index;
+    };
+
+    for(unsigned int z = z0; z < z1; z++)
+    {
+        for(unsigned int y = 0; y + 1 < size.y; y++)
+        {
+            for(unsigned int x = 0; x + 1 < size.x; x++)
+            {
+                unsigned int config = 0;
+                for(unsigned int c = 0; c < 8; c++)
+                {
+                    if(value(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1)) > threshold) { config |= 1u << c; }
+                }
+
+                const auto& triangles = tables.triangles[config];
+                for(auto e : triangles)
+                {
+                    unsigned int c = tables.edges[e][0];
+                    slab.indices.push_back(vertex(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1), tables.axes[e], z));
+                }
+            }
+        }
+
+        /* the upper plane becomes the lower plane of the next layer, its z edges are not computed yet */
+        std::swap(lower, upper);
+        std::fill(upper.begin(), upper.end(), none);
+    }
+}
+
+}
+
+
+/*========================== isosurface_loader ==========================*/
+isosurface isosurface_loader::extract(const volume& vol, float iso)
+{
+    isosurface surface;
+
+    const glm::uvec3 size = vol.size();
+    if(size.x < 2 || size.y < 2 || size.z < 2) { return surface; }
+
+    auto start = core::clock::now();
+
+    /* a few slabs per thread so that slabs crossing the surface (more work) are balanced */
+    const unsigned int layers = size.z - 1;
+    const unsigned int count = std::min(layers, core::hardware_threads() * 4);
+    const unsigned int depth = (layers + count - 1) / count;
+    const float max_value = vol.type() == voxel_type::uint8 ? 255.0f : 65535.0f;
+    const float threshold = std::clamp(iso, 0.0f, 1.0f) * max_value;
+
+    std::vector<detail::isosurface_slab> slabs(count);
+    core::parallel_for(0, count, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t s = begin; s < end; s++)
+        {
+            unsigned int z0 = static_cast<unsigned int>(s) * depth, z1 = std::min(z0 + depth, layers);
+            if(z0 >= z1) { continue; }
+
+            if(vol.type() == voxel_type::uint8)
+            {
+                detail::extract_slab<std::uint8_t>(vol, threshold, z0, z1, slabs[s]);
+            }
+            else
+            {
+                detail::extract_slab<std::uint16_t>(vol, threshold, z0, z1, slabs[s]);
+            }
+        }
+    });
+
+    auto extracted = core::clock::now();
+
+    /* global index of every slab vertex: vertices on the bottom plane of a slab reuse the ones on the top plane of
+       the slab below, everything else is appended */
+    constexpr unsigned int none = std::numeric_limits<unsigned int>::max();
+    std::vector<std::vector<unsigned int>> remap(count);
+    std::vector<std::size_t> index_offset(count + 1, 0);
+    std::vector<unsigned int> shared(static_cast<std::size_t>(size.x) * size.y * 3, none);
+
+    unsigned int vertices = 0;
+    for(unsigned int s = 0; s < count; s++)
+    {
+        auto& slab = slabs[s];
+        auto& map = remap[s];
+        map.assign(slab.positions.size(), none);
+
+        for(const auto& [key, local] : slab.bottom)
+        {
+            map[local] = shared[key];
+        }
+        for(auto& index : map)
+        {
+            if(index == none) { index = vertices++; }
+        }
+
+        std::fill(shared.begin(), shared.end(), none);
+        for(const auto& [key, local] : slab.top)
+        {
+            shared[key] = map[local];
+        }
+
+        index_offset[s + 1] = index_offset[s] + slab.indices.size();
+    }
+
+    surface.positions.resize(vertices);
+    surface.normals.resize(vertices);
+    surface.indices.resize(index_offset[count]);
+    core::parallel_for(0, count, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t s = begin; s < end; s++)
+        {
+            const auto& slab = slabs[s];
+            const auto& map = remap[s];
+            for(std::size_t i = 0; i < slab.positions.size(); i++)
+            {
+                surface.positions[map[i]] = slab.positions[i];
+                surface.normals[map[i]] = slab.normals[i];
+            }
+
+            for(std::size_t i = 0; i < slab.indices.size(); i++)
+            {
+                surface.indices[index_offset[s] + i] = map[slab.indices[i]];
+            }
+        }
+    });
+
+    auto merged = core::clock::now();
+    surface.extract_ms = core::time_cast<core::milli_sec>(extracted - start);
+    surface.merge_ms = core::time_cast<core::milli_sec>(merged - extracted);
+
+    platform_log(core::log::level::info, "[asset::isosurface] extracted {} vertices, {} triangles at iso {:.3f} from {} slabs in {:.1f} ms (merge {:.1f} ms)",
+                 surface.positions.size(), surface.indices.size() / 3, iso, count, surface.extract_ms, surface.merge_ms);
+
+    return surface;
+}
+
+}
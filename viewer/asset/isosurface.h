@@ -0,0 +1,66 @@
+#pragma once
+
+#include "model.h"
+#include "volume.h"
+#include "detail/obj_model.h"
+
+#include <glm/vec3.hpp>
+
+#include <memory>
+#include <vector>
+
+
+namespace asset
+{
+
+/*========================== isosurface ==========================*/
+/* indexed triangle soup of an iso surface in the object space of the raycaster (unit cube around the origin,
+   voxel centers at (i + 0.5) / size - 0.5); normals point from dense to sparse regions */
+struct isosurface
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned int> indices;
+
+    /* duration of the extraction and the merge of the slabs in milliseconds */
+    double extract_ms{0.0};
+    double merge_ms{0.0};
+};
+
+class isosurface_loader
+{
+public:
+    template<typename Data>
+    using result_type = std::shared_ptr<mesh<Data>>;
+
+    /* marching cubes over z slabs in parallel: every slab emits its own vertices (one per intersected edge) and
+       triangles, vertices on the planes shared by two slabs are merged afterwards; iso is a normalized value */
+    static isosurface extract(const volume& vol, float iso);
+
+    template<typename Data>
+    static result_type<Data> load(opengl::context& context, const isosurface& surface);
+};
+
+template<typename Data>
+isosurface_loader::result_type<Data> isosurface_loader::load(opengl::context& context, const isosurface& surface)
+{
+    static_assert(detail::has_member<Data>::position::value, "Vertex Type needs a position!");
+
+    std::vector<Data> vertices(surface.positions.size());
+    for(std::size_t i = 0; i < vertices.size(); i++)
+    {
+        vertices[i].position = surface.positions[i];
+
+        if constexpr (detail::has_member<Data>::normal::value)
+        {
+            vertices[i].normal = surface.normals[i];
+        }
+    }
+
+    auto vao = context.make_vertexarray();
+    auto vbo = context.make_vertexbuffer<Data>(vertices);
+    auto ibo = context.make_indexbuffer<unsigned int>(surface.indices);
+    return std::make_shared<mesh<Data>>("isosurface", vao, vbo, ibo);
+}
+
+}
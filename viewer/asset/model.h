@@ -107,6 +107,8 @@ public:
     }
 
     opengl::handle<opengl::vertexarray> vao() const { return m_vao; }
+    opengl::handle<opengl::vertexbuffer<VertexType>> vertexbuffer() const { return m_vertexbuffer; }
+    opengl::handle<opengl::indexbuffer<IndexType>> indexbuffer() const { return m_indexbuffer; }
 };
 
 /*========================== Material ==========================*/
@@ -120,6 +122,10 @@ public:
         mesh<Data>& m_mesh;
         IndexType m_offset;
         IndexType m_count;
+
+        /* object space bounds of the referenced vertices */
+        glm::vec3 m_min{0.0f};
+        glm::vec3 m_max{0.0f};
     };
 
 private:
@@ -0,0 +1,310 @@
+#include "mpr.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/simd.h"
+#include "viewer/core/time.h"
+#include "viewer/opengl/context.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace asset
+{
+
+namespace detail
+{
+
+template<typename T>
+void copy_mpr_slice(const volume& vol, const std::vector<std::size_t>& offset_x, const std::vector<std::size_t>& offset_y,
+                    std::size_t offset_z, unsigned int z, std::uint8_t* bricks)
+{
+    const auto& size = vol.size();
+    T* dst = reinterpret_cast<T*>(bricks);
+
+    for(unsigned int y = 0; y < size.y; y++)
+    {
+        const T* row = reinterpret_cast<const T*>(vol.slice(z)) + static_cast<std::size_t>(y) * size.x;
+        T* base = dst + offset_z + offset_y[y];
+
+        /* rows of one brick are contiguous */
+        for(unsigned int x = 0; x < size.x; x += mpr_volume::brick_size)
+        {
+            std::memcpy(base + offset_x[x], row + x, std::min(mpr_volume::brick_size, size.x - x) * sizeof(T));
+        }
+    }
+}
+
+}
+
+
+/*========================== mpr_volume ==========================*/
+mpr_volume::mpr_volume(const volume& vol)
+    : m_size(vol.size()), m_type(vol.type())
+{
+    auto start = core::clock::now();
+
+    constexpr std::size_t b = brick_size;
+    const glm::uvec3 bricks = (m_size + brick_size - 1u) / brick_size;
+    const std::size_t voxel_bytes = vol.voxel_bytes();
+
+    /* per axis address parts: brick index times brick stride plus position within the brick */
+    auto offsets = [&](std::vector<std::size_t>& offset, unsigned int n, std::size_t brick_stride, std::size_t voxel_stride)
+    {
+        offset.resize(n);
+        for(unsigned int i = 0; i < n; i++)
+        {
+            offset[i] = (i / b) * brick_stride + (i % b) * voxel_stride;
+        }
+    };
+    offsets(m_offset_x, m_size.x, b * b * b, 1);
+    offsets(m_offset_y, m_size.y, bricks.x * b * b * b, b);
+    offsets(m_offset_z, m_size.z, static_cast<std::size_t>(bricks.x) * bricks.y * b * b * b, b * b);
+
+    m_voxels.assign(static_cast<std::size_t>(bricks.x) * bricks.y * bricks.z * b * b * b * voxel_bytes, 0);
+
+    core::parallel_for(0, m_size.z, 4, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t z = begin; z < end; z++)
+        {
+            if(m_type == voxel_type::uint8)
+            {
+                detail::copy_mpr_slice<std::uint8_t>(vol, m_offset_x, m_offset_y, m_offset_z[z], static_cast<unsigned int>(z), m_voxels.data());
+            }
+            else
+            {
+                detail::copy_mpr_slice<std::uint16_t>(vol, m_offset_x, m_offset_y, m_offset_z[z], static_cast<unsigned int>(z), m_voxels.data());
+            }
+        }
+    });
+
+    platform_log(core::log::level::info, "[asset::mpr_volume] bricked {}x{}x{} voxels ({:.1f} MB) in {:.1f} ms",
+                 m_size.x, m_size.y, m_size.z, m_voxels.size() / (1024.0 * 1024.0), core::time_cast<core::milli_sec>(core::clock::now() - start));
+}
+
+void mpr_volume::resample(const plane& p, const window& w, image& img) const
+{
+    /* nothing to interpolate, black like positions outside the volume */
+    if(glm::any(glm::lessThan(m_size, glm::uvec3(2))))
+    {
+        std::fill_n(reinterpret_cast<color*>(img.ptr()), static_cast<std::size_t>(img.size().x) * img.size().y, color{0, 0, 0, 255});
+        return;
+    }
+
+    /* a few rows per block, every row is an independent line through the volume */
+    core::parallel_for(0, img.size().y, 8, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t row = begin; row < end; row++)
+        {
+            if(m_type == voxel_type::uint8)
+            {
+                resample_row<std::uint8_t>(p, w, img, static_cast<unsigned int>(row));
+            }
+            else
+            {
+                resample_row<std::uint16_t>(p, w, img, static_cast<unsigned int>(row));
+            }
+        }
+    });
+}
+
+float mpr_volume::sample(const glm::vec3& position) const
+{
+    if(glm::any(glm::lessThan(position, glm::vec3(0.0f))) || glm::any(glm::greaterThan(position, glm::vec3(1.0f)))) { return 0.0f; }
+
+    const glm::vec3 v = glm::clamp(position * glm::vec3(m_size) - 0.5f, glm::vec3(0.0f), glm::vec3(m_size - 1u));
+    const glm::uvec3 i = glm::min(glm::uvec3(v), m_size - 2u);
+    const glm::vec3 t = v - glm::vec3(i);
+
+    auto voxel = [&](unsigned int x, unsigned int y, unsigned int z) -> float
+    {
+        const std::size_t address = m_offset_x[x] + m_offset_y[y] + m_offset_z[z];
+        if(m_type == voxel_type::uint8) { return m_voxels[address] / 255.0f; }
+
+        std::uint16_t value;
+        std::memcpy(&value, m_voxels.data() + 2 * address, sizeof(value));
+        return value / 65535.0f;
+    };
+
+    float c00 = glm::mix(voxel(i.x, i.y, i.z), voxel(i.x + 1, i.y, i.z), t.x);
+    float c10 = glm::mix(voxel(i.x, i.y + 1, i.z), voxel(i.x + 1, i.y + 1, i.z), t.x);
+    float c01 = glm::mix(voxel(i.x, i.y, i.z + 1), voxel(i.x + 1, i.y, i.z + 1), t.x);
+    float c11 = glm::mix(voxel(i.x, i.y + 1, i.z + 1), voxel(i.x + 1, i.y + 1, i.z + 1), t.x);
+    return glm::mix(glm::mix(c00, c10, t.y), glm::mix(c01, c11, t.y), t.z);
+}
+
+const glm::uvec3& mpr_volume::size() const
+{
+    return m_size;
+}
+
+voxel_type mpr_volume::type() const
+{
+    return m_type;
+}
+
+template<typename T>
+void mpr_volume::resample_row(const plane& p, const window& w, image& img, unsigned int row) const
+{
+    const glm::uvec2 resolution = img.size();
+    const T* data = reinterpret_cast<const T*>(m_voxels.data());
+    color* out = reinterpret_cast<color*>(img.ptr()) + static_cast<std::size_t>(row) * resolution.x;
+
+    /* voxel coordinates of the first pixel center of the row and the step between pixels */
+    const glm::vec3 n(m_size);
+    const glm::vec3 ds = p.u / static_cast<float>(resolution.x);
+    const glm::vec3 start = p.center + (0.5f - (row + 0.5f) / resolution.y) * p.v - 0.5f * p.u + 0.5f * ds;
+    const glm::vec3 base = start * n - 0.5f;
+    const glm::vec3 step = ds * n;
+
+    /* window mapping of the raw values to [0, 255] */
+    const float width = std::max(w.width, 1e-6f);
+    const float scale = 255.0f / (static_cast<float>(std::numeric_limits<T>::max()) * width);
+    const float offset = -(w.level - 0.5f * width) * 255.0f / width;
+
+    unsigned int x = 0;
+#if defined(CORE_SIMD_SSE2)
+    /* four pixels at a time: coordinates, weights, lerps and windowing in simd, the eight corner fetches per pixel
+       are scalar gathers through the offset tables */
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 limit_lo = _mm_set1_ps(-0.5f);
+    const __m128 limit_hi[3] = {_mm_set1_ps(n.x - 0.5f), _mm_set1_ps(n.y - 0.5f), _mm_set1_ps(n.z - 0.5f)};
+    const __m128 last[3] = {_mm_set1_ps(n.x - 1.0f), _mm_set1_ps(n.y - 1.0f), _mm_set1_ps(n.z - 1.0f)};
+    const __m128 cell[3] = {_mm_set1_ps(n.x - 2.0f), _mm_set1_ps(n.y - 2.0f), _mm_set1_ps(n.z - 2.0f)};
+
+    for(; x + 4 <= resolution.x; x += 4)
+    {
+        const __m128 k = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        __m128 weight[3];
+        alignas(16) std::int32_t index[3][4];
+        for(int axis = 0; axis < 3; axis++)
+        {
+            __m128 v = _mm_add_ps(_mm_set1_ps(base[axis]), _mm_mul_ps(k, _mm_set1_ps(step[axis])));
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(v, limit_lo), _mm_cmple_ps(v, limit_hi[axis])));
+
+            /* clamp to edge, truncation equals floor for the clamped (positive) coordinates */
+            v = _mm_min_ps(_mm_max_ps(v, zero), last[axis]);
+            __m128 i = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(v)), cell[axis]);
+            weight[axis] = _mm_sub_ps(v, i);
+            _mm_store_si128(reinterpret_cast<__m128i*>(index[axis]), _mm_cvttps_epi32(i));
+        }
+
+        alignas(16) float corner[8][4];
+        for(int l = 0; l < 4; l++)
+        {
+            const std::size_t x0 = m_offset_x[index[0][l]], x1 = m_offset_x[index[0][l] + 1];
+            const std::size_t y0 = m_offset_y[index[1][l]], y1 = m_offset_y[index[1][l] + 1];
+            const std::size_t z0 = m_offset_z[index[2][l]], z1 = m_offset_z[index[2][l] + 1];
+
+            corner[0][l] = data[x0 + y0 + z0]; corner[1][l] = data[x1 + y0 + z0];
+            corner[2][l] = data[x0 + y1 + z0]; corner[3][l] = data[x1 + y1 + z0];
+            corner[4][l] = data[x0 + y0 + z1]; corner[5][l] = data[x1 + y0 + z1];
+            corner[6][l] = data[x0 + y1 + z1]; corner[7][l] = data[x1 + y1 + z1];
+        }
+
+        auto lerp = [](__m128 a, __m128 b, __m128 t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); };
+        __m128 c00 = lerp(_mm_load_ps(corner[0]), _mm_load_ps(corner[1]), weight[0]);
+        __m128 c10 = lerp(_mm_load_ps(corner[2]), _mm_load_ps(corner[3]), weight[0]);
+        __m128 c01 = lerp(_mm_load_ps(corner[4]), _mm_load_ps(corner[5]), weight[0]);
+        __m128 c11 = lerp(_mm_load_ps(corner[6]), _mm_load_ps(corner[7]), weight[0]);
+        __m128 value = lerp(lerp(c00, c10, weight[1]), lerp(c01, c11, weight[1]), weight[2]);
+
+        __m128 gray = _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(scale)), _mm_set1_ps(offset + 0.5f));
+        gray = _mm_and_ps(_mm_min_ps(_mm_max_ps(gray, zero), _mm_set1_ps(255.0f)), inside);
+
+        alignas(16) std::int32_t result[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(result), _mm_cvttps_epi32(gray));
+        for(int l = 0; l < 4; l++)
+        {
+            auto g = static_cast<std::uint8_t>(result[l]);
+            out[x + l] = {g, g, g, 255};
+        }
+    }
+#endif
+
+    for(; x < resolution.x; x++)
+    {
+        const glm::vec3 position = (base + static_cast<float>(x) * step + 0.5f) / n;
+        if(glm::any(glm::lessThan(position, glm::vec3(0.0f))) || glm::any(glm::greaterThan(position, glm::vec3(1.0f))))
+        {
+            out[x] = {0, 0, 0, 255};
+            continue;
+        }
+
+        const float value = sample(position) * std::numeric_limits<T>::max();
+        auto g = static_cast<std::uint8_t>(std::clamp(value * scale + offset + 0.5f, 0.0f, 255.0f));
+        out[x] = {g, g, g, 255};
+    }
+}
+
+
+/*========================== mpr_slice ==========================*/
+mpr_slice::mpr_slice(opengl::context& context, const glm::uvec2& resolution)
+    : m_image(resolution.x, resolution.y)
+{
+    m_texture = context.make_texture(opengl::texture_internal_type::rgba8, opengl::texture_format::rgba,
+                                     opengl::texture_type::unsigned_byte_, resolution.x, resolution.y);
+    m_texture->smooth(true);
+    m_texture->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+    m_texture->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+}
+
+void mpr_slice::plane(const mpr_volume::plane& p)
+{
+    m_dirty |= p != m_plane;
+    m_plane = p;
+}
+
+const mpr_volume::plane& mpr_slice::plane() const
+{
+    return m_plane;
+}
+
+void mpr_slice::window(const mpr_volume::window& w)
+{
+    m_dirty |= w != m_window;
+    m_window = w;
+}
+
+const mpr_volume::window& mpr_slice::window() const
+{
+    return m_window;
+}
+
+bool mpr_slice::update(const mpr_volume& volume)
+{
+    if(!m_dirty) { return false; }
+
+    auto start = core::clock::now();
+
+    volume.resample(m_plane, m_window, m_image);
+    m_texture->data(m_image.ptr());
+    m_dirty = false;
+
+    m_update_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    return true;
+}
+
+const image& mpr_slice::pixels() const
+{
+    return m_image;
+}
+
+const opengl::handle<opengl::texture>& mpr_slice::texture() const
+{
+    return m_texture;
+}
+
+double mpr_slice::update_ms() const
+{
+    return m_update_ms;
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "viewer/asset/image.h"
+#include "viewer/asset/volume.h"
+#include "viewer/opengl/texture.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace opengl { class context; }
+
+
+namespace asset
+{
+
+/*========================== mpr_volume ==========================*/
+/* copy of a volume in bricks of 8^3 voxels (original voxel type) for multiplanar reconstruction: a slice plane
+   through the volume touches few bricks per image row, so resampling stays cache friendly for any orientation.
+   Voxel addresses are the sum of three per axis offsets (brick and in-brick part), which keeps trilinear
+   footprints crossing a brick border cheap without an apron */
+class mpr_volume
+{
+public:
+    static constexpr unsigned int brick_size = 8;
+
+    /* plane in texture coordinates: pixel (s, t) in [0, 1]^2 (t from the top) lies at center + (s - 0.5) u + (0.5 - t) v */
+    struct plane
+    {
+        glm::vec3 center{0.5f, 0.5f, 0.5f};
+        glm::vec3 u{1.0f, 0.0f, 0.0f};
+        glm::vec3 v{0.0f, 1.0f, 0.0f};
+
+        bool operator==(const plane&) const = default;
+    };
+
+    /* display window over the normalized values (level = center, width) */
+    struct window
+    {
+        float level{0.5f};
+        float width{1.0f};
+
+        bool operator==(const window&) const = default;
+    };
+
+private:
+    glm::uvec3 m_size;
+    voxel_type m_type;
+
+    std::vector<std::uint8_t> m_voxels;
+    std::vector<std::size_t> m_offset_x;
+    std::vector<std::size_t> m_offset_y;
+    std::vector<std::size_t> m_offset_z;
+
+public:
+    explicit mpr_volume(const volume& vol);
+
+    /* resamples the plane into img (trilinear, rows in parallel), positions outside the volume are black */
+    void resample(const plane& p, const window& w, image& img) const;
+
+    float sample(const glm::vec3& position) const;
+
+    const glm::uvec3& size() const;
+    voxel_type type() const;
+
+private:
+    template<typename T>
+    void resample_row(const plane& p, const window& w, image& img, unsigned int row) const;
+};
+
+
+/*========================== mpr_slice ==========================*/
+/* one slice view with its image and texture, resampled only when its plane or window changed */
+class mpr_slice
+{
+private:
+    mpr_volume::plane m_plane;
+    mpr_volume::window m_window;
+    bool m_dirty{true};
+
+    image m_image;
+    opengl::handle<opengl::texture> m_texture;
+    double m_update_ms{0.0};
+
+public:
+    mpr_slice(opengl::context& context, const glm::uvec2& resolution);
+
+    void plane(const mpr_volume::plane& p);
+    const mpr_volume::plane& plane() const;
+    void window(const mpr_volume::window& w);
+    const mpr_volume::window& window() const;
+
+    /* returns true if the slice was resampled and uploaded */
+    bool update(const mpr_volume& volume);
+
+    const image& pixels() const;
+    const opengl::handle<opengl::texture>& texture() const;
+    double update_ms() const;
+};
+
+}
@@ -5,8 +5,11 @@
 #include "viewer/core/log.h"
 
 #include <tiny_obj_loader/tiny_obj_loader.h>
+#include <glm/common.hpp>
 #include <glm/geometric.hpp>
 
+#include <limits>
+
 namespace asset
 {
 
@@ -198,8 +201,15 @@ public:
                         continue;
                     }
 
+                    glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+                    for(auto index : indices[name])
+                    {
+                        lo = glm::min(lo, glm::vec3(vertices[index].position));
+                        hi = glm::max(hi, glm::vec3(vertices[index].position));
+                    }
+
                     auto& asset_material = (*it).second;
-                    asset_material.m_records.emplace_back(asset_mesh, offset.x, offset.y);
+                    asset_material.m_records.emplace_back(asset_mesh, offset.x, offset.y, lo, hi);
                 }
             }
             else if(shape.points.indices.size() > 0)
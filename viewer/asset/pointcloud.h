@@ -2,7 +2,13 @@
 
 #include "model.h"
 #include "viewer/asset/detail/obj_model.h"
+#include "viewer/asset/detail/las.h"
 #include "viewer/core/log.h"
+#include "viewer/core/mapped_file.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+
+#include <future>
 
 #include <tiny_obj_loader/tiny_obj_loader.h>
 #include <tiny_ply/source/tinyply.h>
@@ -237,6 +243,116 @@ public:
 
         return nullptr;
     }
+
+    /* uncompressed LAS (point formats 0-3, 6-8); the file is memory mapped and decoded in chunks on all
+       threads while the previous chunk is uploaded, positions are recentered around the bounding box center */
+    static result_type load_las(opengl::context& context, const std::filesystem::path& path)
+    {
+        static_assert(detail::has_member<Data>::position::value, "Vertex Type needs a position!");
+
+        if(!std::filesystem::exists(path))
+        {
+            platform_log(core::log::level::error, "Cannot find las file {}", path.string());
+            return nullptr;
+        }
+
+        auto start = core::clock::now();
+
+        core::mapped_file file(path);
+        if(!file.is_open())
+        {
+            return nullptr;
+        }
+        file.sequential();
+
+        detail::las::header header;
+        std::string error;
+        if(!detail::las::parse_header(file.data(), file.size(), header, error))
+        {
+            platform_log(core::log::level::error, "{} ( {} )", error, path.string());
+            return nullptr;
+        }
+
+        std::size_t available = (file.size() - header.point_offset) / header.record_length;
+        if(header.num_points > available)
+        {
+            platform_log(core::log::level::warning, "las file is truncated, reading {} of {} points ( {} )", available, header.num_points, path.string());
+            header.num_points = available;
+        }
+
+        if(header.num_points == 0)
+        {
+            platform_log(core::log::level::error, "{} does not contain points!", path.string());
+            return nullptr;
+        }
+
+        auto color_offset = detail::las::rgb_offset(header.point_format);
+        if constexpr (detail::has_member<Data>::color::value)
+        {
+            if(color_offset == 0)
+            {
+                platform_log(core::log::level::warning, "las point format {} does not include color values, but was requested ( {} )", header.point_format, path.string());
+            }
+        }
+
+        /* float precision is not sufficient for georeferenced coordinates; fold the shift into the offset */
+        glm::dvec3 center = 0.5 * (header.min + header.max);
+        glm::dvec3 offset = header.offset - center;
+        platform_log(core::log::level::info, "las file recentered by ({}, {}, {}) ( {} )", -center.x, -center.y, -center.z, path.string());
+
+        constexpr std::size_t chunk_size = 1 << 20;
+        constexpr std::size_t grain = 1 << 14;
+
+        const std::uint8_t* records = file.data() + header.point_offset;
+        const std::size_t stride = header.record_length;
+        const std::size_t num_points = header.num_points;
+
+        float color_scale = 1.0f;
+        if(color_offset > 0)
+        {
+            color_scale = detail::las::color_scale(records, stride, std::min(num_points, chunk_size), color_offset);
+        }
+
+        auto decode_chunk = [&](std::size_t first, std::vector<Data>& chunk)
+        {
+            std::size_t count = std::min(chunk_size, num_points - first);
+            chunk.resize(count);
+
+            core::parallel_for(0, count, grain, [&](std::size_t begin, std::size_t end)
+            {
+                detail::las::decode(records + (first + begin) * stride, stride, end - begin,
+                                    header.scale, offset, color_offset, color_scale, chunk.data() + begin);
+            });
+        };
+
+        auto vao = context.make_vertexarray();
+        auto vertexbuffer = context.make_vertexbuffer<Data>(num_points);
+
+        /* decode chunk n+1 while chunk n is transferred to the gpu (gl calls stay on this thread) */
+        std::vector<Data> chunks[2];
+        decode_chunk(0, chunks[0]);
+
+        for(std::size_t first = 0, current = 0; first < num_points; first += chunk_size, current ^= 1)
+        {
+            std::future<void> next;
+            if(first + chunk_size < num_points)
+            {
+                next = std::async(std::launch::async, decode_chunk, first + chunk_size, std::ref(chunks[current ^ 1]));
+            }
+
+            auto& chunk = chunks[current];
+            vertexbuffer->data(static_cast<unsigned int>(first), chunk.data(), static_cast<unsigned int>(chunk.size()));
+
+            if(next.valid()) { next.wait(); }
+        }
+
+        auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+        platform_log(core::log::level::info, "loaded {} points in {:.1f} ms ({:.1f} MB/s) ( {} )", num_points, elapsed,
+                     (num_points * stride) / (1024.0 * 1024.0) / (elapsed / 1000.0), path.string());
+
+        auto asset_cloud = std::make_shared<pointcloud<Data>>(vao, vertexbuffer);
+        return asset_cloud;
+    }
 };
 
 }
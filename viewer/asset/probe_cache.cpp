@@ -0,0 +1,394 @@
+#include "probe_cache.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+#include "viewer/opengl/buffer.h"
+#include "viewer/opengl/fence.h"
+
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+/* zlib compressor of stb_image_write (defined in stb_impl.cpp, not declared by the header) */
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+namespace asset
+{
+
+namespace detail
+{
+
+constexpr char probe_magic[4] = {'P', 'R', 'B', 'E'};
+constexpr std::uint32_t probe_version = 1;
+constexpr std::size_t probe_header_size = 52;
+
+struct probe_header
+{
+    std::uint32_t version;
+    std::uint32_t size;
+    std::uint64_t scene;
+    std::uint64_t probe;
+    std::uint32_t compressed[6];
+};
+static_assert(sizeof(detail::probe_magic) + sizeof(probe_header) == probe_header_size, "unexpected probe header padding");
+
+constexpr opengl::cube_face face(int i)
+{
+    return static_cast<opengl::cube_face>(static_cast<int>(opengl::cube_face::positive_x) + i);
+}
+
+}
+
+/*========================== probe_cache ==========================*/
+probe_cache::probe_cache(opengl::context& context, const std::filesystem::path& directory, std::uint64_t scene_hash)
+    : m_context(context), m_directory(directory), m_scene(scene_hash)
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if(error)
+    {
+        platform_log(core::log::level::error, "[asset::probe_cache] Couldn't create directory {0}", m_directory.string());
+    }
+
+    m_worker = std::thread(&probe_cache::write_jobs, this);
+}
+
+probe_cache::~probe_cache()
+{
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_condition.notify_all();
+    m_worker.join();
+}
+
+std::filesystem::path probe_cache::path(std::uint64_t probe_hash) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.probe", static_cast<unsigned long long>(hash(&probe_hash, sizeof(probe_hash), m_scene)));
+    return m_directory / name;
+}
+
+bool probe_cache::load(std::uint64_t probe_hash, opengl::texture_cube& cube)
+{
+    auto start = core::clock::now();
+
+    std::ifstream file(path(probe_hash), std::ios::binary);
+    if(!file) { return false; }
+
+    char magic[sizeof(detail::probe_magic)];
+    detail::probe_header header;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    const unsigned int size = cube.size(opengl::cube_face::positive_x).x;
+    if(!file || std::memcmp(magic, detail::probe_magic, sizeof(magic)) != 0 || header.version != detail::probe_version)
+    {
+        platform_log(core::log::level::warning, "[asset::probe_cache] Ignoring invalid probe file {0}", path(probe_hash).string());
+        return false;
+    }
+    if(header.scene != m_scene || header.probe != probe_hash || header.size != size)
+    {
+        return false;
+    }
+
+    std::array<std::vector<char>, 6> streams;
+    for(int i = 0; i < 6; i++)
+    {
+        streams[i].resize(header.compressed[i]);
+        file.read(streams[i].data(), header.compressed[i]);
+    }
+    if(!file)
+    {
+        platform_log(core::log::level::warning, "[asset::probe_cache] Truncated probe file {0}", path(probe_hash).string());
+        return false;
+    }
+
+    /* faces are independent streams, inflated in parallel */
+    const std::size_t face_bytes = static_cast<std::size_t>(size) * size * 4;
+    std::vector<std::uint8_t> pixels(6 * face_bytes);
+    std::array<int, 6> inflated;
+    core::parallel_for(0, 6, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; i++)
+        {
+            inflated[i] = stbi_zlib_decode_buffer(reinterpret_cast<char*>(pixels.data() + i * face_bytes), static_cast<int>(face_bytes),
+                                                  streams[i].data(), static_cast<int>(streams[i].size()));
+        }
+    });
+
+    if(std::any_of(inflated.begin(), inflated.end(), [&](int bytes){ return bytes != static_cast<int>(face_bytes); }))
+    {
+        platform_log(core::log::level::warning, "[asset::probe_cache] Corrupt probe file {0}", path(probe_hash).string());
+        return false;
+    }
+
+    for(int i = 0; i < 6; i++)
+    {
+        cube.data(detail::face(i), pixels.data() + i * face_bytes, size, size);
+    }
+
+    auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.loaded++;
+        m_stats.load_ms += elapsed;
+    }
+
+    platform_log(core::log::level::info, "[asset::probe_cache] loaded probe {:016x} ({}^2) in {:.1f} ms", probe_hash, size, elapsed);
+    return true;
+}
+
+void probe_cache::store(std::uint64_t probe_hash, const opengl::texture_cube& cube)
+{
+    if(cube.internal_format_type() != opengl::texture_internal_type::rgba8)
+    {
+        platform_log(core::log::level::error, "[asset::probe_cache] Only rgba8 cube maps can be baked");
+        return;
+    }
+
+    /* a newer capture of the same probe replaces one still in flight */
+    m_readbacks.erase(std::remove_if(m_readbacks.begin(), m_readbacks.end(), [&](const auto& r){ return r.probe == probe_hash; }), m_readbacks.end());
+
+    const unsigned int size = cube.size(opengl::cube_face::positive_x).x;
+    const std::size_t face_bytes = static_cast<std::size_t>(size) * size * 4;
+
+    readback r{probe_hash, size, m_context.make_buffer<std::uint8_t>(opengl::buffer_target::pixel_pack, 6 * face_bytes, opengl::buffer_usage::stream_read), m_context.make_fence()};
+
+    /* asynchronous copies into the bound pack buffer (pixels are offsets) */
+    r.staging->bind();
+    for(int i = 0; i < 6; i++)
+    {
+        cube.read(detail::face(i), 0, reinterpret_cast<unsigned char*>(i * face_bytes));
+    }
+    r.staging->unbind();
+    r.fence->insert();
+
+    m_readbacks.push_back(std::move(r));
+}
+
+void probe_cache::update()
+{
+    for(auto it = m_readbacks.begin(); it != m_readbacks.end();)
+    {
+        if(!it->fence->signaled())
+        {
+            ++it;
+            continue;
+        }
+
+        auto start = core::clock::now();
+
+        job j{it->probe, it->size, std::vector<std::uint8_t>(6 * static_cast<std::size_t>(it->size) * it->size * 4)};
+        const auto* src = it->staging->map(opengl::buffer_access::read);
+        if(src)
+        {
+            std::memcpy(j.pixels.data(), src, j.pixels.size());
+            it->staging->unmap();
+        }
+        else
+        {
+            platform_log(core::log::level::error, "[asset::probe_cache] Unable to map pixel pack buffer of probe {:016x}", it->probe);
+        }
+        it->staging->unbind();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.readback_ms += core::time_cast<core::milli_sec>(core::clock::now() - start);
+            if(src) { m_jobs.push_back(std::move(j)); }
+        }
+        m_condition.notify_one();
+
+        it = m_readbacks.erase(it);
+    }
+}
+
+void probe_cache::flush()
+{
+    for(auto& r : m_readbacks)
+    {
+        r.fence->wait(std::numeric_limits<std::uint64_t>::max());
+    }
+    update();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [&](){ return m_jobs.empty() && m_writing == 0; });
+}
+
+std::size_t probe_cache::prune(const std::vector<std::uint64_t>& probe_hashes)
+{
+    std::vector<std::filesystem::path> keep;
+    for(auto probe : probe_hashes)
+    {
+        keep.push_back(path(probe).filename());
+    }
+
+    std::error_code error;
+    std::size_t removed = 0;
+    for(const auto& entry : std::filesystem::directory_iterator(m_directory, error))
+    {
+        const auto& file = entry.path();
+        if(file.extension() != ".probe" || std::find(keep.begin(), keep.end(), file.filename()) != keep.end()) { continue; }
+
+        std::error_code remove_error;
+        if(std::filesystem::remove(file, remove_error)) { removed++; }
+    }
+
+    if(removed > 0)
+    {
+        platform_log(core::log::level::info, "[asset::probe_cache] removed {} stale probe files", removed);
+    }
+    return removed;
+}
+
+probe_cache::statistics probe_cache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto result = m_stats;
+    result.pending = m_readbacks.size() + m_jobs.size() + m_writing;
+    return result;
+}
+
+std::uint64_t probe_cache::hash(const void* data, std::size_t bytes, std::uint64_t seed)
+{
+    const auto* p = static_cast<const std::uint8_t*>(data);
+    for(std::size_t i = 0; i < bytes; i++)
+    {
+        seed = (seed ^ p[i]) * 1099511628211ull;
+    }
+    return seed;
+}
+
+std::uint64_t probe_cache::hash_files(const std::vector<std::filesystem::path>& files, std::uint64_t seed)
+{
+    for(const auto& file : files)
+    {
+        const auto name = file.generic_string();
+        seed = hash(name.data(), name.size(), seed);
+
+        std::error_code error;
+        std::uint64_t size = std::filesystem::file_size(file, error);
+        if(error)
+        {
+            platform_log(core::log::level::warning, "[asset::probe_cache] Scene file {0} not found", file.string());
+            continue;
+        }
+
+        auto time = std::filesystem::last_write_time(file, error).time_since_epoch().count();
+        seed = hash(&size, sizeof(size), seed);
+        seed = hash(&time, sizeof(time), seed);
+    }
+
+    return seed;
+}
+
+void probe_cache::write_jobs()
+{
+    while(true)
+    {
+        job j;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&](){ return m_quit || !m_jobs.empty(); });
+            if(m_jobs.empty()) { return; }
+
+            j = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_writing++;
+        }
+
+        write(j);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_writing--;
+        }
+        m_idle.notify_all();
+    }
+}
+
+bool probe_cache::write(const job& j)
+{
+    auto start = core::clock::now();
+
+    /* faces are deflated in parallel */
+    const std::size_t face_bytes = static_cast<std::size_t>(j.size) * j.size * 4;
+    std::array<unsigned char*, 6> streams{};
+    std::array<int, 6> lengths{};
+    core::parallel_for(0, 6, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; i++)
+        {
+            streams[i] = stbi_zlib_compress(const_cast<unsigned char*>(j.pixels.data() + i * face_bytes), static_cast<int>(face_bytes), &lengths[i], 5);
+        }
+    });
+
+    detail::probe_header header{detail::probe_version, j.size, m_scene, j.probe, {}};
+    bool compressed = true;
+    for(int i = 0; i < 6; i++)
+    {
+        compressed &= streams[i] != nullptr;
+        header.compressed[i] = static_cast<std::uint32_t>(lengths[i]);
+    }
+
+    /* written next to the target and renamed, a crash never leaves a partial probe file behind */
+    const auto target = path(j.probe);
+    auto temporary = target;
+    temporary += ".tmp";
+
+    bool result = false;
+    if(compressed)
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(detail::probe_magic, sizeof(detail::probe_magic));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for(int i = 0; i < 6; i++)
+        {
+            file.write(reinterpret_cast<const char*>(streams[i]), lengths[i]);
+        }
+        file.close();
+
+        std::error_code error;
+        if(file) { std::filesystem::rename(temporary, target, error); }
+        result = file && !error;
+    }
+
+    for(auto* stream : streams)
+    {
+        std::free(stream);
+    }
+
+    if(!result)
+    {
+        platform_log(core::log::level::error, "[asset::probe_cache] Failed writing {0}", target.string());
+        return false;
+    }
+
+    std::size_t file_bytes = detail::probe_header_size;
+    for(auto length : lengths) { file_bytes += length; }
+
+    auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.baked++;
+        m_stats.raw_bytes += j.pixels.size();
+        m_stats.file_bytes += file_bytes;
+        m_stats.compress_ms += elapsed;
+    }
+
+    platform_log(core::log::level::info, "[asset::probe_cache] baked probe {:016x} ({:.1f} MB -> {:.1f} MB) in {:.1f} ms ( {} )",
+                 j.probe, j.pixels.size() / (1024.0 * 1024.0), file_bytes / (1024.0 * 1024.0), elapsed, target.string());
+    return true;
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "viewer/opengl/context.h"
+#include "viewer/opengl/texturecube.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace opengl { class fence; template<typename T> class buffer; }
+
+
+namespace asset
+{
+
+/*========================== probe_cache ==========================*/
+/* baked rgba8 cube maps of static reflection probes: a probe is rendered once, its faces are read back through a
+   pixel pack buffer (polled with a fence, the render thread never waits on the gpu) and compressed and written by
+   a worker thread; later runs upload the file instead of rendering the scene as long as scene and probe hash match
+
+   file layout: header (52 bytes: magic, version, face size, scene hash, probe hash, compressed size per face),
+   followed by one zlib stream per face (+x, -x, +y, -y, +z, -z) */
+class probe_cache
+{
+public:
+    static constexpr std::uint64_t hash_seed = 14695981039346656037ull;
+
+    struct statistics
+    {
+        std::size_t loaded{0};
+        std::size_t baked{0};
+        std::size_t pending{0};
+        std::size_t raw_bytes{0};
+        std::size_t file_bytes{0};
+        double load_ms{0.0};
+        double readback_ms{0.0};
+        double compress_ms{0.0};
+    };
+
+private:
+    /* faces on their way from the gpu */
+    struct readback
+    {
+        std::uint64_t probe;
+        unsigned int size;
+        opengl::handle<opengl::buffer<std::uint8_t>> staging;
+        opengl::handle<opengl::fence> fence;
+    };
+
+    /* faces on their way to the disk */
+    struct job
+    {
+        std::uint64_t probe;
+        unsigned int size;
+        std::vector<std::uint8_t> pixels;
+    };
+
+    opengl::context& m_context;
+    std::filesystem::path m_directory;
+    std::uint64_t m_scene;
+
+    std::vector<readback> m_readbacks;
+
+    std::thread m_worker;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_idle;
+    bool m_quit{false};
+    std::deque<job> m_jobs;
+    std::size_t m_writing{0};
+
+    statistics m_stats;
+
+public:
+    probe_cache(opengl::context& context, const std::filesystem::path& directory, std::uint64_t scene_hash);
+    ~probe_cache();
+
+    probe_cache(const probe_cache&) = delete;
+    probe_cache& operator=(const probe_cache&) = delete;
+
+    std::filesystem::path path(std::uint64_t probe_hash) const;
+
+    /* uploads the baked faces into level 0 of an rgba8 cube map of the same size; false if there is no file for
+       this probe or it was baked for another scene */
+    bool load(std::uint64_t probe_hash, opengl::texture_cube& cube);
+
+    /* queues the read back of level 0 of an rgba8 cube map, written once the gpu finished rendering it */
+    void store(std::uint64_t probe_hash, const opengl::texture_cube& cube);
+
+    /* hands finished read backs to the writer without waiting */
+    void update();
+
+    /* blocks until every queued probe is written */
+    void flush();
+
+    /* removes every probe file of the directory except the given probes of this scene (files of earlier placements
+       or scene versions), returns the number of removed files */
+    std::size_t prune(const std::vector<std::uint64_t>& probe_hashes);
+
+    statistics stats() const;
+
+    /* fnv-1a, chained through seed */
+    static std::uint64_t hash(const void* data, std::size_t bytes, std::uint64_t seed = hash_seed);
+
+    /* path, size and modification time of every file (cheap change detection of scene sources) */
+    static std::uint64_t hash_files(const std::vector<std::filesystem::path>& files, std::uint64_t seed = hash_seed);
+
+private:
+    void write_jobs();
+    bool write(const job& j);
+};
+
+}
@@ -0,0 +1,159 @@
+#include "spherical_harmonics.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace asset
+{
+
+namespace detail
+{
+
+/* direction through texel (s, t) in [0, 1]^2 of a cube map face (same mapping as the gl cube map lookup) */
+inline glm::vec3 cube_direction(int face, float s, float t)
+{
+    const float u = 2.0f * s - 1.0f;
+    const float v = 2.0f * t - 1.0f;
+
+    switch(face)
+    {
+    case 0:  return { 1.0f,   -v,   -u};
+    case 1:  return {-1.0f,   -v,    u};
+    case 2:  return {    u, 1.0f,    v};
+    case 3:  return {    u,-1.0f,   -v};
+    case 4:  return {    u,   -v, 1.0f};
+    default: return {   -u,   -v,-1.0f};
+    }
+}
+
+struct sh_sum
+{
+    std::array<glm::dvec3, 9> radiance{};
+    double weight{0.0};
+};
+
+}
+
+std::array<float, 9> sh_coefficients::basis(const glm::vec3& d)
+{
+    return {
+        0.282095f,
+        0.488603f * d.y,
+        0.488603f * d.z,
+        0.488603f * d.x,
+        1.092548f * d.x * d.y,
+        1.092548f * d.y * d.z,
+        0.315392f * (3.0f * d.z * d.z - 1.0f),
+        1.092548f * d.x * d.z,
+        0.546274f * (d.x * d.x - d.y * d.y)
+    };
+}
+
+glm::vec3 sh_coefficients::irradiance(const glm::vec3& normal) const
+{
+    /* clamped cosine convolution per band */
+    constexpr float band[3] = {glm::pi<float>(), 2.0f * glm::pi<float>() / 3.0f, glm::pi<float>() / 4.0f};
+    constexpr int band_of[9] = {0, 1, 1, 1, 2, 2, 2, 2, 2};
+
+    auto y = basis(glm::normalize(normal));
+    glm::vec3 result(0.0f);
+    for(int i = 0; i < 9; i++)
+    {
+        result += band[band_of[i]] * radiance[i] * y[i];
+    }
+
+    return glm::max(result, glm::vec3(0.0f));
+}
+
+sh_coefficients sh_projection::project(const std::array<const glm::u8vec4*, 6>& faces, unsigned int size)
+{
+    auto start = core::clock::now();
+
+    /* one partial sum per face row, summed in a fixed order afterwards (deterministic result) */
+    std::vector<detail::sh_sum> rows(6 * static_cast<std::size_t>(size));
+    core::parallel_for(0, rows.size(), 16, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t row = begin; row < end; row++)
+        {
+            const int face = static_cast<int>(row / size);
+            const unsigned int y = static_cast<unsigned int>(row % size);
+            const float t = (y + 0.5f) / size;
+            const glm::u8vec4* texels = faces[face] + static_cast<std::size_t>(y) * size;
+
+            auto& sum = rows[row];
+            for(unsigned int x = 0; x < size; x++)
+            {
+                const float s = (x + 0.5f) / size;
+                glm::vec3 direction = detail::cube_direction(face, s, t);
+
+                /* solid angle of the texel relative to its area on the face */
+                const float length2 = glm::dot(direction, direction);
+                const double weight = 1.0 / (length2 * std::sqrt(length2));
+
+                glm::dvec3 color = glm::dvec3(glm::vec3(texels[x]) / 255.0f) * weight;
+                auto y_lm = sh_coefficients::basis(direction / std::sqrt(length2));
+                for(int i = 0; i < 9; i++)
+                {
+                    sum.radiance[i] += color * static_cast<double>(y_lm[i]);
+                }
+                sum.weight += weight;
+            }
+        }
+    });
+
+    detail::sh_sum total;
+    for(const auto& row : rows)
+    {
+        for(int i = 0; i < 9; i++)
+        {
+            total.radiance[i] += row.radiance[i];
+        }
+        total.weight += row.weight;
+    }
+
+    /* the weights sum to the full sphere */
+    sh_coefficients result;
+    const double normalization = 4.0 * glm::pi<double>() / total.weight;
+    for(int i = 0; i < 9; i++)
+    {
+        result.radiance[i] = glm::vec3(total.radiance[i] * normalization);
+    }
+    result.project_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+
+    return result;
+}
+
+sh_coefficients sh_projection::project(const opengl::texture_cube& cube, unsigned int level)
+{
+    auto start = core::clock::now();
+
+    if(cube.internal_format_type() != opengl::texture_internal_type::rgba8)
+    {
+        platform_log(core::log::level::error, "[asset::sh_projection] Only rgba8 cube maps can be read back for projection");
+        return {};
+    }
+
+    const unsigned int size = std::max(cube.sizes()[0].x >> level, 1u);
+    std::vector<glm::u8vec4> pixels(6 * static_cast<std::size_t>(size) * size);
+
+    std::array<const glm::u8vec4*, 6> faces;
+    for(int face = 0; face < 6; face++)
+    {
+        auto* dst = pixels.data() + face * static_cast<std::size_t>(size) * size;
+        cube.read(static_cast<opengl::cube_face>(static_cast<int>(opengl::cube_face::positive_x) + face), level, reinterpret_cast<unsigned char*>(dst));
+        faces[face] = dst;
+    }
+
+    auto result = project(faces, size);
+    result.project_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    return result;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "viewer/opengl/texturecube.h"
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <array>
+#include <cstdint>
+
+
+namespace asset
+{
+
+/*========================== spherical harmonics ==========================*/
+/* order 2 (nine coefficient) projection of the radiance of a cube map, enough for diffuse irradiance */
+struct sh_coefficients
+{
+    std::array<glm::vec3, 9> radiance{};
+
+    /* duration of the projection in milliseconds */
+    double project_ms{0.0};
+
+    /* irradiance around a normal (radiance convolved with the clamped cosine) */
+    glm::vec3 irradiance(const glm::vec3& normal) const;
+
+    /* real sh basis of band 0 - 2 in the order of the coefficients */
+    static std::array<float, 9> basis(const glm::vec3& direction);
+};
+
+class sh_projection
+{
+public:
+    /* cpu projection of six rgba8 faces of size^2 texels (directions as defined for GL cube maps), rows of faces
+       are distributed over all hardware threads and weighted by their texel solid angle */
+    static sh_coefficients project(const std::array<const glm::u8vec4*, 6>& faces, unsigned int size);
+
+    /* reads back one level of an rgba8 cube map and projects it on the cpu */
+    static sh_coefficients project(const opengl::texture_cube& cube, unsigned int level);
+};
+
+}
@@ -0,0 +1,265 @@
+#include "transfer_function.h"
+
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+#include "viewer/opengl/context.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace asset
+{
+
+/*========================== transfer_function ==========================*/
+transfer_function::transfer_function()
+    : m_points{ {0.0f, {0.0f, 0.0f, 0.0f, 0.0f}}, {1.0f, {1.0f, 1.0f, 1.0f, 0.5f}} }
+{
+
+}
+
+const std::vector<transfer_function::point>& transfer_function::points() const
+{
+    return m_points;
+}
+
+std::size_t transfer_function::add(float position, const glm::vec4& color)
+{
+    position = std::clamp(position, 0.0f, 1.0f);
+    auto it = std::upper_bound(m_points.begin(), m_points.end(), position, [](float value, const point& p)
+    {
+        return value < p.position;
+    });
+
+    std::size_t index = std::distance(m_points.begin(), m_points.insert(it, {position, color}));
+    auto range = support(index);
+    invalidate(range.x, range.y);
+
+    return index;
+}
+
+void transfer_function::remove(std::size_t index)
+{
+    if(index >= m_points.size()) { return; }
+
+    auto range = support(index);
+    m_points.erase(m_points.begin() + index);
+    invalidate(range.x, range.y);
+}
+
+std::size_t transfer_function::move(std::size_t index, float position, float opacity)
+{
+    if(index >= m_points.size()) { return index; }
+
+    auto before = support(index);
+
+    point p = m_points[index];
+    p.color.a = std::clamp(opacity, 0.0f, 1.0f);
+    m_points.erase(m_points.begin() + index);
+    index = add(position, p.color);
+
+    invalidate(before.x, before.y);
+    return index;
+}
+
+void transfer_function::color(std::size_t index, const glm::vec3& color)
+{
+    if(index >= m_points.size()) { return; }
+
+    m_points[index].color = glm::vec4(color, m_points[index].color.a);
+    auto range = support(index);
+    invalidate(range.x, range.y);
+}
+
+glm::vec4 transfer_function::evaluate(float value) const
+{
+    if(m_points.empty()) { return glm::vec4(0.0f); }
+    if(value <= m_points.front().position) { return m_points.front().color; }
+    if(value >= m_points.back().position) { return m_points.back().color; }
+
+    auto it = std::upper_bound(m_points.begin(), m_points.end(), value, [](float v, const point& p)
+    {
+        return v < p.position;
+    });
+
+    const auto& b = *it;
+    const auto& a = *(it - 1);
+    float t = b.position > a.position ? (value - a.position) / (b.position - a.position) : 0.0f;
+    return glm::mix(a.color, b.color, t);
+}
+
+float transfer_function::first_visible() const
+{
+    for(std::size_t i = 0; i < m_points.size(); i++)
+    {
+        if(m_points[i].color.a > 0.0f)
+        {
+            return i == 0 ? 0.0f : m_points[i - 1].position;
+        }
+    }
+
+    return 1.0f;
+}
+
+bool transfer_function::dirty() const
+{
+    return m_dirty.x <= m_dirty.y;
+}
+
+const glm::vec2& transfer_function::dirty_range() const
+{
+    return m_dirty;
+}
+
+void transfer_function::invalidate(float begin, float end)
+{
+    if(!dirty())
+    {
+        m_dirty = {begin, end};
+        return;
+    }
+
+    m_dirty = {std::min(m_dirty.x, begin), std::max(m_dirty.y, end)};
+}
+
+void transfer_function::clean()
+{
+    m_dirty = {1.0f, 0.0f};
+}
+
+glm::vec2 transfer_function::support(std::size_t index) const
+{
+    float begin = index > 0 ? m_points[index - 1].position : 0.0f;
+    float end = index + 1 < m_points.size() ? m_points[index + 1].position : 1.0f;
+    return {begin, end};
+}
+
+
+/*========================== preintegration_table ==========================*/
+preintegration_table::preintegration_table(opengl::context& context, unsigned int resolution)
+    : m_resolution(std::max(resolution, 2u))
+{
+    m_lookup.resize(m_resolution);
+    m_extinction.resize(m_resolution);
+    m_table.resize(static_cast<std::size_t>(m_resolution) * m_resolution);
+
+    m_lookup_tex = context.make_texture(opengl::texture_internal_type::rgba16f, opengl::texture_format::rgba,
+                                        opengl::texture_type::float_, m_resolution, 1);
+    m_table_tex = context.make_texture(opengl::texture_internal_type::rgba16f, opengl::texture_format::rgba,
+                                       opengl::texture_type::float_, m_resolution, m_resolution);
+
+    for(auto* tex : {m_lookup_tex.get(), m_table_tex.get()})
+    {
+        tex->smooth(true);
+        tex->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+        tex->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+    }
+}
+
+bool preintegration_table::update(transfer_function& tf, float step_ratio)
+{
+    /* a new step length changes every entry */
+    const bool full = step_ratio != m_step_ratio;
+    if(!full && !tf.dirty())
+    {
+        m_rebuilt = 0;
+        return false;
+    }
+
+    auto start = core::clock::now();
+
+    const glm::vec2 range = full ? glm::vec2(0.0f, 1.0f) : tf.dirty_range();
+    const float scale = static_cast<float>(m_resolution - 1);
+    const unsigned int first = static_cast<unsigned int>(std::clamp(std::floor(range.x * scale), 0.0f, scale));
+    const unsigned int last = static_cast<unsigned int>(std::clamp(std::ceil(range.y * scale), 0.0f, scale));
+
+    m_step_ratio = step_ratio;
+    for(unsigned int i = first; i <= last; i++)
+    {
+        m_lookup[i] = tf.evaluate(i / scale);
+        m_extinction[i] = -std::log(1.0f - std::min(m_lookup[i].a, 0.9999f));
+    }
+
+    /* a segment depends on all lookup entries between its front and back density */
+    std::atomic<std::size_t> rebuilt{0};
+    core::parallel_for(0, m_resolution, 8, [&](std::size_t begin, std::size_t end)
+    {
+        std::size_t count = 0;
+        for(std::size_t front = begin; front < end; front++)
+        {
+            for(unsigned int back = 0; back < m_resolution; back++)
+            {
+                if(std::min<std::size_t>(front, back) > last || std::max<std::size_t>(front, back) < first) { continue; }
+
+                m_table[front * m_resolution + back] = integrate(static_cast<unsigned int>(front), back);
+                count++;
+            }
+        }
+        rebuilt += count;
+    });
+
+    m_lookup_tex->data(reinterpret_cast<const unsigned char*>(m_lookup.data()));
+    m_table_tex->data(reinterpret_cast<const unsigned char*>(m_table.data()));
+    tf.clean();
+
+    m_rebuilt = rebuilt;
+    m_update_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    return true;
+}
+
+unsigned int preintegration_table::resolution() const
+{
+    return m_resolution;
+}
+
+const opengl::handle<opengl::texture>& preintegration_table::lookup() const
+{
+    return m_lookup_tex;
+}
+
+const opengl::handle<opengl::texture>& preintegration_table::table() const
+{
+    return m_table_tex;
+}
+
+std::size_t preintegration_table::rebuilt() const
+{
+    return m_rebuilt;
+}
+
+double preintegration_table::update_ms() const
+{
+    return m_update_ms;
+}
+
+glm::vec4 preintegration_table::integrate(unsigned int front, unsigned int back) const
+{
+    /* front to back compositing of one sub sample per lookup entry crossed by the segment, densities vary
+       linearly along the segment and the opacity of every sub sample is corrected for its length */
+    const unsigned int n = std::max(front > back ? front - back : back - front, 1u);
+    const float length = m_step_ratio / n;
+
+    glm::vec3 color(0.0f);
+    float alpha = 0.0f;
+    for(unsigned int k = 0; k < n; k++)
+    {
+        float x = glm::mix(static_cast<float>(front), static_cast<float>(back), (k + 0.5f) / n);
+        unsigned int x0 = static_cast<unsigned int>(x), x1 = std::min(x0 + 1, m_resolution - 1);
+        float t = x - x0;
+
+        float extinction = glm::mix(m_extinction[x0], m_extinction[x1], t);
+        if(extinction <= 0.0f) { continue; }
+
+        float a = 1.0f - std::exp(-extinction * length);
+        glm::vec3 c = glm::mix(glm::vec3(m_lookup[x0]), glm::vec3(m_lookup[x1]), t);
+
+        color += (1.0f - alpha) * a * c;
+        alpha += (1.0f - alpha) * a;
+    }
+
+    return {color, alpha};
+}
+
+}
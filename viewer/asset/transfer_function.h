@@ -0,0 +1,100 @@
+#pragma once
+
+#include "viewer/opengl/texture.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace opengl { class context; }
+
+
+namespace asset
+{
+
+/*========================== transfer_function ==========================*/
+/* piecewise linear mapping from normalized density to color and opacity (opacity per reference step, usually
+   one voxel); every edit widens a dirty value range so that derived tables can be rebuilt incrementally */
+class transfer_function
+{
+public:
+    struct point
+    {
+        float position;
+        glm::vec4 color;
+    };
+
+private:
+    std::vector<point> m_points;
+    glm::vec2 m_dirty{0.0f, 1.0f};
+
+public:
+    transfer_function();
+
+    const std::vector<point>& points() const;
+
+    /* indices refer to the points sorted by position, move returns the new index of the point */
+    std::size_t add(float position, const glm::vec4& color);
+    void remove(std::size_t index);
+    std::size_t move(std::size_t index, float position, float opacity);
+    void color(std::size_t index, const glm::vec3& color);
+
+    glm::vec4 evaluate(float value) const;
+
+    /* lowest value with non zero opacity (1 if the function is fully transparent) */
+    float first_visible() const;
+
+    bool dirty() const;
+    const glm::vec2& dirty_range() const;
+    void invalidate(float begin = 0.0f, float end = 1.0f);
+    void clean();
+
+private:
+    /* values influenced by point 'index' (up to its neighbours) */
+    glm::vec2 support(std::size_t index) const;
+};
+
+
+/*========================== preintegration_table ==========================*/
+/* 1D lookup texture of a transfer function and the 2D pre-integrated table for ray segments (front density,
+   back density) of one step length; entries store premultiplied color and opacity (rgba16f), only entries
+   whose segment overlaps the dirty range of the transfer function are recomputed */
+class preintegration_table
+{
+private:
+    unsigned int m_resolution;
+    float m_step_ratio{0.0f};
+
+    std::vector<glm::vec4> m_lookup;
+    std::vector<float> m_extinction;
+    std::vector<glm::vec4> m_table;
+
+    opengl::handle<opengl::texture> m_lookup_tex;
+    opengl::handle<opengl::texture> m_table_tex;
+
+    std::size_t m_rebuilt{0};
+    double m_update_ms{0.0};
+
+public:
+    preintegration_table(opengl::context& context, unsigned int resolution = 256);
+
+    /* step_ratio is the ray step length in units of the reference step of the opacities; returns true if the
+       textures changed */
+    bool update(transfer_function& tf, float step_ratio);
+
+    unsigned int resolution() const;
+    const opengl::handle<opengl::texture>& lookup() const;
+    const opengl::handle<opengl::texture>& table() const;
+
+    /* entries recomputed by the last update and its duration */
+    std::size_t rebuilt() const;
+    double update_ms() const;
+
+private:
+    glm::vec4 integrate(unsigned int front, unsigned int back) const;
+};
+
+}
@@ -1,100 +1,703 @@
 #include "volume.h"
 
 #include "viewer/core/log.h"
+#include "viewer/core/mapped_file.h"
+#include "viewer/core/memory.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/simd.h"
+#include "viewer/core/time.h"
+#include "viewer/opengl/buffer.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
 
 namespace asset
 {
 
-volume_loader::result_type volume_loader::load_raw(opengl::context& gl_context, const std::filesystem::path& path, const glm::uvec3& size)
+namespace detail
 {
-    if (!std::filesystem::is_regular_file(path))
+
+/* element wise running min / max of a voxel row (unaligned source, 8 or 16 bit voxels) */
+inline void accumulate_range(const std::uint8_t* row, std::size_t n, std::uint8_t* lo, std::uint8_t* hi)
+{
+    std::size_t i = 0;
+#if defined(CORE_SIMD_SSE2)
+    for(; i + 16 <= n; i += 16)
     {
-        platform_log(core::log::level::error, "[asset::volume] path does is not a file {0} ", path.string());
-        return result_type(new opengl::texture_3D(gl_context, 1, 1, 1));
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lo + i), _mm_min_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + i)), v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hi + i), _mm_max_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + i)), v));
+    }
+#endif
+    for(; i < n; i++)
+    {
+        lo[i] = std::min(lo[i], row[i]);
+        hi[i] = std::max(hi[i], row[i]);
+    }
+}
+
+inline void accumulate_range(const std::uint8_t* row, std::size_t n, std::uint16_t* lo, std::uint16_t* hi)
+{
+    std::size_t i = 0;
+#if defined(CORE_SIMD_SSE2)
+    /* sse2 only has signed 16 bit min / max, flipping the sign bit maps the unsigned order onto it */
+    const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+    for(; i + 8 <= n; i += 8)
+    {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 2 * i)), bias);
+        __m128i l = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + i)), bias);
+        __m128i h = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + i)), bias);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lo + i), _mm_xor_si128(_mm_min_epi16(l, v), bias));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hi + i), _mm_xor_si128(_mm_max_epi16(h, v), bias));
+    }
+#endif
+    for(; i < n; i++)
+    {
+        std::uint16_t value;
+        std::memcpy(&value, row + 2 * i, sizeof(value));
+        lo[i] = std::min(lo[i], value);
+        hi[i] = std::max(hi[i], value);
     }
+}
+
+/* one row of bricks (fixed by, bz): the (extended) voxel rows are reduced vertically with simd into a single
+   row of per x min / max, which is then reduced horizontally per brick */
+template<typename T>
+void compute_brick_row(const volume& vol, brick_grid& grid, unsigned int by, unsigned int bz, std::vector<T>& lo, std::vector<T>& hi)
+{
+    const auto& size = vol.size();
+    const unsigned int b = grid.brick_size;
+    const std::size_t row_bytes = size.x * sizeof(T);
+
+    std::fill(lo.begin(), lo.end(), std::numeric_limits<T>::max());
+    std::fill(hi.begin(), hi.end(), std::numeric_limits<T>::min());
 
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    unsigned int y0 = by * b > 0 ? by * b - 1 : 0, y1 = std::min(size.y, (by + 1) * b + 1);
+    unsigned int z0 = bz * b > 0 ? bz * b - 1 : 0, z1 = std::min(size.z, (bz + 1) * b + 1);
+    for(unsigned int z = z0; z < z1; z++)
+    {
+        const std::uint8_t* slice = vol.slice(z);
+        for(unsigned int y = y0; y < y1; y++)
+        {
+            accumulate_range(slice + y * row_bytes, size.x, lo.data(), hi.data());
+        }
+    }
 
-    /* get file size */
-    file.seekg(0, file.end);
-    auto f_size = file.tellg();
-    file.seekg(0, file.beg);
-    if (f_size == 0)
+    constexpr float scale = 65535.0f / std::numeric_limits<T>::max();
+    for(unsigned int bx = 0; bx < grid.size.x; bx++)
     {
-        file.close();
+        unsigned int x0 = bx * b > 0 ? bx * b - 1 : 0, x1 = std::min(size.x, (bx + 1) * b + 1);
+        T min_value = *std::min_element(lo.begin() + x0, lo.begin() + x1);
+        T max_value = *std::max_element(hi.begin() + x0, hi.begin() + x1);
 
-        platform_log(core::log::level::error, "[asset::volume] Empty volume data at {0}", path.string());
-        return result_type(new opengl::texture_3D(gl_context, 1, 1, 1));
+        grid.range[(static_cast<std::size_t>(bz) * grid.size.y + by) * grid.size.x + bx] =
+            {
+                static_cast<std::uint16_t>(min_value * scale),
+                static_cast<std::uint16_t>(max_value * scale)
+            };
+    }
+}
+
+template<typename T>
+inline float voxel(const std::uint8_t* row, unsigned int x)
+{
+    T value;
+    std::memcpy(&value, row + x * sizeof(T), sizeof(T));
+    return static_cast<float>(value);
+}
+
+/* direction (xyz * 0.5 + 0.5) and magnitude of a gradient in normalized voxel units */
+inline glm::vec4 encode_gradient(float gx, float gy, float gz)
+{
+    float length = std::sqrt(gx * gx + gy * gy + gz * gz);
+    float inv = length > 0.0f ? 1.0f / length : 0.0f;
+    return {gx * inv * 0.5f + 0.5f, gy * inv * 0.5f + 0.5f, gz * inv * 0.5f + 0.5f, std::min(length, 1.0f)};
+}
+
+inline void store_gradient(const glm::vec4& value, gradient_format format, std::uint8_t* dst)
+{
+    if(format == gradient_format::rgba8)
+    {
+        for(int c = 0; c < 4; c++)
+        {
+            dst[c] = static_cast<std::uint8_t>(value[c] * 255.0f + 0.5f);
+        }
+    }
+    else
+    {
+        std::uint16_t half[4] = {glm::packHalf1x16(value.x), glm::packHalf1x16(value.y), glm::packHalf1x16(value.z), glm::packHalf1x16(value.w)};
+        std::memcpy(dst, half, sizeof(half));
     }
+}
+
+#if defined(CORE_SIMD_SSE2)
+/* four consecutive voxels widened to float */
+template<typename T>
+inline __m128 load4(const std::uint8_t* row, unsigned int x);
+
+template<>
+inline __m128 load4<std::uint8_t>(const std::uint8_t* row, unsigned int x)
+{
+    int bytes;
+    std::memcpy(&bytes, row + x, sizeof(bytes));
+    __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+
+template<>
+inline __m128 load4<std::uint16_t>(const std::uint8_t* row, unsigned int x)
+{
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + 2 * x));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+#endif
+
+/* one voxel row (y, z) of central difference gradients (neighbours clamped to the volume like a clamp to edge
+   texture); interior voxels are processed four at a time with simd, border voxels and the remainder are scalar */
+template<typename T>
+void compute_gradient_row(const volume& vol, unsigned int y, unsigned int z, gradient_format format, std::uint8_t* dst)
+{
+    const auto& size = vol.size();
+    const std::size_t row_bytes = size.x * sizeof(T);
+    const std::size_t texel_bytes = format == gradient_format::rgba8 ? 4 : 8;
+    const float scale = 0.5f / std::numeric_limits<T>::max();
+
+    const std::uint8_t* center = vol.slice(z) + y * row_bytes;
+    const std::uint8_t* y_lo = vol.slice(z) + (y > 0 ? y - 1 : 0) * row_bytes;
+    const std::uint8_t* y_hi = vol.slice(z) + std::min(y + 1, size.y - 1) * row_bytes;
+    const std::uint8_t* z_lo = vol.slice(z > 0 ? z - 1 : 0) + y * row_bytes;
+    const std::uint8_t* z_hi = vol.slice(std::min(z + 1, size.z - 1)) + y * row_bytes;
 
-    if( f_size != size.x*size.y*size.z )
+    auto scalar = [&](unsigned int x)
     {
-        file.close();
+        unsigned int x0 = x > 0 ? x - 1 : 0, x1 = std::min(x + 1, size.x - 1);
+        auto value = encode_gradient((voxel<T>(center, x1) - voxel<T>(center, x0)) * scale,
+                                     (voxel<T>(y_hi, x) - voxel<T>(y_lo, x)) * scale,
+                                     (voxel<T>(z_hi, x) - voxel<T>(z_lo, x)) * scale);
+        store_gradient(value, format, dst + x * texel_bytes);
+    };
 
-        platform_log(core::log::level::error, "[asset::volume] Volume size does not match specified size (voxel size is assumed to be one byte) {0}", path.string());
-        return result_type(new opengl::texture_3D(gl_context, 1, 1, 1));
+    unsigned int x = 0;
+    scalar(x++);
+
+#if defined(CORE_SIMD_SSE2)
+    const __m128 vscale = _mm_set1_ps(scale), half = _mm_set1_ps(0.5f), one = _mm_set1_ps(1.0f), unorm = _mm_set1_ps(255.0f);
+    for(; x + 4 < size.x; x += 4)
+    {
+        __m128 gx = _mm_mul_ps(_mm_sub_ps(load4<T>(center, x + 1), load4<T>(center, x - 1)), vscale);
+        __m128 gy = _mm_mul_ps(_mm_sub_ps(load4<T>(y_hi, x), load4<T>(y_lo, x)), vscale);
+        __m128 gz = _mm_mul_ps(_mm_sub_ps(load4<T>(z_hi, x), load4<T>(z_lo, x)), vscale);
+
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)), _mm_mul_ps(gz, gz)));
+        __m128 inv = _mm_and_ps(_mm_cmpgt_ps(length, _mm_setzero_ps()), _mm_div_ps(one, length));
+        __m128 scaled = _mm_mul_ps(inv, half);
+
+        __m128 r = _mm_add_ps(_mm_mul_ps(gx, scaled), half);
+        __m128 g = _mm_add_ps(_mm_mul_ps(gy, scaled), half);
+        __m128 b = _mm_add_ps(_mm_mul_ps(gz, scaled), half);
+        __m128 a = _mm_min_ps(length, one);
+
+        if(format == gradient_format::rgba8)
+        {
+            /* four rgba8 texels are one 128 bit store */
+            __m128i ri = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, unorm), half));
+            __m128i gi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(g, unorm), half));
+            __m128i bi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, unorm), half));
+            __m128i ai = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(a, unorm), half));
+            __m128i texels = _mm_or_si128(_mm_or_si128(ri, _mm_slli_epi32(gi, 8)), _mm_or_si128(_mm_slli_epi32(bi, 16), _mm_slli_epi32(ai, 24)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * texel_bytes), texels);
+        }
+        else
+        {
+            alignas(16) float lanes[4][4];
+            _mm_store_ps(lanes[0], r);
+            _mm_store_ps(lanes[1], g);
+            _mm_store_ps(lanes[2], b);
+            _mm_store_ps(lanes[3], a);
+            for(unsigned int i = 0; i < 4; i++)
+            {
+                store_gradient({lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i]}, format, dst + (x + i) * texel_bytes);
+            }
+        }
     }
+#endif
 
+    for(; x < size.x; x++)
+    {
+        scalar(x);
+    }
+}
 
-    /*----------------- read raw --------------------*/
-    std::vector<std::uint8_t> data(f_size);
-    file.read(reinterpret_cast<char*>(data.data()), data.size());
+/* histogram and per x min / max of the slices [z_begin, z_end) */
+template<typename T>
+void compute_histogram_slab(const volume& vol, unsigned int z_begin, unsigned int z_end, std::vector<std::uint64_t>& bins, T& lo, T& hi)
+{
+    const auto& size = vol.size();
+    const std::size_t row_bytes = size.x * sizeof(T);
+    const std::uint64_t num_bins = bins.size();
+    constexpr std::uint64_t range = static_cast<std::uint64_t>(std::numeric_limits<T>::max()) + 1;
 
-    auto vol_tex = result_type(new opengl::texture_3D(gl_context,
-                                                      opengl::texture_internal_type::r16, opengl::texture_format::red, opengl::texture_type::unsigned_byte_,
-                                                      size.x, size.y, size.z));
-    vol_tex->data(data.data());
+    std::vector<T> row_lo(size.x, std::numeric_limits<T>::max()), row_hi(size.x, std::numeric_limits<T>::min());
+    for(unsigned int z = z_begin; z < z_end; z++)
+    {
+        const std::uint8_t* slice = vol.slice(z);
+        for(unsigned int y = 0; y < size.y; y++)
+        {
+            const std::uint8_t* row = slice + y * row_bytes;
+            accumulate_range(row, size.x, row_lo.data(), row_hi.data());
 
-    vol_tex->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
-    vol_tex->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
-    vol_tex->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::edge);
+            for(unsigned int x = 0; x < size.x; x++)
+            {
+                T value;
+                std::memcpy(&value, row + x * sizeof(T), sizeof(T));
+                bins[value * num_bins / range]++;
+            }
+        }
+    }
 
-    return vol_tex;
+    lo = std::min(lo, *std::min_element(row_lo.begin(), row_lo.end()));
+    hi = std::max(hi, *std::max_element(row_hi.begin(), row_hi.end()));
 }
 
-volume_loader::result_type volume_loader::load_dat(opengl::context& gl_context, const std::filesystem::path& path)
+}
+
+/*========================== volume ==========================*/
+volume::volume(const glm::uvec3& size, voxel_type type)
+    : m_size(size), m_type(type)
+{
+    m_storage.resize(bytes(), 0);
+    m_voxels = m_storage.data();
+}
+
+volume::volume(const std::shared_ptr<core::mapped_file>& file, std::size_t offset, const glm::uvec3& size, voxel_type type)
+    : m_file(file), m_voxels(file->data() + offset), m_size(size), m_type(type)
+{
+
+}
+
+const glm::uvec3& volume::size() const
+{
+    return m_size;
+}
+
+voxel_type volume::type() const
+{
+    return m_type;
+}
+
+std::size_t volume::voxel_bytes() const
+{
+    return m_type == voxel_type::uint8 ? 1 : 2;
+}
+
+std::size_t volume::slice_bytes() const
+{
+    return static_cast<std::size_t>(m_size.x) * m_size.y * voxel_bytes();
+}
+
+std::size_t volume::bytes() const
+{
+    return slice_bytes() * m_size.z;
+}
+
+const std::uint8_t* volume::ptr() const
+{
+    return m_voxels;
+}
+
+const std::uint8_t* volume::slice(unsigned int z) const
+{
+    return m_voxels + z * slice_bytes();
+}
+
+std::uint8_t* volume::data()
+{
+    return m_storage.empty() ? nullptr : m_storage.data();
+}
+
+unsigned int volume::raw(unsigned int x, unsigned int y, unsigned int z) const
+{
+    std::size_t index = (static_cast<std::size_t>(z) * m_size.y + y) * m_size.x + x;
+    if(m_type == voxel_type::uint8)
+    {
+        return m_voxels[index];
+    }
+
+    std::uint16_t value;
+    std::memcpy(&value, m_voxels + 2 * index, sizeof(value));
+    return value;
+}
+
+float volume::value(unsigned int x, unsigned int y, unsigned int z) const
+{
+    return static_cast<float>(raw(x, y, z)) / (m_type == voxel_type::uint8 ? 255.0f : 65535.0f);
+}
+
+
+/*========================== volume_histogram ==========================*/
+float volume_histogram::bin_center(std::size_t bin) const
+{
+    return (bin + 0.5f) / bins.size();
+}
+
+float volume_histogram::suggest_iso() const
+{
+    if(bins.size() < 3)
+    {
+        return 0.5f * (min + max);
+    }
+
+    /* box filtered histogram, so that noise does not create spurious minima */
+    const std::size_t n = bins.size();
+    std::vector<double> smooth(n, 0.0);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        std::size_t first = i >= 2 ? i - 2 : 0, last = std::min(n - 1, i + 2);
+        for(std::size_t j = first; j <= last; j++)
+        {
+            smooth[i] += static_cast<double>(bins[j]);
+        }
+        smooth[i] /= static_cast<double>(last - first + 1);
+    }
+
+    /* walk downhill from the background peak into the first valley */
+    std::size_t i = std::distance(smooth.begin(), std::max_element(smooth.begin(), smooth.end()));
+    while(i + 1 < n && smooth[i + 1] <= smooth[i])
+    {
+        i++;
+    }
+
+    return std::clamp(bin_center(i), min, max);
+}
+
+/*========================== volume_loader ==========================*/
+volume_loader::result_type_cpu volume_loader::map_raw(const std::filesystem::path& path, const glm::uvec3& size)
 {
     if (!std::filesystem::is_regular_file(path))
     {
         platform_log(core::log::level::error, "[asset::volume] path does is not a file {0} ", path.string());
-        return result_type(new opengl::texture_3D(gl_context, 1, 1, 1));
+        return nullptr;
     }
 
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    auto file = std::make_shared<core::mapped_file>(path);
+    if(!file->is_open())
+    {
+        platform_log(core::log::level::error, "[asset::volume] Empty volume data at {0}", path.string());
+        return nullptr;
+    }
 
-    /* get file size */
-    file.seekg(0, file.end);
-    std::size_t f_size = file.tellg();
-    file.seekg(0, file.beg);
-    if (f_size == 0)
+    /* voxel size is derived from the file size (one or two bytes per voxel) */
+    std::size_t num_voxels = static_cast<std::size_t>(size.x) * size.y * size.z;
+    voxel_type type;
+    if(file->size() == num_voxels)
+    {
+        type = voxel_type::uint8;
+    }
+    else if(file->size() == 2 * num_voxels)
+    {
+        type = voxel_type::uint16;
+    }
+    else
     {
-        file.close();
+        platform_log(core::log::level::error, "[asset::volume] Volume size does not match specified size (voxel size is assumed to be one or two bytes) {0}", path.string());
+        return nullptr;
+    }
+
+    return std::make_shared<volume>(file, 0, size, type);
+}
 
+volume_loader::result_type_cpu volume_loader::map_dat(const std::filesystem::path& path)
+{
+    if (!std::filesystem::is_regular_file(path))
+    {
+        platform_log(core::log::level::error, "[asset::volume] path does is not a file {0} ", path.string());
+        return nullptr;
+    }
+
+    auto file = std::make_shared<core::mapped_file>(path);
+    if(!file->is_open())
+    {
         platform_log(core::log::level::error, "[asset::volume] Empty volume data at {0}", path.string());
-        return result_type(new opengl::texture_3D(gl_context, 1, 1, 1));
+        return nullptr;
     }
 
     /*----------------- read dat (https://www.cg.tuwien.ac.at/research/vis/datasets/) --------------------*/
-    struct __attribute((packed))
+    constexpr std::size_t header_size = 3 * sizeof(std::uint16_t);
+    if(file->size() < header_size)
+    {
+        platform_log(core::log::level::error, "[asset::volume] Missing dat header {0}", path.string());
+        return nullptr;
+    }
+
+    std::uint16_t header[3];
+    std::memcpy(header, file->data(), header_size);
+
+    glm::uvec3 size = {header[0], header[1], header[2]};
+    if(file->size() - header_size != static_cast<std::size_t>(size.x) * size.y * size.z * 2)
     {
-        std::uint16_t x;
-        std::uint16_t y;
-        std::uint16_t z;
-    } _header;
+        platform_log(core::log::level::error, "[asset::volume] Volume size does not match dat header {0}", path.string());
+        return nullptr;
+    }
+
+    return std::make_shared<volume>(file, header_size, size, voxel_type::uint16);
+}
+
+volume_loader::result_type volume_loader::load(opengl::context& gl_context, const volume& vol)
+{
+    auto start = core::clock::now();
+    const auto& size = vol.size();
+
+    auto internal = vol.type() == voxel_type::uint8 ? opengl::texture_internal_type::r8 : opengl::texture_internal_type::r16;
+    auto type = vol.type() == voxel_type::uint8 ? opengl::texture_type::unsigned_byte_ : opengl::texture_type::unsigned_short_;
+
+    auto vol_tex = result_type(new opengl::texture_3D(gl_context, internal, opengl::texture_format::red, type, size.x, size.y, size.z));
+
+    vol_tex->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+    vol_tex->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+    vol_tex->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::edge);
+
+    /* slabs of ~32 MB are copied from the mapping into one of two pixel unpack buffers (parallel page faults),
+       while the driver transfers the previous slab; without buffer mapping the slab is uploaded directly */
+    constexpr std::size_t slab_target = 32 << 20;
+    const std::size_t slice_bytes = vol.slice_bytes();
+    const unsigned int slab_depth = static_cast<unsigned int>(std::clamp<std::size_t>(slab_target / slice_bytes, 1, size.z));
+    const std::size_t slab_bytes = slab_depth * slice_bytes;
+
+    auto alignment = gl_context.unpack_alignment(1);
+
+    opengl::handle<opengl::buffer<std::uint8_t>> staging[2] =
+        {
+            gl_context.make_buffer<std::uint8_t>(opengl::buffer_target::pixel_unpack, slab_bytes, opengl::buffer_usage::stream_draw),
+            gl_context.make_buffer<std::uint8_t>(opengl::buffer_target::pixel_unpack, slab_bytes, opengl::buffer_usage::stream_draw)
+        };
+    staging[1]->unbind();
+
+    bool use_staging = true;
+    for(unsigned int z = 0, slab = 0; z < size.z; z += slab_depth, slab++)
+    {
+        unsigned int depth = std::min(slab_depth, size.z - z);
+        std::size_t bytes = depth * slice_bytes;
+        const std::uint8_t* src = vol.slice(z);
+
+        if(use_staging)
+        {
+            auto& pbo = staging[slab & 1];
+            auto* dst = pbo->map(0, static_cast<unsigned int>(bytes), opengl::buffer_access::write | opengl::buffer_access::invalidate_buffer);
+            if(dst)
+            {
+                core::parallel_for(0, bytes, 1 << 20, [&](std::size_t begin, std::size_t end)
+                {
+                    std::memcpy(dst + begin, src + begin, end - begin);
+                });
+                pbo->unmap();
+
+                vol_tex->sub_data(nullptr, 0, 0, z, size.x, size.y, depth);
+                pbo->unbind();
+                continue;
+            }
+
+            platform_log(core::log::level::warning, "[asset::volume] Unable to map pixel unpack buffer, uploading without staging");
+            pbo->unbind();
+            use_staging = false;
+        }
 
-    file.read(reinterpret_cast<char*>(&_header), sizeof(_header));
-    assert(f_size - sizeof(_header) == _header.x * _header.y * _header.z * 2);
+        vol_tex->sub_data(src, 0, 0, z, size.x, size.y, depth);
+    }
 
-    std::vector<std::uint8_t> data(f_size);
-    data.resize(f_size - sizeof(_header));
-    file.read(reinterpret_cast<char*>(data.data()), f_size - sizeof(_header));
+    gl_context.unpack_alignment(alignment);
 
-    auto vol_tex = result_type(new opengl::texture_3D(gl_context,
-                                                      opengl::texture_internal_type::r16, opengl::texture_format::red, opengl::texture_type::unsigned_short_,
-                                                      _header.x, _header.y, _header.z));
-    vol_tex->data(data.data());
+    auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    platform_log(core::log::level::info, "[asset::volume] uploaded {}x{}x{} ({:.1f} MB, {}) in {:.1f} ms ({:.1f} MB/s), staging {} x {:.1f} MB, peak memory {:.1f} MB",
+                 size.x, size.y, size.z, vol.bytes() / (1024.0 * 1024.0), vol.type() == voxel_type::uint8 ? "r8" : "r16",
+                 elapsed, vol.bytes() / (1024.0 * 1024.0) / (elapsed / 1000.0),
+                 use_staging ? 2 : 0, slab_bytes / (1024.0 * 1024.0), core::peak_memory() / (1024.0 * 1024.0));
 
     return vol_tex;
 }
 
+brick_grid volume_loader::compute_bricks(const volume& vol, unsigned int brick_size)
+{
+    auto start = core::clock::now();
+
+    brick_grid grid;
+    grid.brick_size = std::max(brick_size, 1u);
+    grid.size = (vol.size() + grid.brick_size - 1u) / grid.brick_size;
+    grid.range.resize(static_cast<std::size_t>(grid.size.x) * grid.size.y * grid.size.z);
+
+    /* one task per row of bricks, scratch rows are allocated per block */
+    const std::size_t rows = static_cast<std::size_t>(grid.size.y) * grid.size.z;
+    core::parallel_for(0, rows, 1, [&](std::size_t begin, std::size_t end)
+    {
+        if(vol.type() == voxel_type::uint8)
+        {
+            std::vector<std::uint8_t> lo(vol.size().x), hi(vol.size().x);
+            for(std::size_t row = begin; row < end; row++)
+            {
+                detail::compute_brick_row(vol, grid, row % grid.size.y, row / grid.size.y, lo, hi);
+            }
+        }
+        else
+        {
+            std::vector<std::uint16_t> lo(vol.size().x), hi(vol.size().x);
+            for(std::size_t row = begin; row < end; row++)
+            {
+                detail::compute_brick_row(vol, grid, row % grid.size.y, row / grid.size.y, lo, hi);
+            }
+        }
+    });
+
+    auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    platform_log(core::log::level::info, "[asset::volume] computed {}x{}x{} bricks ({}^3 voxels) in {:.1f} ms",
+                 grid.size.x, grid.size.y, grid.size.z, grid.brick_size, elapsed);
+
+    return grid;
+}
+
+volume_loader::result_type volume_loader::load(opengl::context& gl_context, const brick_grid& bricks)
+{
+    auto brick_tex = result_type(new opengl::texture_3D(gl_context,
+                                                        opengl::texture_internal_type::rg16, opengl::texture_format::rg, opengl::texture_type::unsigned_short_,
+                                                        bricks.size.x, bricks.size.y, bricks.size.z));
+    brick_tex->data(reinterpret_cast<const unsigned char*>(bricks.range.data()));
+    brick_tex->smooth(false);
+
+    brick_tex->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+    brick_tex->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+    brick_tex->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::edge);
+
+    return brick_tex;
+}
+
+gradient_volume volume_loader::compute_gradients(const volume& vol, gradient_format format)
+{
+    auto start = core::clock::now();
+    const auto& size = vol.size();
+
+    gradient_volume gradients;
+    gradients.size = size;
+    gradients.format = format;
+
+    const std::size_t texel_bytes = format == gradient_format::rgba8 ? 4 : 8;
+    const std::size_t row_bytes = size.x * texel_bytes;
+    gradients.data.resize(static_cast<std::size_t>(size.y) * size.z * row_bytes);
+
+    /* z slabs of a few slices per task keep the five source rows of a voxel row in cache */
+    core::parallel_for(0, size.z, 4, [&](std::size_t begin, std::size_t end)
+    {
+        for(std::size_t z = begin; z < end; z++)
+        {
+            for(unsigned int y = 0; y < size.y; y++)
+            {
+                std::uint8_t* dst = gradients.data.data() + (z * size.y + y) * row_bytes;
+                if(vol.type() == voxel_type::uint8)
+                {
+                    detail::compute_gradient_row<std::uint8_t>(vol, y, static_cast<unsigned int>(z), format, dst);
+                }
+                else
+                {
+                    detail::compute_gradient_row<std::uint16_t>(vol, y, static_cast<unsigned int>(z), format, dst);
+                }
+            }
+        }
+    });
+
+    auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    platform_log(core::log::level::info, "[asset::volume] computed {}x{}x{} gradients ({}, {:.1f} MB) in {:.1f} ms",
+                 size.x, size.y, size.z, format == gradient_format::rgba8 ? "rgba8" : "rgba16f",
+                 gradients.data.size() / (1024.0 * 1024.0), elapsed);
+
+    return gradients;
+}
+
+volume_loader::result_type volume_loader::load(opengl::context& gl_context, const gradient_volume& gradients)
+{
+    auto internal = gradients.format == gradient_format::rgba8 ? opengl::texture_internal_type::rgba8 : opengl::texture_internal_type::rgba16f;
+    auto type = gradients.format == gradient_format::rgba8 ? opengl::texture_type::unsigned_byte_ : opengl::texture_type::half_float_;
+
+    auto gradient_tex = result_type(new opengl::texture_3D(gl_context, internal, opengl::texture_format::rgba, type,
+                                                           gradients.size.x, gradients.size.y, gradients.size.z));
+    gradient_tex->data(gradients.data.data());
+    gradient_tex->smooth(true);
+
+    gradient_tex->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+    gradient_tex->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+    gradient_tex->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::edge);
+
+    return gradient_tex;
+}
+
+volume_histogram volume_loader::compute_histogram(const volume& vol, unsigned int bins)
+{
+    auto start = core::clock::now();
+
+    volume_histogram histogram;
+    histogram.bins.resize(std::max(bins, 1u), 0);
+
+    /* every task fills a local histogram which is merged once at the end of its slab */
+    std::mutex mutex;
+    unsigned int lo = std::numeric_limits<unsigned int>::max(), hi = 0;
+    core::parallel_for(0, vol.size().z, 4, [&](std::size_t begin, std::size_t end)
+    {
+        std::vector<std::uint64_t> local(histogram.bins.size(), 0);
+        unsigned int local_lo, local_hi;
+        if(vol.type() == voxel_type::uint8)
+        {
+            std::uint8_t l = std::numeric_limits<std::uint8_t>::max(), h = 0;
+            detail::compute_histogram_slab(vol, static_cast<unsigned int>(begin), static_cast<unsigned int>(end), local, l, h);
+            local_lo = l, local_hi = h;
+        }
+        else
+        {
+            std::uint16_t l = std::numeric_limits<std::uint16_t>::max(), h = 0;
+            detail::compute_histogram_slab(vol, static_cast<unsigned int>(begin), static_cast<unsigned int>(end), local, l, h);
+            local_lo = l, local_hi = h;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for(std::size_t i = 0; i < local.size(); i++)
+        {
+            histogram.bins[i] += local[i];
+        }
+        lo = std::min(lo, local_lo);
+        hi = std::max(hi, local_hi);
+    });
+
+    const float max_value = vol.type() == voxel_type::uint8 ? 255.0f : 65535.0f;
+    histogram.min = lo <= hi ? lo / max_value : 0.0f;
+    histogram.max = hi / max_value;
+
+    auto elapsed = core::time_cast<core::milli_sec>(core::clock::now() - start);
+    platform_log(core::log::level::info, "[asset::volume] computed histogram ({} bins, range [{:.3f}, {:.3f}]) in {:.1f} ms",
+                 histogram.bins.size(), histogram.min, histogram.max, elapsed);
+
+    return histogram;
+}
+
+volume_loader::result_type volume_loader::load_raw(opengl::context& gl_context, const std::filesystem::path& path, const glm::uvec3& size)
+{
+    auto vol = map_raw(path, size);
+    if(!vol)
+    {
+        return result_type(new opengl::texture_3D(gl_context, 1, 1, 1));
+    }
+
+    return load(gl_context, *vol);
+}
+
+volume_loader::result_type volume_loader::load_dat(opengl::context& gl_context, const std::filesystem::path& path)
+{
+    auto vol = map_dat(path);
+    if(!vol)
+    {
+        return result_type(new opengl::texture_3D(gl_context, 1, 1, 1));
+    }
+
+    return load(gl_context, *vol);
+}
+
 }
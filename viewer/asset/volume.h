@@ -1,28 +1,124 @@
 #pragma once
 
 #include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <glm/gtc/type_precision.hpp>
 
-#include "viewer/opengl/texture3D.h"
+#include "viewer/opengl/texture3d.h"
 
+#include <cstdint>
 #include <memory>
 #include <filesystem>
+#include <vector>
 
 namespace opengl { class context; }
+namespace core { class mapped_file; }
 
 
 namespace asset
 {
 
+enum class voxel_type
+{
+    uint8,
+    uint16
+};
+
+/* cpu side scalar volume (x fastest, z slowest); voxels either live in a read-only file mapping or in owned memory */
+class volume
+{
+private:
+    std::shared_ptr<core::mapped_file> m_file;
+    std::vector<std::uint8_t> m_storage;
+
+    const std::uint8_t* m_voxels{nullptr};
+    glm::uvec3 m_size{0, 0, 0};
+    voxel_type m_type{voxel_type::uint8};
+
+public:
+    volume(const glm::uvec3& size, voxel_type type);
+    volume(const std::shared_ptr<core::mapped_file>& file, std::size_t offset, const glm::uvec3& size, voxel_type type);
+
+    const glm::uvec3& size() const;
+    voxel_type type() const;
+
+    std::size_t voxel_bytes() const;
+    std::size_t slice_bytes() const;
+    std::size_t bytes() const;
+
+    const std::uint8_t* ptr() const;
+    const std::uint8_t* slice(unsigned int z) const;
+
+    /* only valid for volumes with owned memory */
+    std::uint8_t* data();
+
+    /* raw voxel value and value normalized to [0, 1] */
+    unsigned int raw(unsigned int x, unsigned int y, unsigned int z) const;
+    float value(unsigned int x, unsigned int y, unsigned int z) const;
+};
+
+/* per brick min / max of the normalized voxel values (16 bit), bricks are extended by one voxel into their
+   neighbours so that trilinear samples inside a brick never exceed its range */
+struct brick_grid
+{
+    glm::uvec3 size{0, 0, 0};
+    unsigned int brick_size{8};
+    std::vector<glm::u16vec2> range;
+};
+
+enum class gradient_format
+{
+    rgba8,
+    rgba16f
+};
+
+/* central difference gradients in normalized voxel units: rgb holds the direction (xyz * 0.5 + 0.5) and alpha the
+   magnitude; rgba16f keeps the same encoding with more precision (for 16 bit volumes) */
+struct gradient_volume
+{
+    glm::uvec3 size{0, 0, 0};
+    gradient_format format{gradient_format::rgba8};
+    std::vector<std::uint8_t> data;
+};
+
+/* histogram of the normalized voxel values and their range */
+struct volume_histogram
+{
+    float min{0.0f};
+    float max{0.0f};
+    std::vector<std::uint64_t> bins;
+
+    float bin_center(std::size_t bin) const;
+
+    /* valley between the dominant (background) peak and the next structure */
+    float suggest_iso() const;
+};
+
 class volume_loader
 {
 public:
     using result_type = std::shared_ptr<opengl::texture_3D>;
+    using result_type_cpu = std::shared_ptr<volume>;
+
+    /* voxel type is derived from the file size (one or two bytes per voxel) */
+    static result_type_cpu map_raw(const std::filesystem::path& path, const glm::uvec3& size);
+    static result_type_cpu map_dat(const std::filesystem::path& path);
+
+    /* r8 / r16 texture matching the voxel type, uploaded in slabs through pixel unpack buffers */
+    static result_type load(opengl::context& context, const volume& vol);
+
+    /* min / max occupancy grid for empty space skipping (rg16 texture, one texel per brick) */
+    static brick_grid compute_bricks(const volume& vol, unsigned int brick_size = 8);
+    static result_type load(opengl::context& context, const brick_grid& bricks);
+
+    /* gradient texture (linear filtering) and value histogram, both computed in parallel over z slabs */
+    static gradient_volume compute_gradients(const volume& vol, gradient_format format = gradient_format::rgba8);
+    static result_type load(opengl::context& context, const gradient_volume& gradients);
+    static volume_histogram compute_histogram(const volume& vol, unsigned int bins = 256);
 
     static result_type load_raw(opengl::context& context, const std::filesystem::path& path, const glm::uvec3& size);
     static result_type load_dat(opengl::context& context, const std::filesystem::path& path);
 };
 
 }
-
-
@@ -0,0 +1,374 @@
+#include "volume_series.h"
+
+#include "viewer/core/log.h"
+#include "viewer/core/mapped_file.h"
+#include "viewer/core/parallel.h"
+#include "viewer/core/time.h"
+#include "viewer/opengl/buffer.h"
+#include "viewer/opengl/context.h"
+#include "viewer/opengl/fence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace asset
+{
+
+/*========================== volume_series ==========================*/
+volume_series::volume_series(opengl::context& context, std::vector<std::filesystem::path> steps, const glm::uvec3& size, voxel_type type, std::size_t prefetch)
+    : m_context(context), m_steps(std::move(steps)), m_size(size), m_type(type),
+      m_bytes(static_cast<std::size_t>(size.x) * size.y * size.z * (type == voxel_type::uint8 ? 1 : 2)),
+      m_prefetch(std::clamp<std::size_t>(prefetch, 1, std::max<std::size_t>(m_steps.size(), 1)))
+{
+    auto internal = type == voxel_type::uint8 ? opengl::texture_internal_type::r8 : opengl::texture_internal_type::r16;
+    auto texel = type == voxel_type::uint8 ? opengl::texture_type::unsigned_byte_ : opengl::texture_type::unsigned_short_;
+
+    for(auto& stage : m_stages)
+    {
+        stage.texture = context.make_texture_3D(internal, opengl::texture_format::red, texel, size.x, size.y, size.z);
+        stage.texture->parameter(opengl::wrap_coord::wrap_s, opengl::wrapping::edge);
+        stage.texture->parameter(opengl::wrap_coord::wrap_t, opengl::wrapping::edge);
+        stage.texture->parameter(opengl::wrap_coord::wrap_r, opengl::wrapping::edge);
+
+        stage.staging = context.make_buffer<std::uint8_t>(opengl::buffer_target::pixel_unpack, m_bytes, opengl::buffer_usage::stream_draw);
+        stage.staging->unbind();
+        stage.fence = context.make_fence();
+    }
+
+    m_worker = std::thread(&volume_series::prefetch, this);
+}
+
+volume_series::~volume_series()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_condition.notify_all();
+    m_worker.join();
+}
+
+bool volume_series::update(double dt)
+{
+    if(m_steps.empty()) { return false; }
+
+    /* frame rate independent playback position */
+    const double count = static_cast<double>(m_steps.size());
+    if(m_playing)
+    {
+        m_time += dt * m_speed;
+        if(m_loop)
+        {
+            m_time = std::fmod(m_time, count);
+        }
+        else if(m_time >= count - 1.0)
+        {
+            m_time = count - 1.0;
+            m_playing = false;
+        }
+    }
+
+    const std::size_t want = wanted();
+    m_stats.wanted = want;
+
+    /* move the prefetch window along */
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_first != want)
+        {
+            m_first = want;
+            m_condition.notify_one();
+        }
+        m_stats.cached = m_cache.size();
+        m_stats.read_mb_s = m_read_seconds > 0.0 ? m_read_bytes / (1024.0 * 1024.0) / m_read_seconds : 0.0;
+    }
+
+    bool changed = false;
+    auto* front = &m_stages[m_front];
+    auto* back = &m_stages[1 - m_front];
+
+    /* 1. display the back texture once its upload completed and playback reached it */
+    if(back->step != npos && back->fence->signaled())
+    {
+        std::size_t back_distance = distance(front->step, back->step);
+        if(front->step == npos || (back_distance > 0 && back_distance <= distance(front->step, want)))
+        {
+            if(front->step != npos && m_count_drops)
+            {
+                m_stats.dropped += back_distance - 1;
+            }
+            m_count_drops = true;
+
+            m_front = 1 - m_front;
+            std::swap(front, back);
+            back->step = npos;
+
+            m_stats.shown++;
+            changed = true;
+        }
+    }
+
+    /* 2. upload the wanted step, or the one after it if the wanted step is displayed */
+    std::size_t target = front->step == want ? next(want) : want;
+    bool in_flight = back->step != npos && !back->fence->signaled();
+    if(target != npos && back->step != target && !in_flight)
+    {
+        if(auto data = cached(target))
+        {
+            auto start = core::clock::now();
+
+            auto* dst = back->staging->map(0, static_cast<unsigned int>(m_bytes), opengl::buffer_access::write | opengl::buffer_access::invalidate_buffer);
+            if(dst)
+            {
+                core::parallel_for(0, m_bytes, 1 << 20, [&](std::size_t begin, std::size_t end)
+                {
+                    std::memcpy(dst + begin, data->data() + begin, end - begin);
+                });
+                back->staging->unmap();
+
+                auto alignment = m_context.unpack_alignment(1);
+                back->texture->sub_data(nullptr, 0, 0, 0, m_size.x, m_size.y, m_size.z);
+                m_context.unpack_alignment(alignment);
+            }
+            else
+            {
+                platform_log(core::log::level::warning, "[asset::volume_series] Unable to map pixel unpack buffer, uploading without staging");
+                back->staging->unbind();
+
+                auto alignment = m_context.unpack_alignment(1);
+                back->texture->sub_data(data->data(), 0, 0, 0, m_size.x, m_size.y, m_size.z);
+                m_context.unpack_alignment(alignment);
+            }
+            back->staging->unbind();
+
+            back->fence->insert();
+            back->step = target;
+
+            m_stats.upload_ms = core::time_cast<core::milli_sec>(core::clock::now() - start);
+        }
+    }
+
+    /* 3. the wanted step is not on screen this frame */
+    if(front->step != want)
+    {
+        m_stats.stalled++;
+    }
+
+    return changed;
+}
+
+void volume_series::play(bool value)
+{
+    m_playing = value;
+}
+
+bool volume_series::playing() const
+{
+    return m_playing;
+}
+
+void volume_series::speed(float steps_per_second)
+{
+    m_speed = std::max(steps_per_second, 0.0f);
+}
+
+float volume_series::speed() const
+{
+    return m_speed;
+}
+
+void volume_series::loop(bool value)
+{
+    /* read by the prefetch worker to wrap its window */
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_loop = value;
+}
+
+bool volume_series::loop() const
+{
+    return m_loop;
+}
+
+void volume_series::seek(std::size_t step)
+{
+    if(m_steps.empty()) { return; }
+
+    m_time = static_cast<double>(std::min(step, m_steps.size() - 1));
+
+    /* a pending upload of the old position is discarded, the jump itself is no drop */
+    auto& back = m_stages[1 - m_front];
+    back.fence->reset();
+    back.step = npos;
+    m_count_drops = false;
+}
+
+std::size_t volume_series::steps() const
+{
+    return m_steps.size();
+}
+
+std::size_t volume_series::current() const
+{
+    return m_stages[m_front].step;
+}
+
+const std::filesystem::path& volume_series::path(std::size_t step) const
+{
+    return m_steps[step];
+}
+
+const glm::uvec3& volume_series::size() const
+{
+    return m_size;
+}
+
+voxel_type volume_series::type() const
+{
+    return m_type;
+}
+
+const opengl::handle<opengl::texture_3D>& volume_series::texture() const
+{
+    return m_stages[m_front].texture;
+}
+
+const volume_series::statistics& volume_series::stats() const
+{
+    return m_stats;
+}
+
+void volume_series::prefetch()
+{
+    while(true)
+    {
+        std::size_t step = npos;
+        std::shared_ptr<std::vector<std::uint8_t>> buffer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [&]()
+            {
+                return m_quit || (step = next_missing()) != npos;
+            });
+            if(m_quit) { return; }
+
+            /* steps behind the window are recycled before anything new is read; a step still being uploaded is
+               shared with the render thread and dropped instead (freed with its last reference) */
+            for(auto it = m_cache.begin(); it != m_cache.end();)
+            {
+                if(distance(m_first, it->first) >= m_prefetch)
+                {
+                    if(it->second.use_count() == 1) { m_pool.push_back(std::move(it->second)); }
+                    it = m_cache.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            if(m_pool.empty())
+            {
+                buffer = std::make_shared<std::vector<std::uint8_t>>(m_bytes);
+            }
+            else
+            {
+                buffer = std::move(m_pool.back());
+                m_pool.pop_back();
+            }
+        }
+
+        auto start = core::clock::now();
+
+        core::mapped_file file;
+        if(file.open(m_steps[step]) && file.size() == m_bytes)
+        {
+            file.sequential();
+            std::memcpy(buffer->data(), file.data(), m_bytes);
+        }
+        else
+        {
+            platform_log(core::log::level::error, "[asset::volume_series] Unable to read time step {0}", m_steps[step].string());
+            std::fill(buffer->begin(), buffer->end(), 0);
+        }
+
+        auto elapsed = core::time_cast<core::sec>(core::clock::now() - start);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache[step] = std::move(buffer);
+        m_read_bytes += static_cast<double>(m_bytes);
+        m_read_seconds += elapsed;
+    }
+}
+
+std::size_t volume_series::next_missing() const
+{
+    std::size_t step = m_first;
+    for(std::size_t i = 0; i < m_prefetch && step != npos; i++, step = next(step))
+    {
+        if(m_cache.find(step) == m_cache.end()) { return step; }
+    }
+
+    return npos;
+}
+
+std::shared_ptr<std::vector<std::uint8_t>> volume_series::cached(std::size_t step)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_cache.find(step);
+    return it != m_cache.end() ? it->second : nullptr;
+}
+
+std::size_t volume_series::wanted() const
+{
+    return std::min(static_cast<std::size_t>(m_time), m_steps.size() - 1);
+}
+
+std::size_t volume_series::next(std::size_t step) const
+{
+    if(step + 1 < m_steps.size()) { return step + 1; }
+    return m_loop ? 0 : npos;
+}
+
+std::size_t volume_series::distance(std::size_t from, std::size_t to) const
+{
+    return (to + m_steps.size() - from) % m_steps.size();
+}
+
+
+/*========================== volume_series_loader ==========================*/
+volume_series_loader::result_type volume_series_loader::load(opengl::context& context, const std::filesystem::path& directory, const glm::uvec3& size, std::size_t prefetch)
+{
+    std::error_code error;
+    std::vector<std::filesystem::path> steps;
+    for(const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if(entry.is_regular_file() && entry.path().extension() == ".raw")
+        {
+            steps.push_back(entry.path());
+        }
+    }
+
+    if(error || steps.empty())
+    {
+        platform_log(core::log::level::error, "[asset::volume_series] No raw time steps found in {0}", directory.string());
+        return nullptr;
+    }
+    std::sort(steps.begin(), steps.end());
+
+    const std::size_t voxels = static_cast<std::size_t>(size.x) * size.y * size.z;
+    const auto bytes = std::filesystem::file_size(steps.front(), error);
+    if(error || (bytes != voxels && bytes != 2 * voxels))
+    {
+        platform_log(core::log::level::error, "[asset::volume_series] Time step size does not match the volume size {0}", steps.front().string());
+        return nullptr;
+    }
+
+    auto type = bytes == voxels ? voxel_type::uint8 : voxel_type::uint16;
+    platform_log(core::log::level::info, "[asset::volume_series] {} time steps of {}x{}x{} ({}) in {}",
+                 steps.size(), size.x, size.y, size.z, type == voxel_type::uint8 ? "uint8" : "uint16", directory.string());
+
+    return std::make_shared<volume_series>(context, std::move(steps), size, type, prefetch);
+}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "viewer/asset/volume.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace opengl { class context; class fence; template<typename T> class buffer; }
+
+
+namespace asset
+{
+
+/*========================== volume_series ==========================*/
+/* time varying volume with one raw file per time step: upcoming steps are read on a background thread into a
+   small cpu cache, the render thread copies a cached step into a pixel unpack buffer and uploads it into the back
+   of two texture_3Ds; a fence tells when the back texture can be displayed, so update() never waits on the disk
+   or the gpu and late steps are either shown later (stalled) or skipped (dropped) */
+class volume_series
+{
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    struct statistics
+    {
+        std::size_t wanted{0};
+        std::size_t shown{0};
+        std::size_t dropped{0};
+        std::size_t stalled{0};
+        std::size_t cached{0};
+        double read_mb_s{0.0};
+        double upload_ms{0.0};
+    };
+
+private:
+    /* texture with its staging buffer, fence and the time step it holds */
+    struct stage
+    {
+        opengl::handle<opengl::texture_3D> texture;
+        opengl::handle<opengl::buffer<std::uint8_t>> staging;
+        opengl::handle<opengl::fence> fence;
+        std::size_t step{npos};
+    };
+
+    opengl::context& m_context;
+
+    std::vector<std::filesystem::path> m_steps;
+    glm::uvec3 m_size;
+    voxel_type m_type;
+    std::size_t m_bytes;
+
+    stage m_stages[2];
+    unsigned int m_front{0};
+    bool m_count_drops{true};
+
+    /* playback position in time steps */
+    double m_time{0.0};
+    float m_speed{10.0f};
+    bool m_playing{true};
+    bool m_loop{true};
+
+    /* prefetch window [m_first, m_first + m_prefetch) shared with the worker */
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_quit{false};
+    std::size_t m_first{0};
+    std::size_t m_prefetch;
+    std::map<std::size_t, std::shared_ptr<std::vector<std::uint8_t>>> m_cache;
+    std::vector<std::shared_ptr<std::vector<std::uint8_t>>> m_pool;
+    double m_read_bytes{0.0};
+    double m_read_seconds{0.0};
+
+    statistics m_stats;
+
+public:
+    volume_series(opengl::context& context, std::vector<std::filesystem::path> steps, const glm::uvec3& size, voxel_type type, std::size_t prefetch = 4);
+    ~volume_series();
+
+    volume_series(const volume_series&) = delete;
+    volume_series& operator=(const volume_series&) = delete;
+
+    /* advances playback by dt seconds (frame rate independent) and schedules uploads;
+       returns true if the displayed time step changed */
+    bool update(double dt);
+
+    void play(bool value);
+    bool playing() const;
+    void speed(float steps_per_second);
+    float speed() const;
+    void loop(bool value);
+    bool loop() const;
+    void seek(std::size_t step);
+
+    std::size_t steps() const;
+    std::size_t current() const;
+    const std::filesystem::path& path(std::size_t step) const;
+    const glm::uvec3& size() const;
+    voxel_type type() const;
+
+    /* texture of the displayed time step */
+    const opengl::handle<opengl::texture_3D>& texture() const;
+    const statistics& stats() const;
+
+private:
+    void prefetch();
+    std::size_t next_missing() const;
+    std::shared_ptr<std::vector<std::uint8_t>> cached(std::size_t step);
+
+    std::size_t wanted() const;
+    std::size_t next(std::size_t step) const;
+    std::size_t distance(std::size_t from, std::size_t to) const;
+};
+
+class volume_series_loader
+{
+public:
+    using result_type = std::shared_ptr<volume_series>;
+
+    /* all .raw files of a directory in lexicographic order; the voxel type is derived from the first file */
+    static result_type load(opengl::context& context, const std::filesystem::path& directory, const glm::uvec3& size, std::size_t prefetch = 4);
+};
+
+}
@@ -29,11 +29,31 @@ time frameclock::restart()
     return m_elapsed;
 }
 
+unsigned int frameclock::sample_depth() const
+{
+    return static_cast<unsigned int>(m_buffer.size());
+}
+
 time frameclock::dt() const
 {
     return m_elapsed;
 }
 
+time frameclock::min() const
+{
+    return m_time.m_min;
+}
+
+time frameclock::max() const
+{
+    return m_time.m_max;
+}
+
+time frameclock::avg() const
+{
+    return m_time.m_avg;
+}
+
 float frameclock::fps() const
 {
     return m_freq.m_avg;
@@ -0,0 +1,194 @@
+#include "mapped_file.h"
+
+#include "viewer/core/log.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace core
+{
+
+mapped_file::mapped_file(const std::filesystem::path& path)
+{
+    open(path);
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+{
+    swap(other);
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if(this != &other)
+    {
+        close();
+        swap(other);
+    }
+
+    return *this;
+}
+
+#if defined(_WIN32)
+
+bool mapped_file::open(const std::filesystem::path& path)
+{
+    close();
+
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        platform_log(core::log::level::error, "[core::mapped_file] Couldn't open file {0}", path.string());
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        platform_log(core::log::level::error, "[core::mapped_file] Empty file or unknown size {0}", path.string());
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping == nullptr)
+    {
+        CloseHandle(file);
+        platform_log(core::log::level::error, "[core::mapped_file] Couldn't create file mapping {0}", path.string());
+        return false;
+    }
+
+    auto* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        platform_log(core::log::level::error, "[core::mapped_file] Couldn't map view of file {0}", path.string());
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const std::uint8_t*>(view);
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    return true;
+}
+
+void mapped_file::close()
+{
+    if(m_data) { UnmapViewOfFile(m_data); }
+    if(m_mapping) { CloseHandle(m_mapping); }
+    if(m_file) { CloseHandle(m_file); }
+
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+
+void mapped_file::sequential() const
+{
+    /* FILE_FLAG_SEQUENTIAL_SCAN is set on open */
+}
+
+void mapped_file::swap(mapped_file& other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+}
+
+#else
+
+bool mapped_file::open(const std::filesystem::path& path)
+{
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+        platform_log(core::log::level::error, "[core::mapped_file] Couldn't open file {0}", path.string());
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        ::close(file);
+        platform_log(core::log::level::error, "[core::mapped_file] Empty file or unknown size {0}", path.string());
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    if(view == MAP_FAILED)
+    {
+        ::close(file);
+        platform_log(core::log::level::error, "[core::mapped_file] Couldn't map file {0}", path.string());
+        return false;
+    }
+
+    m_file = file;
+    m_data = static_cast<const std::uint8_t*>(view);
+    m_size = static_cast<std::size_t>(info.st_size);
+
+    return true;
+}
+
+void mapped_file::close()
+{
+    if(m_data) { munmap(const_cast<std::uint8_t*>(m_data), m_size); }
+    if(m_file >= 0) { ::close(m_file); }
+
+    m_data = nullptr;
+    m_file = -1;
+    m_size = 0;
+}
+
+void mapped_file::sequential() const
+{
+    if(m_data) { madvise(const_cast<std::uint8_t*>(m_data), m_size, MADV_SEQUENTIAL); }
+}
+
+void mapped_file::swap(mapped_file& other) noexcept
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_file, other.m_file);
+}
+
+#endif
+
+bool mapped_file::is_open() const
+{
+    return m_data != nullptr;
+}
+
+const std::uint8_t* mapped_file::data() const
+{
+    return m_data;
+}
+
+std::size_t mapped_file::size() const
+{
+    return m_size;
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace core
+{
+
+/* read-only memory mapping of a file (pages are loaded lazily by the os) */
+class mapped_file
+{
+private:
+    const std::uint8_t* m_data{nullptr};
+    std::size_t m_size{0};
+
+#if defined(_WIN32)
+    void* m_file{nullptr};
+    void* m_mapping{nullptr};
+#else
+    int m_file{-1};
+#endif
+
+public:
+    mapped_file() = default;
+    explicit mapped_file(const std::filesystem::path& path);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    /* hint that the mapping is read front to back (enables aggressive read-ahead) */
+    void sequential() const;
+
+    bool is_open() const;
+    const std::uint8_t* data() const;
+    std::size_t size() const;
+
+private:
+    void swap(mapped_file& other) noexcept;
+};
+
+}
@@ -0,0 +1,35 @@
+#include "memory.h"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+namespace core
+{
+
+std::size_t peak_memory()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return static_cast<std::size_t>(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        /* kilobytes on linux */
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+    }
+    return 0;
+#endif
+}
+
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+namespace core
+{
+
+/* peak resident set size of the process in bytes (0 if unavailable) */
+std::size_t peak_memory();
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace core
+{
+
+inline unsigned int hardware_threads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/* splits [begin, end) into blocks of 'grain' items which are handed out to all hardware threads;
+   func(block_begin, block_end) is invoked once per block (the calling thread participates) */
+template<typename Func>
+void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, Func&& func)
+{
+    if(end <= begin) { return; }
+
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t num_blocks = (end - begin + grain - 1) / grain;
+    const std::size_t num_threads = std::min<std::size_t>(hardware_threads(), num_blocks);
+
+    std::atomic<std::size_t> next_block{0};
+    auto worker = [&]()
+    {
+        for(std::size_t block = next_block++; block < num_blocks; block = next_block++)
+        {
+            std::size_t block_begin = begin + block * grain;
+            std::size_t block_end = std::min(end, block_begin + grain);
+            func(block_begin, block_end);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for(std::size_t i = 1; i < num_threads; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+/* sse2 is part of every x86-64 target; other architectures fall back to the scalar paths */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CORE_SIMD_SSE2
+#endif
@@ -21,6 +21,11 @@ enum class buffer_access : GLenum
     unsynchronized      = GL_MAP_UNSYNCHRONIZED_BIT
 };
 
+inline buffer_access operator | (buffer_access lhs, buffer_access rhs)
+{
+    return static_cast<buffer_access>(static_cast<GLenum>(lhs) | static_cast<GLenum>(rhs));
+}
+
 enum class buffer_usage : GLenum
 {
     stream_draw = GL_STREAM_DRAW,
@@ -49,7 +54,9 @@ enum class buffer_target : GLenum
     uniform             = GL_UNIFORM_BUFFER,
     transform_feedback  = GL_TRANSFORM_FEEDBACK_BUFFER,
     query               = GL_QUERY_BUFFER,
-    atomic_counter      = GL_ATOMIC_COUNTER_BUFFER
+    atomic_counter      = GL_ATOMIC_COUNTER_BUFFER,
+    pixel_pack          = GL_PIXEL_PACK_BUFFER,
+    pixel_unpack        = GL_PIXEL_UNPACK_BUFFER
 };
 
 
@@ -63,6 +70,7 @@ protected:
 
     GLuint m_handle;
     size_t m_num_items;
+    bool m_mapped{false};
 
     buffer(context &context, buffer_target target, buffer_usage usage);
     buffer(context &context, buffer_target target, size_t number, buffer_usage usage);
@@ -89,6 +97,13 @@ public:
     void data(unsigned int offsetItems, std::initializer_list<T> items);
     void data(unsigned int offsetItems, const std::vector<T>& items);
 
+    /* gpu side copy from another buffer, the data never passes the host */
+    void copy(unsigned int offsetItems, const buffer<T>& source, unsigned int sourceOffsetItems, unsigned int numItems);
+
+    T* map(buffer_access access);
+    T* map(unsigned int offsetItems, unsigned int numItems, buffer_access access);
+    void unmap();
+
     void bind();
     void unbind();
 
@@ -188,6 +203,12 @@ size_t buffer<T>::size() const
     return m_num_items;
 }
 
+template <typename T>
+bool buffer<T>::mapped() const
+{
+    return m_mapped;
+}
+
 template <typename T>
 void buffer<T>::data(const T* items, unsigned int number)
 {
@@ -248,6 +269,47 @@ void buffer<T>::data(unsigned int offsetItems, const std::vector<T>& items)
     glBufferSubData(static_cast<GLenum>(m_target), offsetBytes, numBytes, items.data());
 }
 
+template <typename T>
+void buffer<T>::copy(unsigned int offsetItems, const buffer<T>& source, unsigned int sourceOffsetItems, unsigned int numItems)
+{
+    size_t offsetBytes = offsetItems * sizeof(T);
+    size_t sourceOffsetBytes = sourceOffsetItems * sizeof(T);
+    size_t numBytes = numItems * sizeof(T);
+
+    m_context.bind_buffer(GL_COPY_READ_BUFFER, source.m_handle);
+    m_context.bind_buffer(GL_COPY_WRITE_BUFFER, m_handle);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffsetBytes, offsetBytes, numBytes);
+}
+
+template <typename T>
+T* buffer<T>::map(buffer_access access)
+{
+    return map(0, static_cast<unsigned int>(m_num_items), access);
+}
+
+template <typename T>
+T* buffer<T>::map(unsigned int offsetItems, unsigned int numItems, buffer_access access)
+{
+    size_t offsetBytes = offsetItems * sizeof(T);
+    size_t numBytes = numItems * sizeof(T);
+
+    bind();
+    auto* ptr = glMapBufferRange(static_cast<GLenum>(m_target), offsetBytes, numBytes, static_cast<GLbitfield>(access));
+    m_mapped = (ptr != nullptr);
+
+    return static_cast<T*>(ptr);
+}
+
+template <typename T>
+void buffer<T>::unmap()
+{
+    if(!m_mapped) { return; }
+
+    bind();
+    glUnmapBuffer(static_cast<GLenum>(m_target));
+    m_mapped = false;
+}
+
 template <typename T>
 void buffer<T>::bind()
 {
@@ -7,6 +7,8 @@
 
 #include "shaderprogram.h"
 #include "vertexarray.h"
+#include "fence.h"
+#include "query.h"
 
 #include <sstream>
 
@@ -192,6 +194,17 @@ const std::string &context::renderer() const
     return m_renderer;
 }
 
+bool context::extension(const std::string& name) const
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for(GLint i = 0; i < count; i++)
+    {
+        if(name == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i))) { return true; }
+    }
+    return false;
+}
+
 bool context::set(options option, bool enable)
 {
     auto current = m_options[option];
@@ -256,6 +269,19 @@ std::pair<blend_func_factor_alpha, blend_func_factor_alpha> context::set(blend_f
     return previous;
 }
 
+depth_func context::set(depth_func func)
+{
+    auto previous = m_depth_func;
+    m_depth_func = func;
+
+    if(previous != func)
+    {
+        glDepthFunc(static_cast<GLenum>(m_depth_func));
+    }
+
+    return previous;
+}
+
 polygon_mode context::set(polygon_mode mode)
 {
     auto previous = m_polygon_mode;
@@ -360,6 +386,19 @@ float context::point_size(float size)
     return previous;
 }
 
+int context::unpack_alignment(int alignment)
+{
+    auto previous = m_unpack_alignment;
+    m_unpack_alignment = alignment;
+
+    if(previous != alignment)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    }
+
+    return previous;
+}
+
 void context::clear_color(float r, float g, float b, float a)
 {
     m_clear_color[0] = r;
@@ -379,6 +418,16 @@ void context::swap_framebuffer()
     m_window.display();
 }
 
+void context::read_pixels(int x, int y, int width, int height, unsigned char* rgba)
+{
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+}
+
+void context::read_pixels(int x, int y, int width, int height, float* rgba)
+{
+    glReadPixels(x, y, width, height, GL_RGBA, GL_FLOAT, rgba);
+}
+
 void context::bind_vertexarray(GLuint handle)
 {
     glBindVertexArray(handle);
@@ -449,6 +498,16 @@ void context::draw_array(primitives mode, GLsizei count, GLsizei first)
     glDrawArrays(static_cast<GLenum>(mode), first, count * detail::primitive_size(mode));
 }
 
+void context::dispatch_compute(GLuint groups_x, GLuint groups_y, GLuint groups_z)
+{
+    glDispatchCompute(groups_x, groups_y, groups_z);
+}
+
+void context::barrier(memory_barrier barriers)
+{
+    glMemoryBarrier(static_cast<GLbitfield>(barriers));
+}
+
 std::shared_ptr<shader_program> context::make_shader()
 {
     return std::shared_ptr<shader_program>(new shader_program(*this));
@@ -459,6 +518,16 @@ std::shared_ptr<vertexarray> context::make_vertexarray()
     return std::shared_ptr<vertexarray>(new vertexarray(*this));
 }
 
+std::shared_ptr<fence> context::make_fence()
+{
+    return std::shared_ptr<fence>(new fence(*this));
+}
+
+std::shared_ptr<timer_query> context::make_timer_query()
+{
+    return std::shared_ptr<timer_query>(new timer_query(*this));
+}
+
 context::context(glfw::window& window)
     : m_window(window)
 {   
@@ -509,12 +578,14 @@ context::context(glfw::window& window)
     m_blend_func[1] = static_cast<blend_func_factor_alpha>(detail::query_int(GL_BLEND_DST_ALPHA));
 
     m_polygon_mode = static_cast<polygon_mode>(detail::query_int2(GL_POLYGON_MODE)[0]);
+    m_depth_func = static_cast<depth_func>(detail::query_int(GL_DEPTH_FUNC));
 
     m_viewport = detail::query_int4(GL_VIEWPORT);
 
     m_scissor = detail::query_int4(GL_SCISSOR_BOX);
     m_line_width = detail::query_float(GL_LINE_WIDTH);
     m_point_size = detail::query_float(GL_POINT_SIZE);
+    m_unpack_alignment = detail::query_int(GL_UNPACK_ALIGNMENT);
 }
 
 
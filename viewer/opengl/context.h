@@ -18,9 +18,13 @@ namespace opengl
 class shader_program;
 class vertexarray;
 class texture;
+class texture_3D;
+class texture_array;
 class texture_cube;
 class renderbuffer;
 class framebuffer;
+class fence;
+class timer_query;
 
 template<typename T> class buffer;
 template<typename T> class indexbuffer;
@@ -93,6 +97,18 @@ enum class polygon_mode : GLenum
     fill = GL_FILL
 };
 
+enum class depth_func : GLenum
+{
+    never = GL_NEVER,
+    less = GL_LESS,
+    equal = GL_EQUAL,
+    less_equal = GL_LEQUAL,
+    greater = GL_GREATER,
+    not_equal = GL_NOTEQUAL,
+    greater_equal = GL_GEQUAL,
+    always = GL_ALWAYS
+};
+
 enum class blend_equation : GLenum
 {
     add = GL_FUNC_ADD,
@@ -126,6 +142,27 @@ enum class clear_options : GLbitfield
     all = (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT)
 };
 
+enum class memory_barrier : GLbitfield
+{
+    vertex_attrib_array = GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT,
+    element_array = GL_ELEMENT_ARRAY_BARRIER_BIT,
+    uniform = GL_UNIFORM_BARRIER_BIT,
+    texture_fetch = GL_TEXTURE_FETCH_BARRIER_BIT,
+    shader_image_access = GL_SHADER_IMAGE_ACCESS_BARRIER_BIT,
+    command = GL_COMMAND_BARRIER_BIT,
+    pixel_buffer = GL_PIXEL_BUFFER_BARRIER_BIT,
+    texture_update = GL_TEXTURE_UPDATE_BARRIER_BIT,
+    buffer_update = GL_BUFFER_UPDATE_BARRIER_BIT,
+    framebuffer = GL_FRAMEBUFFER_BARRIER_BIT,
+    shader_storage = GL_SHADER_STORAGE_BARRIER_BIT,
+    all = GL_ALL_BARRIER_BITS
+};
+
+inline memory_barrier operator | (memory_barrier lhs, memory_barrier rhs)
+{
+    return static_cast<memory_barrier>(static_cast<GLbitfield>(lhs) | static_cast<GLbitfield>(rhs));
+}
+
 class context
 {
 private:
@@ -141,6 +178,7 @@ private:
 
     polygon_face m_polygon_face;
     polygon_mode m_polygon_mode;
+    depth_func m_depth_func;
 
     std::array<int, 4> m_viewport;
     std::array<int, 4> m_scissor;
@@ -149,6 +187,7 @@ private:
     float m_line_width;
     float m_point_size;
     bool m_depth_mask;
+    int m_unpack_alignment;
 
     GLuint m_shader_binding;
     GLuint m_vertexarray_binding;
@@ -164,6 +203,9 @@ public:
     const std::string& vendor() const;
     const std::string& renderer() const;
 
+    /* driver exposes the extension (e.g. "GL_ARB_shader_viewport_layer_array") */
+    bool extension(const std::string& name) const;
+
     bool set(options option, bool enable);
     bool enable(options option);
     bool disable(options option);
@@ -175,6 +217,7 @@ public:
     std::pair<blend_func_factor_alpha, blend_func_factor_alpha> set(blend_func_factor_alpha src, blend_func_factor_alpha dst);
 
     polygon_mode set(polygon_mode mode);
+    depth_func set(depth_func func);
     polygon_face cull(polygon_face face);
 
     std::array<int, 4> viewport(int x, int y, int width, int height);
@@ -187,11 +230,16 @@ public:
 
     float line_width(float width);
     float point_size(float size);
+    int unpack_alignment(int alignment);
 
     void clear_color(float r, float g, float b, float a);
     void clear(clear_options buffers);
     void swap_framebuffer();
 
+    /* rgba8 / rgba32f pixels of the bound read framebuffer, rows bottom to top */
+    void read_pixels(int x, int y, int width, int height, unsigned char* rgba);
+    void read_pixels(int x, int y, int width, int height, float* rgba);
+
     void bind_vertexarray(GLuint handle);
     void bind_buffer(GLenum bind, GLuint handle);
     void bind_buffer_base(GLenum target, GLuint index, GLuint handle);
@@ -205,8 +253,14 @@ public:
     void draw_elements(primitives mode, GLsizei count, type data_type, GLsizei offset = 0);
     void draw_array(primitives mode, GLsizei count, GLsizei first = 0);
 
+    /* compute shader of the bound program, writes are visible to later commands named in barrier() */
+    void dispatch_compute(GLuint groups_x, GLuint groups_y = 1, GLuint groups_z = 1);
+    void barrier(memory_barrier barriers);
+
     handle<shader_program> make_shader();
     handle<vertexarray> make_vertexarray();
+    handle<fence> make_fence();
+    handle<timer_query> make_timer_query();
 
     template<typename... Args>
     handle<texture> make_texture(Args... args)
@@ -214,6 +268,18 @@ public:
         return handle<texture>( new texture(*this, std::forward<Args>(args)...) );
     }
 
+    template<typename... Args>
+    handle<texture_3D> make_texture_3D(Args... args)
+    {
+        return handle<texture_3D>( new texture_3D(*this, std::forward<Args>(args)...) );
+    }
+
+    template<typename... Args>
+    handle<texture_array> make_texture_array(Args... args)
+    {
+        return handle<texture_array>( new texture_array(*this, std::forward<Args>(args)...) );
+    }
+
     template<typename... Args>
     handle<texture_cube> make_texture_cube(Args... args)
     {
@@ -0,0 +1,50 @@
+#include "fence.h"
+
+namespace opengl
+{
+
+fence::~fence()
+{
+    reset();
+}
+
+fence::fence(context& gl_context)
+    : m_context(gl_context)
+{
+
+}
+
+void fence::insert()
+{
+    reset();
+    m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void fence::reset()
+{
+    if(m_sync)
+    {
+        glDeleteSync(m_sync);
+        m_sync = nullptr;
+    }
+}
+
+bool fence::pending() const
+{
+    return m_sync != nullptr;
+}
+
+bool fence::signaled()
+{
+    return wait(0);
+}
+
+bool fence::wait(std::uint64_t timeout)
+{
+    if(!m_sync) { return true; }
+
+    GLenum result = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+}
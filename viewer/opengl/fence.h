@@ -0,0 +1,42 @@
+#pragma once
+
+#include "context.h"
+
+#include <cstdint>
+
+namespace opengl
+{
+
+/* sync object signaled once the gpu has processed all commands issued before insert() */
+class fence
+{
+private:
+    context& m_context;
+    GLsync m_sync{nullptr};
+
+public:
+    ~fence();
+
+    fence(const fence &) = delete;
+    fence &operator=(const fence &) = delete;
+
+    /* replaces a pending sync object */
+    void insert();
+    void reset();
+
+    /* a sync object was inserted and not reset */
+    bool pending() const;
+
+    /* non blocking poll (flushes the command queue so that the fence is eventually signaled) */
+    bool signaled();
+
+    /* blocks at most timeout nanoseconds */
+    bool wait(std::uint64_t timeout);
+
+private:
+    fence(context& gl_context);
+
+    friend context;
+};
+
+}
@@ -5,6 +5,7 @@
 #include "renderbuffer.h"
 #include "texture.h"
 #include "texturecube.h"
+#include "texture_array.h"
 
 namespace opengl
 {
@@ -112,7 +113,7 @@ void framebuffer::attach_color(GLuint unit, const handle<renderbuffer> &buffer)
     unbind();
 }
 
-void framebuffer::attach_color(GLuint unit, const handle<texture_cube>& texture)
+void framebuffer::attach_color(GLuint unit, const handle<texture_cube>& texture, unsigned int level)
 {
     if(texture->format() == texture_format::depth || texture->format() == texture_format::depth_stencil)
     {
@@ -123,7 +124,24 @@ void framebuffer::attach_color(GLuint unit, const handle<texture_cube>& texture)
     bind();
 
     GLenum attachment = detail::as_color_attachment(unit);
-    glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture->gl_handle(), 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture->gl_handle(), level);
+    check_completed();
+
+    unbind();
+}
+
+void framebuffer::attach_color(GLuint unit, const handle<texture_cube>& texture, cube_face face, unsigned int level)
+{
+    if(texture->format() == texture_format::depth || texture->format() == texture_format::depth_stencil)
+    {
+        platform_log(core::log::level::error, "Can't attach Texture Cube with non color format to framebuffer (as color attachment)");
+        return;
+    }
+
+    bind();
+
+    GLenum attachment = detail::as_color_attachment(unit);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, static_cast<GLenum>(face), texture->gl_handle(), level);
     check_completed();
 
     unbind();
@@ -188,6 +206,48 @@ void framebuffer::attach_depth(const handle<texture_cube>& texture)
     unbind();
 }
 
+void framebuffer::attach_depth(const handle<texture_cube>& texture, cube_face face)
+{
+    bind();
+
+    switch (texture->format()) {
+    case texture_format::depth:
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, static_cast<GLenum>(face), texture->gl_handle(), 0);
+        break;
+
+    case texture_format::depth_stencil:
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, static_cast<GLenum>(face), texture->gl_handle(), 0);
+        break;
+
+    default:
+        platform_log(core::log::level::error, "Can't attach Texture Cube with non depth/stencil format to framebuffer (as depth/stencil attachment)");
+    }
+    check_completed();
+
+    unbind();
+}
+
+void framebuffer::attach_depth(const handle<texture_array>& texture, unsigned int layer)
+{
+    bind();
+
+    switch (texture->format()) {
+    case texture_format::depth:
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture->gl_handle(), 0, layer);
+        break;
+
+    case texture_format::depth_stencil:
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, texture->gl_handle(), 0, layer);
+        break;
+
+    default:
+        platform_log(core::log::level::error, "Can't attach Texture Array with non depth/stencil format to framebuffer (as depth/stencil attachment)");
+    }
+    check_completed();
+
+    unbind();
+}
+
 void framebuffer::bind(framebuffer_bind options)
 {
     m_context.bind_framebuffer(static_cast<GLenum>(options), m_handle);
@@ -288,6 +348,16 @@ void framebuffer::blit_default(int src_x0, int src_y0, int src_x1, int src_y1, i
     unbind();
 }
 
+void framebuffer::blit(framebuffer& target, int x0, int y0, int x1, int y1, blit_mask mask, blit_filter filter)
+{
+    bind(framebuffer_bind::read);
+    target.bind(framebuffer_bind::draw);
+
+    glBlitFramebuffer(x0, y0, x1, y1, x0, y0, x1, y1, static_cast<GLbitfield>(mask), static_cast<GLenum>(filter));
+
+    unbind();
+}
+
 bool framebuffer::completed() const
 {
     return m_complete;
@@ -5,6 +5,8 @@
 namespace opengl
 {
 
+enum class cube_face : GLenum;
+
 enum class framebuffer_bind : GLenum
 {
     read        = GL_READ_FRAMEBUFFER,
@@ -59,11 +61,14 @@ public:
 
     void attach_color(GLuint unit, const handle<texture>& texture);
     void attach_color(GLuint unit, const handle<renderbuffer>& buffer);
-    void attach_color(GLuint unit, const handle<texture_cube>& texture);
+    void attach_color(GLuint unit, const handle<texture_cube>& texture, unsigned int level = 0);
+    void attach_color(GLuint unit, const handle<texture_cube>& texture, cube_face face, unsigned int level = 0);
 
     void attach_depth(const handle<texture>& texture);
     void attach_depth(const handle<renderbuffer>& buffer);
     void attach_depth(const handle<texture_cube>& texture);
+    void attach_depth(const handle<texture_cube>& texture, cube_face face);
+    void attach_depth(const handle<texture_array>& texture, unsigned int layer);
 
     void bind(framebuffer_bind options = framebuffer_bind::read_write);
     void unbind(framebuffer_bind options = framebuffer_bind::read_write);
@@ -80,6 +85,9 @@ public:
     void blit_default(int x0, int y0, int x1, int y1, blit_mask mask, blit_filter filter = blit_filter::nearest);
     void blit_default(int src_x0, int src_y0, int src_x1, int src_y1, int dst_x0, int dst_y0, int dst_x1, int dst_y1, blit_mask mask, blit_filter filter = blit_filter::nearest);
 
+    /* copies the region into the same region of another framebuffer */
+    void blit(framebuffer& target, int x0, int y0, int x1, int y1, blit_mask mask, blit_filter filter = blit_filter::nearest);
+
     bool completed() const;
 
 private:
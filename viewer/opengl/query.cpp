@@ -0,0 +1,66 @@
+#include "query.h"
+
+namespace opengl
+{
+
+timer_query::~timer_query()
+{
+    if(m_handle)
+    {
+        glDeleteQueries(1, &m_handle);
+    }
+}
+
+timer_query::timer_query(context& gl_context)
+    : m_context(gl_context)
+{
+    glGenQueries(1, &m_handle);
+}
+
+void timer_query::begin()
+{
+    glBeginQuery(GL_TIME_ELAPSED, m_handle);
+    m_active = true;
+    m_pending = false;
+}
+
+void timer_query::end()
+{
+    if(!m_active) { return; }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active = false;
+    m_pending = true;
+}
+
+bool timer_query::pending() const
+{
+    return m_pending;
+}
+
+bool timer_query::available()
+{
+    if(!m_pending) { return false; }
+
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(m_handle, GL_QUERY_RESULT_AVAILABLE, &available);
+    if(available == GL_FALSE) { return false; }
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(m_handle, GL_QUERY_RESULT, &elapsed);
+    m_elapsed = elapsed;
+    m_pending = false;
+    return true;
+}
+
+std::uint64_t timer_query::elapsed() const
+{
+    return m_elapsed;
+}
+
+double timer_query::elapsed_ms() const
+{
+    return m_elapsed / 1000000.0;
+}
+
+}
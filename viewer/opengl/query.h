@@ -0,0 +1,46 @@
+#pragma once
+
+#include "context.h"
+
+#include <cstdint>
+
+namespace opengl
+{
+
+/* gpu time elapsed between begin() and end(); the result is polled frames later, reading it early would stall the
+   pipeline (elapsed queries can't be nested, only one may be active at a time) */
+class timer_query
+{
+private:
+    context& m_context;
+    GLuint m_handle{0};
+    bool m_active{false};
+    bool m_pending{false};
+    std::uint64_t m_elapsed{0};
+
+public:
+    ~timer_query();
+
+    timer_query(const timer_query &) = delete;
+    timer_query &operator=(const timer_query &) = delete;
+
+    void begin();
+    void end();
+
+    /* ended and the result not fetched yet */
+    bool pending() const;
+
+    /* non blocking poll, fetches the result once the gpu is done */
+    bool available();
+
+    /* nanoseconds of the last available result */
+    std::uint64_t elapsed() const;
+    double elapsed_ms() const;
+
+private:
+    timer_query(context& gl_context);
+
+    friend context;
+};
+
+}
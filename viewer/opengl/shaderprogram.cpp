@@ -331,6 +331,8 @@ namespace detail
     void uniform(GLint location, GLboolean x, GLboolean y, GLboolean z) { glUniform3i(location, x, y, z); }
     void uniform(GLint location, GLboolean x, GLboolean y, GLboolean z, GLboolean w) { glUniform4i(location, x, y, z, w); }
 
+    void uniform(GLint location, const GLint& v, const std::size_t size) { glUniform1iv(location, size, &v); }
+    void uniform(GLint location, const glm::vec3& v, const std::size_t size) { glUniform3fv(location, size, glm::value_ptr(v)); }
     void uniform(GLint location, const glm::mat4& m, const std::size_t size) { glUniformMatrix4fv(location, size, GL_FALSE, glm::value_ptr(m)); }
 }
 
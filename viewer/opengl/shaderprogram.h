@@ -143,6 +143,8 @@ namespace detail
     void uniform(GLint location, GLboolean x, GLboolean y, GLboolean z);
     void uniform(GLint location, GLboolean x, GLboolean y, GLboolean z, GLboolean w);
 
+    void uniform(GLint location, const GLint& v, const std::size_t size);
+    void uniform(GLint location, const glm::vec3& v, const std::size_t size);
     void uniform(GLint location, const glm::mat4& m, const std::size_t size);
 }
 
@@ -98,6 +98,18 @@ void texture::parameter(texture_color flag, const glm::vec4 &color)
     glTexParameterfv(GL_TEXTURE_2D, static_cast<GLenum>(flag), glm::value_ptr(color));
 }
 
+void texture::parameter(compare_mode mode)
+{
+    bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, static_cast<GLint>(mode));
+}
+
+void texture::parameter(depth_func func)
+{
+    bind();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, static_cast<GLint>(func));
+}
+
 void texture::bind(unsigned int unit) const
 {
     m_context.bind_texture(GL_TEXTURE_2D, m_handle, unit);
@@ -15,26 +15,41 @@ enum class texture_internal_type : GLenum
     r8 = GL_R8,
     r16 = GL_R16,
     r16F = GL_R16F,
+    r32ui = GL_R32UI,
+    rg8 = GL_RG8,
+    rg8_snorm = GL_RG8_SNORM,
+    rg16 = GL_RG16,
+    rg16_snorm = GL_RG16_SNORM,
+    rg16F = GL_RG16F,
+    rg32F = GL_RG32F,
     rgb8 = GL_RGB8,
     rgb8U = GL_RGB8UI,
     rgb16 = GL_RGB16,
     rgb16U = GL_RGB16UI,
     rgb16F = GL_RGB16F,
     rgb32F = GL_RGB32F,
+    r11g11b10f = GL_R11F_G11F_B10F,
     rgba8 = GL_RGBA8,
-    rgba8u = GL_RGB8UI,
+    rgba8u = GL_RGBA8UI,
+    rgb10_a2 = GL_RGB10_A2,
     rgba16 = GL_RGBA16,
     rgba16f = GL_RGBA16F,
+    rgba32f = GL_RGBA32F,
     rgba32ui = GL_RGBA32UI,
     depth = GL_DEPTH_COMPONENT,
+    depth24 = GL_DEPTH_COMPONENT24,
     depth32 = GL_DEPTH_COMPONENT32,
     depth_stencil = GL_DEPTH_STENCIL,
-    depth24_stencil8 = GL_DEPTH24_STENCIL8
+    depth24_stencil8 = GL_DEPTH24_STENCIL8,
+    compressed_red_rgtc1 = GL_COMPRESSED_RED_RGTC1
 };
 
 enum class texture_format : GLenum
 {
     red = GL_RED,
+    red_int = GL_RED_INTEGER,
+    rg = GL_RG,
+    rg_int = GL_RG_INTEGER,
     rgb = GL_RGB,
     rgb_int = GL_RGB_INTEGER,
     rgba = GL_RGBA,
@@ -52,6 +67,7 @@ enum class texture_type : GLenum
     short_ = GL_SHORT,
     unsigned_int_ = GL_UNSIGNED_INT,
     int_ = GL_INT,
+    half_float_ = GL_HALF_FLOAT,
     float_ = GL_FLOAT
 };
 
@@ -92,6 +108,20 @@ enum class mag_filter : GLenum
     linear = GL_LINEAR
 };
 
+/* depth textures sampled by shadow samplers compare against the reference coordinate (function of depth_func) */
+enum class compare_mode : GLenum
+{
+    none = GL_NONE,
+    ref_to_texture = GL_COMPARE_REF_TO_TEXTURE
+};
+
+enum class image_access : GLenum
+{
+    read_only = GL_READ_ONLY,
+    write_only = GL_WRITE_ONLY,
+    read_write = GL_READ_WRITE
+};
+
 enum class pixel_format : GLenum
 {
     stencil = GL_STENCIL_INDEX,
@@ -138,6 +168,8 @@ public:
     void parameter(mag_filter filter);
     void parameter(wrap_coord coord, wrapping wrap);
     void parameter(texture_color flag, const glm::vec4 &color);
+    void parameter(compare_mode mode);
+    void parameter(depth_func func);
 
     void bind(unsigned int unit = 0) const;
     void unbind(unsigned int unit = 0) const;
@@ -61,6 +61,12 @@ void texture_3D::data(const unsigned char* pixels)
     data(pixels, m_size.x, m_size.y, m_size.z);
 }
 
+void texture_3D::sub_data(const unsigned char* pixels, unsigned int x, unsigned int y, unsigned int z, unsigned int width, unsigned int height, unsigned int depth)
+{
+    bind();
+    glTexSubImage3D(GL_TEXTURE_3D, 0, x, y, z, width, height, depth, static_cast<GLenum>(m_format), static_cast<GLenum>(m_type), pixels);
+}
+
 void texture_3D::parameter(min_filter filter)
 {
     bind();
@@ -118,7 +124,13 @@ texture_type texture_3D::type() const
 texture_3D::texture_3D(context& gl_context, texture_internal_type internal, texture_format format, texture_type type, unsigned int width, unsigned int height, unsigned int depth, const glm::vec4& color)
     :  m_context(gl_context), m_internal_type(internal), m_format(format), m_type(type), m_size(width, height, depth)
 {
+    glGenTextures(1, &m_handle);
+    platform_assert(m_handle != 0, "Unable to allocate a new texture handle");
+
+    resize(width, height, depth);
 
+    parameter(min_filter::linear);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 1);
 }
 
 texture_3D::texture_3D(context& gl_context, unsigned int width, unsigned int height, unsigned int depth, const glm::vec4& color)
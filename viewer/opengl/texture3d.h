@@ -34,6 +34,7 @@ public:
 
     void data(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int depth);
     void data(const unsigned char* pixels);
+    void sub_data(const unsigned char* pixels, unsigned int x, unsigned int y, unsigned int z, unsigned int width, unsigned int height, unsigned int depth);
 
     void parameter(min_filter filter);
     void parameter(mag_filter filter);
@@ -0,0 +1,160 @@
+#include "texture_array.h"
+
+#include "viewer/core/assert.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace opengl
+{
+
+texture_array::~texture_array()
+{
+    if (m_handle)
+    {
+        glDeleteTextures(1, &m_handle);
+    }
+}
+
+void texture_array::resize(unsigned int width, unsigned int height, unsigned int layers)
+{
+    data(nullptr, width, height, layers);
+}
+
+const glm::uvec3& texture_array::size() const
+{
+    return m_size;
+}
+
+void texture_array::repeat(bool value)
+{
+    parameter(wrap_coord::wrap_s, value ? wrapping::repeat : wrapping::border);
+    parameter(wrap_coord::wrap_t, value ? wrapping::repeat : wrapping::border);
+}
+
+void texture_array::smooth(bool value)
+{
+    parameter(value ? min_filter::linear : min_filter::nearest);
+    parameter(value ? mag_filter::linear : mag_filter::nearest);
+}
+
+void texture_array::data(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int layers)
+{
+    bind();
+    m_size = {width, height, layers};
+
+    if(compressed())
+    {
+        /* storage only, the blocks follow with compressed_sub_data */
+        const auto bytes = static_cast<GLsizei>(((width + 3) / 4) * ((height + 3) / 4) * 8 * layers);
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, 0, static_cast<GLenum>(m_internal_type), m_size.x, m_size.y, m_size.z, 0, bytes, nullptr);
+        return;
+    }
+
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(m_internal_type), m_size.x, m_size.y, m_size.z, 0,
+                 static_cast<GLenum>(m_format), static_cast<GLenum>(m_type), pixels);
+}
+
+void texture_array::sub_data(const unsigned char* pixels, unsigned int x, unsigned int y, unsigned int layer, unsigned int width, unsigned int height, unsigned int layers)
+{
+    bind();
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, width, height, layers, static_cast<GLenum>(m_format), static_cast<GLenum>(m_type), pixels);
+}
+
+void texture_array::compressed_sub_data(const unsigned char* blocks, unsigned int layer, unsigned int layers, std::size_t bytes)
+{
+    bind();
+    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, m_size.x, m_size.y, layers,
+                              static_cast<GLenum>(m_internal_type), static_cast<GLsizei>(bytes), blocks);
+}
+
+void texture_array::parameter(min_filter filter)
+{
+    bind();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(filter));
+}
+
+void texture_array::parameter(mag_filter filter)
+{
+    bind();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(filter));
+}
+
+void texture_array::parameter(wrap_coord coord, wrapping wrap)
+{
+    bind();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, static_cast<GLenum>(coord), static_cast<GLint>(wrap));
+}
+
+void texture_array::parameter(texture_color flag, const glm::vec4& color)
+{
+    bind();
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, static_cast<GLenum>(flag), glm::value_ptr(color));
+}
+
+void texture_array::parameter(compare_mode mode)
+{
+    bind();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, static_cast<GLint>(mode));
+}
+
+void texture_array::parameter(depth_func func)
+{
+    bind();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, static_cast<GLint>(func));
+}
+
+void texture_array::bind(unsigned int unit) const
+{
+    m_context.bind_texture(GL_TEXTURE_2D_ARRAY, m_handle, unit);
+}
+
+void texture_array::bind_image(unsigned int unit, image_access access, unsigned int level) const
+{
+    glBindImageTexture(unit, m_handle, level, GL_TRUE, 0, static_cast<GLenum>(access), static_cast<GLenum>(m_internal_type));
+}
+
+void texture_array::unbind(unsigned int unit) const
+{
+    m_context.bind_texture(GL_TEXTURE_2D_ARRAY, 0, unit);
+}
+
+GLuint texture_array::gl_handle() const
+{
+    return m_handle;
+}
+
+texture_internal_type texture_array::internal_format_type() const
+{
+    return m_internal_type;
+}
+
+texture_format texture_array::format() const
+{
+    return m_format;
+}
+
+texture_type texture_array::type() const
+{
+    return m_type;
+}
+
+bool texture_array::compressed() const
+{
+    return m_internal_type == texture_internal_type::compressed_red_rgtc1;
+}
+
+texture_array::texture_array(context& gl_context, texture_internal_type internal, texture_format format, texture_type type, unsigned int width, unsigned int height, unsigned int layers)
+    :  m_context(gl_context), m_internal_type(internal), m_format(format), m_type(type), m_size(width, height, layers)
+{
+    glGenTextures(1, &m_handle);
+    platform_assert(m_handle != 0, "Unable to allocate a new texture handle");
+
+    resize(width, height, layers);
+
+    smooth();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    parameter(wrap_coord::wrap_s, wrapping::edge);
+    parameter(wrap_coord::wrap_t, wrapping::edge);
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "texture.h"
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+
+namespace opengl
+{
+
+/* 2D texture array (GL_TEXTURE_2D_ARRAY), size is width, height and number of layers; also holds block compressed
+   formats which are not available for 3D textures */
+class texture_array final
+{
+private:
+    context& m_context;
+    GLuint m_handle;
+    texture_internal_type m_internal_type;
+    texture_format m_format;
+    texture_type m_type;
+    glm::uvec3 m_size = {1, 1, 1};
+
+public:
+    ~texture_array();
+
+    texture_array(const texture_array &) = delete;
+    texture_array &operator=(const texture_array &) = delete;
+
+    void resize(unsigned int width, unsigned int height, unsigned int layers);
+    const glm::uvec3& size() const;
+
+    void repeat(bool value = true);
+    void smooth(bool value = true);
+
+    void data(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int layers);
+    void sub_data(const unsigned char* pixels, unsigned int x, unsigned int y, unsigned int layer, unsigned int width, unsigned int height, unsigned int layers);
+
+    /* uploads whole, already compressed layers (bytes for all of them) */
+    void compressed_sub_data(const unsigned char* blocks, unsigned int layer, unsigned int layers, std::size_t bytes);
+
+    void parameter(min_filter filter);
+    void parameter(mag_filter filter);
+    void parameter(wrap_coord coord, wrapping wrap);
+    void parameter(texture_color flag, const glm::vec4 &color);
+    void parameter(compare_mode mode);
+    void parameter(depth_func func);
+
+    void bind(unsigned int unit = 0) const;
+    void unbind(unsigned int unit = 0) const;
+
+    /* all layers of a level as image (load / store in compute shaders) */
+    void bind_image(unsigned int unit, image_access access, unsigned int level = 0) const;
+
+    GLuint gl_handle() const;
+    texture_internal_type internal_format_type() const;
+    texture_format format() const;
+    texture_type type() const;
+    bool compressed() const;
+
+private:
+    texture_array(context& gl_context, texture_internal_type internal, texture_format format, texture_type type,
+                  unsigned int width = 1, unsigned int height = 1, unsigned int layers = 1);
+
+    friend context;
+};
+
+
+}
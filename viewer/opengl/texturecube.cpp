@@ -2,8 +2,11 @@
 
 #include "viewer/core/assert.h"
 
+#include <glm/common.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+
 namespace opengl
 {
 
@@ -44,12 +47,12 @@ void texture_cube::resize(cube_face face, unsigned int width, unsigned int heigh
                  static_cast<GLenum>(m_format), static_cast<GLenum>(m_type), nullptr);
 }
 
-const glm::uvec2& texture_cube::size(cube_face face)
+const glm::uvec2& texture_cube::size(cube_face face) const
 {
     return m_sizes[detail::idx(face)];
 }
 
-const std::array<glm::uvec2, 6>& texture_cube::sizes()
+const std::array<glm::uvec2, 6>& texture_cube::sizes() const
 {
     return m_sizes;
 }
@@ -83,6 +86,35 @@ void texture_cube::data(cube_face face, const unsigned char* pixels)
     data(face, pixels, m_sizes[idx].x, m_sizes[idx].y);
 }
 
+void texture_cube::mip_levels(unsigned int levels)
+{
+    m_levels = std::max(levels, 1u);
+
+    bind();
+    for(unsigned int level = 1; level < m_levels; level++)
+    {
+        for(int idx = 0; idx < 6; idx++)
+        {
+            auto size = glm::max(m_sizes[idx] >> level, glm::uvec2(1));
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + idx, level, static_cast<GLint>(m_internal_type), size.x, size.y, 0,
+                         static_cast<GLenum>(m_format), static_cast<GLenum>(m_type), nullptr);
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+}
+
+unsigned int texture_cube::levels() const
+{
+    return m_levels;
+}
+
+void texture_cube::read(cube_face face, unsigned int level, unsigned char* pixels) const
+{
+    bind();
+    glGetTexImage(static_cast<GLenum>(face), level, static_cast<GLenum>(m_format), static_cast<GLenum>(m_type), pixels);
+}
+
 void texture_cube::parameter(min_filter filter)
 {
     bind();
@@ -29,6 +29,7 @@ private:
     texture_format m_format;
     texture_type m_type;
     std::array<glm::uvec2, 6> m_sizes;
+    unsigned int m_levels = 1;
 
 public:
     ~texture_cube();
@@ -39,8 +40,8 @@ public:
     void create(unsigned int width = 1, unsigned int height = 1, const glm::u8vec4& color = {0, 0, 0, 255});
     void resize(unsigned int width, unsigned int height);
     void resize(cube_face face, unsigned int width, unsigned int height);
-    const glm::uvec2& size(cube_face face);
-    const std::array<glm::uvec2, 6>& sizes();
+    const glm::uvec2& size(cube_face face) const;
+    const std::array<glm::uvec2, 6>& sizes() const;
 
     void repeat(bool value = true);
     void smooth(bool value = true);
@@ -48,6 +49,13 @@ public:
     void data(cube_face face, const unsigned char* pixels, unsigned int width, unsigned int height);
     void data(cube_face face, const unsigned char* pixels);
 
+    /* allocates the levels 1..levels - 1 below the current face sizes (e.g. as render targets of prefiltering) */
+    void mip_levels(unsigned int levels);
+    unsigned int levels() const;
+
+    /* copies a face level to pixels in the format / type of the texture */
+    void read(cube_face face, unsigned int level, unsigned char* pixels) const;
+
     void parameter(min_filter filter);
     void parameter(mag_filter filter);
     void parameter(wrap_coord coord, wrapping wrap);
@@ -4,6 +4,18 @@
 namespace opengl
 {
 
+namespace detail
+{
+
+/* offsets are given in indices, glDrawElements expects bytes into the index buffer */
+inline void* index_offset(size_t offset, GLenum type)
+{
+    size_t bytes = type == GL_UNSIGNED_BYTE ? 1 : (type == GL_UNSIGNED_SHORT ? 2 : 4);
+    return reinterpret_cast<void*>(offset * bytes);
+}
+
+}
+
 GLuint vertexarray::gl_handle()
 {
     return m_handle;
@@ -63,7 +75,39 @@ void vertexarray::draw(size_t offset, size_t count, primitives mode_) const
     }
     else
     {
-        glDrawElements(mode, count, m_indexbuffer_type, (void*) offset);
+        glDrawElements(mode, count, m_indexbuffer_type, detail::index_offset(offset, m_indexbuffer_type));
+    }
+}
+
+void vertexarray::draw_instanced(size_t instances, primitives mode_) const
+{
+    bind();
+
+    GLenum mode = static_cast<GLenum>(mode_);
+
+    if(m_indexbuffer_size == 0)
+    {
+        glDrawArraysInstanced(mode, 0, m_vertexbuffer_size, instances);
+    }
+    else
+    {
+        glDrawElementsInstanced(mode, m_indexbuffer_size, m_indexbuffer_type, nullptr, instances);
+    }
+}
+
+void vertexarray::draw_instanced(size_t offset, size_t count, size_t instances, primitives mode_) const
+{
+    bind();
+
+    GLenum mode = static_cast<GLenum>(mode_);
+
+    if(m_indexbuffer_size == 0)
+    {
+        glDrawArraysInstanced(mode, offset, count, instances);
+    }
+    else
+    {
+        glDrawElementsInstanced(mode, count, m_indexbuffer_type, detail::index_offset(offset, m_indexbuffer_type), instances);
     }
 }
 
@@ -74,10 +74,14 @@ public:
     void update(const handle<indexbuffer<T>>& indexBuffer);
 
 
+    /* offset and count in vertices, or in indices if an index buffer is attached */
     void draw(primitives mode) const;
     void draw(size_t count, primitives mode) const;
     void draw(size_t offset, size_t count, primitives mode) const;
 
+    void draw_instanced(size_t instances, primitives mode) const;
+    void draw_instanced(size_t offset, size_t count, size_t instances, primitives mode) const;
+
 private:
     vertexarray(context& context);
 
@@ -22,6 +22,11 @@ void camera_control::ignore(bool val)
     m_ignore = val;
 }
 
+bool camera_control::active() const
+{
+    return false;
+}
+
 camera& camera_control::cam()
 {
     return m_cam;
@@ -84,6 +89,11 @@ void orbit_control::update(const glm::vec2& diff, float zoom)
     cam.position(cam.look_at() + coord);
 }
 
+bool orbit_control::active() const
+{
+    return m_button_pressed;
+}
+
 void orbit_control::receive(const msg::mouse_button& msg)
 {
     if(m_ignore) { return; }
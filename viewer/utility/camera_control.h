@@ -25,6 +25,9 @@ public:
     virtual void update(double dt) = 0;
     void ignore(bool val);
 
+    /* user is currently manipulating the camera */
+    virtual bool active() const;
+
     util::camera& cam();
     core::window& window();
     core::mouse& mouse();
@@ -45,6 +48,8 @@ public:
     void update(double dt) override;
     void update(const glm::vec2& diff, float zoom);
 
+    bool active() const override;
+
     void receive(const msg::mouse_button&);
     void receive(const msg::mouse_position&);
     void receive(const msg::mouse_scroll&);
@@ -80,6 +80,11 @@ util::camera& viewer::camera()
     return m_camera;
 }
 
+util::camera_control& viewer::controls()
+{
+    return *m_controls;
+}
+
 
 const core::frameclock& viewer::frameclock() const
 {
@@ -54,6 +54,7 @@ public:
     opengl::context& context();
     core::msg_bus& msg_bus();
     util::camera& camera();
+    util::camera_control& controls();
     const core::frameclock& frameclock() const;
 
     /* install callbacks */